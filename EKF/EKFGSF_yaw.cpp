@@ -52,9 +52,8 @@ void EKFGSF_yaw::update(const imuSample& imu_sample,
 
 	// AHRS prediction cycle for each model - this always runs
 	_ahrs_accel_fusion_gain = ahrsCalcAccelGain();
-	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index ++) {
-		predictEKF(model_index);
-	}
+	ahrsPredict();
+	predictEKF();
 
 	// The 3-state EKF models only run when flying to avoid corrupted estimates due to operator handling and GPS interference
 	if (_run_ekf_gsf && _vel_data_updated) {
@@ -63,18 +62,15 @@ void EKFGSF_yaw::update(const imuSample& imu_sample,
 			ahrsAlignYaw();
 			// Initialise to gyro bias estimate from main filter because there could be a large
 			// uncorrected rate gyro bias error about the gravity vector
-			for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index ++) {
-				_ahrs_ekf_gsf[model_index].gyro_bias = imu_gyro_bias;
+			for (uint8_t i = 0; i < 3; i++) {
+				for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index ++) {
+					_ahrs_ekf_gsf.gyro_bias[i][model_index] = imu_gyro_bias(i);
+				}
 			}
 			_ekf_gsf_vel_fuse_started = true;
 		} else {
-			bool bad_update = false;
-			for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index ++) {
-				// subsequent measurements are fused as direct state observations
-				if (!updateEKF(model_index)) {
-					bad_update = true;
-				}
-			}
+			// subsequent measurements are fused as direct state observations
+			const bool bad_update = !updateEKF();
 
 			if (!bad_update) {
 				float total_weight = 0.0f;
@@ -126,66 +122,110 @@ void EKFGSF_yaw::update(const imuSample& imu_sample,
 	// equal to the weighting value before it is summed.
 	Vector2f yaw_vector;
 	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index ++) {
-		yaw_vector(0) += _model_weights(model_index) * cosf(_ekf_gsf[model_index].X(2));
-		yaw_vector(1) += _model_weights(model_index) * sinf(_ekf_gsf[model_index].X(2));
+		float sin_yaw;
+		float cos_yaw;
+		hotpath::sincosf(_ekf_gsf.X[2][model_index], sin_yaw, cos_yaw);
+		yaw_vector(0) += _model_weights(model_index) * cos_yaw;
+		yaw_vector(1) += _model_weights(model_index) * sin_yaw;
 	}
-	_gsf_yaw = atan2f(yaw_vector(1),yaw_vector(0));
+	_gsf_yaw = hotpath::atan2f(yaw_vector(1),yaw_vector(0));
 
 	// calculate a composite variance for the yaw state from a weighted average of the variance for each model
 	// models with larger innovations are weighted less
 	_gsf_yaw_variance = 0.0f;
 	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index ++) {
-		const float yaw_delta = wrap_pi(_ekf_gsf[model_index].X(2) - _gsf_yaw);
-		_gsf_yaw_variance += _model_weights(model_index) * (_ekf_gsf[model_index].P(2,2) + yaw_delta * yaw_delta);
+		const float yaw_delta = wrap_pi(_ekf_gsf.X[2][model_index] - _gsf_yaw);
+		_gsf_yaw_variance += _model_weights(model_index) * (_ekf_gsf.P[5][model_index] + yaw_delta * yaw_delta);
 	}
 
 	// prevent the same velocity data being used more than once
 	_vel_data_updated = false;
 }
 
-void EKFGSF_yaw::ahrsPredict(const uint8_t model_index)
+void EKFGSF_yaw::ahrsPredict()
 {
-	// generate attitude solution using simple complementary filter for the selected model
+	// generate attitude solution using simple complementary filter for all models
 
-	const Vector3f ang_rate = _delta_ang / fmaxf(_delta_ang_dt, 0.001f) - _ahrs_ekf_gsf[model_index].gyro_bias;
+	const Vector3f ang_rate_uncorrected = _delta_ang / fmaxf(_delta_ang_dt, 0.001f);
+	const bool accel_correction_enabled = _ahrs_accel_fusion_gain > 0.0f;
+	const bool centripetal_accel_compensation_enabled = _true_airspeed > FLT_EPSILON;
+	const float accel_norm_inv = accel_correction_enabled ? 1.0f / _ahrs_accel_norm : 0.0f;
+	const float gyro_bias_gain = _gyro_bias_gain * _delta_ang_dt;
+	constexpr float gyro_bias_limit = 0.05f;
 
-	const Dcmf R_to_body = _ahrs_ekf_gsf[model_index].R.transpose();
-	const Vector3f gravity_direction_bf = R_to_body.col(2);
+	float (&R)[3][3][N_MODELS_EKFGSF] = _ahrs_ekf_gsf.R;
+	float (&gyro_bias)[3][N_MODELS_EKFGSF] = _ahrs_ekf_gsf.gyro_bias;
 
-	// Perform angular rate correction using accel data and reduce correction as accel magnitude moves away from 1 g (reduces drift when vehicle picked up and moved).
-	// During fixed wing flight, compensate for centripetal acceleration assuming coordinated turns and X axis forward
-	Vector3f tilt_correction;
-	if (_ahrs_accel_fusion_gain > 0.0f) {
+	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
+		const float ang_rate_x = ang_rate_uncorrected(0) - gyro_bias[0][model_index];
+		const float ang_rate_y = ang_rate_uncorrected(1) - gyro_bias[1][model_index];
+		const float ang_rate_z = ang_rate_uncorrected(2) - gyro_bias[2][model_index];
+
+		// Perform angular rate correction using accel data and reduce correction as accel magnitude moves away from 1 g (reduces drift when vehicle picked up and moved).
+		// During fixed wing flight, compensate for centripetal acceleration assuming coordinated turns and X axis forward
+		float tilt_correction_x = 0.0f;
+		float tilt_correction_y = 0.0f;
+		float tilt_correction_z = 0.0f;
+
+		if (accel_correction_enabled) {
+			float accel_y = _ahrs_accel(1);
+			float accel_z = _ahrs_accel(2);
+
+			if (centripetal_accel_compensation_enabled) {
+				// Calculate body frame centripetal acceleration with assumption X axis is aligned with the airspeed vector
+				// Use cross product of body rate and body frame airspeed vector
+				accel_y -= _true_airspeed * ang_rate_z;
+				accel_z += _true_airspeed * ang_rate_y;
+			}
 
-		Vector3f accel = _ahrs_accel;
+			// gravity direction in body frame is the last row of the body to earth rotation matrix
+			const float gravity_x = R[2][0][model_index];
+			const float gravity_y = R[2][1][model_index];
+			const float gravity_z = R[2][2][model_index];
+			tilt_correction_x = (gravity_y * accel_z - gravity_z * accel_y) * _ahrs_accel_fusion_gain * accel_norm_inv;
+			tilt_correction_y = (gravity_z * _ahrs_accel(0) - gravity_x * accel_z) * _ahrs_accel_fusion_gain * accel_norm_inv;
+			tilt_correction_z = (gravity_x * accel_y - gravity_y * _ahrs_accel(0)) * _ahrs_accel_fusion_gain * accel_norm_inv;
+		}
 
-		if (_true_airspeed > FLT_EPSILON) {
-			// Calculate body frame centripetal acceleration with assumption X axis is aligned with the airspeed vector
-			// Use cross product of body rate and body frame airspeed vector
-			const Vector3f centripetal_accel_bf = Vector3f(0.0f, _true_airspeed * ang_rate(2), - _true_airspeed * ang_rate(1));
+		// Gyro bias estimation
+		const float spin_rate = sqrtf(ang_rate_x * ang_rate_x + ang_rate_y * ang_rate_y + ang_rate_z * ang_rate_z);
 
-			// correct measured accel for centripetal acceleration
-			accel -= centripetal_accel_bf;
+		if (spin_rate < 0.175f) {
+			gyro_bias[0][model_index] = math::constrain(gyro_bias[0][model_index] - tilt_correction_x * gyro_bias_gain, -gyro_bias_limit, gyro_bias_limit);
+			gyro_bias[1][model_index] = math::constrain(gyro_bias[1][model_index] - tilt_correction_y * gyro_bias_gain, -gyro_bias_limit, gyro_bias_limit);
+			gyro_bias[2][model_index] = math::constrain(gyro_bias[2][model_index] - tilt_correction_z * gyro_bias_gain, -gyro_bias_limit, gyro_bias_limit);
 		}
 
-		tilt_correction = (gravity_direction_bf % accel) * _ahrs_accel_fusion_gain / _ahrs_accel_norm;
-
-	}
+		// delta angle from previous to current frame
+		const float g0 = _delta_ang(0) + (tilt_correction_x - gyro_bias[0][model_index]) * _delta_ang_dt;
+		const float g1 = _delta_ang(1) + (tilt_correction_y - gyro_bias[1][model_index]) * _delta_ang_dt;
+		const float g2 = _delta_ang(2) + (tilt_correction_z - gyro_bias[2][model_index]) * _delta_ang_dt;
+
+		// Efficient propagation of the delta angle in body frame applied to the body to earth frame rotation matrix
+		for (uint8_t r = 0; r < 3; r++) {
+			const float R0 = R[r][0][model_index];
+			const float R1 = R[r][1][model_index];
+			const float R2 = R[r][2][model_index];
+			float row0 = R0 + (R1 * g2 - R2 * g1);
+			float row1 = R1 + (R2 * g0 - R0 * g2);
+			float row2 = R2 + (R0 * g1 - R1 * g0);
+
+			// Renormalise rows
+			const float rowLengthSq = row0 * row0 + row1 * row1 + row2 * row2;
+
+			if (rowLengthSq > FLT_EPSILON) {
+				// Use linear approximation for inverse sqrt taking advantage of the row length being close to 1.0
+				const float rowLengthInv = 1.5f - 0.5f * rowLengthSq;
+				row0 *= rowLengthInv;
+				row1 *= rowLengthInv;
+				row2 *= rowLengthInv;
+			}
 
-	// Gyro bias estimation
-	constexpr float gyro_bias_limit = 0.05f;
-	const float spinRate = ang_rate.length();
-	if (spinRate < 0.175f) {
-		_ahrs_ekf_gsf[model_index].gyro_bias -= tilt_correction * (_gyro_bias_gain * _delta_ang_dt);
-		_ahrs_ekf_gsf[model_index].gyro_bias = matrix::constrain(_ahrs_ekf_gsf[model_index].gyro_bias, -gyro_bias_limit, gyro_bias_limit);
+			R[r][0][model_index] = row0;
+			R[r][1][model_index] = row1;
+			R[r][2][model_index] = row2;
+		}
 	}
-
-	// delta angle from previous to current frame
-	const Vector3f delta_angle_corrected = _delta_ang + (tilt_correction - _ahrs_ekf_gsf[model_index].gyro_bias) * _delta_ang_dt;
-
-	// Apply delta angle to rotation matrix
-	_ahrs_ekf_gsf[model_index].R = ahrsPredictRotMat(_ahrs_ekf_gsf[model_index].R, delta_angle_corrected);
-
 }
 
 void EKFGSF_yaw::ahrsAlignTilt()
@@ -216,7 +256,7 @@ void EKFGSF_yaw::ahrsAlignTilt()
 	R.setRow(2, down_in_bf);
 
 	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
-		_ahrs_ekf_gsf[model_index].R = R;
+		setAhrsRotMat(model_index, R);
 	}
 }
 
@@ -224,255 +264,310 @@ void EKFGSF_yaw::ahrsAlignYaw()
 {
 	// Align yaw angle for each model
 	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
-		if (fabsf(_ahrs_ekf_gsf[model_index].R(2, 0)) < fabsf(_ahrs_ekf_gsf[model_index].R(2, 1))) {
+		const Dcmf R = getAhrsRotMat(model_index);
+
+		if (fabsf(R(2, 0)) < fabsf(R(2, 1))) {
 			// get the roll, pitch, yaw estimates from the rotation matrix using a  321 Tait-Bryan rotation sequence
-			Eulerf euler_init(_ahrs_ekf_gsf[model_index].R);
+			Eulerf euler_init(R);
 
 			// set the yaw angle
-			euler_init(2) = wrap_pi(_ekf_gsf[model_index].X(2));
+			euler_init(2) = wrap_pi(_ekf_gsf.X[2][model_index]);
 
 			// update the rotation matrix
-			_ahrs_ekf_gsf[model_index].R = Dcmf(euler_init);
+			setAhrsRotMat(model_index, Dcmf(euler_init));
 
 		} else {
 			// Calculate the 312 Tait-Bryan rotation sequence that rotates from earth to body frame
 			Vector3f rot312;
-			rot312(0) = wrap_pi(_ekf_gsf[model_index].X(2)); // first rotation (yaw) taken from EKF model state
-			rot312(1) = asinf(_ahrs_ekf_gsf[model_index].R(2, 1)); // second rotation (roll)
-			rot312(2) = atan2f(-_ahrs_ekf_gsf[model_index].R(2, 0), _ahrs_ekf_gsf[model_index].R(2, 2));  // third rotation (pitch)
+			rot312(0) = wrap_pi(_ekf_gsf.X[2][model_index]); // first rotation (yaw) taken from EKF model state
+			rot312(1) = asinf(R(2, 1)); // second rotation (roll)
+			rot312(2) = atan2f(-R(2, 0), R(2, 2));  // third rotation (pitch)
 
 			// Calculate the body to earth frame rotation matrix
-			_ahrs_ekf_gsf[model_index].R = taitBryan312ToRotMat(rot312);
+			setAhrsRotMat(model_index, taitBryan312ToRotMat(rot312));
 
 		}
-		_ahrs_ekf_gsf[model_index].aligned = true;
 	}
 }
 
-void EKFGSF_yaw::predictEKF(const uint8_t model_index)
+Dcmf EKFGSF_yaw::getAhrsRotMat(const uint8_t model_index) const
 {
-	// generate an attitude reference using IMU data
-	ahrsPredict(model_index);
+	Dcmf R;
 
-	// we don't start running the EKF part of the algorithm until there are regular velocity observations
-	if (!_ekf_gsf_vel_fuse_started) {
-		return;
+	for (uint8_t row = 0; row < 3; row++) {
+		for (uint8_t col = 0; col < 3; col++) {
+			R(row, col) = _ahrs_ekf_gsf.R[row][col][model_index];
+		}
 	}
 
-	// Calculate the yaw state using a projection onto the horizontal that avoids gimbal lock
-	if (fabsf(_ahrs_ekf_gsf[model_index].R(2, 0)) < fabsf(_ahrs_ekf_gsf[model_index].R(2, 1))) {
-		// use 321 Tait-Bryan rotation to define yaw state
-		_ekf_gsf[model_index].X(2) = atan2f(_ahrs_ekf_gsf[model_index].R(1, 0), _ahrs_ekf_gsf[model_index].R(0, 0));
-	} else {
-		// use 312 Tait-Bryan rotation to define yaw state
-		_ekf_gsf[model_index].X(2) = atan2f(-_ahrs_ekf_gsf[model_index].R(0, 1), _ahrs_ekf_gsf[model_index].R(1, 1)); // first rotation (yaw)
+	return R;
+}
+
+void EKFGSF_yaw::setAhrsRotMat(const uint8_t model_index, const Dcmf &R)
+{
+	for (uint8_t row = 0; row < 3; row++) {
+		for (uint8_t col = 0; col < 3; col++) {
+			_ahrs_ekf_gsf.R[row][col][model_index] = R(row, col);
+		}
 	}
+}
 
-	// calculate delta velocity in a horizontal front-right frame
-	const Vector3f del_vel_NED = _ahrs_ekf_gsf[model_index].R * _delta_vel;
-	const float dvx =   del_vel_NED(0) * cosf(_ekf_gsf[model_index].X(2)) + del_vel_NED(1) * sinf(_ekf_gsf[model_index].X(2));
-	const float dvy = - del_vel_NED(0) * sinf(_ekf_gsf[model_index].X(2)) + del_vel_NED(1) * cosf(_ekf_gsf[model_index].X(2));
-
-	// sum delta velocities in earth frame:
-	_ekf_gsf[model_index].X(0) += del_vel_NED(0);
-	_ekf_gsf[model_index].X(1) += del_vel_NED(1);
-
-	// predict covariance - autocode from https://github.com/priseborough/3_state_filter/blob/flightLogReplay-wip/calcPupdate.txt
-
-	// Local short variable name copies required for readability
-	// Compiler might be smart enough to optimise these out
-	const float &P00 = _ekf_gsf[model_index].P(0,0);
-	const float &P01 = _ekf_gsf[model_index].P(0,1);
-	const float &P02 = _ekf_gsf[model_index].P(0,2);
-	const float &P10 = _ekf_gsf[model_index].P(1,0);
-	const float &P11 = _ekf_gsf[model_index].P(1,1);
-	const float &P12 = _ekf_gsf[model_index].P(1,2);
-	const float &P20 = _ekf_gsf[model_index].P(2,0);
-	const float &P21 = _ekf_gsf[model_index].P(2,1);
-	const float &P22 = _ekf_gsf[model_index].P(2,2);
+void EKFGSF_yaw::predictEKF()
+{
+	// we don't start running the EKF part of the algorithm until there are regular velocity observations
+	if (!_ekf_gsf_vel_fuse_started) {
+		return;
+	}
 
 	// Use fixed values for delta velocity and delta angle process noise variances
 	const float dvxVar = sq(_accel_noise * _delta_vel_dt); // variance of forward delta velocity - (m/s)^2
 	const float dvyVar = dvxVar; // variance of right delta velocity - (m/s)^2
 	const float dazVar = sq(_gyro_noise * _delta_ang_dt); // variance of yaw delta angle - rad^2
+	const float min_var = 1e-6f;
 
-	const float t2 = sinf(_ekf_gsf[model_index].X(2));
-	const float t3 = cosf(_ekf_gsf[model_index].X(2));
-	const float t4 = dvy*t3;
-	const float t5 = dvx*t2;
-	const float t6 = t4+t5;
-	const float t8 = P22*t6;
-	const float t7 = P02-t8;
-	const float t9 = dvx*t3;
-	const float t11 = dvy*t2;
-	const float t10 = t9-t11;
-	const float t12 = dvxVar*t2*t3;
-	const float t13 = t2*t2;
-	const float t14 = t3*t3;
-	const float t15 = P22*t10;
-	const float t16 = P12+t15;
+	const float (&R)[3][3][N_MODELS_EKFGSF] = _ahrs_ekf_gsf.R;
+	float (&X)[3][N_MODELS_EKFGSF] = _ekf_gsf.X;
+	float (&P)[6][N_MODELS_EKFGSF] = _ekf_gsf.P;
 
-	const float min_var = 1e-6f;
-	_ekf_gsf[model_index].P(0,0) = fmaxf(P00-P20*t6+dvxVar*t14+dvyVar*t13-t6*t7 , min_var);
-	_ekf_gsf[model_index].P(0,1) = P01+t12-P21*t6+t7*t10-dvyVar*t2*t3;
-	_ekf_gsf[model_index].P(0,2) = t7;
-	_ekf_gsf[model_index].P(1,0) = P10+t12+P20*t10-t6*t16-dvyVar*t2*t3;
-	_ekf_gsf[model_index].P(1,1) = fmaxf(P11+P21*t10+dvxVar*t13+dvyVar*t14+t10*t16 , min_var);
-	_ekf_gsf[model_index].P(1,2) = t16;
-	_ekf_gsf[model_index].P(2,0) = P20-t8;
-	_ekf_gsf[model_index].P(2,1) = P21+t15;
-	_ekf_gsf[model_index].P(2,2) = fmaxf(P22+dazVar , min_var);
-
-	// force symmetry
-	_ekf_gsf[model_index].P.makeBlockSymmetric<3>(0);
+	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
+		// Calculate the yaw state using a projection onto the horizontal that avoids gimbal lock
+		if (fabsf(R[2][0][model_index]) < fabsf(R[2][1][model_index])) {
+			// use 321 Tait-Bryan rotation to define yaw state
+			X[2][model_index] = hotpath::atan2f(R[1][0][model_index], R[0][0][model_index]);
+		} else {
+			// use 312 Tait-Bryan rotation to define yaw state
+			X[2][model_index] = hotpath::atan2f(-R[0][1][model_index], R[1][1][model_index]); // first rotation (yaw)
+		}
+
+		// calculate delta velocity in a horizontal front-right frame
+		const float del_vel_N = R[0][0][model_index] * _delta_vel(0) + R[0][1][model_index] * _delta_vel(1) + R[0][2][model_index] * _delta_vel(2);
+		const float del_vel_E = R[1][0][model_index] * _delta_vel(0) + R[1][1][model_index] * _delta_vel(1) + R[1][2][model_index] * _delta_vel(2);
+		float t2;
+		float t3;
+		hotpath::sincosf(X[2][model_index], t2, t3);
+		const float dvx =   del_vel_N * t3 + del_vel_E * t2;
+		const float dvy = - del_vel_N * t2 + del_vel_E * t3;
+
+		// sum delta velocities in earth frame:
+		X[0][model_index] += del_vel_N;
+		X[1][model_index] += del_vel_E;
+
+		// predict covariance - autocode from https://github.com/priseborough/3_state_filter/blob/flightLogReplay-wip/calcPupdate.txt
+
+		// Local short variable name copies required for readability
+		const float P00 = P[0][model_index];
+		const float P01 = P[1][model_index];
+		const float P02 = P[2][model_index];
+		const float P10 = P01;
+		const float P11 = P[3][model_index];
+		const float P12 = P[4][model_index];
+		const float P20 = P02;
+		const float P21 = P12;
+		const float P22 = P[5][model_index];
+
+		const float t4 = dvy*t3;
+		const float t5 = dvx*t2;
+		const float t6 = t4+t5;
+		const float t8 = P22*t6;
+		const float t7 = P02-t8;
+		const float t9 = dvx*t3;
+		const float t11 = dvy*t2;
+		const float t10 = t9-t11;
+		const float t12 = dvxVar*t2*t3;
+		const float t13 = t2*t2;
+		const float t14 = t3*t3;
+		const float t15 = P22*t10;
+		const float t16 = P12+t15;
+
+		const float P00_new = fmaxf(P00-P20*t6+dvxVar*t14+dvyVar*t13-t6*t7 , min_var);
+		const float P01_new = P01+t12-P21*t6+t7*t10-dvyVar*t2*t3;
+		const float P02_new = t7;
+		const float P10_new = P10+t12+P20*t10-t6*t16-dvyVar*t2*t3;
+		const float P11_new = fmaxf(P11+P21*t10+dvxVar*t13+dvyVar*t14+t10*t16 , min_var);
+		const float P12_new = t16;
+		const float P20_new = P20-t8;
+		const float P21_new = P21+t15;
+		const float P22_new = fmaxf(P22+dazVar , min_var);
+
+		// force symmetry
+		P[0][model_index] = P00_new;
+		P[1][model_index] = (P10_new + P01_new) / 2.0f;
+		P[2][model_index] = (P20_new + P02_new) / 2.0f;
+		P[3][model_index] = P11_new;
+		P[4][model_index] = (P21_new + P12_new) / 2.0f;
+		P[5][model_index] = P22_new;
+	}
 }
 
-// Update EKF states and covariance for specified model index using velocity measurement
-bool EKFGSF_yaw::updateEKF(const uint8_t model_index)
+// Update EKF states and covariance for all models using velocity measurement
+bool EKFGSF_yaw::updateEKF()
 {
 	// set observation variance from accuracy estimate supplied by GPS and apply a sanity check minimum
 	const float velObsVar = sq(fmaxf(_vel_accuracy, 0.5f));
+	const float min_var = 1e-6f;
+	bool update_ok = true;
 
-	// calculate velocity observation innovations
-	_ekf_gsf[model_index].innov(0) = _ekf_gsf[model_index].X(0) - _vel_NE(0);
-	_ekf_gsf[model_index].innov(1) = _ekf_gsf[model_index].X(1) - _vel_NE(1);
-
-	// Use temporary variables for covariance elements to reduce verbosity of auto-code expressions
-	const float &P00 = _ekf_gsf[model_index].P(0,0);
-	const float &P01 = _ekf_gsf[model_index].P(0,1);
-	const float &P02 = _ekf_gsf[model_index].P(0,2);
-	const float &P10 = _ekf_gsf[model_index].P(1,0);
-	const float &P11 = _ekf_gsf[model_index].P(1,1);
-	const float &P12 = _ekf_gsf[model_index].P(1,2);
-	const float &P20 = _ekf_gsf[model_index].P(2,0);
-	const float &P21 = _ekf_gsf[model_index].P(2,1);
-	const float &P22 = _ekf_gsf[model_index].P(2,2);
-
-	// calculate innovation variance
-	matrix::SquareMatrix<float, 2> S = _ekf_gsf[model_index].P.slice<2, 2>(0, 0);
-	S(0, 0) += velObsVar;
-	S(1, 1) += velObsVar;
-
-	// Update the inverse of the innovation covariance matrix S_inverse
-	updateInnovCovMatInv(model_index, S);
-
-	// Perform a chi-square innovation consistency test and calculate a compression scale factor that limits the magnitude of innovations to 5-sigma
-	float innov_comp_scale_factor = 1.0f;
-
-	// test ratio = transpose(innovation) * inverse(innovation variance) * innovation = [1x2] * [2,2] * [2,1] = [1,1]
-	const float test_ratio = _ekf_gsf[model_index].innov * (_ekf_gsf[model_index].S_inverse * _ekf_gsf[model_index].innov);
-
-	// If the test ratio is greater than 25 (5 Sigma) then reduce the length of the innovation vector to clip it at 5-Sigma
-	// This protects from large measurement spikes
-	if (test_ratio > 25.0f) {
-		innov_comp_scale_factor = sqrtf(25.0f / test_ratio);
-	}
+	float (&R)[3][3][N_MODELS_EKFGSF] = _ahrs_ekf_gsf.R;
+	float (&X)[3][N_MODELS_EKFGSF] = _ekf_gsf.X;
+	float (&P)[6][N_MODELS_EKFGSF] = _ekf_gsf.P;
+	float (&S_inverse)[3][N_MODELS_EKFGSF] = _ekf_gsf.S_inverse;
+	float (&S_det_inverse)[N_MODELS_EKFGSF] = _ekf_gsf.S_det_inverse;
+	float (&innov)[2][N_MODELS_EKFGSF] = _ekf_gsf.innov;
 
-	// calculate Kalman gain K  nd covariance matrix P
-	// autocode from https://github.com/priseborough/3_state_filter/blob/flightLogReplay-wip/calcK.txt
-	// and https://github.com/priseborough/3_state_filter/blob/flightLogReplay-wip/calcPmat.txt
-	const float t2 = P00*velObsVar;
- 	const float t3 = P11*velObsVar;
-	const float t4 = velObsVar*velObsVar;
-	const float t5 = P00*P11;
-	const float t9 = P01*P10;
-	const float t6 = t2+t3+t4+t5-t9;
-	float t7;
-	if (fabsf(t6) > 1e-6f) {
-		t7 = 1.0f/t6;
-	} else {
-		// skip this fusion step
-		return false;
+	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
+		// calculate velocity observation innovations
+		const float innov_N = X[0][model_index] - _vel_NE(0);
+		const float innov_E = X[1][model_index] - _vel_NE(1);
+		innov[0][model_index] = innov_N;
+		innov[1][model_index] = innov_E;
+
+		// Use temporary variables for covariance elements to reduce verbosity of auto-code expressions
+		const float P00 = P[0][model_index];
+		const float P01 = P[1][model_index];
+		const float P02 = P[2][model_index];
+		const float P10 = P01;
+		const float P11 = P[3][model_index];
+		const float P12 = P[4][model_index];
+		const float P20 = P02;
+		const float P21 = P12;
+		const float P22 = P[5][model_index];
+
+		// calculate innovation variance
+		const float S00 = P00 + velObsVar;
+		const float S01 = P01;
+		const float S11 = P11 + velObsVar;
+
+		// Update the inverse of the innovation covariance matrix S_inverse
+		// calculate determinant inverse and protect against badly conditioned matrix
+		const float S_det = S00 * S11 - S01 * S01;
+		S_det_inverse[model_index] = 1.0f / fmaxf(S_det , 1e-12f);
+		S_inverse[0][model_index] =   S_det_inverse[model_index] * S11;
+		S_inverse[1][model_index] = - S_det_inverse[model_index] * S01;
+		S_inverse[2][model_index] =   S_det_inverse[model_index] * S00;
+
+		// Perform a chi-square innovation consistency test and calculate a compression scale factor that limits the magnitude of innovations to 5-sigma
+		float innov_comp_scale_factor = 1.0f;
+
+		// test ratio = transpose(innovation) * inverse(innovation variance) * innovation = [1x2] * [2,2] * [2,1] = [1,1]
+		const float test_ratio = innov_N * (S_inverse[0][model_index] * innov_N + S_inverse[1][model_index] * innov_E)
+					 + innov_E * (S_inverse[1][model_index] * innov_N + S_inverse[2][model_index] * innov_E);
+
+		// If the test ratio is greater than 25 (5 Sigma) then reduce the length of the innovation vector to clip it at 5-Sigma
+		// This protects from large measurement spikes
+		if (test_ratio > 25.0f) {
+			innov_comp_scale_factor = sqrtf(25.0f / test_ratio);
+		}
+
+		// calculate Kalman gain K  nd covariance matrix P
+		// autocode from https://github.com/priseborough/3_state_filter/blob/flightLogReplay-wip/calcK.txt
+		// and https://github.com/priseborough/3_state_filter/blob/flightLogReplay-wip/calcPmat.txt
+		const float t2 = P00*velObsVar;
+		const float t3 = P11*velObsVar;
+		const float t4 = velObsVar*velObsVar;
+		const float t5 = P00*P11;
+		const float t9 = P01*P10;
+		const float t6 = t2+t3+t4+t5-t9;
+
+		if (!(fabsf(t6) > 1e-6f)) {
+			// skip this fusion step
+			update_ok = false;
+			continue;
+		}
+
+		const float t7 = 1.0f/t6;
+		const float t8 = P11+velObsVar;
+		const float t10 = P00+velObsVar;
+
+		const float K00 = -P01*P10*t7+P00*t7*t8;
+		const float K01 = -P00*P01*t7+P01*t7*t10;
+		const float K10 = -P10*P11*t7+P10*t7*t8;
+		const float K11 = -P01*P10*t7+P11*t7*t10;
+		const float K20 = -P10*P21*t7+P20*t7*t8;
+		const float K21 = -P01*P20*t7+P21*t7*t10;
+
+		const float t11 = P00*P01*t7;
+		const float t15 = P01*t7*t10;
+		const float t12 = t11-t15;
+		const float t13 = P01*P10*t7;
+		const float t16 = P00*t7*t8;
+		const float t14 = t13-t16;
+		const float t17 = t8*t12;
+		const float t18 = P01*t14;
+		const float t19 = t17+t18;
+		const float t20 = t10*t14;
+		const float t21 = P10*t12;
+		const float t22 = t20+t21;
+		const float t27 = P11*t7*t10;
+		const float t23 = t13-t27;
+		const float t24 = P10*P11*t7;
+		const float t26 = P10*t7*t8;
+		const float t25 = t24-t26;
+		const float t28 = t8*t23;
+		const float t29 = P01*t25;
+		const float t30 = t28+t29;
+		const float t31 = t10*t25;
+		const float t32 = P10*t23;
+		const float t33 = t31+t32;
+		const float t34 = P01*P20*t7;
+		const float t38 = P21*t7*t10;
+		const float t35 = t34-t38;
+		const float t36 = P10*P21*t7;
+		const float t39 = P20*t7*t8;
+		const float t37 = t36-t39;
+		const float t40 = t8*t35;
+		const float t41 = P01*t37;
+		const float t42 = t40+t41;
+		const float t43 = t10*t37;
+		const float t44 = P10*t35;
+		const float t45 = t43+t44;
+
+		const float P00_new = fmaxf(P00-t12*t19-t14*t22 , min_var);
+		const float P01_new = P01-t19*t23-t22*t25;
+		const float P02_new = P02-t19*t35-t22*t37;
+		const float P10_new = P10-t12*t30-t14*t33;
+		const float P11_new = fmaxf(P11-t23*t30-t25*t33 , min_var);
+		const float P12_new = P12-t30*t35-t33*t37;
+		const float P20_new = P20-t12*t42-t14*t45;
+		const float P21_new = P21-t23*t42-t25*t45;
+		const float P22_new = fmaxf(P22-t35*t42-t37*t45 , min_var);
+
+		// force symmetry
+		P[0][model_index] = P00_new;
+		P[1][model_index] = (P10_new + P01_new) / 2.0f;
+		P[2][model_index] = (P20_new + P02_new) / 2.0f;
+		P[3][model_index] = P11_new;
+		P[4][model_index] = (P21_new + P12_new) / 2.0f;
+		P[5][model_index] = P22_new;
+
+		// Correct the state vector and capture the change in yaw angle
+		const float oldYaw = X[2][model_index];
+
+		X[0][model_index] -= (K00 * innov_N + K01 * innov_E) * innov_comp_scale_factor;
+		X[1][model_index] -= (K10 * innov_N + K11 * innov_E) * innov_comp_scale_factor;
+		X[2][model_index] -= (K20 * innov_N + K21 * innov_E) * innov_comp_scale_factor;
+
+		const float yawDelta = X[2][model_index] - oldYaw;
+
+		// apply the change in yaw angle to the AHRS
+		// take advantage of sparseness in the yaw rotation matrix
+		float sinYaw;
+		float cosYaw;
+		hotpath::sincosf(yawDelta, sinYaw, cosYaw);
+
+		for (uint8_t col = 0; col < 3; col++) {
+			const float R_prev0 = R[0][col][model_index];
+			const float R_prev1 = R[1][col][model_index];
+			R[0][col][model_index] = R_prev0 * cosYaw - R_prev1 * sinYaw;
+			R[1][col][model_index] = R_prev0 * sinYaw + R_prev1 * cosYaw;
+		}
 	}
-	const float t8 = P11+velObsVar;
-	const float t10 = P00+velObsVar;
-
-	matrix::Matrix<float, 3, 2> K;
- 	K(0,0) = -P01*P10*t7+P00*t7*t8;
-	K(0,1) = -P00*P01*t7+P01*t7*t10;
-	K(1,0) = -P10*P11*t7+P10*t7*t8;
-	K(1,1) = -P01*P10*t7+P11*t7*t10;
-	K(2,0) = -P10*P21*t7+P20*t7*t8;
-	K(2,1) = -P01*P20*t7+P21*t7*t10;
-
-	const float t11 = P00*P01*t7;
-	const float t15 = P01*t7*t10;
-	const float t12 = t11-t15;
-	const float t13 = P01*P10*t7;
-	const float t16 = P00*t7*t8;
-	const float t14 = t13-t16;
-	const float t17 = t8*t12;
-	const float t18 = P01*t14;
-	const float t19 = t17+t18;
-	const float t20 = t10*t14;
-	const float t21 = P10*t12;
-	const float t22 = t20+t21;
-	const float t27 = P11*t7*t10;
-	const float t23 = t13-t27;
-	const float t24 = P10*P11*t7;
-	const float t26 = P10*t7*t8;
-	const float t25 = t24-t26;
-	const float t28 = t8*t23;
-	const float t29 = P01*t25;
-	const float t30 = t28+t29;
-	const float t31 = t10*t25;
-	const float t32 = P10*t23;
-	const float t33 = t31+t32;
-	const float t34 = P01*P20*t7;
-	const float t38 = P21*t7*t10;
-	const float t35 = t34-t38;
-	const float t36 = P10*P21*t7;
-	const float t39 = P20*t7*t8;
-	const float t37 = t36-t39;
-	const float t40 = t8*t35;
-	const float t41 = P01*t37;
-	const float t42 = t40+t41;
-	const float t43 = t10*t37;
-	const float t44 = P10*t35;
-	const float t45 = t43+t44;
 
-	const float min_var = 1e-6f;
-	_ekf_gsf[model_index].P(0,0) = fmaxf(P00-t12*t19-t14*t22 , min_var);
-	_ekf_gsf[model_index].P(0,1) = P01-t19*t23-t22*t25;
-	_ekf_gsf[model_index].P(0,2) = P02-t19*t35-t22*t37;
-	_ekf_gsf[model_index].P(1,0) = P10-t12*t30-t14*t33;
-	_ekf_gsf[model_index].P(1,1) = fmaxf(P11-t23*t30-t25*t33 , min_var);
-	_ekf_gsf[model_index].P(1,2) = P12-t30*t35-t33*t37;
-	_ekf_gsf[model_index].P(2,0) = P20-t12*t42-t14*t45;
-	_ekf_gsf[model_index].P(2,1) = P21-t23*t42-t25*t45;
-	_ekf_gsf[model_index].P(2,2) = fmaxf(P22-t35*t42-t37*t45 , min_var);
-
-	// force symmetry
-	_ekf_gsf[model_index].P.makeBlockSymmetric<3>(0);
-
-	// Correct the state vector and capture the change in yaw angle
-	const float oldYaw = _ekf_gsf[model_index].X(2);
-
-	_ekf_gsf[model_index].X -= (K * _ekf_gsf[model_index].innov) * innov_comp_scale_factor;
-
-	const float yawDelta = _ekf_gsf[model_index].X(2) - oldYaw;
-
-	// apply the change in yaw angle to the AHRS
-	// take advantage of sparseness in the yaw rotation matrix
-	const float cosYaw = cosf(yawDelta);
-	const float sinYaw = sinf(yawDelta);
-	const float R_prev00 = _ahrs_ekf_gsf[model_index].R(0, 0);
-	const float R_prev01 = _ahrs_ekf_gsf[model_index].R(0, 1);
-	const float R_prev02 = _ahrs_ekf_gsf[model_index].R(0, 2);
-
-	_ahrs_ekf_gsf[model_index].R(0, 0) = R_prev00 * cosYaw - _ahrs_ekf_gsf[model_index].R(1, 0) * sinYaw;
-	_ahrs_ekf_gsf[model_index].R(0, 1) = R_prev01 * cosYaw - _ahrs_ekf_gsf[model_index].R(1, 1) * sinYaw;
-	_ahrs_ekf_gsf[model_index].R(0, 2) = R_prev02 * cosYaw - _ahrs_ekf_gsf[model_index].R(1, 2) * sinYaw;
-	_ahrs_ekf_gsf[model_index].R(1, 0) = R_prev00 * sinYaw + _ahrs_ekf_gsf[model_index].R(1, 0) * cosYaw;
-	_ahrs_ekf_gsf[model_index].R(1, 1) = R_prev01 * sinYaw + _ahrs_ekf_gsf[model_index].R(1, 1) * cosYaw;
-	_ahrs_ekf_gsf[model_index].R(1, 2) = R_prev02 * sinYaw + _ahrs_ekf_gsf[model_index].R(1, 2) * cosYaw;
-
-	return true;
+	return update_ok;
 }
 
-void EKFGSF_yaw::initialiseEKFGSF()
+void EKFGSF_yaw::initialiseEKFGSF(float yaw_centre)
 {
-	_gsf_yaw = 0.0f;
+	_gsf_yaw = yaw_centre;
 	_ekf_gsf_vel_fuse_started = false;
 	_gsf_yaw_variance = _m_pi2 * _m_pi2;
 	_model_weights.setAll(1.0f / (float)N_MODELS_EKFGSF);  // All filter models start with the same weight
@@ -481,43 +576,28 @@ void EKFGSF_yaw::initialiseEKFGSF()
 	const float yaw_increment = 2.0f * _m_pi / (float)N_MODELS_EKFGSF;
 	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
 		// evenly space initial yaw estimates in the region between +-Pi
-		_ekf_gsf[model_index].X(2) = -_m_pi + (0.5f * yaw_increment) + ((float)model_index * yaw_increment);
+		_ekf_gsf.X[2][model_index] = wrap_pi(yaw_centre + (-_m_pi + (0.5f * yaw_increment) + ((float)model_index * yaw_increment)));
 
 		// take velocity states and corresponding variance from last measurement
-		_ekf_gsf[model_index].X(0) = _vel_NE(0);
-		_ekf_gsf[model_index].X(1) = _vel_NE(1);
-		_ekf_gsf[model_index].P(0,0) = sq(_vel_accuracy);
-		_ekf_gsf[model_index].P(1,1) = _ekf_gsf[model_index].P(0,0);
+		_ekf_gsf.X[0][model_index] = _vel_NE(0);
+		_ekf_gsf.X[1][model_index] = _vel_NE(1);
+		_ekf_gsf.P[0][model_index] = sq(_vel_accuracy);
+		_ekf_gsf.P[3][model_index] = _ekf_gsf.P[0][model_index];
 
 		// use half yaw interval for yaw uncertainty
-		_ekf_gsf[model_index].P(2,2) = sq(0.5f * yaw_increment);
+		_ekf_gsf.P[5][model_index] = sq(0.5f * yaw_increment);
 	}
 }
 
 float EKFGSF_yaw::gaussianDensity(const uint8_t model_index) const
 {
 	// calculate transpose(innovation) * inv(S) * innovation
-	const float normDist = _ekf_gsf[model_index].innov.dot(_ekf_gsf[model_index].S_inverse * _ekf_gsf[model_index].innov);
-
-	return _m_2pi_inv * sqrtf(_ekf_gsf[model_index].S_det_inverse) * expf(-0.5f * normDist);
-}
-
-void EKFGSF_yaw::updateInnovCovMatInv(const uint8_t model_index, const matrix::SquareMatrix<float, 2> &S)
-{
-	// calculate determinant for innovation covariance matrix
-	const float t2 = S(0,0) * S(1,1);
-	const float t5 = S(0,1) * S(1,0);
-	const float t3 = t2 - t5;
-
-	// calculate determinant inverse and protect against badly conditioned matrix
-	_ekf_gsf[model_index].S_det_inverse = 1.0f / fmaxf(t3 , 1e-12f);
-
-	// calculate inv(S)
-	_ekf_gsf[model_index].S_inverse(0,0) =   _ekf_gsf[model_index].S_det_inverse * S(1,1);
-	_ekf_gsf[model_index].S_inverse(1,1) =   _ekf_gsf[model_index].S_det_inverse * S(0,0);
-	_ekf_gsf[model_index].S_inverse(0,1) = - _ekf_gsf[model_index].S_det_inverse * S(0,1);
-	_ekf_gsf[model_index].S_inverse(1,0) = - _ekf_gsf[model_index].S_det_inverse * S(1,0);
+	const float innov_N = _ekf_gsf.innov[0][model_index];
+	const float innov_E = _ekf_gsf.innov[1][model_index];
+	const float normDist = innov_N * (_ekf_gsf.S_inverse[0][model_index] * innov_N + _ekf_gsf.S_inverse[1][model_index] * innov_E)
+			       + innov_E * (_ekf_gsf.S_inverse[1][model_index] * innov_N + _ekf_gsf.S_inverse[2][model_index] * innov_E);
 
+	return _m_2pi_inv * sqrtf(_ekf_gsf.S_det_inverse[model_index]) * hotpath::expf(-0.5f * normDist);
 }
 
 bool EKFGSF_yaw::getLogData(float *yaw_composite, float *yaw_variance, float yaw[N_MODELS_EKFGSF], float innov_VN[N_MODELS_EKFGSF], float innov_VE[N_MODELS_EKFGSF], float weight[N_MODELS_EKFGSF])
@@ -526,9 +606,9 @@ bool EKFGSF_yaw::getLogData(float *yaw_composite, float *yaw_variance, float yaw
 		*yaw_composite = _gsf_yaw;
 		*yaw_variance = _gsf_yaw_variance;
 		for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
-			yaw[model_index] = _ekf_gsf[model_index].X(2);
-			innov_VN[model_index] = _ekf_gsf[model_index].innov(0);
-			innov_VE[model_index] = _ekf_gsf[model_index].innov(1);
+			yaw[model_index] = _ekf_gsf.X[2][model_index];
+			innov_VN[model_index] = _ekf_gsf.innov[0][model_index];
+			innov_VE[model_index] = _ekf_gsf.innov[1][model_index];
 			weight[model_index] = _model_weights(model_index);
 		}
 		return true;
@@ -556,32 +636,39 @@ float EKFGSF_yaw::ahrsCalcAccelGain() const
 	return _tilt_gain * sq(1.f - math::min(attenuation * fabsf(delta_accel_g), 1.f));
 }
 
-Matrix3f EKFGSF_yaw::ahrsPredictRotMat(const Matrix3f &R, const Vector3f &g)
+void EKFGSF_yaw::reset(const Quatf &quat, const Vector2f &velocity, float accuracy, const Vector3f &imu_gyro_bias)
 {
-	Matrix3f ret = R;
-	ret(0,0) += R(0,1) * g(2) - R(0,2) * g(1);
-	ret(0,1) += R(0,2) * g(0) - R(0,0) * g(2);
-	ret(0,2) += R(0,0) * g(1) - R(0,1) * g(0);
-	ret(1,0) += R(1,1) * g(2) - R(1,2) * g(1);
-	ret(1,1) += R(1,2) * g(0) - R(1,0) * g(2);
-	ret(1,2) += R(1,0) * g(1) - R(1,1) * g(0);
-	ret(2,0) += R(2,1) * g(2) - R(2,2) * g(1);
-	ret(2,1) += R(2,2) * g(0) - R(2,0) * g(2);
-	ret(2,2) += R(2,0) * g(1) - R(2,1) * g(0);
-
-	// Renormalise rows
-	for (uint8_t r = 0; r < 3; r++) {
-		const float rowLengthSq = ret.row(r).norm_squared();
-		if (rowLengthSq > FLT_EPSILON) {
-			// Use linear approximation for inverse sqrt taking advantage of the row length being close to 1.0
-			const float rowLengthInv = 1.5f - 0.5f * rowLengthSq;
-			ret(r,0) *= rowLengthInv;
-			ret(r,1) *= rowLengthInv;
-			ret(r,2) *= rowLengthInv;
+	const Dcmf R(quat);
+
+	_vel_NE = velocity;
+	_vel_accuracy = accuracy;
+	_vel_data_updated = false;
+
+	// the specific force filter has not been updated while the estimator was stopped
+	_ahrs_accel = R.transpose() * Vector3f(0.0f, 0.0f, -CONSTANTS_ONE_G);
+
+	// use the same yaw definition as the EKF models
+	float yaw;
+
+	if (fabsf(R(2, 0)) < fabsf(R(2, 1))) {
+		yaw = atan2f(R(1, 0), R(0, 0));
+	} else {
+		yaw = atan2f(-R(0, 1), R(1, 1));
+	}
+
+	initialiseEKFGSF(yaw);
+
+	for (uint8_t model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
+		setAhrsRotMat(model_index, R);
+
+		for (uint8_t i = 0; i < 3; i++) {
+			_ahrs_ekf_gsf.gyro_bias[i][model_index] = imu_gyro_bias(i);
 		}
-        }
+	}
 
-	return ret;
+	ahrsAlignYaw();
+	_ahrs_ekf_gsf_tilt_aligned = true;
+	_ekf_gsf_vel_fuse_started = true;
 }
 
 bool EKFGSF_yaw::getYawData(float *yaw, float *yaw_variance)
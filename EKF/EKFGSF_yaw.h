@@ -5,6 +5,7 @@
 #include <mathlib/mathlib.h>
 
 #include "common.h"
+#include "fast_math.hpp"
 #include "utils.hpp"
 
 using matrix::AxisAnglef;
@@ -16,7 +17,12 @@ using matrix::Vector2f;
 using matrix::Vector3f;
 using matrix::wrap_pi;
 
-static constexpr uint8_t N_MODELS_EKFGSF = 5;
+// number of models in the bank, set by the ECL_EKFGSF_N_MODELS build option
+#ifndef ECL_EKFGSF_N_MODELS
+#define ECL_EKFGSF_N_MODELS 5
+#endif
+static constexpr uint8_t N_MODELS_EKFGSF = ECL_EKFGSF_N_MODELS;
+static_assert(N_MODELS_EKFGSF >= 2, "the EKF-GSF needs at least two models");
 
 // Required math constants
 static constexpr float _m_2pi_inv = 0.159154943f;
@@ -47,18 +53,54 @@ public:
 			float innov_VE[N_MODELS_EKFGSF],
 			float weight[N_MODELS_EKFGSF]);
 
+	// restart all models from an external attitude and velocity estimate, with the model yaws spread
+	// evenly around its yaw, used when the estimator has not been updated for a while
+	void reset(const Quatf &quat,			// body to earth frame rotation
+		   const Vector2f &velocity,		// NE velocity (m/s)
+		   float accuracy,			// 1-sigma accuracy of velocity (m/s)
+		   const Vector3f &imu_gyro_bias);	// estimated rate gyro bias (rad/sec)
+
     	// get yaw estimate and the corresponding variance
     	// return false if no yaw estimate available
     	bool getYawData(float *yaw, float *yaw_variance);
 
+	// save or restore the filter state, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar)
+	{
+		ar.io(_delta_ang);
+		ar.io(_delta_vel);
+		ar.io(_delta_ang_dt);
+		ar.io(_delta_vel_dt);
+		ar.io(_true_airspeed);
+		ar.io(_ahrs_ekf_gsf);
+		ar.io(_ahrs_ekf_gsf_tilt_aligned);
+		ar.io(_ahrs_accel_fusion_gain);
+		ar.io(_ahrs_accel);
+		ar.io(_ahrs_accel_norm);
+		ar.io(_ekf_gsf);
+		ar.io(_vel_data_updated);
+		ar.io(_run_ekf_gsf);
+		ar.io(_vel_NE);
+		ar.io(_vel_accuracy);
+		ar.io(_ekf_gsf_vel_fuse_started);
+		ar.io(_model_weights);
+		ar.io(_gsf_yaw);
+		ar.io(_gsf_yaw_variance);
+	}
+
 private:
 
 	// Parameters - these could be made tuneable
-	const float _gyro_noise{1.0e-1f}; 	// yaw rate noise used for covariance prediction (rad/sec)
-	const float _accel_noise{2.0f};		// horizontal accel noise used for covariance prediction (m/sec**2)
-	const float _tilt_gain{0.2f};		// gain from tilt error to gyro correction for complementary filter (1/sec)
-	const float _gyro_bias_gain{0.04f};	// gain applied to integral of gyro correction for complementary filter (1/sec)
-	const float _weight_min{0.0f};		// minimum value of an individual model weighting
+	float _gyro_noise{1.0e-1f}; 	// yaw rate noise used for covariance prediction (rad/sec)
+	float _accel_noise{2.0f};		// horizontal accel noise used for covariance prediction (m/sec**2)
+	float _tilt_gain{0.2f};		// gain from tilt error to gyro correction for complementary filter (1/sec)
+	float _gyro_bias_gain{0.04f};	// gain applied to integral of gyro correction for complementary filter (1/sec)
+	float _weight_min{0.0f};		// minimum value of an individual model weighting
+
+	// The AHRS and EKF banks are stored as structures of arrays with the model index as the innermost
+	// dimension, so that each processing step runs all models in a single loop over contiguous data
+	// which the compiler can vectorise.
 
 	// Declarations used by the bank of N_MODELS_EKFGSF AHRS complementary filters
 
@@ -69,13 +111,9 @@ private:
 	float _true_airspeed{};	// true airspeed used for centripetal accel compensation (m/s)
 
 	struct _ahrs_ekf_gsf_struct{
-		Dcmf R;			// matrix that rotates a vector from body to earth frame
-		Vector3f gyro_bias;	// gyro bias learned and used by the quaternion calculation
-		bool aligned;		// true when AHRS has been aligned
-		float vel_NE[2];	// NE velocity vector from last GPS measurement (m/s)
-		bool fuse_gps;		// true when GPS should be fused on that frame
-		float accel_dt;		// time step used when generating _simple_accel_FR data (sec)
-	} _ahrs_ekf_gsf[N_MODELS_EKFGSF]{};
+		float R[3][3][N_MODELS_EKFGSF];		// matrix that rotates a vector from body to earth frame
+		float gyro_bias[3][N_MODELS_EKFGSF];	// gyro bias learned and used by the quaternion calculation
+	} _ahrs_ekf_gsf{};
 
 	bool _ahrs_ekf_gsf_tilt_aligned{};	// true the initial tilt alignment has been calculated
 	float _ahrs_accel_fusion_gain{};	// gain from accel vector tilt error to rate gyro correction used by AHRS calculation
@@ -85,8 +123,8 @@ private:
 	// calculate the gain from gravity vector misalingment to tilt correction to be used by all AHRS filters
 	float ahrsCalcAccelGain() const;
 
-	// update specified AHRS rotation matrix using IMU and optionally true airspeed data
-	void ahrsPredict(const uint8_t model_index);
+	// update the AHRS rotation matrices of all models using IMU and optionally true airspeed data
+	void ahrsPredict();
 
 	// align all AHRS roll and pitch orientations using IMU delta velocity vector
 	void ahrsAlignTilt();
@@ -94,18 +132,19 @@ private:
 	// align all AHRS yaw orientations to initial values
 	void ahrsAlignYaw();
 
-	// Efficient propagation of a delta angle in body frame applied to the body to earth frame rotation matrix
-	Matrix3f ahrsPredictRotMat(const Matrix3f &R, const Vector3f &g);
+	// get or set the AHRS rotation matrix of the specified model
+	Dcmf getAhrsRotMat(const uint8_t model_index) const;
+	void setAhrsRotMat(const uint8_t model_index, const Dcmf &R);
 
 	// Declarations used by a bank of N_MODELS_EKFGSF EKFs
 
 	struct _ekf_gsf_struct{
-		matrix::Vector3f X; 				// Vel North (m/s),  Vel East (m/s), yaw (rad)s
-		matrix::SquareMatrix<float, 3> P; 		// covariance matrix
-		matrix::SquareMatrix<float, 2> S_inverse;	// inverse of the innovation covariance matrix
-		float S_det_inverse; 				// inverse of the innovation covariance matrix determinant
-		matrix::Vector2f innov; 			// Velocity N,E innovation (m/s)
-	} _ekf_gsf[N_MODELS_EKFGSF]{};
+		float X[3][N_MODELS_EKFGSF];		// Vel North (m/s),  Vel East (m/s), yaw (rad)s
+		float P[6][N_MODELS_EKFGSF];		// upper triangle of the symmetric covariance matrix: P00, P01, P02, P11, P12, P22
+		float S_inverse[3][N_MODELS_EKFGSF];	// upper triangle of the symmetric inverse innovation covariance matrix: 00, 01, 11
+		float S_det_inverse[N_MODELS_EKFGSF];	// inverse of the innovation covariance matrix determinant
+		float innov[2][N_MODELS_EKFGSF];	// Velocity N,E innovation (m/s)
+	} _ekf_gsf{};
 
 	bool _vel_data_updated{};	// true when velocity data has been updated
 	bool _run_ekf_gsf{};		// true when operating condition is suitable for to run the GSF and EKF models and fuse velocity data
@@ -114,14 +153,15 @@ private:
 	bool _ekf_gsf_vel_fuse_started{}; // true when the EKF's have started fusing velocity data and the prediction and update processing is active
 
 	// initialise states and covariance data for the GSF and EKF filters
-	void initialiseEKFGSF();
+	// the model yaws are spread evenly around yaw_centre (rad)
+	void initialiseEKFGSF(float yaw_centre = 0.0f);
 
-	// predict state and covariance for the specified EKF using inertial data
-	void predictEKF(const uint8_t model_index);
+	// predict state and covariance for all EKF models using inertial data
+	void predictEKF();
 
-	// update state and covariance for the specified EKF using a NE velocity measurement
-	// return false if update failed
-	bool updateEKF(const uint8_t model_index);
+	// update state and covariance for all EKF models using a NE velocity measurement
+	// return false if the update failed for any of the models
+	bool updateEKF();
 
 	inline float sq(float x) const { return x * x; };
 
@@ -134,7 +174,4 @@ private:
 	// return the probability of the state estimate for the specified EKF assuming a gaussian error distribution
 	float gaussianDensity(const uint8_t model_index) const;
 
-	// update the inverse of the innovation covariance matrix
-	void updateInnovCovMatInv(const uint8_t model_index, const matrix::SquareMatrix<float, 2> &S);
-
 };
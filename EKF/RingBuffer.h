@@ -40,6 +40,7 @@
 #include <inttypes.h>
 #include <cstdio>
 #include <cstring>
+#include <utility>
 
 template <typename data_type>
 class RingBuffer
@@ -55,11 +56,55 @@ public:
 	}
 	~RingBuffer() { delete[] _buffer; }
 
-	// no copy, assignment, move, move assignment
-	RingBuffer(const RingBuffer &) = delete;
-	RingBuffer &operator=(const RingBuffer &) = delete;
-	RingBuffer(RingBuffer &&) = delete;
-	RingBuffer &operator=(RingBuffer &&) = delete;
+	// copies are deep so that a copied estimator owns its own history,
+	// the samples are copied bytewise so that a copy saves the same snapshot as the original
+	RingBuffer(const RingBuffer &other) :
+		_head(other._head),
+		_tail(other._tail),
+		_size(other._size),
+		_first_write(other._first_write)
+	{
+		if (other._buffer != nullptr) {
+			_buffer = new data_type[_size];
+			memcpy(_buffer, other._buffer, sizeof(data_type) * _size);
+		}
+	}
+
+	RingBuffer(RingBuffer &&other) :
+		_buffer(other._buffer),
+		_head(other._head),
+		_tail(other._tail),
+		_size(other._size),
+		_first_write(other._first_write)
+	{
+		other._buffer = nullptr;
+		other._size = 0;
+	}
+
+	RingBuffer &operator=(const RingBuffer &other)
+	{
+		if (this != &other) {
+			RingBuffer copy(other);
+			swap(copy);
+		}
+
+		return *this;
+	}
+
+	RingBuffer &operator=(RingBuffer &&other)
+	{
+		swap(other);
+		return *this;
+	}
+
+	void swap(RingBuffer &other)
+	{
+		std::swap(_buffer, other._buffer);
+		std::swap(_head, other._head);
+		std::swap(_tail, other._tail);
+		std::swap(_size, other._size);
+		std::swap(_first_write, other._first_write);
+	}
 
 	bool allocate(uint8_t size)
 	{
@@ -96,7 +141,59 @@ public:
 		_buffer = nullptr;
 	}
 
-	void push(const data_type &sample)
+	// change the length keeping the newest samples that have not been popped, returns false if the allocation failed
+	bool resize(uint8_t size)
+	{
+		if (size == 0) {
+			return false;
+		}
+
+		data_type *buffer = new data_type[size];
+
+		if (buffer == nullptr) {
+			return false;
+		}
+
+		for (uint8_t index = 0; index < size; index++) {
+			buffer[index] = {};
+		}
+
+		// copy from the newest sample backwards so that the samples end up in the same order
+		uint8_t count = 0;
+
+		if (!_first_write && (_buffer != nullptr)) {
+			uint8_t index = _head;
+
+			while (count < size) {
+				buffer[size - 1 - count] = _buffer[index];
+				count++;
+
+				if (index == _tail) {
+					break;
+				}
+
+				index = (index == 0) ? _size - 1 : index - 1;
+			}
+		}
+
+		delete[] _buffer;
+		_buffer = buffer;
+		_size = size;
+
+		_head = size - 1;
+		_tail = size - count;
+		_first_write = (count == 0);
+
+		if (_first_write) {
+			_head = 0;
+			_tail = 0;
+		}
+
+		return true;
+	}
+
+	// returns true if the oldest sample was overwritten because the buffer was full
+	bool push(const data_type &sample)
 	{
 
 		uint8_t head_new = _head;
@@ -111,15 +208,25 @@ public:
 		// move tail if we overwrite it
 		if (_head == _tail && !_first_write) {
 			_tail = (_tail + 1) % _size;
+			return true;
 
 		} else {
 			_first_write = false;
 		}
+
+		return false;
 	}
 
 	uint8_t get_length() const { return _size; }
 
+	// number of samples that have not been popped
+	uint8_t get_used_length() const { return _first_write ? 0 : (_head + _size - _tail) % _size + 1; }
+
+	// true when all samples have been popped or none has been pushed since the allocation
+	bool is_empty() const { return _first_write; }
+
 	data_type &operator[](const uint8_t index) { return _buffer[index]; }
+	const data_type &operator[](const uint8_t index) const { return _buffer[index]; }
 
 	const data_type &get_newest() { return _buffer[_head]; }
 	const data_type &get_oldest() { return _buffer[_tail]; }
@@ -164,6 +271,29 @@ public:
 
 	int get_total_size() { return sizeof(*this) + sizeof(data_type) * _size; }
 
+	// save or restore the buffer allocation and contents, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar)
+	{
+		uint8_t size = (_buffer != nullptr) ? _size : 0;
+		ar.io(size);
+
+		if (size == 0) {
+			unallocate();
+
+		} else if (size != _size || _buffer == nullptr) {
+			allocate(size);
+		}
+
+		if (_buffer != nullptr) {
+			ar.bytes(_buffer, sizeof(data_type) * _size);
+		}
+
+		ar.io(_head);
+		ar.io(_tail);
+		ar.io(_first_write);
+	}
+
 private:
 	data_type *_buffer{nullptr};
 
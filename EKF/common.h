@@ -161,6 +161,54 @@ struct auxVelSample {
 	uint64_t time_us;	///< timestamp of the measurement (uSec)
 };
 
+struct stateDeltaSample {
+	uint64_t time_us;	///< timestamp at the end of the prediction step (uSec)
+	float dt;		///< length of the prediction step (sec)
+	Vector3f delta_vel;	///< NED velocity change predicted from the IMU data (m/sec)
+	Vector3f delta_pos;	///< NED position change predicted from the IMU data (m)
+	float delta_yaw;	///< rotation about the earth frame vertical predicted from the IMU data (rad)
+};
+
+// observation sensors with their own buffer, used to index the per sensor arrival timing
+enum ObsSensorType : uint8_t {
+	OBS_SENSOR_GPS = 0,
+	OBS_SENSOR_MAG,
+	OBS_SENSOR_BARO,
+	OBS_SENSOR_RANGE,
+	OBS_SENSOR_AIRSPEED,
+	OBS_SENSOR_FLOW,
+	OBS_SENSOR_EXT_VISION,
+	OBS_SENSOR_DRAG,
+	OBS_SENSOR_AUXVEL,
+	OBS_SENSOR_COUNT
+};
+
+// number of bins of the observation sample age and jitter histograms, see obsIngestStatus for the bin limits
+static constexpr uint8_t OBS_INGEST_HIST_BINS = 6;
+
+// sample counts and arrival timing of one observation sensor, see ObsIngestMonitor
+struct obsIngestStatus {
+	uint32_t received;		///< number of samples passed to the estimator
+	uint32_t averaged;		///< number of samples averaged into the next buffered sample because they arrived within the minimum observation interval
+	uint32_t dropped;		///< number of samples discarded because they arrived within the minimum observation interval
+	uint32_t overwritten;		///< number of buffered samples overwritten before they reached the fusion time horizon
+	uint32_t resize_dropped;	///< number of buffered samples discarded by resizing the buffer before they reached the fusion time horizon
+	uint32_t fused;			///< number of samples that passed the innovation consistency check
+	uint32_t gate_rejected;		///< number of samples that failed the innovation consistency check
+	uint32_t age_histogram[OBS_INGEST_HIST_BINS];	///< buffered samples by age when they arrive, bin limits 20, 50, 100, 150, 200 msec
+	uint32_t jitter_histogram[OBS_INGEST_HIST_BINS];	///< buffered samples by deviation from the mean interval, bin limits 1, 2, 5, 10, 20 msec
+	float interval_us;		///< filtered time between buffered samples (uSec)
+	float jitter_us;		///< filtered deviation of the time between buffered samples (uSec)
+	float age_us;			///< filtered age of the buffered samples when they arrive (uSec)
+	uint8_t buffer_length;		///< length of the observation buffer
+	uint8_t peak_occupancy;		///< largest number of samples waiting in the observation buffer at once
+};
+
+// ingest status of all observation sensors
+struct ingestStatus {
+	obsIngestStatus sensor[OBS_SENSOR_COUNT];	///< indexed by ObsSensorType
+};
+
 // Integer definitions for vdist_sensor_type
 #define VDIST_SENSOR_BARO  0	///< Use baro height
 #define VDIST_SENSOR_GPS   1	///< Use GPS height
@@ -185,7 +233,9 @@ struct auxVelSample {
 
 enum TerrainFusionMask : int32_t {
 	TerrainFuseRangeFinder = (1 << 0),
-	TerrainFuseOpticalFlow = (1 << 1)
+	TerrainFuseOpticalFlow = (1 << 1),
+	TerrainFusePrior = (1 << 2),		///< use the terrain height source set with Ekf::setTerrainHeightSource()
+	TerrainFuseGrid = (1 << 3)		///< learn the terrain in a local grid and use it when revisiting a cell
 };
 
 // Integer definitions for mag_fusion_type
@@ -216,6 +266,11 @@ struct parameters {
 	int32_t terrain_fusion_mode{TerrainFusionMask::TerrainFuseRangeFinder |
 				    TerrainFusionMask::TerrainFuseOpticalFlow}; ///< aiding source(s) selection bitmask for the terrain estimator
 	int32_t sensor_interval_min_ms{20};		///< minimum time of arrival difference between non IMU sensor updates. Sets the size of the observation buffers. (mSec)
+	int32_t obs_buffer_sizing{0};			///< 1 to size each observation buffer from the measured arrival timing of its sensor while on ground, 0 to use the same length for all
+	int32_t fusion_budget{0};			///< number of scalar observations fused per update above which lower priority fusions are deferred, 0 to disable
+	int32_t update_budget_us{0};			///< filter update duration above which optional processing is shed, 0 to disable (uSec)
+	int32_t overload_cycles{5};			///< number of consecutive filter updates over update_budget_us before more processing is shed
+	int32_t overload_restore_cycles{50};		///< number of consecutive filter updates well within update_budget_us before shed processing is restored
 
 	// measurement time delays
 	float min_delay_ms{0.0f};		///< Maximum time delay of any sensor used to increase buffer length to handle large timing jitter (mSec)
@@ -227,6 +282,7 @@ struct parameters {
 	float range_delay_ms{5.0f};		///< range finder measurement delay relative to the IMU (mSec)
 	float ev_delay_ms{100.0f};		///< off-board vision measurement delay relative to the IMU (mSec)
 	float auxvel_delay_ms{0.0f};		///< auxiliary velocity measurement delay relative to the IMU (mSec)
+	float retrodiction_max_ms{0.0f};	///< maximum time GPS and airspeed measurements are fused after they were measured, corrected for the state change since, to shorten the fusion time horizon delay. 0 to disable (mSec)
 
 	// input noise
 	float gyro_noise{1.5e-2f};		///< IMU angular rate noise used for covariance prediction (rad/sec)
@@ -241,6 +297,8 @@ struct parameters {
 	float wind_vel_p_noise_scaler{0.5f};	///< scaling of wind process noise with vertical velocity
 	float terrain_p_noise{5.0f};		///< process noise for terrain offset (m/sec)
 	float terrain_gradient{0.5f};		///< gradient of terrain used to estimate process noise due to changing position (m/m)
+	float terrain_prior_gate{5.0f};		///< terrain height prior and learned grid fusion innovation consistency gate size (STD)
+	float terrain_grid_cell_size{5.0f};	///< horizontal size of the cells of the learned terrain grid (m)
 
 	// initialization errors
 	float switch_on_gyro_bias{0.1f};	///< 1-sigma gyro bias uncertainty at switch on (rad/sec)
@@ -370,6 +428,12 @@ struct parameters {
 	unsigned EKFGSF_reset_delay{1000000};	///< Number of uSec of bad innovations on main filter in immediate post-takeoff phase before yaw is reset to EKF-GSF value
 	float EKFGSF_yaw_err_max{0.262f}; 	///< Composite yaw 1-sigma uncertainty threshold used to check for convergence (rad)
 	unsigned EKFGSF_reset_count_limit{3};	///< Maximum number of times the yaw can be reset to the EKF-GSF yaw estimator value
+
+	// Parameters used to stop the EKF-GSF yaw estimator while its yaw is not needed
+	int32_t EKFGSF_lazy{0};			///< set to 1 to only run the EKF-GSF yaw estimator when its yaw may be needed
+	unsigned EKFGSF_lazy_stable_time{30000000};	///< time the yaw has to be aided and consistent in flight before the EKF-GSF is stopped (uSec)
+	unsigned EKFGSF_lazy_period{60000000};	///< interval at which a stopped EKF-GSF is run to keep checking the yaw, 0 to disable (uSec)
+	unsigned EKFGSF_lazy_duration{10000000};	///< duration of each periodic run of a stopped EKF-GSF (uSec)
 };
 
 struct stateSample {
@@ -501,8 +565,128 @@ union terrain_fusion_status_u {
 	struct {
 		bool range_finder: 1;	///< 0 - true if we are fusing range finder data
 		bool flow: 1;			///< 1 - true if we are fusing flow data
+		bool prior: 1;			///< 2 - true if we are fusing the terrain height prior
+		bool grid: 1;			///< 3 - true if we are fusing terrain learned earlier in the flight
+	} flags;
+	uint8_t value;
+};
+
+// processing shed while the filter update exceeds update_budget_us, bits are set in order from the lowest
+union overload_status_u {
+	struct {
+		bool ekfgsf: 1;		///< 0 - true if the EKF-GSF yaw estimator is stopped
+		bool terrain: 1;	///< 1 - true if the terrain estimator is stopped
+		bool drag_beta: 1;	///< 2 - true if drag and synthetic sideslip fusion is stopped
+		bool cov_decimated: 1;	///< 3 - true if the covariance is predicted over two updates at once
 	} flags;
 	uint8_t value;
 };
 
+// optional sections of estimatorStatusSnapshot, selected when requesting it from Ekf::getStatusSnapshot()
+enum StatusSnapshotSection : uint8_t {
+	STATUS_SECTION_STATES = (1 << 0),	///< state vector, variances and output states
+	STATUS_SECTION_INNOVATIONS = (1 << 1),	///< innovations, innovation variances and test ratios of all observations
+	STATUS_SECTION_RESETS = (1 << 2),	///< changes and counters of the state resets
+	STATUS_SECTION_INGEST = (1 << 3),	///< sample counts and arrival timing of the observation sensors
+	STATUS_SECTION_ALL = 0x0f
+};
+
+// innovations of a velocity and position observation, as returned by getGpsVelPosInnov() and the related getters
+struct velPosInnovStatus {
+	float innov[6];		///< NED velocity (m/sec) and NED position (m) innovations
+	float innov_var[6];	///< NED velocity (m/sec)**2 and NED position (m)**2 innovation variances
+	float test_ratio[4];	///< horizontal velocity, vertical velocity, horizontal position and vertical position test ratios
+};
+
+// innovation of a scalar observation
+struct scalarInnovStatus {
+	float innov;
+	float innov_var;
+	float test_ratio;
+};
+
+// filter status in a flat structure that can be copied as a block, see Ekf::getStatusSnapshot()
+struct estimatorStatusSnapshot {
+	uint64_t time_us;		///< time of the fusion time horizon (uSec)
+	uint8_t sections;		///< sections filled in addition to the status, see StatusSnapshotSection
+
+	// status, always filled
+	uint32_t control_status;	///< see filter_control_status_u
+	uint16_t fault_status;		///< see fault_status_u
+	uint16_t innov_check_fail_status;	///< see innovation_fault_status_u
+	uint16_t gps_check_fail_status;	///< see gps_check_fail_status_u
+	uint16_t solution_status;	///< see ekf_solution_status
+	uint8_t terrain_sensor_status;	///< see terrain_fusion_status_u
+	uint8_t overload_status;	///< see overload_status_u
+	bool local_position_valid;
+	bool global_position_valid;
+	bool terrain_valid;
+	bool dead_reckoning;
+	float mag_test_ratio;		///< largest of the test ratios returned by get_innovation_test_status()
+	float vel_test_ratio;
+	float pos_test_ratio;
+	float hgt_test_ratio;
+	float tas_test_ratio;
+	float hagl_test_ratio;
+	float beta_test_ratio;
+	float gpos_eph;			///< 1-sigma horizontal accuracy of the WGS-84 position (m)
+	float gpos_epv;			///< 1-sigma vertical accuracy of the WGS-84 position (m)
+	float lpos_eph;			///< 1-sigma horizontal accuracy of the local position (m)
+	float lpos_epv;			///< 1-sigma vertical accuracy of the local position (m)
+	float vel_evh;			///< 1-sigma horizontal velocity accuracy (m/sec)
+	float vel_evv;			///< 1-sigma vertical velocity accuracy (m/sec)
+	float vxy_max;			///< control limits, see get_ekf_ctrl_limits()
+	float vz_max;
+	float hagl_min;
+	float hagl_max;
+	float vibe_metrics[3];		///< see getImuVibrationMetrics()
+	float output_tracking_error[3];	///< see getOutputTrackingError()
+
+	// STATUS_SECTION_STATES
+	float states[24];		///< state vector at the fusion time horizon
+	float variances[24];		///< diagonal of the covariance matrix
+	float output_quat[4];		///< quaternion at the current time
+	float output_vel[3];		///< NED velocity at the current time (m/sec)
+	float output_pos[3];		///< NED position at the current time (m)
+	float terrain_vpos;		///< terrain vertical position relative to the NED origin (m)
+	float terrain_var;		///< terrain vertical position variance (m**2)
+
+	// STATUS_SECTION_INNOVATIONS
+	velPosInnovStatus gps;
+	velPosInnovStatus ev;
+	scalarInnovStatus baro_hgt;
+	scalarInnovStatus rng_hgt;
+	scalarInnovStatus heading;
+	scalarInnovStatus airspeed;
+	scalarInnovStatus beta;
+	scalarInnovStatus hagl;
+	float aux_vel_innov[2];
+	float aux_vel_innov_var[2];
+	float aux_vel_test_ratio;
+	float flow_innov[2];
+	float flow_innov_var[2];
+	float flow_test_ratio;
+	float mag_innov[3];
+	float mag_innov_var[3];
+	float mag_field_test_ratio;
+	float drag_innov[2];
+	float drag_innov_var[2];
+	float drag_test_ratio[2];
+
+	// STATUS_SECTION_RESETS
+	float posD_reset;		///< change of the last reset of each kind, see get_posD_reset() and the related getters
+	float velD_reset;
+	float posNE_reset[2];
+	float velNE_reset[2];
+	float quat_reset[4];
+	uint8_t posD_reset_counter;
+	uint8_t velD_reset_counter;
+	uint8_t posNE_reset_counter;
+	uint8_t velNE_reset_counter;
+	uint8_t quat_reset_counter;
+
+	// STATUS_SECTION_INGEST
+	ingestStatus ingest;
+};
+
 }
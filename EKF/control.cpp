@@ -93,8 +93,13 @@ void Ekf::controlFusionModes()
 
 	// check for arrival of new sensor data at the fusion time horizon
 	_time_prev_gps_us = _gps_sample_delayed.time_us;
-	_gps_data_ready = _gps_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_gps_sample_delayed);
-	_mag_data_ready = _mag_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_mag_sample_delayed);
+	_gps_data_ready = popObservation(_gps_buffer, OBS_GPS, &_gps_sample_delayed);
+
+	if (_gps_data_ready && (_retrodiction_ms > 0.0f)) {
+		_gps_data_ready = retrodictGpsSample(_gps_sample_delayed);
+	}
+
+	_mag_data_ready = popObservation(_mag_buffer, OBS_MAG, &_mag_sample_delayed);
 
 	if (_mag_data_ready) {
 		// if enabled, use knowledge of theoretical magnetic field vector to calculate a synthetic magnetomter Z component value.
@@ -109,7 +114,7 @@ void Ekf::controlFusionModes()
 	}
 
 	_delta_time_baro_us = _baro_sample_delayed.time_us;
-	_baro_data_ready = _baro_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_baro_sample_delayed);
+	_baro_data_ready = popObservation(_baro_buffer, OBS_BARO, &_baro_sample_delayed);
 
 	// if we have a new baro sample save the delta time between this sample and the last sample which is
 	// used below for baro offset calculations
@@ -121,7 +126,7 @@ void Ekf::controlFusionModes()
 
 	{
 	// Get range data from buffer and check validity
-	const bool is_rng_data_ready = _range_buffer.pop_first_older_than(_imu_sample_delayed.time_us, _range_sensor.getSampleAddress());
+	const bool is_rng_data_ready = popObservation(_range_buffer, OBS_RANGE, _range_sensor.getSampleAddress());
 	_range_sensor.setDataReadiness(is_rng_data_ready);
 	_range_sensor.runChecks(_imu_sample_delayed.time_us, _R_to_earth);
 
@@ -141,7 +146,7 @@ void Ekf::controlFusionModes()
 	// This means we stop looking for new data until the old data has been fused, unless we are not fusing optical flow,
 	// in this case we need to empty the buffer
 	if (!_flow_data_ready || !_control_status.flags.opt_flow) {
-		_flow_data_ready = _flow_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_flow_sample_delayed)
+		_flow_data_ready = popObservation(_flow_buffer, OBS_FLOW, &_flow_sample_delayed)
 				   && (_R_to_earth(2, 2) > _params.range_cos_max_tilt);
 	}
 
@@ -153,23 +158,46 @@ void Ekf::controlFusionModes()
 		_flow_for_terrain_data_ready &= (!_control_status.flags.opt_flow && _control_status.flags.gps);
 	}
 
-	_ev_data_ready = _ext_vision_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_ev_sample_delayed);
-	_tas_data_ready = _airspeed_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_airspeed_sample_delayed);
+	_ev_data_ready = popObservation(_ext_vision_buffer, OBS_EXT_VISION, &_ev_sample_delayed);
+	_tas_data_ready = popObservation(_airspeed_buffer, OBS_AIRSPEED, &_airspeed_sample_delayed);
+
+	if (_tas_data_ready && (_retrodiction_ms > 0.0f)) {
+		_tas_data_ready = retrodictAirspeedSample(_airspeed_sample_delayed);
+	}
+
+	scheduleFusions();
 
 	// check for height sensor timeouts and reset and change sensor if necessary
 	controlHeightSensorTimeouts();
 
 	// control use of observations for aiding
+	// the magnetometer, optical flow and height logic runs every cycle because it filters data or integrates
+	// the IMU, the other sources are only handled when new data is ready or while they have timeouts to monitor
 	controlMagFusion();
 	controlOpticalFlowFusion();
-	controlGpsFusion();
-	controlAirDataFusion();
-	controlBetaFusion();
-	controlDragFusion();
+
+	if (_gps_data_ready || _control_status.flags.gps) {
+		controlGpsFusion();
+	}
+
+	if (_tas_data_ready || _control_status.flags.fuse_aspd || _control_status.flags.wind) {
+		controlAirDataFusion();
+	}
+
+	if ((_control_status.flags.fuse_beta && _control_status.flags.in_air) || _control_status.flags.wind) {
+		controlBetaFusion();
+	}
+
+	if (_params.fusion_mode & MASK_USE_DRAG) {
+		controlDragFusion();
+	}
+
 	controlHeightFusion();
 
 	// Additional data odoemtery data from an external estimator can be fused.
-	controlExternalVisionFusion();
+	if (_ev_data_ready || _control_status.flags.ev_pos || _control_status.flags.ev_vel) {
+		controlExternalVisionFusion();
+	}
 
 	// Additional horizontal velocity data from an auxiliary sensor can be fused
 	controlAuxVelFusion();
@@ -181,6 +209,62 @@ void Ekf::controlFusionModes()
 	update_deadreckoning_status();
 }
 
+void Ekf::scheduleFusions()
+{
+	_fusion_cost = 0;
+
+	if (_params.fusion_budget <= 0) {
+		// release a sample deferred before the budget was disabled
+		_mag_data_ready |= _mag_fusion_deferred;
+		_mag_fusion_deferred = false;
+		return;
+	}
+
+	// the height and the aiding sources that constrain the position are never deferred
+	_fusion_cost += 1;
+
+	if (_gps_data_ready && _control_status.flags.gps) {
+		_fusion_cost += 5;
+	}
+
+	if (_flow_data_ready && _control_status.flags.opt_flow) {
+		_fusion_cost += 2;
+	}
+
+	if (_ev_data_ready) {
+		_fusion_cost += (_control_status.flags.ev_pos ? 2 : 0)
+				+ (_control_status.flags.ev_vel ? 3 : 0)
+				+ (_control_status.flags.ev_yaw ? 1 : 0);
+	}
+
+	if (_tas_data_ready && _control_status.flags.in_air) {
+		_fusion_cost += 1;
+	}
+
+	// the magnetometer is the first to wait, typically in the updates where GPS data is fused
+	if (_mag_data_ready || _mag_fusion_deferred) {
+		_mag_fusion_deferred = deferFusion(_control_status.flags.mag_3D ? 3 : 1, _mag_defer_count);
+		_mag_data_ready = !_mag_fusion_deferred;
+	}
+}
+
+bool Ekf::deferFusion(int32_t cost, uint8_t &defer_count)
+{
+	if ((_params.fusion_budget > 0)
+	    && (_fusion_cost + cost > _params.fusion_budget)
+	    && (defer_count < FUSION_DEFER_MAX)) {
+
+		defer_count++;
+		_fusion_deferral_count++;
+		return true;
+	}
+
+	// the samples wait at most FUSION_DEFER_MAX updates, well within the time the buffers keep them
+	defer_count = 0;
+	_fusion_cost += cost;
+	return false;
+}
+
 void Ekf::controlExternalVisionFusion()
 {
 	// Check for new external vision data
@@ -241,6 +325,9 @@ void Ekf::controlExternalVisionFusion()
 
 
 
+		// true if any of the vision position and velocity observations passed the innovation check
+		bool ev_fused = false;
+
 		// determine if we should use the horizontal position observations
 		if (_control_status.flags.ev_pos) {
 
@@ -315,7 +402,7 @@ void Ekf::controlExternalVisionFusion()
 			// innovation gate size
 			ev_pos_innov_gates(0) = fmaxf(_params.ev_pos_innov_gate, 1.0f);
 
-			fuseHorizontalPosition(_ev_pos_innov, ev_pos_innov_gates, ev_pos_obs_var, _ev_pos_innov_var, _ev_pos_test_ratio);
+			ev_fused |= fuseHorizontalPosition(_ev_pos_innov, ev_pos_innov_gates, ev_pos_obs_var, _ev_pos_innov_var, _ev_pos_test_ratio);
 		}
 
 		// determine if we should use the velocity observations
@@ -339,10 +426,14 @@ void Ekf::controlExternalVisionFusion()
 
 			ev_vel_innov_gates.setAll(fmaxf(_params.ev_vel_innov_gate, 1.0f));
 
-			fuseHorizontalVelocity(_ev_vel_innov, ev_vel_innov_gates,ev_vel_obs_var, _ev_vel_innov_var, _ev_vel_test_ratio);
+			ev_fused |= fuseHorizontalVelocity(_ev_vel_innov, ev_vel_innov_gates,ev_vel_obs_var, _ev_vel_innov_var, _ev_vel_test_ratio);
 			fuseVerticalVelocity(_ev_vel_innov, ev_vel_innov_gates, ev_vel_obs_var, _ev_vel_innov_var, _ev_vel_test_ratio);
 		}
 
+		if (_control_status.flags.ev_pos || _control_status.flags.ev_vel) {
+			_obs_ingest[OBS_SENSOR_EXT_VISION].recordFusion(ev_fused);
+		}
+
 		// determine if we should use the yaw observation
 		if (_control_status.flags.ev_yaw) {
 			fuseHeading();
@@ -503,6 +594,7 @@ void Ekf::controlOpticalFlowFusion()
 		// but use a relaxed time criteria to enable it to coast through bad range finder data
 		if (_control_status.flags.opt_flow && isRecent(_time_last_hagl_fuse, (uint64_t)10e6)) {
 			fuseOptFlow();
+			_obs_ingest[OBS_SENSOR_FLOW].recordFusion(_optflow_test_ratio <= 1.0f);
 			_last_known_posNE = _state.pos.xy();
 		}
 
@@ -711,9 +803,10 @@ void Ekf::controlGpsFusion()
 			gps_vel_innov_gates(0) = gps_vel_innov_gates(1) = fmaxf(_params.gps_vel_innov_gate, 1.0f);
 
 			// fuse GPS measurement
-			fuseHorizontalVelocity(_gps_vel_innov, gps_vel_innov_gates,gps_vel_obs_var, _gps_vel_innov_var, _gps_vel_test_ratio);
+			const bool vel_fused = fuseHorizontalVelocity(_gps_vel_innov, gps_vel_innov_gates,gps_vel_obs_var, _gps_vel_innov_var, _gps_vel_test_ratio);
 			fuseVerticalVelocity(_gps_vel_innov, gps_vel_innov_gates, gps_vel_obs_var, _gps_vel_innov_var, _gps_vel_test_ratio);
-			fuseHorizontalPosition(_gps_pos_innov, gps_pos_innov_gates, gps_pos_obs_var, _gps_pos_innov_var, _gps_pos_test_ratio);
+			const bool pos_fused = fuseHorizontalPosition(_gps_pos_innov, gps_pos_innov_gates, gps_pos_obs_var, _gps_pos_innov_var, _gps_pos_test_ratio);
+			_obs_ingest[OBS_SENSOR_GPS].recordFusion(vel_fused || pos_fused);
 		}
 
 	} else if (_control_status.flags.gps && (_imu_sample_delayed.time_us - _gps_sample_delayed.time_us > (uint64_t)10e6)) {
@@ -1098,8 +1191,9 @@ void Ekf::controlHeightFusion()
 				}
 			}
 			// fuse height information
-			fuseVerticalPosition(_baro_hgt_innov,baro_hgt_innov_gate,
+			const bool baro_fused = fuseVerticalPosition(_baro_hgt_innov,baro_hgt_innov_gate,
 				baro_hgt_obs_var, _baro_hgt_innov_var,_baro_hgt_test_ratio);
+			_obs_ingest[OBS_SENSOR_BARO].recordFusion(baro_fused);
 
 		} else if (_control_status.flags.gps_hgt) {
 			Vector2f gps_hgt_innov_gate;
@@ -1129,8 +1223,9 @@ void Ekf::controlHeightFusion()
 			// innovation gate size
 			rng_hgt_innov_gate(1) = fmaxf(_params.range_innov_gate, 1.0f);
 			// fuse height information
-			fuseVerticalPosition(_rng_hgt_innov,rng_hgt_innov_gate,
+			const bool rng_fused = fuseVerticalPosition(_rng_hgt_innov,rng_hgt_innov_gate,
 				rng_hgt_obs_var, _rng_hgt_innov_var,_rng_hgt_test_ratio);
+			_obs_ingest[OBS_SENSOR_RANGE].recordFusion(rng_fused);
 
 		} else if (_control_status.flags.ev_hgt) {
 			Vector2f ev_hgt_innov_gate;
@@ -1212,6 +1307,7 @@ void Ekf::controlAirDataFusion()
 		}
 
 		fuseAirspeed();
+		_obs_ingest[OBS_SENSOR_AIRSPEED].recordFusion(!_innov_check_fail_status.flags.reject_airspeed);
 	}
 }
 
@@ -1232,7 +1328,8 @@ void Ekf::controlBetaFusion()
 	// Sufficient time has lapsed sice the last fusion
 	bool beta_fusion_time_triggered = isTimedOut(_time_last_beta_fuse, _params.beta_avg_ft_us);
 
-	if (beta_fusion_time_triggered && _control_status.flags.fuse_beta && _control_status.flags.in_air) {
+	if (beta_fusion_time_triggered && _control_status.flags.fuse_beta && _control_status.flags.in_air
+	    && !_overload_status.flags.drag_beta && !deferFusion(1, _beta_defer_count)) {
 		// If starting wind state estimation, reset the wind states and covariances before fusing any data
 		if (!_control_status.flags.wind) {
 			// activate the wind states
@@ -1260,8 +1357,14 @@ void Ekf::controlDragFusion()
 				resetWindStates();
 				resetWindCovariance();
 
-			} else if (_drag_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_drag_sample_delayed)) {
-				fuseDrag();
+			} else if (!_overload_status.flags.drag_beta
+				   && (popObservation(_drag_buffer, OBS_DRAG, &_drag_sample_delayed) || _drag_fusion_deferred)) {
+				_drag_fusion_deferred = deferFusion(2, _drag_defer_count);
+
+				if (!_drag_fusion_deferred) {
+					fuseDrag();
+					_obs_ingest[OBS_SENSOR_DRAG].recordFusion((_drag_test_ratio[0] <= 1.0f) || (_drag_test_ratio[1] <= 1.0f));
+				}
 			}
 
 		} else {
@@ -1323,7 +1426,7 @@ void Ekf::controlFakePosFusion()
 
 void Ekf::controlAuxVelFusion()
 {
-	const bool data_ready = _auxvel_buffer.pop_first_older_than(_imu_sample_delayed.time_us, &_auxvel_sample_delayed);
+	const bool data_ready = popObservation(_auxvel_buffer, OBS_AUXVEL, &_auxvel_sample_delayed);
 
 	if (data_ready && isHorizontalAidingActive()) {
 
@@ -1331,8 +1434,9 @@ void Ekf::controlAuxVelFusion()
 
 		_aux_vel_innov = _state.vel - _auxvel_sample_delayed.vel;
 
-		fuseHorizontalVelocity(_aux_vel_innov, aux_vel_innov_gate, _auxvel_sample_delayed.velVar,
+		const bool aux_vel_fused = fuseHorizontalVelocity(_aux_vel_innov, aux_vel_innov_gate, _auxvel_sample_delayed.velVar,
 				_aux_vel_innov_var, _aux_vel_test_ratio);
+		_obs_ingest[OBS_SENSOR_AUXVEL].recordFusion(aux_vel_fused);
 
 		// Can be enabled after bit for this is added to EKF_AID_MASK
 		// fuseVerticalVelocity(_aux_vel_innov, aux_vel_innov_gate, _auxvel_sample_delayed.velVar,
@@ -111,7 +111,39 @@ Vector3f Ekf::getVelocityVariance() const
 	return P.slice<3,3>(4,4).diag();
 }
 
-void Ekf::predictCovariance()
+void Ekf::controlCovariancePrediction()
+{
+	// Use average update interval to reduce accumulated covariance prediction errors due to small single frame dt values
+	if (!_overload_status.flags.cov_decimated && (_cov_pred_samples == 0)) {
+		predictCovariance(_imu_sample_delayed, FILTER_UPDATE_PERIOD_S);
+		return;
+	}
+
+	// while decimated the IMU data of two updates is summed and the covariance is predicted over both at once
+	if (_cov_pred_samples == 0) {
+		_cov_pred_imu = _imu_sample_delayed;
+
+	} else {
+		_cov_pred_imu.delta_ang += _imu_sample_delayed.delta_ang;
+		_cov_pred_imu.delta_vel += _imu_sample_delayed.delta_vel;
+		_cov_pred_imu.delta_ang_dt += _imu_sample_delayed.delta_ang_dt;
+		_cov_pred_imu.delta_vel_dt += _imu_sample_delayed.delta_vel_dt;
+		_cov_pred_imu.time_us = _imu_sample_delayed.time_us;
+
+		for (int i = 0; i < 3; i++) {
+			_cov_pred_imu.delta_vel_clipping[i] |= _imu_sample_delayed.delta_vel_clipping[i];
+		}
+	}
+
+	_cov_pred_samples++;
+
+	if ((_cov_pred_samples >= 2) || !_overload_status.flags.cov_decimated) {
+		predictCovariance(_cov_pred_imu, _cov_pred_samples * FILTER_UPDATE_PERIOD_S);
+		_cov_pred_samples = 0;
+	}
+}
+
+void Ekf::predictCovariance(const imuSample &imu_delayed, float dt)
 {
 	// assign intermediate state variables
 	const float q0 = _state.quat_nominal(0);
@@ -119,13 +151,13 @@ void Ekf::predictCovariance()
 	const float q2 = _state.quat_nominal(2);
 	const float q3 = _state.quat_nominal(3);
 
-	const float dax = _imu_sample_delayed.delta_ang(0);
-	const float day = _imu_sample_delayed.delta_ang(1);
-	const float daz = _imu_sample_delayed.delta_ang(2);
+	const float dax = imu_delayed.delta_ang(0);
+	const float day = imu_delayed.delta_ang(1);
+	const float daz = imu_delayed.delta_ang(2);
 
-	const float dvx = _imu_sample_delayed.delta_vel(0);
-	const float dvy = _imu_sample_delayed.delta_vel(1);
-	const float dvz = _imu_sample_delayed.delta_vel(2);
+	const float dvx = imu_delayed.delta_vel(0);
+	const float dvy = imu_delayed.delta_vel(1);
+	const float dvz = imu_delayed.delta_vel(2);
 
 	const float dax_b = _state.delta_ang_bias(0);
 	const float day_b = _state.delta_ang_bias(1);
@@ -135,8 +167,6 @@ void Ekf::predictCovariance()
 	const float dvy_b = _state.delta_vel_bias(1);
 	const float dvz_b = _state.delta_vel_bias(2);
 
-	// Use average update interval to reduce accumulated covariance prediction errors due to small single frame dt values
-	const float dt = FILTER_UPDATE_PERIOD_S;
 	const float dt_inv = 1.0f / dt;
 
 	// convert rate of change of rate gyro bias (rad/s**2) as specified by the parameter to an expected change in delta angle (rad) since the last update
@@ -149,9 +179,9 @@ void Ekf::predictCovariance()
 	// xy accel bias learning is also disabled on ground as those states are poorly observable when perpendicular to the gravity vector
 	const float alpha = math::constrain((dt / _params.acc_bias_learn_tc), 0.0f, 1.0f);
 	const float beta = 1.0f - alpha;
-	_ang_rate_magnitude_filt = fmaxf(dt_inv * _imu_sample_delayed.delta_ang.norm(), beta * _ang_rate_magnitude_filt);
-	_accel_magnitude_filt = fmaxf(dt_inv * _imu_sample_delayed.delta_vel.norm(), beta * _accel_magnitude_filt);
-	_accel_vec_filt = alpha * dt_inv * _imu_sample_delayed.delta_vel + beta * _accel_vec_filt;
+	_ang_rate_magnitude_filt = fmaxf(dt_inv * imu_delayed.delta_ang.norm(), beta * _ang_rate_magnitude_filt);
+	_accel_magnitude_filt = fmaxf(dt_inv * imu_delayed.delta_vel.norm(), beta * _accel_magnitude_filt);
+	_accel_vec_filt = alpha * dt_inv * imu_delayed.delta_vel + beta * _accel_vec_filt;
 
 	const bool is_manoeuvre_level_high = _ang_rate_magnitude_filt > _params.acc_bias_learn_gyr_lim
 					    || _accel_magnitude_filt > _params.acc_bias_learn_acc_lim;
@@ -254,15 +284,15 @@ void Ekf::predictCovariance()
 
 	// Accelerometer Clipping
 	// delta velocity X: increase process noise if sample contained any X axis clipping
-	if (_imu_sample_delayed.delta_vel_clipping[0]) {
+	if (imu_delayed.delta_vel_clipping[0]) {
 		dvxVar = sq(dt * BADACC_BIAS_PNOISE);
 	}
 	// delta velocity Y: increase process noise if sample contained any Y axis clipping
-	if (_imu_sample_delayed.delta_vel_clipping[1]) {
+	if (imu_delayed.delta_vel_clipping[1]) {
 		dvyVar = sq(dt * BADACC_BIAS_PNOISE);
 	}
 	// delta velocity Z: increase process noise if sample contained any Z axis clipping
-	if (_imu_sample_delayed.delta_vel_clipping[2]) {
+	if (imu_delayed.delta_vel_clipping[2]) {
 		dvzVar = sq(dt * BADACC_BIAS_PNOISE);
 	}
 
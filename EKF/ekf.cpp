@@ -48,6 +48,12 @@ bool Ekf::init(uint64_t timestamp)
 {
 	bool ret = initialise_interface(timestamp);
 	reset();
+
+	// the learned terrain grid is allocated before the flight so that learning cells never allocates
+	if (shouldUseTerrainGridForHagl()) {
+		_terrain_grid.allocate();
+	}
+
 	_accel_lpf.setAlpha(.1f);
 	_gyro_lpf.setAlpha(.1f);
 	_mag_lpf.setAlpha(.1f);
@@ -77,6 +83,8 @@ void Ekf::reset()
 
 	_filter_initialised = false;
 	_terrain_initialised = false;
+	_terrain_grid.reset();
+	_terrain_grid_cell = TerrainHeightGrid::INVALID_CELL;
 	_range_sensor.setPitchOffset(_params.rng_sens_pitch);
 	_range_sensor.setCosMaxTilt(_params.range_cos_max_tilt);
 
@@ -90,6 +98,9 @@ void Ekf::reset()
 	_fault_status.value = 0;
 	_innov_check_fail_status.value = 0;
 
+	setOverloadLevel(0);
+	_cov_pred_samples = 0;
+
 	_accel_magnitude_filt = 0.0f;
 	_ang_rate_magnitude_filt = 0.0f;
 	_prev_dvel_bias_var.zero();
@@ -113,29 +124,100 @@ bool Ekf::update()
 
 	// Only run the filter if IMU data in the buffer has been updated
 	if (_imu_updated) {
+		const uint64_t update_start_us = ecl_absolute_time();
+
+		// shed optional processing if the previous updates took too long
+		controlOverload();
+
 		// perform state and covariance prediction for the main filter
 		predictState();
-		predictCovariance();
+		controlCovariancePrediction();
 
 		// control fusion of observation data
 		controlFusionModes();
 
 		// run a separate filter for terrain estimation
-		runTerrainEstimator();
+		if (!_overload_status.flags.terrain) {
+			runTerrainEstimator();
+
+		} else {
+			// let the terrain estimate time out while it is not updated and initialise it again when restored
+			_terrain_initialised = false;
+			updateTerrainValidity();
+		}
 
 		updated = true;
 
 		// run EKF-GSF yaw estimator
 		runYawEKFGSF();
+
+		// the update time is reported with setUpdateTime() instead where there is no clock
+		const uint64_t update_time_us = ecl_absolute_time() - update_start_us;
+
+		if (update_time_us > 0) {
+			_update_time_us = (uint32_t)update_time_us;
+		}
 	}
 
 	// the output observer always runs
 	// Use full rate IMU data at the current time horizon
 	calculateOutputStates();
 
+	if (_output_predictor != nullptr) {
+		_output_predictor->publish(_output_new, _state.delta_ang_bias / _dt_ekf_avg, _state.delta_vel_bias / _dt_ekf_avg);
+	}
+
 	return updated;
 }
 
+void Ekf::controlOverload()
+{
+	if (_params.update_budget_us <= 0) {
+		_overload_count = 0;
+		_underload_count = 0;
+		setOverloadLevel(0);
+		return;
+	}
+
+	const uint32_t budget_us = (uint32_t)_params.update_budget_us;
+
+	if (_update_time_us > budget_us) {
+		_underload_count = 0;
+
+		// shed one more step each time the budget has been exceeded for overload_cycles updates in a row
+		if ((_overload_level < OVERLOAD_LEVEL_MAX)
+		    && ((int32_t)++_overload_count >= _params.overload_cycles)) {
+			setOverloadLevel(_overload_level + 1);
+		}
+
+	} else if (_update_time_us < OVERLOAD_RESTORE_RATIO * budget_us) {
+		_overload_count = 0;
+
+		// restore the last shed step after a longer period well within the budget to avoid oscillating
+		if ((_overload_level > 0)
+		    && ((int32_t)++_underload_count >= _params.overload_restore_cycles)) {
+			setOverloadLevel(_overload_level - 1);
+		}
+
+	} else {
+		_overload_count = 0;
+		_underload_count = 0;
+	}
+
+	// the time is only used once so that an update that is not measured counts as within the budget
+	_update_time_us = 0;
+}
+
+void Ekf::setOverloadLevel(uint8_t level)
+{
+	if (level != _overload_level) {
+		_overload_level = level;
+		_overload_status.value = (uint8_t)((1 << level) - 1);
+		_overload_count = 0;
+		_underload_count = 0;
+	}
+}
+
 bool Ekf::initialiseFilter()
 {
 	// Filter accel for tilt initialization
@@ -286,7 +368,16 @@ void Ekf::predictState()
 	_state.vel(2) += CONSTANTS_ONE_G * _imu_sample_delayed.delta_vel_dt;
 
 	// predict position states via trapezoidal integration of velocity
-	_state.pos += (vel_last + _state.vel) * _imu_sample_delayed.delta_vel_dt * 0.5f;
+	const Vector3f delta_pos = (vel_last + _state.vel) * _imu_sample_delayed.delta_vel_dt * 0.5f;
+	_state.pos += delta_pos;
+
+	// keep the predicted changes to correct late measurements with, see retrodiction_max_ms
+	if (_retrodiction_ms > 0.0f) {
+		const float delta_yaw = _R_to_earth(2, 0) * corrected_delta_ang(0) + _R_to_earth(2, 1) * corrected_delta_ang(1)
+					+ _R_to_earth(2, 2) * corrected_delta_ang(2);
+		_state_delta_buffer.push(stateDeltaSample{_imu_sample_delayed.time_us, _imu_sample_delayed.delta_vel_dt,
+					 _state.vel - vel_last, delta_pos, delta_yaw});
+	}
 
 	constrainStates();
 
@@ -337,7 +428,7 @@ void Ekf::calculateOutputStates()
 	// Note fixed coefficients are used to save operations. The exact time constant is not important.
 	_yaw_rate_lpf_ef = 0.95f * _yaw_rate_lpf_ef + 0.05f * spin_del_ang_D / imu.delta_ang_dt;
 
-	const Quatf dq(AxisAnglef{delta_angle});
+	const Quatf dq(hotpath::quatFromAxisAngle(delta_angle));
 
 	// rotate the previous INS quaternion by the delta quaternions
 	_output_new.time_us = imu.time_us;
@@ -528,5 +619,5 @@ Quatf Ekf::calculate_quaternion() const
 
 	// increment the quaternions using the corrected delta angle vector
 	// the quaternions must always be normalised after modification
-	return Quatf{_output_new.quat_nominal * AxisAnglef{delta_angle}}.unit();
+	return Quatf{_output_new.quat_nominal * hotpath::quatFromAxisAngle(delta_angle)}.unit();
 }
@@ -43,8 +43,31 @@
 #pragma once
 
 #include "estimator_interface.h"
+#include "output_predictor.hpp"
+#include "terrain_height_grid.hpp"
 
-class Ekf : public EstimatorInterface
+class TerrainHeightSource;
+
+// pointer to an object that is attached to one filter instance and not owned by it, a copy of
+// the filter starts detached and assigning a filter to another one keeps the attached object
+template<typename T>
+class AttachedPtr
+{
+public:
+	AttachedPtr() = default;
+	AttachedPtr(const AttachedPtr &) {}
+	AttachedPtr &operator=(const AttachedPtr &) { return *this; }
+
+	AttachedPtr &operator=(T *ptr) { _ptr = ptr; return *this; }
+
+	operator T *() const { return _ptr; }
+	T *operator->() const { return _ptr; }
+
+private:
+	T *_ptr{nullptr};
+};
+
+class Ekf final : public EstimatorInterface
 {
 public:
 	static constexpr uint8_t _k_num_states{24};		///< number of EKF states
@@ -54,6 +77,11 @@ public:
 	Ekf() = default;
 	virtual ~Ekf() = default;
 
+	// copying a running filter creates an independent fork of it, the fork does not publish to the
+	// output predictor or use the terrain height source of the original, see AttachedPtr
+	Ekf(const Ekf &) = default;
+	Ekf &operator=(const Ekf &) = default;
+
 	// initialise variables to sane values (also interface class)
 	bool init(uint64_t timestamp) override;
 
@@ -234,6 +262,31 @@ public:
 	// get the terrain variance
 	float get_terrain_var() const { return _terrain_var; }
 
+	// terrain learned during the flight, see TerrainFuseGrid
+	const TerrainHeightGrid &getTerrainGrid() const { return _terrain_grid; }
+
+	// number of fusions deferred to a later update to stay within the fusion budget
+	uint32_t getDeferredFusionCount() const { return _fusion_deferral_count; }
+
+	// report the measured duration of the last filter update on platforms where the filter cannot measure it itself
+	void setUpdateTime(uint32_t update_time_us) { _update_time_us = update_time_us; }
+
+	// processing shed to stay within update_budget_us, see overload_status_u
+	uint8_t getOverloadStatus() const { return _overload_status.value; }
+
+	// sum of the state changes predicted from the IMU data between the time and the fusion time horizon,
+	// returns false if the time is older than the kept changes, see retrodiction_max_ms
+	bool getStateDeltaSince(uint64_t time_us, Vector3f &delta_vel, Vector3f &delta_pos, float &delta_yaw) const;
+
+	// publish the output states to a predictor running on a higher priority thread after every update,
+	// the predictor is not owned by the filter and has to outlive it, nullptr to stop publishing
+	void setOutputPredictor(OutputPredictor *predictor) { _output_predictor = predictor; }
+
+	// set the terrain height source used as a prior by the terrain estimator when enabled in
+	// terrain_fusion_mode, the source is not owned by the filter and has to outlive it.
+	// It is queried from the filter update and must not block, see TerrainHeightSource
+	void setTerrainHeightSource(TerrainHeightSource *source) { _terrain_source = source; }
+
 	// get the accelerometer bias in m/s**2
 	Vector3f getAccelBias() const override;
 
@@ -280,6 +333,10 @@ public:
 	// return a bitmask integer that describes which state estimates can be used for flight control
 	void get_ekf_soln_status(uint16_t *status) override;
 
+	// fill the status and the requested sections of a status snapshot in one call instead of using the individual
+	// getters, sections is a bitmask of StatusSnapshotSection
+	void getStatusSnapshot(estimatorStatusSnapshot &snapshot, uint8_t sections = STATUS_SECTION_ALL);
+
 	// return the quaternion defining the rotation from the External Vision to the EKF reference frame
 	matrix::Quatf getVisionAlignmentQuaternion() const override;
 
@@ -299,6 +356,17 @@ public:
 	// This should only be used as a last resort before activating a loss of navigation failsafe
 	void requestEmergencyNavReset() override;
 
+	// save the complete filter state in a compact versioned binary form
+	// returns the number of bytes written or 0 if the buffer is too small
+	size_t saveSnapshot(uint8_t *buffer, size_t buffer_size) const;
+
+	// number of bytes saveSnapshot() needs for the current filter state
+	size_t getSnapshotSize() const;
+
+	// restore a filter state written by saveSnapshot()
+	// returns false and leaves the filter unchanged if the data is corrupted or has a different format version
+	bool restoreSnapshot(const uint8_t *buffer, size_t size);
+
 private:
 	struct {
 		uint8_t velNE_counter;	///< number of horizontal position reset events (allow to wrap if count exceeds 255)
@@ -337,6 +405,27 @@ private:
 	bool _tas_data_ready{false};	///< true when new true airspeed data has fallen behind the fusion time horizon and is available to be fused
 	bool _flow_for_terrain_data_ready{false}; /// same flag as "_flow_data_ready" but used for separate terrain estimator
 
+	// fusion budget, see fusion_budget in parameters
+	static constexpr uint8_t FUSION_DEFER_MAX{2};	///< maximum number of consecutive updates a fusion can be deferred by
+	int32_t _fusion_cost{0};		///< number of scalar observations scheduled for fusion in the current update
+	bool _mag_fusion_deferred{false};	///< true when the magnetometer sample at the fusion time horizon is waiting for a later update
+	bool _drag_fusion_deferred{false};	///< true when the drag sample at the fusion time horizon is waiting for a later update
+	uint8_t _mag_defer_count{0};		///< number of consecutive updates the magnetometer fusion has been deferred by
+	uint8_t _drag_defer_count{0};		///< number of consecutive updates the drag fusion has been deferred by
+	uint8_t _beta_defer_count{0};		///< number of consecutive updates the sideslip fusion has been deferred by
+	uint32_t _fusion_deferral_count{0};	///< total number of deferred fusions
+
+	// overload degradation, see update_budget_us in parameters
+	static constexpr uint8_t OVERLOAD_LEVEL_MAX{4};		///< number of processing steps that can be shed
+	static constexpr float OVERLOAD_RESTORE_RATIO{0.8f};	///< fraction of the budget the update time has to stay below to restore processing
+	overload_status_u _overload_status{};	///< processing currently shed
+	uint8_t _overload_level{0};		///< number of processing steps currently shed
+	uint32_t _update_time_us{0};		///< measured duration of the last filter update, 0 if unknown (uSec)
+	uint32_t _overload_count{0};		///< number of consecutive updates over the budget
+	uint32_t _underload_count{0};		///< number of consecutive updates below the restore threshold
+	imuSample _cov_pred_imu{};		///< IMU data summed while the covariance prediction is decimated
+	uint8_t _cov_pred_samples{0};		///< number of IMU samples summed in _cov_pred_imu
+
 	uint64_t _time_prev_gps_us{0};	///< time stamp of previous GPS data retrieved from the buffer (uSec)
 	uint64_t _time_last_aiding{0};	///< amount of time we have been doing inertial only deadreckoning (uSec)
 	bool _using_synthetic_position{false};	///< true if we are using a synthetic position to constrain drift
@@ -443,6 +532,7 @@ private:
 	Vector3f _vel_err_integ;	///< integral of velocity tracking error (m)
 	Vector3f _pos_err_integ;	///< integral of position tracking error (m.s)
 	Vector3f _output_tracking_error; ///< contains the magnitude of the angle, velocity and position track errors (rad, m/s, m)
+	AttachedPtr<OutputPredictor> _output_predictor{};	///< predictor running on a higher priority thread, not owned
 
 	// variables used for the GPS quality checks
 	Vector3f _gps_pos_deriv_filt;	///< GPS NED position derivative (m/sec)
@@ -491,10 +581,18 @@ private:
 	float _terrain_vpos{0.0f};		///< estimated vertical position of the terrain underneath the vehicle in local NED frame (m)
 	float _terrain_var{1e4f};		///< variance of terrain position estimate (m**2)
 	uint64_t _time_last_hagl_fuse{0};		///< last system time that a range sample was fused by the terrain estimator
+	uint64_t _time_last_flow_terrain_fuse{0};	///< last system time that optical flow was fused by the terrain estimator
 	uint64_t _time_last_fake_hagl_fuse{0};	///< last system time that a fake range sample was fused by the terrain estimator
 	bool _terrain_initialised{false};	///< true when the terrain estimator has been initialized
 	bool _hagl_valid{false};		///< true when the height above ground estimate is valid
 	terrain_fusion_status_u _hagl_sensor_status{}; ///< Struct indicating type of sensor used to estimate height above ground
+	AttachedPtr<TerrainHeightSource> _terrain_source{};	///< terrain height prior, not owned
+	float _terrain_prior_offset{0.0f};	///< offset between the terrain prior and the estimated terrain, calibrated on ground (m)
+	uint64_t _time_last_terrain_prior_check{0};	///< last system time that the terrain prior was looked up in air
+	uint64_t _time_last_terrain_prior_fuse{0};	///< last system time that the terrain prior was fused by the terrain estimator
+	TerrainHeightGrid _terrain_grid{};	///< terrain learned from the range finder and optical flow during the flight
+	uint32_t _terrain_grid_cell{TerrainHeightGrid::INVALID_CELL};	///< grid cell the vehicle was in at the last terrain update
+	uint64_t _time_last_terrain_grid_fuse{0};	///< last system time that a learned grid cell was fused by the terrain estimator
 
 	// height sensor status
 	bool _baro_hgt_faulty{false};		///< true if valid baro data is unavailable for use
@@ -524,8 +622,20 @@ private:
 	// predict ekf state
 	void predictState();
 
-	// predict ekf covariance
-	void predictCovariance();
+	// predict ekf covariance every update, or every second update while decimated because of overload
+	void controlCovariancePrediction();
+
+	// predict ekf covariance over dt using the delta angles and velocities of the IMU sample
+	void predictCovariance(const imuSample &imu_delayed, float dt);
+
+	// correct a measurement for the state change since it was measured so it can be fused at the current
+	// fusion time horizon, returns false if it is too old, see retrodiction_max_ms
+	bool retrodictGpsSample(gpsSample &gps);
+	bool retrodictAirspeedSample(airspeedSample &airspeed);
+
+	// shed or restore optional processing depending on the measured update time
+	void controlOverload();
+	void setOverloadLevel(uint8_t level);
 
 	// ekf sequential fusion of magnetometer measurements
 	void fuseMag();
@@ -623,12 +733,44 @@ private:
 	// returns false if bias corrected body rate data is unavailable
 	bool calcOptFlowBodyRateComp();
 
+	// estimate the cost of the high priority fusions of the current update and defer the magnetometer
+	// fusion if it does not fit in the fusion budget
+	void scheduleFusions();
+
+	// return true if a fusion of the given number of scalar observations has to wait for a later update
+	// to stay within the fusion budget, defer_count is the number of updates it has been waiting for
+	bool deferFusion(int32_t cost, uint8_t &defer_count);
+
+	// pop the sample of an observation buffer that has fallen behind the fusion time horizon,
+	// buffers without pending samples are not searched
+	template<typename T>
+	bool popObservation(RingBuffer<T> &buffer, ObsBufferMask mask, T *sample)
+	{
+		if (!(_obs_pending & mask)) {
+			return false;
+		}
+
+		const bool popped = buffer.pop_first_older_than(_imu_sample_delayed.time_us, sample);
+
+		if (buffer.is_empty()) {
+			_obs_pending &= ~mask;
+		}
+
+		return popped;
+	}
+
 	// initialise the terrain vertical position estimator
 	// return true if the initialisation is successful
 	bool initHagl();
 
 	bool shouldUseRangeFinderForHagl() const;
 	bool shouldUseOpticalFlowForHagl() const;
+	bool shouldUseTerrainPriorForHagl() const;
+	bool shouldUseTerrainGridForHagl() const;
+
+	// get the terrain vertical position in local NED frame and its variance from the terrain height source
+	// at the current position, return false if it is not available
+	bool getTerrainPrior(float &terrain_vpos, float &terrain_var) const;
 
 	// run the terrain estimator
 	void runTerrainEstimator();
@@ -639,6 +781,12 @@ private:
 	// update the terrain vertical position estimate using an optical flow measurement
 	void fuseFlowForTerrain();
 
+	// update the terrain vertical position estimate using the terrain height source as a pseudo-measurement
+	void fuseTerrainPrior();
+
+	// update the terrain vertical position estimate using the learned terrain of the current grid cell
+	void fuseTerrainGrid();
+
 	// reset the heading and magnetic field states using the declination and magnetometer/external vision measurements
 	// return true if successful
 	bool resetMagHeading(const Vector3f &mag_init, bool increase_yaw_var = true, bool update_buffer = true);
@@ -874,10 +1022,19 @@ private:
 	uint64_t _time_last_on_ground_us{0};	///< last tine we were on the ground (uSec)
 	bool _do_ekfgsf_yaw_reset{false};	// true when an emergency yaw reset has been requested
 	uint8_t _ekfgsf_yaw_reset_count{0};	// number of times the yaw has been reset to the EKF-GSF estimate
+	bool _ekfgsf_active{true};		///< false while the EKF-GSF is stopped because its yaw is not needed
+	uint64_t _time_last_yaw_not_stable_us{0};	///< last time the yaw was not aided and consistent in flight (uSec)
+
+	// save or restore all members of the filter, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar);
 
 	// Call once per _imu_sample_delayed update after all main EKF data fusion oeprations have been completed
 	void runYawEKFGSF();
 
+	// return true if the EKF-GSF has to run because its yaw may be needed, see EKFGSF_lazy
+	bool isYawEKFGSFNeeded();
+
 	// Resets the main Nav EKf yaw to the estimator from the EKF-GSF yaw estimator
 	// Resets the horizontal velocity and position to the default navigation sensor
 	// Returns true if the reset was successful
@@ -1078,7 +1078,7 @@ void Ekf::get_innovation_test_status(uint16_t &status, float &mag, float &vel, f
 // return a bitmask integer that describes which state estimates are valid
 void Ekf::get_ekf_soln_status(uint16_t *status)
 {
-	ekf_solution_status soln_status;
+	ekf_solution_status soln_status{};
 	// TODO: Is this accurate enough?
 	soln_status.flags.attitude = _control_status.flags.tilt_align && _control_status.flags.yaw_align && (_fault_status.value == 0);
 	soln_status.flags.velocity_horiz = (isHorizontalAidingActive() || (_control_status.flags.fuse_beta && _control_status.flags.fuse_aspd)) && (_fault_status.value == 0);
@@ -1098,6 +1098,110 @@ void Ekf::get_ekf_soln_status(uint16_t *status)
 	*status = soln_status.value;
 }
 
+void Ekf::getStatusSnapshot(estimatorStatusSnapshot &snapshot, uint8_t sections)
+{
+	snapshot.time_us = _imu_sample_delayed.time_us;
+	snapshot.sections = sections & STATUS_SECTION_ALL;
+
+	snapshot.control_status = _control_status.value;
+	snapshot.fault_status = _fault_status.value;
+	get_innovation_test_status(snapshot.innov_check_fail_status, snapshot.mag_test_ratio, snapshot.vel_test_ratio,
+				   snapshot.pos_test_ratio, snapshot.hgt_test_ratio, snapshot.tas_test_ratio,
+				   snapshot.hagl_test_ratio, snapshot.beta_test_ratio);
+	snapshot.gps_check_fail_status = _gps_check_fail_status.value;
+	get_ekf_soln_status(&snapshot.solution_status);
+	snapshot.terrain_sensor_status = _hagl_sensor_status.value;
+	snapshot.overload_status = _overload_status.value;
+	snapshot.local_position_valid = local_position_is_valid();
+	snapshot.global_position_valid = global_position_is_valid();
+	snapshot.terrain_valid = isTerrainEstimateValid();
+	snapshot.dead_reckoning = _is_dead_reckoning;
+	get_ekf_gpos_accuracy(&snapshot.gpos_eph, &snapshot.gpos_epv);
+	get_ekf_lpos_accuracy(&snapshot.lpos_eph, &snapshot.lpos_epv);
+	get_ekf_vel_accuracy(&snapshot.vel_evh, &snapshot.vel_evv);
+	get_ekf_ctrl_limits(&snapshot.vxy_max, &snapshot.vz_max, &snapshot.hagl_min, &snapshot.hagl_max);
+	_vibe_metrics.copyTo(snapshot.vibe_metrics);
+	_output_tracking_error.copyTo(snapshot.output_tracking_error);
+
+	if (sections & STATUS_SECTION_STATES) {
+		getStateAtFusionHorizonAsVector().copyTo(snapshot.states);
+
+		for (unsigned index = 0; index < _k_num_states; index++) {
+			snapshot.variances[index] = P(index, index);
+		}
+
+		_output_new.quat_nominal.copyTo(snapshot.output_quat);
+		getVelocity().copyTo(snapshot.output_vel);
+		getPosition().copyTo(snapshot.output_pos);
+		snapshot.terrain_vpos = _terrain_vpos;
+		snapshot.terrain_var = _terrain_var;
+	}
+
+	if (sections & STATUS_SECTION_INNOVATIONS) {
+		velPosInnovStatus &gps = snapshot.gps;
+		getGpsVelPosInnov(&gps.innov[0], gps.innov[2], &gps.innov[3], gps.innov[5]);
+		getGpsVelPosInnovVar(&gps.innov_var[0], gps.innov_var[2], &gps.innov_var[3], gps.innov_var[5]);
+		getGpsVelPosInnovRatio(gps.test_ratio[0], gps.test_ratio[1], gps.test_ratio[2], gps.test_ratio[3]);
+
+		velPosInnovStatus &ev = snapshot.ev;
+		getEvVelPosInnov(&ev.innov[0], ev.innov[2], &ev.innov[3], ev.innov[5]);
+		getEvVelPosInnovVar(&ev.innov_var[0], ev.innov_var[2], &ev.innov_var[3], ev.innov_var[5]);
+		getEvVelPosInnovRatio(ev.test_ratio[0], ev.test_ratio[1], ev.test_ratio[2], ev.test_ratio[3]);
+
+		getBaroHgtInnov(snapshot.baro_hgt.innov);
+		getBaroHgtInnovVar(snapshot.baro_hgt.innov_var);
+		getBaroHgtInnovRatio(snapshot.baro_hgt.test_ratio);
+
+		getRngHgtInnov(snapshot.rng_hgt.innov);
+		getRngHgtInnovVar(snapshot.rng_hgt.innov_var);
+		getRngHgtInnovRatio(snapshot.rng_hgt.test_ratio);
+
+		getHeadingInnov(snapshot.heading.innov);
+		getHeadingInnovVar(snapshot.heading.innov_var);
+		getHeadingInnovRatio(snapshot.heading.test_ratio);
+
+		getAirspeedInnov(snapshot.airspeed.innov);
+		getAirspeedInnovVar(snapshot.airspeed.innov_var);
+		getAirspeedInnovRatio(snapshot.airspeed.test_ratio);
+
+		getBetaInnov(snapshot.beta.innov);
+		getBetaInnovVar(snapshot.beta.innov_var);
+		getBetaInnovRatio(snapshot.beta.test_ratio);
+
+		getHaglInnov(snapshot.hagl.innov);
+		getHaglInnovVar(snapshot.hagl.innov_var);
+		getHaglInnovRatio(snapshot.hagl.test_ratio);
+
+		getAuxVelInnov(snapshot.aux_vel_innov);
+		getAuxVelInnovVar(snapshot.aux_vel_innov_var);
+		getAuxVelInnovRatio(snapshot.aux_vel_test_ratio);
+
+		getFlowInnov(snapshot.flow_innov);
+		getFlowInnovVar(snapshot.flow_innov_var);
+		getFlowInnovRatio(snapshot.flow_test_ratio);
+
+		getMagInnov(snapshot.mag_innov);
+		getMagInnovVar(snapshot.mag_innov_var);
+		getMagInnovRatio(snapshot.mag_field_test_ratio);
+
+		getDragInnov(snapshot.drag_innov);
+		getDragInnovVar(snapshot.drag_innov_var);
+		getDragInnovRatio(snapshot.drag_test_ratio);
+	}
+
+	if (sections & STATUS_SECTION_RESETS) {
+		get_posD_reset(&snapshot.posD_reset, &snapshot.posD_reset_counter);
+		get_velD_reset(&snapshot.velD_reset, &snapshot.velD_reset_counter);
+		get_posNE_reset(snapshot.posNE_reset, &snapshot.posNE_reset_counter);
+		get_velNE_reset(snapshot.velNE_reset, &snapshot.velNE_reset_counter);
+		get_quat_reset(snapshot.quat_reset, &snapshot.quat_reset_counter);
+	}
+
+	if (sections & STATUS_SECTION_INGEST) {
+		getIngestStatus(snapshot.ingest);
+	}
+}
+
 void Ekf::fuse(const Vector24f& K, float innovation)
 {
 	_state.quat_nominal -= K.slice<4, 1>(0, 0) * innovation;
@@ -1688,7 +1792,7 @@ bool Ekf::resetYawToEKFGSF()
 	// data and the yaw estimate has converged
 	float new_yaw, new_yaw_variance;
 
-	if (!yawEstimator.getYawData(&new_yaw, &new_yaw_variance)) {
+	if (!_ekfgsf_active || !yawEstimator.getYawData(&new_yaw, &new_yaw_variance)) {
 		return false;
 	}
 
@@ -1727,11 +1831,29 @@ void Ekf::requestEmergencyNavReset()
 
 bool Ekf::getDataEKFGSF(float *yaw_composite, float *yaw_variance, float yaw[N_MODELS_EKFGSF], float innov_VN[N_MODELS_EKFGSF], float innov_VE[N_MODELS_EKFGSF], float weight[N_MODELS_EKFGSF])
 {
-	return yawEstimator.getLogData(yaw_composite,yaw_variance,yaw,innov_VN,innov_VE,weight);
+	return _ekfgsf_active && yawEstimator.getLogData(yaw_composite,yaw_variance,yaw,innov_VN,innov_VE,weight);
 }
 
 void Ekf::runYawEKFGSF()
 {
+	const bool needed = isYawEKFGSFNeeded();
+
+	if (!needed || _overload_status.flags.ekfgsf) {
+		_ekfgsf_active = false;
+		return;
+	}
+
+	if (!_ekfgsf_active) {
+		_ekfgsf_active = true;
+
+		// the models are stale after being stopped, so restart them from the main filter in flight
+		// on ground the estimator realigns by itself when velocity fusion starts
+		if (_control_status.flags.in_air && _control_status.flags.tilt_align) {
+			const float vel_accuracy = sqrtf(fmaxf(P(4, 4), P(5, 5)));
+			yawEstimator.reset(_state.quat_nominal, _state.vel.xy(), vel_accuracy, getGyroBias());
+		}
+	}
+
 	float TAS;
 	if (isTimedOut(_airspeed_sample_delayed.time_us, 1000000) && _control_status.flags.fixed_wing) {
 		TAS = _params.EKFGSF_tas_default;
@@ -1749,6 +1871,35 @@ void Ekf::runYawEKFGSF()
 	}
 }
 
+bool Ekf::isYawEKFGSFNeeded()
+{
+	// the yaw is stable when it is observed directly and the velocity innovations are consistent
+	const bool yaw_aided = _control_status.flags.mag_hdg || _control_status.flags.mag_3D
+			       || _control_status.flags.gps_yaw || _control_status.flags.ev_yaw;
+	const bool yaw_consistent = _control_status.flags.yaw_align
+				    && !_do_ekfgsf_yaw_reset
+				    && !_yaw_use_inhibit
+				    && !_mag_inhibit_yaw_reset_req
+				    && !_control_status.flags.mag_fault
+				    && !isTimedOut(_time_last_hor_vel_fuse, _params.EKFGSF_reset_delay);
+
+	// keep running on ground so that the estimate has converged when it is needed after takeoff
+	if (!_control_status.flags.in_air || !yaw_aided || !yaw_consistent) {
+		_time_last_yaw_not_stable_us = _imu_sample_delayed.time_us;
+		return true;
+	}
+
+	const uint64_t time_stable = _imu_sample_delayed.time_us - _time_last_yaw_not_stable_us;
+
+	if (_params.EKFGSF_lazy == 0 || time_stable < _params.EKFGSF_lazy_stable_time) {
+		return true;
+	}
+
+	// run for the last part of every period at a low duty cycle to keep checking the yaw
+	const uint64_t period = _params.EKFGSF_lazy_period;
+	return period > 0 && ((time_stable - _params.EKFGSF_lazy_stable_time) % period) + _params.EKFGSF_lazy_duration >= period;
+}
+
 void Ekf::resetGpsDriftCheckFilters()
 {
 	_gps_velNE_filt.setZero();
@@ -124,21 +124,68 @@ bool EstimatorInterface::checkIfVehicleAtRest(float dt)
 }
 
 
+template<typename T>
+bool EstimatorInterface::allocateObsBuffer(RingBuffer<T> &buffer, ObsSensorType sensor, uint8_t default_length,
+		const char *buffer_name)
+{
+	const uint8_t length = buffer.get_length();
+	bool allocated = true;
+
+	if ((_params.obs_buffer_sizing == 1) && _obs_ingest[sensor].isValid()) {
+		// the buffer is only resized on ground, in flight it keeps the length it had at takeoff
+		if (!_control_status.flags.in_air
+		    && (_newest_high_rate_imu_sample.time_us >= _time_last_obs_sizing_us[sensor] + OBS_BUFFER_SIZING_INTERVAL_US)) {
+			_time_last_obs_sizing_us[sensor] = _newest_high_rate_imu_sample.time_us;
+
+			const uint32_t horizon_delay_us = math::max((uint32_t)(_newest_high_rate_imu_sample.time_us - _imu_sample_delayed.time_us),
+							  (uint32_t)(_imu_buffer_length - 1) * FILTER_UPDATE_PERIOD_MS * 1000);
+			const uint8_t required_length = _obs_ingest[sensor].getRequiredLength(horizon_delay_us, _min_obs_interval_us,
+							_imu_buffer_length);
+
+			// do not follow small changes of the timing back and forth
+			if ((required_length > length) || (required_length + 1 < length)) {
+				const uint8_t used_length = buffer.get_used_length();
+				allocated = buffer.resize(required_length);
+
+				// resizing keeps the newest samples
+				if (allocated && (used_length > required_length)) {
+					_obs_ingest[sensor].recordResizeDropped(used_length - required_length);
+				}
+			}
+		}
+
+	} else if (length < default_length) {
+		allocated = buffer.allocate(default_length);
+	}
+
+	if (!allocated) {
+		printBufferAllocationFailed(buffer_name);
+	}
+
+	return allocated;
+}
+
+template<typename T>
+void EstimatorInterface::pushObservation(RingBuffer<T> &buffer, ObsSensorType sensor, ObsBufferMask mask, const T &sample)
+{
+	const bool overwritten = buffer.push(sample);
+	_obs_ingest[sensor].update(sample.time_us, _newest_high_rate_imu_sample.time_us, buffer.get_length(),
+				   buffer.get_used_length(), overwritten);
+	_obs_pending |= mask;
+}
+
 void EstimatorInterface::setMagData(const magSample &mag_sample)
 {
 	if (!_initialised || _mag_buffer_fail) {
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_mag_buffer.get_length() < _obs_buffer_length) {
-		_mag_buffer_fail = !_mag_buffer.allocate(_obs_buffer_length);
+	_mag_buffer_fail = !allocateObsBuffer(_mag_buffer, OBS_SENSOR_MAG, _obs_buffer_length, "mag");
 
-		if (_mag_buffer_fail) {
-			printBufferAllocationFailed("mag");
-			return;
-		}
+	if (_mag_buffer_fail) {
+		return;
 	}
 
 	// downsample to highest possible sensor rate
@@ -147,6 +194,8 @@ void EstimatorInterface::setMagData(const magSample &mag_sample)
 	_mag_data_sum += mag_sample.mag;
 	_mag_timestamp_sum += mag_sample.time_us / 1000; // Dividing by 1000 to avoid overflow
 
+	_obs_ingest[OBS_SENSOR_MAG].recordReceived((mag_sample.time_us - _time_last_mag) <= _min_obs_interval_us, true);
+
 	// limit data rate to prevent data being lost
 	if ((mag_sample.time_us - _time_last_mag) > _min_obs_interval_us) {
 		_time_last_mag = mag_sample.time_us;
@@ -160,7 +209,7 @@ void EstimatorInterface::setMagData(const magSample &mag_sample)
 
 		mag_sample_new.mag = _mag_data_sum / _mag_sample_count;
 
-		_mag_buffer.push(mag_sample_new);
+		pushObservation(_mag_buffer, OBS_SENSOR_MAG, OBS_MAG, mag_sample_new);
 
 		_mag_sample_count = 0;
 		_mag_data_sum.setZero();
@@ -174,20 +223,19 @@ void EstimatorInterface::setGpsData(const gps_message &gps)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_gps_buffer.get_length() < _obs_buffer_length) {
-		_gps_buffer_fail = !_gps_buffer.allocate(_obs_buffer_length);
+	_gps_buffer_fail = !allocateObsBuffer(_gps_buffer, OBS_SENSOR_GPS, _obs_buffer_length, "GPS");
 
-		if (_gps_buffer_fail) {
-			printBufferAllocationFailed("GPS");
-			return;
-		}
+	if (_gps_buffer_fail) {
+		return;
 	}
 
 	// limit data rate to prevent data being lost
 	bool need_gps = (_params.fusion_mode & MASK_USE_GPS) || (_params.vdist_sensor_type == VDIST_SENSOR_GPS);
 
+	_obs_ingest[OBS_SENSOR_GPS].recordReceived((gps.time_usec - _time_last_gps) <= _min_obs_interval_us, false);
+
 	// TODO: remove checks that are not timing related
 	if (((gps.time_usec - _time_last_gps) > _min_obs_interval_us) && need_gps && gps.fix_type > 2) {
 		_time_last_gps = gps.time_usec;
@@ -226,7 +274,7 @@ void EstimatorInterface::setGpsData(const gps_message &gps)
 			gps_sample_new.pos(1) = 0.0f;
 		}
 
-		_gps_buffer.push(gps_sample_new);
+		pushObservation(_gps_buffer, OBS_SENSOR_GPS, OBS_GPS, gps_sample_new);
 	}
 }
 
@@ -236,15 +284,12 @@ void EstimatorInterface::setBaroData(const baroSample &baro_sample)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_baro_buffer.get_length() < _obs_buffer_length) {
-		_baro_buffer_fail = !_baro_buffer.allocate(_obs_buffer_length);
+	_baro_buffer_fail = !allocateObsBuffer(_baro_buffer, OBS_SENSOR_BARO, _obs_buffer_length, "baro");
 
-		if (_baro_buffer_fail) {
-			printBufferAllocationFailed("baro");
-			return;
-		}
+	if (_baro_buffer_fail) {
+		return;
 	}
 
 	// downsample to highest possible sensor rate
@@ -253,6 +298,8 @@ void EstimatorInterface::setBaroData(const baroSample &baro_sample)
 	_baro_alt_sum += baro_sample.hgt;
 	_baro_timestamp_sum += baro_sample.time_us / 1000; // Dividing by 1000 to avoid overflow
 
+	_obs_ingest[OBS_SENSOR_BARO].recordReceived((baro_sample.time_us - _time_last_baro) <= _min_obs_interval_us, true);
+
 	// limit data rate to prevent data being lost
 	if ((baro_sample.time_us - _time_last_baro) > _min_obs_interval_us) {
 		_time_last_baro = baro_sample.time_us;
@@ -267,7 +314,7 @@ void EstimatorInterface::setBaroData(const baroSample &baro_sample)
 		baro_sample_new.time_us -= _params.baro_delay_ms * 1000;
 		baro_sample_new.time_us -= FILTER_UPDATE_PERIOD_MS * 1000 / 2;
 
-		_baro_buffer.push(baro_sample_new);
+		pushObservation(_baro_buffer, OBS_SENSOR_BARO, OBS_BARO, baro_sample_new);
 
 		_baro_sample_count = 0;
 		_baro_alt_sum = 0.0f;
@@ -281,17 +328,16 @@ void EstimatorInterface::setAirspeedData(const airspeedSample &airspeed_sample)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_airspeed_buffer.get_length() < _obs_buffer_length) {
-		_airspeed_buffer_fail = !_airspeed_buffer.allocate(_obs_buffer_length);
+	_airspeed_buffer_fail = !allocateObsBuffer(_airspeed_buffer, OBS_SENSOR_AIRSPEED, _obs_buffer_length, "airspeed");
 
-		if (_airspeed_buffer_fail) {
-			printBufferAllocationFailed("airspeed");
-			return;
-		}
+	if (_airspeed_buffer_fail) {
+		return;
 	}
 
+	_obs_ingest[OBS_SENSOR_AIRSPEED].recordReceived((airspeed_sample.time_us - _time_last_airspeed) <= _min_obs_interval_us, false);
+
 	// limit data rate to prevent data being lost
 	if ((airspeed_sample.time_us - _time_last_airspeed) > _min_obs_interval_us) {
 		_time_last_airspeed = airspeed_sample.time_us;
@@ -301,7 +347,7 @@ void EstimatorInterface::setAirspeedData(const airspeedSample &airspeed_sample)
 		airspeed_sample_new.time_us -= _params.airspeed_delay_ms * 1000;
 		airspeed_sample_new.time_us -= FILTER_UPDATE_PERIOD_MS * 1000 / 2;
 
-		_airspeed_buffer.push(airspeed_sample_new);
+		pushObservation(_airspeed_buffer, OBS_SENSOR_AIRSPEED, OBS_AIRSPEED, airspeed_sample_new);
 	}
 }
 
@@ -311,17 +357,16 @@ void EstimatorInterface::setRangeData(const rangeSample& range_sample)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_range_buffer.get_length() < _obs_buffer_length) {
-		_range_buffer_fail = !_range_buffer.allocate(_obs_buffer_length);
+	_range_buffer_fail = !allocateObsBuffer(_range_buffer, OBS_SENSOR_RANGE, _obs_buffer_length, "range");
 
-		if (_range_buffer_fail) {
-			printBufferAllocationFailed("range");
-			return;
-		}
+	if (_range_buffer_fail) {
+		return;
 	}
 
+	_obs_ingest[OBS_SENSOR_RANGE].recordReceived((range_sample.time_us - _time_last_range) <= _min_obs_interval_us, false);
+
 	// limit data rate to prevent data being lost
 	if ((range_sample.time_us - _time_last_range) > _min_obs_interval_us) {
 		_time_last_range = range_sample.time_us;
@@ -330,7 +375,7 @@ void EstimatorInterface::setRangeData(const rangeSample& range_sample)
 		range_sample_new.time_us -= _params.range_delay_ms * 1000;
 		range_sample_new.time_us -= FILTER_UPDATE_PERIOD_MS * 1000 / 2;
 
-		_range_buffer.push(range_sample_new);
+		pushObservation(_range_buffer, OBS_SENSOR_RANGE, OBS_RANGE, range_sample_new);
 	}
 }
 
@@ -340,17 +385,16 @@ void EstimatorInterface::setOpticalFlowData(const flowSample& flow)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_flow_buffer.get_length() < _imu_buffer_length) {
-		_flow_buffer_fail = !_flow_buffer.allocate(_imu_buffer_length);
+	_flow_buffer_fail = !allocateObsBuffer(_flow_buffer, OBS_SENSOR_FLOW, _imu_buffer_length, "flow");
 
-		if (_flow_buffer_fail) {
-			printBufferAllocationFailed("flow");
-			return;
-		}
+	if (_flow_buffer_fail) {
+		return;
 	}
 
+	_obs_ingest[OBS_SENSOR_FLOW].recordReceived((flow.time_us - _time_last_optflow) <= _min_obs_interval_us, false);
+
 	// limit data rate to prevent data being lost
 	if ((flow.time_us - _time_last_optflow) > _min_obs_interval_us) {
 		// check if enough integration time and fail if integration time is less than 50%
@@ -391,7 +435,7 @@ void EstimatorInterface::setOpticalFlowData(const flowSample& flow)
 
 			optflow_sample_new.dt = delta_time;
 
-			_flow_buffer.push(optflow_sample_new);
+			pushObservation(_flow_buffer, OBS_SENSOR_FLOW, OBS_FLOW, optflow_sample_new);
 		}
 	}
 }
@@ -403,17 +447,16 @@ void EstimatorInterface::setExtVisionData(const extVisionSample& evdata)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_ext_vision_buffer.get_length() < _obs_buffer_length) {
-		_ev_buffer_fail = !_ext_vision_buffer.allocate(_obs_buffer_length);
+	_ev_buffer_fail = !allocateObsBuffer(_ext_vision_buffer, OBS_SENSOR_EXT_VISION, _obs_buffer_length, "vision");
 
-		if (_ev_buffer_fail) {
-			printBufferAllocationFailed("vision");
-			return;
-		}
+	if (_ev_buffer_fail) {
+		return;
 	}
 
+	_obs_ingest[OBS_SENSOR_EXT_VISION].recordReceived((evdata.time_us - _time_last_ext_vision) <= _min_obs_interval_us, false);
+
 	// limit data rate to prevent data being lost
 	if ((evdata.time_us - _time_last_ext_vision) > _min_obs_interval_us) {
 		_time_last_ext_vision = evdata.time_us;
@@ -423,7 +466,7 @@ void EstimatorInterface::setExtVisionData(const extVisionSample& evdata)
 		ev_sample_new.time_us -= _params.ev_delay_ms * 1000;
 		ev_sample_new.time_us -= FILTER_UPDATE_PERIOD_MS * 1000 / 2;
 
-		_ext_vision_buffer.push(ev_sample_new);
+		pushObservation(_ext_vision_buffer, OBS_SENSOR_EXT_VISION, OBS_EXT_VISION, ev_sample_new);
 	}
 }
 
@@ -433,17 +476,16 @@ void EstimatorInterface::setAuxVelData(const auxVelSample& auxvel_sample)
 		return;
 	}
 
-	// Allocate the required buffer size if not previously done
+	// Allocate the required buffer size if not previously done, or resize it to the measured sensor timing
 	// Do not retry if allocation has failed previously
-	if (_auxvel_buffer.get_length() < _obs_buffer_length) {
-		_auxvel_buffer_fail = !_auxvel_buffer.allocate(_obs_buffer_length);
+	_auxvel_buffer_fail = !allocateObsBuffer(_auxvel_buffer, OBS_SENSOR_AUXVEL, _obs_buffer_length, "aux vel");
 
-		if (_auxvel_buffer_fail) {
-			printBufferAllocationFailed("aux vel");
-			return;
-		}
+	if (_auxvel_buffer_fail) {
+		return;
 	}
 
+	_obs_ingest[OBS_SENSOR_AUXVEL].recordReceived((auxvel_sample.time_us - _time_last_auxvel) <= _min_obs_interval_us, false);
+
 	// limit data rate to prevent data being lost
 	if ((auxvel_sample.time_us - _time_last_auxvel) > _min_obs_interval_us) {
 		_time_last_auxvel = auxvel_sample.time_us;
@@ -453,7 +495,7 @@ void EstimatorInterface::setAuxVelData(const auxVelSample& auxvel_sample)
 		auxvel_sample_new.time_us -= _params.auxvel_delay_ms * 1000;
 		auxvel_sample_new.time_us -= FILTER_UPDATE_PERIOD_MS * 1000 / 2;
 
-		_auxvel_buffer.push(auxvel_sample_new);
+		pushObservation(_auxvel_buffer, OBS_SENSOR_AUXVEL, OBS_AUXVEL, auxvel_sample_new);
 	}
 }
 
@@ -496,7 +538,8 @@ void EstimatorInterface::setDragData()
 			_drag_down_sampled.time_us /= _drag_sample_count;
 
 			// write to buffer
-			_drag_buffer.push(_drag_down_sampled);
+			_obs_ingest[OBS_SENSOR_DRAG].recordReceived(false, false);
+			pushObservation(_drag_buffer, OBS_SENSOR_DRAG, OBS_DRAG, _drag_down_sampled);
 
 			// reset accumulators
 			_drag_sample_count = 0;
@@ -509,15 +552,20 @@ void EstimatorInterface::setDragData()
 
 bool EstimatorInterface::initialise_interface(uint64_t timestamp)
 {
+	// GPS and airspeed measurements can be fused after the time they were measured at, shortening the time horizon delay
+	_retrodiction_ms = math::constrain(_params.retrodiction_max_ms, 0.0f, RETRODICTION_MAX_MS);
+	const float gps_horizon_delay_ms = math::max(_params.gps_delay_ms - _retrodiction_ms, 0.0f);
+	const float airspeed_horizon_delay_ms = math::max(_params.airspeed_delay_ms - _retrodiction_ms, 0.0f);
+
 	// find the maximum time delay the buffers are required to handle
 	uint16_t max_time_delay_ms = math::max(_params.mag_delay_ms,
 					 math::max(_params.range_delay_ms,
-					     math::max(_params.gps_delay_ms,
+					     math::max(gps_horizon_delay_ms,
 						 math::max(_params.flow_delay_ms,
 						     math::max(_params.ev_delay_ms,
 							 math::max(_params.auxvel_delay_ms,
 							     math::max(_params.min_delay_ms,
-								 math::max(_params.airspeed_delay_ms, _params.baro_delay_ms))))))));
+								 math::max(airspeed_horizon_delay_ms, _params.baro_delay_ms))))))));
 
 	// calculate the IMU buffer length required to accomodate the maximum delay with some allowance for jitter
 	_imu_buffer_length = (max_time_delay_ms / FILTER_UPDATE_PERIOD_MS) + 1;
@@ -540,6 +588,15 @@ bool EstimatorInterface::initialise_interface(uint64_t timestamp)
 		return false;
 	}
 
+	// keep the state changes predicted over the time the late measurements are corrected for, with some allowance for jitter
+	if ((_retrodiction_ms > 0.0f)
+	    && !_state_delta_buffer.allocate((uint8_t)ceilf(_retrodiction_ms / FILTER_UPDATE_PERIOD_MS) + 2)) {
+
+		printBufferAllocationFailed("state delta");
+		unallocate_buffers();
+		return false;
+	}
+
 	_imu_sample_delayed.time_us = timestamp;
 	_imu_sample_delayed.delta_vel_clipping[0] = false;
 	_imu_sample_delayed.delta_vel_clipping[1] = false;
@@ -547,11 +604,17 @@ bool EstimatorInterface::initialise_interface(uint64_t timestamp)
 
 	_fault_status.value = 0;
 
+	for (ObsIngestMonitor &monitor : _obs_ingest) {
+		monitor.reset();
+	}
+
 	return true;
 }
 
 void EstimatorInterface::unallocate_buffers()
 {
+	_obs_pending = 0;
+
 	_imu_buffer.unallocate();
 	_gps_buffer.unallocate();
 	_mag_buffer.unallocate();
@@ -562,6 +625,7 @@ void EstimatorInterface::unallocate_buffers()
 	_ext_vision_buffer.unallocate();
 	_output_buffer.unallocate();
 	_output_vert_buffer.unallocate();
+	_state_delta_buffer.unallocate();
 	_drag_buffer.unallocate();
 	_auxvel_buffer.unallocate();
 
@@ -597,6 +661,13 @@ bool EstimatorInterface::isHorizontalAidingActive() const
 	return getNumberOfActiveHorizontalAidingSources() > 0;
 }
 
+void EstimatorInterface::getIngestStatus(ingestStatus &status) const
+{
+	for (uint8_t sensor = 0; sensor < OBS_SENSOR_COUNT; sensor++) {
+		_obs_ingest[sensor].getStatus(status.sensor[sensor]);
+	}
+}
+
 void EstimatorInterface::printBufferAllocationFailed(const char * buffer_name)
 {
 	if(buffer_name)
@@ -621,4 +692,24 @@ void EstimatorInterface::print_status()
 	ECL_INFO("output buffer: %d (%d Bytes)", _output_buffer.get_length(), _output_buffer.get_total_size());
 	ECL_INFO("output vert buffer: %d (%d Bytes)", _output_vert_buffer.get_length(), _output_vert_buffer.get_total_size());
 	ECL_INFO("drag buffer: %d (%d Bytes)", _drag_buffer.get_length(), _drag_buffer.get_total_size());
+	ECL_INFO("state delta buffer: %d (%d Bytes)", _state_delta_buffer.get_length(), _state_delta_buffer.get_total_size());
+
+	static const char *const obs_sensor_names[OBS_SENSOR_COUNT] = {"gps", "mag", "baro", "range", "airspeed", "flow", "vision", "drag", "aux vel"};
+
+	for (uint8_t sensor = 0; sensor < OBS_SENSOR_COUNT; sensor++) {
+		const ObsIngestMonitor &monitor = _obs_ingest[sensor];
+
+		if (monitor.isValid()) {
+			obsIngestStatus status;
+			monitor.getStatus(status);
+
+			ECL_INFO("%s timing: interval %.1f ms, jitter %.1f ms, age %.1f ms, peak buffer use %u/%u", obs_sensor_names[sensor],
+				 (double)(status.interval_us * 1e-3f), (double)(status.jitter_us * 1e-3f),
+				 (double)(status.age_us * 1e-3f), (unsigned)status.peak_occupancy, (unsigned)status.buffer_length);
+			ECL_INFO("%s samples: %u received, %u averaged, %u dropped, %u overwritten, %u resize dropped, %u fused, %u rejected",
+				 obs_sensor_names[sensor], (unsigned)status.received, (unsigned)status.averaged, (unsigned)status.dropped,
+				 (unsigned)status.overwritten, (unsigned)status.resize_dropped, (unsigned)status.fused,
+				 (unsigned)status.gate_rejected);
+		}
+	}
 }
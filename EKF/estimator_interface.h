@@ -48,6 +48,7 @@
 #include "imu_down_sampler.hpp"
 #include "EKFGSF_yaw.h"
 #include "sensor_range_finder.hpp"
+#include "obs_ingest_monitor.hpp"
 #include "utils.hpp"
 
 #include <geo/geo.h>
@@ -62,6 +63,8 @@ class EstimatorInterface
 public:
 	EstimatorInterface():_imu_down_sampler(FILTER_UPDATE_PERIOD_S){};
 	virtual ~EstimatorInterface() = default;
+	EstimatorInterface(const EstimatorInterface &) = default;
+	EstimatorInterface &operator=(const EstimatorInterface &) = default;
 
 	virtual bool init(uint64_t timestamp) = 0;
 	virtual void reset() = 0;
@@ -394,6 +397,15 @@ public:
 
 	void print_status();
 
+	// delay of the fusion time horizon behind the newest IMU data (mSec)
+	unsigned getFusionHorizonDelayMs() const { return (_imu_buffer_length > 0) ? (_imu_buffer_length - 1) * FILTER_UPDATE_PERIOD_MS : 0; }
+
+	// arrival timing and overruns of the observation buffer of a sensor
+	const ObsIngestMonitor &getObsIngest(ObsSensorType sensor) const { return _obs_ingest[sensor]; }
+
+	// sample counts and arrival timing of all observation sensors
+	void getIngestStatus(ingestStatus &status) const;
+
 	static constexpr unsigned FILTER_UPDATE_PERIOD_MS{10};	// ekf prediction period in milliseconds - this should ideally be an integer multiple of the IMU time delta
 	static constexpr float FILTER_UPDATE_PERIOD_S{FILTER_UPDATE_PERIOD_MS * 0.001f};
 
@@ -427,6 +439,10 @@ protected:
 	*/
 	uint8_t _imu_buffer_length{0};
 
+	// GPS and airspeed measurements can be fused at most this long after they were measured, see retrodiction_max_ms
+	static constexpr float RETRODICTION_MAX_MS{80.0f};	// stays below the 100 msec the observation buffers accept older samples for
+	float _retrodiction_ms{0.0f};	// time the fusion time horizon delay has been shortened by, 0 if disabled (msec)
+
 	unsigned _min_obs_interval_us{0}; // minimum time interval between observations that will guarantee data is not lost (usec)
 
 	float _dt_imu_avg{0.0f};	// average imu update period in s
@@ -525,6 +541,30 @@ protected:
 	RingBuffer<outputVert> _output_vert_buffer;
 	RingBuffer<dragSample> _drag_buffer;
 	RingBuffer<auxVelSample> _auxvel_buffer;
+	RingBuffer<stateDeltaSample> _state_delta_buffer;	///< state changes predicted over the retrodiction time
+
+	// observation buffers holding samples that have not been popped at the fusion time horizon yet,
+	// a bit is set when a sample is pushed and cleared when the fusion has emptied the buffer
+	enum ObsBufferMask : uint16_t {
+		OBS_GPS = (1 << 0),
+		OBS_MAG = (1 << 1),
+		OBS_BARO = (1 << 2),
+		OBS_RANGE = (1 << 3),
+		OBS_AIRSPEED = (1 << 4),
+		OBS_FLOW = (1 << 5),
+		OBS_EXT_VISION = (1 << 6),
+		OBS_DRAG = (1 << 7),
+		OBS_AUXVEL = (1 << 8)
+	};
+	uint16_t _obs_pending{0};
+
+	// arrival timing of the samples pushed to each observation buffer, see obs_ingest_monitor.hpp
+	ObsIngestMonitor _obs_ingest[OBS_SENSOR_COUNT];
+
+	// the length of an observation buffer is evaluated at most once per interval so that the timing
+	// noise does not make the sensor callbacks reallocate the buffer at the sample rate
+	static constexpr uint64_t OBS_BUFFER_SIZING_INTERVAL_US = 1000000;
+	uint64_t _time_last_obs_sizing_us[OBS_SENSOR_COUNT] {};	///< IMU time of the last evaluation of each buffer length (uSec)
 
 	// yaw estimator instance
 	EKFGSF_yaw yawEstimator;
@@ -589,4 +629,18 @@ protected:
 	virtual float compensateBaroForDynamicPressure(const float baro_alt_uncompensated) = 0;
 
 	void printBufferAllocationFailed(const char * buffer_name);
+
+	// allocate an observation buffer if not done yet, or resize it on ground to the length the measured
+	// arrival timing of the sensor needs when obs_buffer_sizing is enabled, returns false if the allocation failed,
+	// samples discarded by a shorter buffer are counted separately from overwritten ones
+	template<typename T>
+	bool allocateObsBuffer(RingBuffer<T> &buffer, ObsSensorType sensor, uint8_t default_length, const char *buffer_name);
+
+	// push a sample to an observation buffer and record its arrival timing
+	template<typename T>
+	void pushObservation(RingBuffer<T> &buffer, ObsSensorType sensor, ObsBufferMask mask, const T &sample);
+
+	// save or restore all members of the interface, see snapshot.hpp
+	template<typename Archive>
+	void snapshotInterface(Archive &ar);
 };
@@ -0,0 +1,219 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Polynomial approximations of the libm functions used on the estimator hot paths.
+ *
+ * The functions in fast_math are always approximate and can be called directly where
+ * their error is acceptable. The functions in hotpath use the approximations when the
+ * library is built with ECL_FAST_MATH and fall back to libm otherwise, so each call site
+ * chooses between libm, the approximation and the build option.
+ *
+ * The quoted maximum errors are checked against libm in test_fastMath.cpp.
+ */
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <matrix/math.hpp>
+
+namespace estimator
+{
+namespace fast_math
+{
+
+static constexpr float kPi = 3.14159265f;
+static constexpr float kPi2 = 1.57079633f;
+
+inline uint32_t floatToBits(float x)
+{
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return bits;
+}
+
+inline float bitsToFloat(uint32_t bits)
+{
+	float x;
+	memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+// four quadrant arc tangent (rad) for finite inputs, returns 0 for atan2(0, 0)
+// max absolute error 3.0e-7 rad
+inline float atan2(float y, float x)
+{
+	const float abs_x = fabsf(x);
+	const float abs_y = fabsf(y);
+	const float den = (abs_x > abs_y) ? abs_x : abs_y;
+
+	if (den <= 0.0f) {
+		return 0.0f;
+	}
+
+	// arc tangent of a ratio in [0, 1], polynomial in a^2 from Abramowitz and Stegun 4.4.49
+	const float a = ((abs_x > abs_y) ? abs_y : abs_x) / den;
+	const float s = a * a;
+	float angle = a * (1.0f + s * (-0.3333314528f + s * (0.1999355085f + s * (-0.1420889944f + s *
+			   (0.1065626393f + s * (-0.0752896400f + s * (0.0429096138f + s * (-0.0161657367f + s *
+					   0.0028662257f))))))));
+
+	if (abs_y > abs_x) {
+		angle = kPi2 - angle;
+	}
+
+	if (x < 0.0f) {
+		angle = kPi - angle;
+	}
+
+	return (y < 0.0f) ? -angle : angle;
+}
+
+// sine and cosine of an angle (rad) with |x| < 1.0e4
+// max absolute error 2.5e-7
+inline void sincos(float x, float &sin_x, float &cos_x)
+{
+	// reduce to r in [-pi/4, pi/4] with x = r + quadrant * pi/2
+	// pi/2 is split in three parts whose leading ones have few enough bits for the products to be exact
+	const float quadrant = floorf(x * 0.636619772f + 0.5f);
+	const float r = ((x - quadrant * 1.5703125f) - quadrant * 4.837512969970703125e-4f) - quadrant * 7.549789954891882e-8f;
+	const float r2 = r * r;
+
+	// minimax polynomials on [-pi/4, pi/4]
+	const float sin_r = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+	const float cos_r = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568e-2f + r2 * (-1.388731625e-3f + r2 * 2.443315711e-5f));
+
+	switch (static_cast<int32_t>(quadrant) & 3) {
+	case 0:
+		sin_x = sin_r;
+		cos_x = cos_r;
+		break;
+
+	case 1:
+		sin_x = cos_r;
+		cos_x = -sin_r;
+		break;
+
+	case 2:
+		sin_x = -sin_r;
+		cos_x = -cos_r;
+		break;
+
+	default:
+		sin_x = -cos_r;
+		cos_x = sin_r;
+		break;
+	}
+}
+
+// natural exponential, returns 0 below -87 and saturates at exp(88)
+// max relative error 4.0e-7
+inline float exp(float x)
+{
+	if (x < -87.0f) {
+		return 0.0f;
+	}
+
+	if (x > 88.0f) {
+		x = 88.0f;
+	}
+
+	// x = f + n * ln(2) with f in [-ln(2)/2, ln(2)/2], ln(2) split in two parts to keep f accurate
+	const float n = floorf(x * 1.44269504f + 0.5f);
+	const float f = (x - n * 0.693359375f) + n * 2.12194440e-4f;
+
+	// minimax polynomial for exp(f)
+	const float exp_f = 1.0f + f + f * f * (5.0000001201e-1f + f * (1.6666665459e-1f + f * (4.1665795894e-2f + f *
+			    (8.3334519073e-3f + f * (1.3981999507e-3f + f * 1.9875691500e-4f)))));
+
+	// scale by 2^n by writing the exponent bits directly
+	return exp_f * bitsToFloat(static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23);
+}
+
+// inverse square root for x > 0
+// bit level initial guess refined by two Newton-Raphson iterations, max relative error 5.0e-6
+inline float invSqrt(float x)
+{
+	float y = bitsToFloat(0x5f375a86u - (floatToBits(x) >> 1));
+	const float half_x = 0.5f * x;
+	y = y * (1.5f - half_x * y * y);
+	y = y * (1.5f - half_x * y * y);
+	return y;
+}
+
+// quaternion of the rotation given by a rotation vector (rad)
+// components within 5.0e-6 of the exact ones, limited by invSqrt()
+inline matrix::Quatf quatFromAxisAngle(const matrix::Vector3f &rot_vec)
+{
+	const float angle_sq = rot_vec.dot(rot_vec);
+
+	// same threshold as matrix::Quaternion(const AxisAngle &)
+	if (angle_sq < 1e-20f) {
+		return matrix::Quatf{};
+	}
+
+	const float angle_inv = invSqrt(angle_sq);
+	float sin_half;
+	float cos_half;
+	sincos(0.5f * angle_sq * angle_inv, sin_half, cos_half);
+	const float scale = sin_half * angle_inv;
+	return matrix::Quatf{cos_half, rot_vec(0) * scale, rot_vec(1) * scale, rot_vec(2) * scale};
+}
+
+} // namespace fast_math
+
+namespace hotpath
+{
+
+#if defined(ECL_FAST_MATH)
+
+inline float atan2f(float y, float x) { return fast_math::atan2(y, x); }
+inline void sincosf(float x, float &sin_x, float &cos_x) { fast_math::sincos(x, sin_x, cos_x); }
+inline float expf(float x) { return fast_math::exp(x); }
+inline float invSqrtf(float x) { return fast_math::invSqrt(x); }
+inline matrix::Quatf quatFromAxisAngle(const matrix::Vector3f &rot_vec) { return fast_math::quatFromAxisAngle(rot_vec); }
+
+#else
+
+inline float atan2f(float y, float x) { return ::atan2f(y, x); }
+inline void sincosf(float x, float &sin_x, float &cos_x) { sin_x = ::sinf(x); cos_x = ::cosf(x); }
+inline float expf(float x) { return ::expf(x); }
+inline float invSqrtf(float x) { return 1.0f / ::sqrtf(x); }
+inline matrix::Quatf quatFromAxisAngle(const matrix::Vector3f &rot_vec) { return matrix::Quatf{matrix::AxisAnglef{rot_vec}}; }
+
+#endif // ECL_FAST_MATH
+
+} // namespace hotpath
+} // namespace estimator
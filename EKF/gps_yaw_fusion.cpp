@@ -66,7 +66,7 @@ void Ekf::fuseGpsYaw()
 	}
 
 	// calculate predicted antenna yaw angle
-	const float predicted_hdg =  atan2f(ant_vec_ef(1),ant_vec_ef(0));
+	const float predicted_hdg =  hotpath::atan2f(ant_vec_ef(1),ant_vec_ef(0));
 
 	// calculate observation jacobian
 	float t2 = sinf(_gps_yaw_offset);
@@ -58,12 +58,22 @@ public:
 		return _imu_down_sampled;
 	}
 
+	// save or restore the down sampling state, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar)
+	{
+		ar.io(_imu_down_sampled);
+		ar.io(_delta_angle_accumulated);
+		ar.io(_imu_collection_time_adj);
+		ar.io(_do_reset);
+	}
+
 private:
 	void reset();
 
 	imuSample _imu_down_sampled{};
 	Quatf _delta_angle_accumulated{};
-	const float _target_dt;  // [sec]
+	float _target_dt;  // [sec]
 	float _imu_collection_time_adj{0.f};
 	bool _do_reset{true};
 };
@@ -338,8 +338,12 @@ void Ekf::runMagAndMagDeclFusions()
 {
 	if (_control_status.flags.mag_3D) {
 		run3DMagAndDeclFusions();
+		_obs_ingest[OBS_SENSOR_MAG].recordFusion(!(_innov_check_fail_status.flags.reject_mag_x
+						       || _innov_check_fail_status.flags.reject_mag_y
+						       || _innov_check_fail_status.flags.reject_mag_z));
 	} else if (_control_status.flags.mag_hdg) {
 		fuseHeading();
+		_obs_ingest[OBS_SENSOR_MAG].recordFusion(!_innov_check_fail_status.flags.reject_yaw);
 	}
 }
 
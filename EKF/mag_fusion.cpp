@@ -491,7 +491,7 @@ void Ekf::fuseYaw321(float yaw, float yaw_variance, bool zero_innovation)
 	if (zero_innovation) {
 		innovation = 0.0f;
 	} else {
-		innovation = wrap_pi(atan2f(_R_to_earth(1, 0), _R_to_earth(0, 0)) - measurement);
+		innovation = wrap_pi(hotpath::atan2f(_R_to_earth(1, 0), _R_to_earth(0, 0)) - measurement);
 	}
 
 	// define the innovation gate size
@@ -582,7 +582,7 @@ void Ekf::fuseYaw312(float yaw, float yaw_variance, bool zero_innovation)
 		innovation = 0.0f;
 	} else {
 		// calculate the the innovation and wrap to the interval between +-pi
-		innovation = wrap_pi(atan2f(-_R_to_earth(0, 1), _R_to_earth(1, 1)) - measurement);
+		innovation = wrap_pi(hotpath::atan2f(-_R_to_earth(0, 1), _R_to_earth(1, 1)) - measurement);
 	}
 
 	// define the innovation gate size
@@ -769,14 +769,14 @@ void Ekf::fuseHeading()
 			}
 
 			// the angle of the projection onto the horizontal gives the yaw angle
-			measured_hdg = -atan2f(mag_earth_pred(1), mag_earth_pred(0)) + getMagDeclination();
+			measured_hdg = -hotpath::atan2f(mag_earth_pred(1), mag_earth_pred(0)) + getMagDeclination();
 
 		} else if (_control_status.flags.ev_yaw) {
 			// calculate the yaw angle for a 321 sequence
 			// Expressions obtained from yaw_input_321.c produced by https://github.com/PX4/ecl/blob/master/matlab/scripts/Inertial%20Nav%20EKF/quat2yaw321.m
 			const float Tbn_1_0 = 2.0f*(_ev_sample_delayed.quat(0)*_ev_sample_delayed.quat(3)+_ev_sample_delayed.quat(1)*_ev_sample_delayed.quat(2));
 			const float Tbn_0_0 = sq(_ev_sample_delayed.quat(0))+sq(_ev_sample_delayed.quat(1))-sq(_ev_sample_delayed.quat(2))-sq(_ev_sample_delayed.quat(3));
-			measured_hdg = atan2f(Tbn_1_0,Tbn_0_0);
+			measured_hdg = hotpath::atan2f(Tbn_1_0,Tbn_0_0);
 
 		} else {
 			measured_hdg = predicted_hdg;
@@ -817,14 +817,14 @@ void Ekf::fuseHeading()
 	} else {
 
 		// pitched more than rolled so use 312 rotation order to calculate the observed yaw angle
-		predicted_hdg = atan2f(-_R_to_earth(0, 1), _R_to_earth(1, 1));
+		predicted_hdg = hotpath::atan2f(-_R_to_earth(0, 1), _R_to_earth(1, 1));
 		if (_control_status.flags.mag_hdg) {
 
 			// Calculate the body to earth frame rotation matrix from the euler angles using a 312 rotation sequence
 			// with yaw angle set to to zero
 			const Vector3f rotVec312(0.0f,  // yaw
 						 asinf(_R_to_earth(2, 1)),  // roll
-						 atan2f(-_R_to_earth(2, 0), _R_to_earth(2, 2)));  // pitch
+						 hotpath::atan2f(-_R_to_earth(2, 0), _R_to_earth(2, 2)));  // pitch
 			const Dcmf R_to_earth = taitBryan312ToRotMat(rotVec312);
 
 			// rotate the magnetometer measurements into earth frame using a zero yaw angle
@@ -836,14 +836,14 @@ void Ekf::fuseHeading()
 			}
 
 			// the angle of the projection onto the horizontal gives the yaw angle
-			measured_hdg = -atan2f(mag_earth_pred(1), mag_earth_pred(0)) + getMagDeclination();
+			measured_hdg = -hotpath::atan2f(mag_earth_pred(1), mag_earth_pred(0)) + getMagDeclination();
 
 		} else if (_control_status.flags.ev_yaw) {
 			// calculate the yaw angle for a 312 sequence
 			// Values from yaw_input_312.c file produced by https://github.com/PX4/ecl/blob/master/matlab/scripts/Inertial%20Nav%20EKF/quat2yaw312.m
 			float Tbn_0_1_neg = 2.0f*(_ev_sample_delayed.quat(0)*_ev_sample_delayed.quat(3)-_ev_sample_delayed.quat(1)*_ev_sample_delayed.quat(2));
 			float Tbn_1_1 = sq(_ev_sample_delayed.quat(0))-sq(_ev_sample_delayed.quat(1))+sq(_ev_sample_delayed.quat(2))-sq(_ev_sample_delayed.quat(3));
-			measured_hdg = atan2f(Tbn_0_1_neg,Tbn_1_1);
+			measured_hdg = hotpath::atan2f(Tbn_0_1_neg,Tbn_1_1);
 
 		} else {
 			measured_hdg = predicted_hdg;
@@ -0,0 +1,161 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file obs_ingest_monitor.cpp
+ */
+
+#include "obs_ingest_monitor.hpp"
+
+#include <math.h>
+
+constexpr uint16_t ObsIngestMonitor::MIN_SAMPLES;
+constexpr float ObsIngestMonitor::FILTER_COEF;
+constexpr uint32_t ObsIngestMonitor::AGE_BIN_LIMITS_US[];
+constexpr uint32_t ObsIngestMonitor::JITTER_BIN_LIMITS_US[];
+
+void ObsIngestMonitor::recordReceived(bool within_min_interval, bool averaging)
+{
+	_received_count++;
+
+	if (within_min_interval) {
+		if (averaging) {
+			_averaged_count++;
+
+		} else {
+			_dropped_count++;
+		}
+	}
+}
+
+void ObsIngestMonitor::update(uint64_t time_us, uint64_t now_us, uint8_t buffer_length, uint8_t used_length,
+			      bool overwritten)
+{
+	_buffer_length = buffer_length;
+
+	if (used_length > _peak_occupancy) {
+		_peak_occupancy = used_length;
+	}
+
+	if (overwritten) {
+		_overrun_count++;
+	}
+
+	const float age_us = (now_us > time_us) ? (float)(now_us - time_us) : 0.0f;
+	_age_histogram[histogramBin(AGE_BIN_LIMITS_US, age_us)]++;
+
+	if (_sample_count == 0) {
+		_age_us = age_us;
+
+	} else {
+		const float interval_us = (time_us > _time_last_us) ? (float)(time_us - _time_last_us) : 0.0f;
+
+		if (_sample_count == 1) {
+			_interval_us = interval_us;
+
+		} else {
+			const float jitter_us = fabsf(interval_us - _interval_us);
+			_jitter_histogram[histogramBin(JITTER_BIN_LIMITS_US, jitter_us)]++;
+			_jitter_us += FILTER_COEF * (jitter_us - _jitter_us);
+			_interval_us += FILTER_COEF * (interval_us - _interval_us);
+		}
+
+		_age_us += FILTER_COEF * (age_us - _age_us);
+	}
+
+	_time_last_us = time_us;
+
+	if (_sample_count < UINT16_MAX) {
+		_sample_count++;
+	}
+}
+
+uint8_t ObsIngestMonitor::getRequiredLength(uint32_t horizon_delay_us, uint32_t min_interval_us, uint8_t max_length) const
+{
+	const float interval_us = fmaxf(_interval_us, (float)min_interval_us);
+
+	if (interval_us < 1.0f) {
+		return max_length;
+	}
+
+	// time a sample waits in the buffer, with allowance for the sample timing jitter
+	const float wait_us = fmaxf((float)horizon_delay_us - _age_us + 3.0f * _jitter_us, 0.0f);
+
+	// the samples arriving while one waits, the one waiting and a spare entry
+	const float length = ceilf(wait_us / interval_us) + 2.0f;
+
+	return (uint8_t)fminf(length, (float)max_length);
+}
+
+void ObsIngestMonitor::recordFusion(bool passed_gate)
+{
+	if (passed_gate) {
+		_fused_count++;
+
+	} else {
+		_gate_rejected_count++;
+	}
+}
+
+void ObsIngestMonitor::getStatus(estimator::obsIngestStatus &status) const
+{
+	status.received = _received_count;
+	status.averaged = _averaged_count;
+	status.dropped = _dropped_count;
+	status.overwritten = _overrun_count;
+	status.resize_dropped = _resize_dropped_count;
+	status.fused = _fused_count;
+	status.gate_rejected = _gate_rejected_count;
+
+	for (uint8_t bin = 0; bin < estimator::OBS_INGEST_HIST_BINS; bin++) {
+		status.age_histogram[bin] = _age_histogram[bin];
+		status.jitter_histogram[bin] = _jitter_histogram[bin];
+	}
+
+	status.interval_us = _interval_us;
+	status.jitter_us = _jitter_us;
+	status.age_us = _age_us;
+	status.buffer_length = _buffer_length;
+	status.peak_occupancy = _peak_occupancy;
+}
+
+uint8_t ObsIngestMonitor::histogramBin(const uint32_t limits[estimator::OBS_INGEST_HIST_BINS - 1], float value_us)
+{
+	uint8_t bin = 0;
+
+	while ((bin < estimator::OBS_INGEST_HIST_BINS - 1) && (value_us >= (float)limits[bin])) {
+		bin++;
+	}
+
+	return bin;
+}
@@ -0,0 +1,133 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Arrival timing of the samples of one observation sensor, measured when they are pushed to
+ * the observation buffer. The age of a sample is the time between its delay compensated time
+ * stamp and the newest IMU data, the sample waits in the buffer until the fusion time horizon
+ * has caught up with it, so the buffer has to hold the samples arriving during that time.
+ * The monitor also counts what happens to the samples from their arrival to their fusion.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "common.h"
+
+class ObsIngestMonitor
+{
+public:
+	static constexpr uint16_t MIN_SAMPLES = 20; // samples required before the timing is used to size the buffer
+
+	ObsIngestMonitor() = default;
+	~ObsIngestMonitor() = default;
+
+	void reset() { *this = ObsIngestMonitor{}; }
+
+	// record a sample passed to the estimator, within_min_interval is true if it is not buffered on its own,
+	// averaging is true if the sensor averages such samples into the next buffered one instead of dropping them
+	void recordReceived(bool within_min_interval, bool averaging);
+
+	// record a sample pushed to a buffer of buffer_length entries holding used_length samples after the push,
+	// overwritten is true if an unused sample was overwritten by it
+	void update(uint64_t time_us, uint64_t now_us, uint8_t buffer_length, uint8_t used_length, bool overwritten);
+
+	// record unused samples discarded when the buffer was made shorter, counted separately from overwritten ones
+	void recordResizeDropped(uint8_t count) { _resize_dropped_count += count; }
+
+	// record the result of the innovation consistency check of a sample at the fusion time horizon
+	void recordFusion(bool passed_gate);
+
+	bool isValid() const { return _sample_count >= MIN_SAMPLES; }
+
+	// number of buffer entries needed to keep every sample until it falls behind the fusion time horizon,
+	// samples arriving faster than min_interval_us are dropped before they are buffered
+	uint8_t getRequiredLength(uint32_t horizon_delay_us, uint32_t min_interval_us, uint8_t max_length) const;
+
+	float getInterval() const { return _interval_us; }	///< filtered time between samples (uSec)
+	float getJitter() const { return _jitter_us; }		///< filtered deviation of the time between samples (uSec)
+	float getAge() const { return _age_us; }		///< filtered age of the samples when they arrive (uSec)
+	uint32_t getOverrunCount() const { return _overrun_count; }
+	uint32_t getResizeDroppedCount() const { return _resize_dropped_count; }
+	uint8_t getBufferLength() const { return _buffer_length; }
+
+	void getStatus(estimator::obsIngestStatus &status) const;
+
+	// save or restore the monitor, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar)
+	{
+		ar.io(_time_last_us);
+		ar.io(_interval_us);
+		ar.io(_jitter_us);
+		ar.io(_age_us);
+		ar.io(_sample_count);
+		ar.io(_overrun_count);
+		ar.io(_resize_dropped_count);
+		ar.io(_buffer_length);
+		ar.io(_received_count);
+		ar.io(_averaged_count);
+		ar.io(_dropped_count);
+		ar.io(_fused_count);
+		ar.io(_gate_rejected_count);
+		ar.io(_age_histogram);
+		ar.io(_jitter_histogram);
+		ar.io(_peak_occupancy);
+	}
+
+private:
+	static constexpr float FILTER_COEF = 0.1f;	///< weight of the newest sample in the filtered values
+
+	// upper limits of all but the last histogram bin (uSec)
+	static constexpr uint32_t AGE_BIN_LIMITS_US[estimator::OBS_INGEST_HIST_BINS - 1] = {20000, 50000, 100000, 150000, 200000};
+	static constexpr uint32_t JITTER_BIN_LIMITS_US[estimator::OBS_INGEST_HIST_BINS - 1] = {1000, 2000, 5000, 10000, 20000};
+
+	static uint8_t histogramBin(const uint32_t limits[estimator::OBS_INGEST_HIST_BINS - 1], float value_us);
+
+	uint64_t _time_last_us{0};
+	float _interval_us{0.0f};
+	float _jitter_us{0.0f};
+	float _age_us{0.0f};
+	uint16_t _sample_count{0};
+	uint32_t _overrun_count{0};	///< number of samples overwritten before they were used
+	uint32_t _resize_dropped_count{0};	///< number of samples discarded by a shorter buffer before they were used
+	uint8_t _buffer_length{0};	///< length of the buffer when the last sample was pushed
+	uint32_t _received_count{0};
+	uint32_t _averaged_count{0};
+	uint32_t _dropped_count{0};
+	uint32_t _fused_count{0};
+	uint32_t _gate_rejected_count{0};
+	uint32_t _age_histogram[estimator::OBS_INGEST_HIST_BINS] {};
+	uint32_t _jitter_histogram[estimator::OBS_INGEST_HIST_BINS] {};
+	uint8_t _peak_occupancy{0};
+};
@@ -0,0 +1,142 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file output_predictor.cpp
+ */
+
+#include "output_predictor.hpp"
+
+#include <geo/geo.h>
+
+#include "fast_math.hpp"
+
+using matrix::Dcmf;
+using matrix::Quatf;
+using matrix::Vector3f;
+
+constexpr uint8_t OutputPredictor::HISTORY_LENGTH;
+
+void OutputPredictor::publish(const estimator::outputSample &output, const Vector3f &gyro_bias,
+			      const Vector3f &accel_bias)
+{
+	_publication.write(publication_s{output, gyro_bias, accel_bias});
+}
+
+void OutputPredictor::update(const estimator::imuSample &imu)
+{
+	publication_s publication;
+	uint32_t sequence;
+
+	if (_publication.read(publication, sequence) && (sequence != _publication_sequence)) {
+		_publication_sequence = sequence;
+		align(publication);
+	}
+
+	if (!_valid || (imu.time_us <= _output.time_us)) {
+		return;
+	}
+
+	const Vector3f delta_angle{imu.delta_ang - _gyro_bias * imu.delta_ang_dt};
+
+	_output.time_us = imu.time_us;
+	_output.quat_nominal = _output.quat_nominal * estimator::hotpath::quatFromAxisAngle(delta_angle);
+	_output.quat_nominal.normalize();
+
+	// rotate the bias corrected delta velocity to earth frame and correct for gravity
+	Vector3f delta_vel_earth{Dcmf(_output.quat_nominal) * (imu.delta_vel - _accel_bias * imu.delta_vel_dt)};
+	delta_vel_earth(2) += CONSTANTS_ONE_G * imu.delta_vel_dt;
+
+	// use trapezoidal integration for the position
+	const Vector3f vel_last{_output.vel};
+	_output.vel += delta_vel_earth;
+	_output.pos += (_output.vel + vel_last) * (imu.delta_vel_dt * 0.5f);
+
+	pushHistory();
+}
+
+void OutputPredictor::align(const publication_s &publication)
+{
+	_gyro_bias = publication.gyro_bias;
+	_accel_bias = publication.accel_bias;
+
+	// the filter has caught up with the predictor, continue from its output
+	if (!_valid || (publication.output.time_us >= _output.time_us)) {
+		_output = publication.output;
+		_history_count = 0;
+		_valid = true;
+		pushHistory();
+		return;
+	}
+
+	// find the newest predictor state at or before the published one
+	uint8_t index = _history_newest;
+	uint8_t count = 0;
+
+	while ((count < _history_count) && (_history[index].time_us > publication.output.time_us)) {
+		index = (index + HISTORY_LENGTH - 1) % HISTORY_LENGTH;
+		count++;
+	}
+
+	// the filter lags by more than the history, wait for a newer publication
+	if (count == _history_count) {
+		return;
+	}
+
+	const estimator::outputSample &reference = _history[index];
+	const Quatf q_delta{(publication.output.quat_nominal * reference.quat_nominal.inversed()).normalized()};
+	const Vector3f vel_delta{publication.output.vel - reference.vel};
+	const Vector3f pos_delta{publication.output.pos - reference.pos};
+
+	// apply the correction to that state and all newer ones so later publications are aligned to corrected states
+	for (uint8_t i = 0; i <= count; i++) {
+		estimator::outputSample &state = _history[(index + i) % HISTORY_LENGTH];
+		state.quat_nominal = (q_delta * state.quat_nominal).normalized();
+		state.vel += vel_delta;
+		state.pos += pos_delta;
+	}
+
+	_output.quat_nominal = (q_delta * _output.quat_nominal).normalized();
+	_output.vel += vel_delta;
+	_output.pos += pos_delta;
+}
+
+void OutputPredictor::pushHistory()
+{
+	_history_newest = (_history_newest + 1) % HISTORY_LENGTH;
+	_history[_history_newest] = _output;
+
+	if (_history_count < HISTORY_LENGTH) {
+		_history_count++;
+	}
+}
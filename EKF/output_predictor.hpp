@@ -0,0 +1,95 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Output predictor that runs on its own, higher priority thread than the filter.
+ * It integrates every IMU sample as soon as it arrives and is corrected towards the output
+ * states of the filter whenever the filter thread has published new ones, so the latency
+ * and jitter of its output do not depend on how long the delayed horizon fusion takes.
+ * The filter publishes its output at the time of the newest IMU sample it has received,
+ * which is usually a few samples behind the predictor, the difference between the
+ * published states and the predictor states at that time is then applied to all the newer
+ * predictor states, the same way the filter applies its resets to the output buffer.
+ */
+#pragma once
+
+#include <matrix/math.hpp>
+
+#include "common.h"
+#include "seqlock.hpp"
+
+class OutputPredictor
+{
+public:
+	static constexpr uint8_t HISTORY_LENGTH = 64; // number of IMU samples the filter can lag behind the predictor
+
+	OutputPredictor() = default;
+	~OutputPredictor() = default;
+
+	// called by the filter thread, see Ekf::setOutputPredictor()
+	void publish(const estimator::outputSample &output, const matrix::Vector3f &gyro_bias,
+		     const matrix::Vector3f &accel_bias);
+
+	// called by the predictor thread for every IMU sample
+	void update(const estimator::imuSample &imu);
+
+	// true once the predictor has been initialised from the filter output
+	bool isValid() const { return _valid; }
+
+	// output states at the IMU at the time of the last IMU sample
+	const estimator::outputSample &getOutput() const { return _output; }
+
+private:
+	struct publication_s {
+		estimator::outputSample output;
+		matrix::Vector3f gyro_bias;	///< (rad/sec)
+		matrix::Vector3f accel_bias;	///< (m/sec**2)
+	};
+
+	// correct the predictor with the output published by the filter
+	void align(const publication_s &publication);
+
+	void pushHistory();
+
+	SeqLock<publication_s> _publication;
+	uint32_t _publication_sequence{0};	///< sequence number of the last publication used
+
+	estimator::outputSample _output{};
+	matrix::Vector3f _gyro_bias{};		///< (rad/sec)
+	matrix::Vector3f _accel_bias{};		///< (m/sec**2)
+	bool _valid{false};
+
+	estimator::outputSample _history[HISTORY_LENGTH] {};
+	uint8_t _history_newest{0};		///< index of the newest entry
+	uint8_t _history_count{0};		///< number of valid entries
+};
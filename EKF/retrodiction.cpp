@@ -0,0 +1,147 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file retrodiction.cpp
+ * Correction of GPS and airspeed measurements that are fused at a later time than they were
+ * measured at, using the state changes the filter predicted from the IMU data in between.
+ * Using the predicted changes instead of the difference of the stored states keeps the
+ * corrections free of the fusion updates and resets applied in between.
+ */
+
+#include "ekf.h"
+
+#include <ecl.h>
+#include <mathlib/mathlib.h>
+
+bool Ekf::getStateDeltaSince(uint64_t time_us, Vector3f &delta_vel, Vector3f &delta_pos, float &delta_yaw) const
+{
+	delta_vel.zero();
+	delta_pos.zero();
+	delta_yaw = 0.0f;
+
+	if (time_us >= _imu_sample_delayed.time_us) {
+		return true;
+	}
+
+	const uint8_t used_length = _state_delta_buffer.get_used_length();
+
+	if (used_length == 0) {
+		return false;
+	}
+
+	// the start of the oldest kept step is not known, so the changes are only known after its end
+	uint8_t index = _state_delta_buffer.get_oldest_index();
+	uint64_t step_start_us = _state_delta_buffer[index].time_us;
+
+	if (step_start_us > time_us) {
+		return false;
+	}
+
+	for (uint8_t i = 1; i < used_length; i++) {
+		index = (index + 1) % _state_delta_buffer.get_length();
+		const stateDeltaSample &sample = _state_delta_buffer[index];
+
+		if (sample.time_us > _imu_sample_delayed.time_us) {
+			break;
+		}
+
+		if ((sample.time_us > time_us) && (sample.time_us > step_start_us)) {
+			// only use the part of the step after the time of the measurement, steps start at the end of the previous one
+			float scale = 1.0f;
+
+			if (step_start_us < time_us) {
+				scale = (float)(sample.time_us - time_us) / (float)(sample.time_us - step_start_us);
+			}
+
+			delta_vel += sample.delta_vel * scale;
+			delta_pos += sample.delta_pos * scale;
+			delta_yaw += sample.delta_yaw * scale;
+		}
+
+		step_start_us = sample.time_us;
+	}
+
+	return true;
+}
+
+bool Ekf::retrodictGpsSample(gpsSample &gps)
+{
+	Vector3f delta_vel;
+	Vector3f delta_pos;
+	float delta_yaw;
+
+	// the measurement is older than the kept state changes, it cannot be used
+	if (!getStateDeltaSince(gps.time_us, delta_vel, delta_pos, delta_yaw)) {
+		return false;
+	}
+
+	gps.pos += Vector2f(delta_pos.xy());
+	gps.hgt -= delta_pos(2);
+	gps.vel += delta_vel;
+
+	if (ISFINITE(gps.yaw)) {
+		gps.yaw = wrap_pi(gps.yaw + delta_yaw);
+	}
+
+	// account for the errors of the predicted changes due to the accelerometer noise
+	const float lag = (_imu_sample_delayed.time_us - gps.time_us) * 1e-6f;
+	gps.sacc = sqrtf(sq(gps.sacc) + sq(_params.accel_noise * lag));
+	gps.hacc = sqrtf(sq(gps.hacc) + sq(_params.accel_noise * lag * lag));
+	gps.vacc = sqrtf(sq(gps.vacc) + sq(_params.accel_noise * lag * lag));
+
+	gps.time_us = _imu_sample_delayed.time_us;
+
+	return true;
+}
+
+bool Ekf::retrodictAirspeedSample(airspeedSample &airspeed)
+{
+	Vector3f delta_vel;
+	Vector3f delta_pos;
+	float delta_yaw;
+
+	if (!getStateDeltaSince(airspeed.time_us, delta_vel, delta_pos, delta_yaw)) {
+		return false;
+	}
+
+	// the wind is assumed to be constant over the retrodiction time
+	const Vector3f wind{_state.wind_vel(0), _state.wind_vel(1), 0.0f};
+	const Vector3f rel_vel{_state.vel - wind};
+	const float tas_change = rel_vel.norm() - (rel_vel - delta_vel).norm();
+
+	airspeed.true_airspeed = fmaxf(airspeed.true_airspeed + tas_change, 0.0f);
+	airspeed.time_us = _imu_sample_delayed.time_us;
+
+	return true;
+}
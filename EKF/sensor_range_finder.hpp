@@ -96,6 +96,30 @@ public:
 	float getValidMinVal() const { return _rng_valid_min_val; }
 	float getValidMaxVal() const { return _rng_valid_max_val; }
 
+	// save or restore the sensor state, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar)
+	{
+		ar.io(_sample);
+		ar.io(_is_sample_ready);
+		ar.io(_is_sample_valid);
+		ar.io(_time_last_valid_us);
+		ar.io(_is_stuck);
+		ar.io(_stuck_threshold);
+		ar.io(_stuck_min_val);
+		ar.io(_stuck_max_val);
+		ar.io(_dt_data_lpf);
+		ar.io(_cos_tilt_rng_to_earth);
+		ar.io(_range_cos_max_tilt);
+		ar.io(_pitch_offset_rad);
+		ar.io(_sin_pitch_offset);
+		ar.io(_cos_pitch_offset);
+		ar.io(_rng_valid_min_val);
+		ar.io(_rng_valid_max_val);
+		ar.io(_time_bad_quality_us);
+		ar.io(_quality_hyst_us);
+	}
+
 private:
 	void updateSensorToEarthRotation(const matrix::Dcmf &R_to_earth);
 
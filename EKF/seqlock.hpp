@@ -0,0 +1,111 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Single writer sequence lock used to hand data from a lower priority thread to a higher
+ * priority one without blocking either of them. The data is copied word by word through
+ * relaxed atomics so that a read racing a write is well defined and detected by the
+ * sequence number instead. Readers never wait for the writer, a read overlapping a write
+ * fails and the reader keeps its previous copy.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template<typename T>
+class SeqLock
+{
+public:
+	SeqLock() = default;
+	~SeqLock() = default;
+
+	SeqLock(const SeqLock &) = delete;
+	SeqLock &operator=(const SeqLock &) = delete;
+
+	// must only be called from one thread at a time
+	void write(const T &data)
+	{
+		uint32_t words[WORDS] {};
+		memcpy(words, &data, sizeof(T));
+
+		const uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+
+		// an odd sequence number marks a write in progress
+		_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0; i < WORDS; i++) {
+			_words[i].store(words[i], std::memory_order_relaxed);
+		}
+
+		_sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	// copy the last written data and its sequence number, returns false if nothing has been
+	// written yet or a write was in progress, the data is only modified when the read succeeds
+	bool read(T &data, uint32_t &sequence) const
+	{
+		const uint32_t sequence_start = _sequence.load(std::memory_order_acquire);
+
+		if ((sequence_start == 0) || (sequence_start & 1)) {
+			return false;
+		}
+
+		uint32_t words[WORDS];
+
+		for (size_t i = 0; i < WORDS; i++) {
+			words[i] = _words[i].load(std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (_sequence.load(std::memory_order_relaxed) != sequence_start) {
+			return false;
+		}
+
+		memcpy(&data, words, sizeof(T));
+		sequence = sequence_start;
+		return true;
+	}
+
+private:
+	static_assert(std::is_trivially_copyable<T>::value, "the data is copied as raw words");
+
+	static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+	std::atomic<uint32_t> _sequence{0};
+	std::atomic<uint32_t> _words[WORDS] {};
+};
@@ -0,0 +1,417 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file snapshot.cpp
+ * Save and restore of the complete filter state.
+ */
+
+#include "ekf.h"
+#include "snapshot.hpp"
+
+#include <new>
+
+template<typename Archive>
+void EstimatorInterface::snapshotInterface(Archive &ar)
+{
+	ar.io(_params);
+	_imu_down_sampler.snapshot(ar);
+	ar.io(_obs_buffer_length);
+	ar.io(_imu_buffer_length);
+	ar.io(_min_obs_interval_us);
+	ar.io(_dt_imu_avg);
+	ar.io(_imu_sample_delayed);
+	ar.io(_mag_sample_delayed);
+	ar.io(_baro_sample_delayed);
+	ar.io(_gps_sample_delayed);
+	_range_sensor.snapshot(ar);
+	ar.io(_airspeed_sample_delayed);
+	ar.io(_flow_sample_delayed);
+	ar.io(_ev_sample_delayed);
+	ar.io(_drag_sample_delayed);
+	ar.io(_drag_down_sampled);
+	ar.io(_auxvel_sample_delayed);
+	ar.io(_drag_sample_count);
+	ar.io(_drag_sample_time_dt);
+	ar.io(_air_density);
+	ar.io(_flow_max_rate);
+	ar.io(_flow_min_distance);
+	ar.io(_flow_max_distance);
+	ar.io(_output_sample_delayed);
+	ar.io(_output_new);
+	ar.io(_output_vert_delayed);
+	ar.io(_output_vert_new);
+	ar.io(_newest_high_rate_imu_sample);
+	ar.io(_R_to_earth_now);
+	ar.io(_vel_imu_rel_body_ned);
+	ar.io(_vel_deriv);
+	ar.io(_imu_updated);
+	ar.io(_initialised);
+	ar.io(_NED_origin_initialised);
+	ar.io(_gps_speed_valid);
+	ar.io(_gps_origin_eph);
+	ar.io(_gps_origin_epv);
+	ar.io(_pos_ref);
+	ar.io(_gps_pos_prev);
+	ar.io(_gps_alt_prev);
+	ar.io(_gps_yaw_offset);
+	ar.io(_yaw_test_ratio);
+	ar.io(_mag_test_ratio);
+	ar.io(_gps_vel_test_ratio);
+	ar.io(_gps_pos_test_ratio);
+	ar.io(_ev_vel_test_ratio);
+	ar.io(_ev_pos_test_ratio);
+	ar.io(_aux_vel_test_ratio);
+	ar.io(_baro_hgt_test_ratio);
+	ar.io(_rng_hgt_test_ratio);
+	ar.io(_optflow_test_ratio);
+	ar.io(_tas_test_ratio);
+	ar.io(_hagl_test_ratio);
+	ar.io(_beta_test_ratio);
+	ar.io(_drag_test_ratio);
+	ar.io(_innov_check_fail_status);
+	ar.io(_is_dead_reckoning);
+	ar.io(_deadreckon_time_exceeded);
+	ar.io(_is_wind_dead_reckoning);
+	ar.io(_delta_ang_prev);
+	ar.io(_delta_vel_prev);
+	ar.io(_vibe_metrics);
+	ar.io(_gps_drift_metrics);
+	ar.io(_time_last_move_detect_us);
+	ar.io(_gps_drift_updated);
+	_imu_buffer.snapshot(ar);
+	_gps_buffer.snapshot(ar);
+	_mag_buffer.snapshot(ar);
+	_baro_buffer.snapshot(ar);
+	_range_buffer.snapshot(ar);
+	_airspeed_buffer.snapshot(ar);
+	_flow_buffer.snapshot(ar);
+	_ext_vision_buffer.snapshot(ar);
+	_output_buffer.snapshot(ar);
+	_output_vert_buffer.snapshot(ar);
+	_drag_buffer.snapshot(ar);
+	_auxvel_buffer.snapshot(ar);
+	_state_delta_buffer.snapshot(ar);
+	ar.io(_retrodiction_ms);
+	ar.io(_obs_pending);
+	for (ObsIngestMonitor &monitor : _obs_ingest) {
+		monitor.snapshot(ar);
+	}
+	ar.io(_time_last_obs_sizing_us);
+	yawEstimator.snapshot(ar);
+	ar.io(_gps_buffer_fail);
+	ar.io(_mag_buffer_fail);
+	ar.io(_baro_buffer_fail);
+	ar.io(_range_buffer_fail);
+	ar.io(_airspeed_buffer_fail);
+	ar.io(_flow_buffer_fail);
+	ar.io(_ev_buffer_fail);
+	ar.io(_drag_buffer_fail);
+	ar.io(_auxvel_buffer_fail);
+	ar.io(_time_last_imu);
+	ar.io(_time_last_gps);
+	ar.io(_time_last_mag);
+	ar.io(_time_last_baro);
+	ar.io(_time_last_range);
+	ar.io(_time_last_airspeed);
+	ar.io(_time_last_ext_vision);
+	ar.io(_time_last_optflow);
+	ar.io(_time_last_auxvel);
+	ar.io(_time_last_gnd_effect_on);
+	ar.io(_mag_data_sum);
+	ar.io(_mag_sample_count);
+	ar.io(_mag_timestamp_sum);
+	ar.io(_baro_alt_sum);
+	ar.io(_baro_sample_count);
+	ar.io(_baro_timestamp_sum);
+	ar.io(_fault_status);
+	ar.io(_mag_declination_gps);
+	ar.io(_mag_inclination_gps);
+	ar.io(_mag_strength_gps);
+	ar.io(_control_status);
+	ar.io(_control_status_prev);
+}
+
+template<typename Archive>
+void Ekf::snapshot(Archive &ar)
+{
+	snapshotInterface(ar);
+
+	ar.io(_state_reset_status);
+	ar.io(_dt_ekf_avg);
+	ar.io(_ang_rate_delayed_raw);
+	ar.io(_state);
+	ar.io(_filter_initialised);
+	ar.io(_fuse_hpos_as_odom);
+	ar.io(_pos_meas_prev);
+	ar.io(_hpos_pred_prev);
+	ar.io(_hpos_prev_available);
+	ar.io(_R_ev_to_ekf);
+	ar.io(_gps_data_ready);
+	ar.io(_mag_data_ready);
+	ar.io(_baro_data_ready);
+	ar.io(_flow_data_ready);
+	ar.io(_ev_data_ready);
+	ar.io(_tas_data_ready);
+	ar.io(_flow_for_terrain_data_ready);
+	ar.io(_fusion_cost);
+	ar.io(_mag_fusion_deferred);
+	ar.io(_drag_fusion_deferred);
+	ar.io(_mag_defer_count);
+	ar.io(_drag_defer_count);
+	ar.io(_beta_defer_count);
+	ar.io(_fusion_deferral_count);
+	ar.io(_overload_status);
+	ar.io(_overload_level);
+	ar.io(_update_time_us);
+	ar.io(_overload_count);
+	ar.io(_underload_count);
+	ar.io(_cov_pred_imu);
+	ar.io(_cov_pred_samples);
+	ar.io(_time_prev_gps_us);
+	ar.io(_time_last_aiding);
+	ar.io(_using_synthetic_position);
+	ar.io(_time_last_hor_pos_fuse);
+	ar.io(_time_last_hgt_fuse);
+	ar.io(_time_last_hor_vel_fuse);
+	ar.io(_time_last_ver_vel_fuse);
+	ar.io(_time_last_delpos_fuse);
+	ar.io(_time_last_of_fuse);
+	ar.io(_time_last_arsp_fuse);
+	ar.io(_time_last_beta_fuse);
+	ar.io(_time_last_fake_pos);
+	ar.io(_time_last_gps_yaw_fuse);
+	ar.io(_last_known_posNE);
+	ar.io(_imu_collection_time_adj);
+	ar.io(_time_acc_bias_check);
+	ar.io(_delta_time_baro_us);
+	ar.io(_last_imu_bias_cov_reset_us);
+	ar.io(_earth_rate_NED);
+	ar.io(_R_to_earth);
+	ar.io(_accel_lpf_NE);
+	ar.io(_yaw_delta_ef);
+	ar.io(_yaw_rate_lpf_ef);
+	ar.io(_mag_bias_observable);
+	ar.io(_yaw_angle_observable);
+	ar.io(_time_yaw_started);
+	ar.io(_num_bad_flight_yaw_events);
+	ar.io(_mag_use_not_inhibit_us);
+	ar.io(_mag_inhibit_yaw_reset_req);
+	ar.io(_last_static_yaw);
+	ar.io(_mag_yaw_reset_req);
+	ar.io(_mag_decl_cov_reset);
+	ar.io(_synthetic_mag_z_active);
+	ar.io(_yaw_use_inhibit);
+	ar.io(P);
+	ar.io(_delta_vel_bias_var_accum);
+	ar.io(_delta_angle_bias_var_accum);
+	ar.io(_gps_vel_innov);
+	ar.io(_gps_vel_innov_var);
+	ar.io(_gps_pos_innov);
+	ar.io(_gps_pos_innov_var);
+	ar.io(_ev_vel_innov);
+	ar.io(_ev_vel_innov_var);
+	ar.io(_ev_pos_innov);
+	ar.io(_ev_pos_innov_var);
+	ar.io(_baro_hgt_innov);
+	ar.io(_baro_hgt_innov_var);
+	ar.io(_rng_hgt_innov);
+	ar.io(_rng_hgt_innov_var);
+	ar.io(_aux_vel_innov);
+	ar.io(_aux_vel_innov_var);
+	ar.io(_heading_innov);
+	ar.io(_heading_innov_var);
+	ar.io(_mag_innov);
+	ar.io(_mag_innov_var);
+	ar.io(_drag_innov);
+	ar.io(_drag_innov_var);
+	ar.io(_airspeed_innov);
+	ar.io(_airspeed_innov_var);
+	ar.io(_beta_innov);
+	ar.io(_beta_innov_var);
+	ar.io(_hagl_innov);
+	ar.io(_hagl_innov_var);
+	ar.io(_flow_innov);
+	ar.io(_flow_innov_var);
+	ar.io(_flow_gyro_bias);
+	ar.io(_imu_del_ang_of);
+	ar.io(_delta_time_of);
+	ar.io(_time_bad_motion_us);
+	ar.io(_time_good_motion_us);
+	ar.io(_inhibit_flow_use);
+	ar.io(_flow_compensated_XY_rad);
+	ar.io(_delta_angle_corr);
+	ar.io(_vel_err_integ);
+	ar.io(_pos_err_integ);
+	ar.io(_output_tracking_error);
+	ar.io(_gps_pos_deriv_filt);
+	ar.io(_gps_velNE_filt);
+	ar.io(_gps_velD_diff_filt);
+	ar.io(_last_gps_fail_us);
+	ar.io(_last_gps_pass_us);
+	ar.io(_gps_error_norm);
+	ar.io(_min_gps_health_time_us);
+	ar.io(_gps_checks_passed);
+	ar.io(_last_gps_origin_time_us);
+	ar.io(_gps_alt_ref);
+	ar.io(_is_first_imu_sample);
+	ar.io(_baro_counter);
+	ar.io(_mag_counter);
+	ar.io(_accel_lpf);
+	ar.io(_gyro_lpf);
+	ar.io(_mag_lpf);
+	ar.io(_hgt_sensor_offset);
+	ar.io(_baro_hgt_offset);
+	ar.io(_last_on_ground_posD);
+	ar.io(_flt_mag_align_start_time);
+	ar.io(_time_last_mov_3d_mag_suitable);
+	ar.io(_saved_mag_bf_variance);
+	ar.io(_saved_mag_ef_covmat);
+	ar.io(_velpos_reset_request);
+	ar.io(_gps_check_fail_status);
+	ar.io(_accel_bias_inhibit);
+	ar.io(_accel_vec_filt);
+	ar.io(_accel_magnitude_filt);
+	ar.io(_ang_rate_magnitude_filt);
+	ar.io(_prev_dvel_bias_var);
+	ar.io(_terrain_vpos);
+	ar.io(_terrain_var);
+	ar.io(_time_last_hagl_fuse);
+	ar.io(_time_last_flow_terrain_fuse);
+	ar.io(_time_last_fake_hagl_fuse);
+	ar.io(_terrain_initialised);
+	ar.io(_hagl_valid);
+	ar.io(_hagl_sensor_status);
+	ar.io(_terrain_prior_offset);
+	ar.io(_time_last_terrain_prior_check);
+	ar.io(_time_last_terrain_prior_fuse);
+	_terrain_grid.snapshot(ar);
+	ar.io(_terrain_grid_cell);
+	ar.io(_time_last_terrain_grid_fuse);
+	ar.io(_baro_hgt_faulty);
+	ar.io(_gps_hgt_intermittent);
+	ar.io(_is_gps_yaw_faulty);
+	ar.io(_time_bad_vert_accel);
+	ar.io(_time_good_vert_accel);
+	ar.io(_bad_vert_accel_detected);
+	ar.io(_is_range_aid_suitable);
+	ar.io(_height_rate_lpf);
+	ar.io(_ekfgsf_yaw_reset_time);
+	ar.io(_time_last_on_ground_us);
+	ar.io(_do_ekfgsf_yaw_reset);
+	ar.io(_ekfgsf_yaw_reset_count);
+	ar.io(_ekfgsf_active);
+	ar.io(_time_last_yaw_not_stable_us);
+}
+
+size_t Ekf::getSnapshotSize() const
+{
+	// the archive only reads the members while saving
+	SnapshotWriter counter;
+	const_cast<Ekf *>(this)->snapshot(counter);
+
+	return sizeof(snapshot_header) + counter.position();
+}
+
+size_t Ekf::saveSnapshot(uint8_t *buffer, size_t buffer_size) const
+{
+	if (buffer == nullptr || buffer_size < sizeof(snapshot_header)) {
+		return 0;
+	}
+
+	uint8_t *payload = buffer + sizeof(snapshot_header);
+	SnapshotWriter writer(payload, buffer_size - sizeof(snapshot_header));
+	const_cast<Ekf *>(this)->snapshot(writer);
+
+	if (!writer.ok()) {
+		return 0;
+	}
+
+	snapshot_header header{};
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.header_size = sizeof(snapshot_header);
+	header.payload_size = writer.position();
+	header.checksum = snapshotChecksum(payload, writer.position());
+	memcpy(buffer, &header, sizeof(snapshot_header));
+
+	return sizeof(snapshot_header) + writer.position();
+}
+
+bool Ekf::restoreSnapshot(const uint8_t *buffer, size_t size)
+{
+	if (buffer == nullptr || size < sizeof(snapshot_header)) {
+		return false;
+	}
+
+	snapshot_header header;
+	memcpy(&header, buffer, sizeof(snapshot_header));
+
+	if (header.magic != SNAPSHOT_MAGIC
+	    || header.version != SNAPSHOT_VERSION
+	    || header.header_size != sizeof(snapshot_header)
+	    || header.payload_size > size - sizeof(snapshot_header)) {
+		return false;
+	}
+
+	const uint8_t *payload = buffer + sizeof(snapshot_header);
+
+	if (snapshotChecksum(payload, header.payload_size) != header.checksum) {
+		return false;
+	}
+
+	// decode into a copy so that a layout mismatch cannot leave this filter partially overwritten,
+	// the copy lives on the heap because the filter is too large for the caller's stack
+	Ekf *restored = new (std::nothrow) Ekf(*this);
+
+	if (restored == nullptr) {
+		return false;
+	}
+
+	SnapshotReader reader(payload, header.payload_size);
+	restored->snapshot(reader);
+
+	const bool success = reader.ok() && reader.position() == header.payload_size;
+
+	if (success) {
+		*this = *restored;
+
+	} else {
+		// only possible if the member lists changed without incrementing SNAPSHOT_VERSION
+		ECL_ERR("EKF snapshot layout mismatch");
+	}
+
+	delete restored;
+
+	return success;
+}
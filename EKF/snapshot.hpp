@@ -0,0 +1,146 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Archives used to save and restore the complete filter state.
+ * Every class holding filter state lists its members once in a
+ * snapshot(Archive &) template which is instantiated with a
+ * SnapshotWriter to save and with a SnapshotReader to restore.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace estimator
+{
+
+// format of the data written by Ekf::saveSnapshot()
+// increment the version whenever a member is added to or removed from a snapshot() list or changes its layout
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x53464b45; // "EKFS"
+static constexpr uint16_t SNAPSHOT_VERSION = 16;
+
+struct snapshot_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;
+	uint32_t payload_size;	///< number of bytes following the header
+	uint32_t checksum;	///< FNV-1a hash of the payload
+};
+
+class SnapshotWriter
+{
+public:
+	// a writer without buffer only counts the number of bytes required
+	SnapshotWriter() = default;
+	SnapshotWriter(uint8_t *buffer, size_t size) : _buffer(buffer), _size(size) {}
+
+	template<typename T>
+	void io(const T &data)
+	{
+		static_assert(!std::is_pointer<T>::value, "pointers can not be part of a snapshot");
+		bytes(&data, sizeof(T));
+	}
+
+	void bytes(const void *data, size_t size)
+	{
+		if (_buffer != nullptr) {
+			if (_pos + size <= _size) {
+				memcpy(_buffer + _pos, data, size);
+
+			} else {
+				_ok = false;
+			}
+		}
+
+		_pos += size;
+	}
+
+	size_t position() const { return _pos; }
+	bool ok() const { return _ok; }
+
+private:
+	uint8_t *_buffer{nullptr};
+	size_t _size{0};
+	size_t _pos{0};
+	bool _ok{true};
+};
+
+class SnapshotReader
+{
+public:
+	SnapshotReader(const uint8_t *buffer, size_t size) : _buffer(buffer), _size(size) {}
+
+	template<typename T>
+	void io(T &data)
+	{
+		static_assert(!std::is_pointer<T>::value, "pointers can not be part of a snapshot");
+		bytes(&data, sizeof(T));
+	}
+
+	void bytes(void *data, size_t size)
+	{
+		if (_pos + size <= _size) {
+			memcpy(data, _buffer + _pos, size);
+
+		} else {
+			_ok = false;
+		}
+
+		_pos += size;
+	}
+
+	size_t position() const { return _pos; }
+	bool ok() const { return _ok; }
+
+private:
+	const uint8_t *_buffer;
+	size_t _size;
+	size_t _pos{0};
+	bool _ok{true};
+};
+
+inline uint32_t snapshotChecksum(const uint8_t *data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+} // namespace estimator
@@ -41,6 +41,7 @@
 
 #include "ekf.h"
 #include <ecl.h>
+#include <geo_lookup/terrain_height_source.h>
 #include <mathlib/mathlib.h>
 
 bool Ekf::initHagl()
@@ -55,6 +56,14 @@ bool Ekf::initHagl()
 		_time_last_fake_hagl_fuse = _time_last_imu;
 		initialized = true;
 
+		// calibrate the vertical offset between the terrain prior and the local frame
+		float prior_vpos;
+		float prior_var;
+
+		if (shouldUseTerrainPriorForHagl() && getTerrainPrior(prior_vpos, prior_var)) {
+			_terrain_prior_offset += _terrain_vpos - prior_vpos;
+		}
+
 	} else if (shouldUseRangeFinderForHagl()
 		   && _range_sensor.isDataHealthy()) {
 		// if we have a fresh measurement, use it to initialise the terrain estimator
@@ -64,6 +73,19 @@ bool Ekf::initHagl()
 		// success
 		initialized = true;
 
+	} else if (shouldUseTerrainGridForHagl()
+		   && _terrain_grid.lookup(_state.pos.xy(), _terrain_vpos, _terrain_var)) {
+		// this part of the terrain has already been measured during the flight
+		_terrain_var += sq(0.5f * _params.terrain_gradient * _terrain_grid.getCellSize());
+		_time_last_terrain_grid_fuse = _time_last_imu;
+		initialized = true;
+
+	} else if (shouldUseTerrainPriorForHagl()
+		   && getTerrainPrior(_terrain_vpos, _terrain_var)) {
+		// the terrain prior is more accurate than the flow initialisation below
+		_time_last_terrain_prior_fuse = _time_last_imu;
+		initialized = true;
+
 	} else if (shouldUseOpticalFlowForHagl()
 		   && _flow_for_terrain_data_ready) {
 		// initialise terrain vertical position to origin as this is the best guess we have
@@ -93,13 +115,56 @@ bool Ekf::shouldUseOpticalFlowForHagl() const
 	return (_params.terrain_fusion_mode & TerrainFusionMask::TerrainFuseOpticalFlow);
 }
 
+bool Ekf::shouldUseTerrainPriorForHagl() const
+{
+	return (_params.terrain_fusion_mode & TerrainFusionMask::TerrainFusePrior)
+	       && (_terrain_source != nullptr);
+}
+
+bool Ekf::shouldUseTerrainGridForHagl() const
+{
+	return (_params.terrain_fusion_mode & TerrainFusionMask::TerrainFuseGrid);
+}
+
+bool Ekf::getTerrainPrior(float &terrain_vpos, float &terrain_var) const
+{
+	if (!_NED_origin_initialised) {
+		return false;
+	}
+
+	double lat;
+	double lon;
+	map_projection_reproject(&_pos_ref, _state.pos(0), _state.pos(1), &lat, &lon);
+
+	float height;
+	float height_var;
+
+	if (!_terrain_source->getTerrainHeight(lat, lon, height, height_var)) {
+		return false;
+	}
+
+	terrain_vpos = _gps_alt_ref - height + _terrain_prior_offset;
+
+	// add the error due to the terrain gradient and the uncertainty of the vehicle horizontal position
+	terrain_var = fmaxf(height_var, 0.0f) + sq(_params.terrain_gradient) * (P(7, 7) + P(8, 8));
+
+	return true;
+}
+
 void Ekf::runTerrainEstimator()
 {
 	// If we are on ground, store the local position and time to use as a reference
 	if (!_control_status.flags.in_air) {
 		_last_on_ground_posD = _state.pos(2);
+
+		// the grid may have been enabled after init, it is never allocated in flight
+		if (shouldUseTerrainGridForHagl()) {
+			_terrain_grid.allocate();
+		}
 	}
 
+	_terrain_grid.setCellSize(_params.terrain_grid_cell_size);
+
 	// Perform initialisation check and
 	// on ground, continuously reset the terrain estimator
 	if (!_terrain_initialised || !_control_status.flags.in_air) {
@@ -119,6 +184,16 @@ void Ekf::runTerrainEstimator()
 		// limit the variance to prevent it becoming badly conditioned
 		_terrain_var = math::constrain(_terrain_var, 0.0f, 1e4f);
 
+		// use the terrain learned earlier in the flight once when entering a grid cell
+		if (shouldUseTerrainGridForHagl()) {
+			const uint32_t grid_cell = _terrain_grid.getCellKey(_state.pos.xy());
+
+			if (grid_cell != _terrain_grid_cell) {
+				_terrain_grid_cell = grid_cell;
+				fuseTerrainGrid();
+			}
+		}
+
 		// Fuse range finder data if available
 		if (shouldUseRangeFinderForHagl()
 		    && _range_sensor.isDataHealthy()) {
@@ -131,6 +206,20 @@ void Ekf::runTerrainEstimator()
 			_flow_for_terrain_data_ready = false;
 		}
 
+		// the terrain prior only changes with position, so it does not need to be fused at a high rate
+		if (shouldUseTerrainPriorForHagl()
+		    && isTimedOut(_time_last_terrain_prior_check, (uint64_t)1e6)) {
+			fuseTerrainPrior();
+			_time_last_terrain_prior_check = _time_last_imu;
+		}
+
+		// learn the terrain measured by the range finder or optical flow in this update, the flow fused
+		// by the main filter does not correct the terrain estimate
+		if (shouldUseTerrainGridForHagl()
+		    && ((_time_last_hagl_fuse == _time_last_imu) || (_time_last_flow_terrain_fuse == _time_last_imu))) {
+			_terrain_grid.update(_state.pos.xy(), _terrain_vpos, _terrain_var);
+		}
+
 		// constrain _terrain_vpos to be a minimum of _params.rng_gnd_clearance larger than _state.pos(2)
 		if (_terrain_vpos - _state.pos(2) < _params.rng_gnd_clearance) {
 			_terrain_vpos = _params.rng_gnd_clearance + _state.pos(2);
@@ -255,6 +344,7 @@ void Ekf::fuseFlowForTerrain()
 		// guard against negative variance
 		_terrain_var = fmaxf(_terrain_var - KxHxP, 0.0f);
 		_time_last_of_fuse = _time_last_imu;
+		_time_last_flow_terrain_fuse = _time_last_imu;
 	}
 
 	// Calculate observation matrix for flow around the vehicle y axis
@@ -283,6 +373,63 @@ void Ekf::fuseFlowForTerrain()
 		// guard against negative variance
 		_terrain_var = fmaxf(_terrain_var - KyHyP, 0.0f);
 		_time_last_of_fuse = _time_last_imu;
+		_time_last_flow_terrain_fuse = _time_last_imu;
+	}
+}
+
+void Ekf::fuseTerrainPrior()
+{
+	float prior_vpos;
+	float prior_var;
+
+	if (!getTerrainPrior(prior_vpos, prior_var)) {
+		return;
+	}
+
+	const float innov = _terrain_vpos - prior_vpos;
+
+	// calculate the innovation variance - limiting it to prevent a badly conditioned fusion
+	const float innov_var = fmaxf(_terrain_var + prior_var, prior_var);
+
+	// perform an innovation consistency check and only fuse data if it passes
+	const float gate_size = fmaxf(_params.terrain_prior_gate, 1.0f);
+
+	if (sq(innov) <= sq(gate_size) * innov_var) {
+		const float gain = _terrain_var / innov_var;
+		_terrain_vpos -= gain * innov;
+		_terrain_var = fmaxf(_terrain_var * (1.0f - gain), 0.0f);
+		_time_last_terrain_prior_fuse = _time_last_imu;
+	}
+}
+
+void Ekf::fuseTerrainGrid()
+{
+	float grid_vpos;
+	float grid_var;
+
+	if (!_terrain_grid.lookup(_state.pos.xy(), grid_vpos, grid_var)) {
+		return;
+	}
+
+	// add the terrain change between the positions the cell was learned at and the current one
+	grid_var += sq(0.5f * _params.terrain_gradient * _terrain_grid.getCellSize());
+
+	// the cell was learned from the same sensors as the current estimate, only use it if it adds information
+	if (grid_var >= _terrain_var) {
+		return;
+	}
+
+	const float innov = _terrain_vpos - grid_vpos;
+	const float innov_var = _terrain_var + grid_var;
+
+	// perform an innovation consistency check and only fuse data if it passes
+	const float gate_size = fmaxf(_params.terrain_prior_gate, 1.0f);
+
+	if (sq(innov) <= sq(gate_size) * innov_var) {
+		const float gain = _terrain_var / innov_var;
+		_terrain_vpos -= gain * innov;
+		_terrain_var = fmaxf(_terrain_var * (1.0f - gain), 0.0f);
+		_time_last_terrain_grid_fuse = _time_last_imu;
 	}
 }
 
@@ -308,6 +455,12 @@ void Ekf::updateTerrainValidity()
 						 && (_time_last_fake_hagl_fuse != _time_last_hagl_fuse);
 	_hagl_sensor_status.flags.flow = shouldUseOpticalFlowForHagl()
 					 && recent_flow_for_terrain_fusion;
+
+	// fusing the prior does not keep the height above ground valid, its accuracy is not checked by any sensor
+	_hagl_sensor_status.flags.prior = shouldUseTerrainPriorForHagl()
+					  && isRecent(_time_last_terrain_prior_fuse, (uint64_t)5e6);
+	_hagl_sensor_status.flags.grid = shouldUseTerrainGridForHagl()
+					 && isRecent(_time_last_terrain_grid_fuse, (uint64_t)5e6);
 }
 
 // get the estimated vertical position of the terrain relative to the NED origin
@@ -0,0 +1,194 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file terrain_height_grid.cpp
+ */
+
+#include "terrain_height_grid.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <utility>
+
+constexpr uint16_t TerrainHeightGrid::CAPACITY;
+constexpr uint8_t TerrainHeightGrid::MAX_PROBES;
+constexpr uint32_t TerrainHeightGrid::INVALID_CELL;
+
+TerrainHeightGrid::TerrainHeightGrid(const TerrainHeightGrid &other) :
+	_cell_size(other._cell_size),
+	_update_counter(other._update_counter)
+{
+	if (other._cells != nullptr) {
+		_cells = new cell_s[CAPACITY];
+
+		if (_cells != nullptr) {
+			for (uint16_t i = 0; i < CAPACITY; i++) {
+				_cells[i] = other._cells[i];
+			}
+		}
+	}
+}
+
+TerrainHeightGrid &TerrainHeightGrid::operator=(const TerrainHeightGrid &other)
+{
+	if (this != &other) {
+		TerrainHeightGrid copy(other);
+		std::swap(_cells, copy._cells);
+		_cell_size = copy._cell_size;
+		_update_counter = copy._update_counter;
+	}
+
+	return *this;
+}
+
+bool TerrainHeightGrid::allocate()
+{
+	if (_cells == nullptr) {
+		_cells = new cell_s[CAPACITY];
+	}
+
+	return _cells != nullptr;
+}
+
+void TerrainHeightGrid::reset()
+{
+	for (uint16_t i = 0; (_cells != nullptr) && (i < CAPACITY); i++) {
+		_cells[i] = cell_s{};
+	}
+
+	_update_counter = 0;
+}
+
+void TerrainHeightGrid::setCellSize(float cell_size)
+{
+	if (fabsf(cell_size - _cell_size) > FLT_EPSILON) {
+		_cell_size = cell_size;
+		reset();
+	}
+}
+
+uint32_t TerrainHeightGrid::getCellKey(const matrix::Vector2f &pos) const
+{
+	if (_cell_size < FLT_EPSILON) {
+		return INVALID_CELL;
+	}
+
+	const float north = floorf(pos(0) / _cell_size);
+	const float east = floorf(pos(1) / _cell_size);
+
+	// the cell indices are offset to be positive and packed in 16 bit each, keeping them below
+	// 0xFFFF leaves INVALID_CELL unused
+	if (!(fabsf(north) < float(INT16_MAX)) || !(fabsf(east) < float(INT16_MAX))) {
+		return INVALID_CELL;
+	}
+
+	return (uint32_t(north + 32768.f) << 16) | uint32_t(east + 32768.f);
+}
+
+uint16_t TerrainHeightGrid::hash(uint32_t key)
+{
+	// mix the north and east indices so that neighbouring cells spread over the table
+	key ^= key >> 16;
+	key *= 0x45d9f3bU;
+	key ^= key >> 16;
+	return key & (CAPACITY - 1);
+}
+
+void TerrainHeightGrid::update(const matrix::Vector2f &pos, float terrain_vpos, float terrain_var)
+{
+	const uint32_t key = getCellKey(pos);
+
+	if ((key == INVALID_CELL) || (_cells == nullptr)) {
+		return;
+	}
+
+	const uint16_t start = hash(key);
+	cell_s *target = &_cells[start];
+
+	for (uint8_t probe = 0; probe < MAX_PROBES; probe++) {
+		cell_s &cell = _cells[(start + probe) & (CAPACITY - 1)];
+
+		if (cell.key == key) {
+			target = &cell;
+			break;
+		}
+
+		// prefer an empty entry, otherwise the least recently updated one
+		if ((target->key != INVALID_CELL)
+		    && ((cell.key == INVALID_CELL) || (cell.last_update < target->last_update))) {
+			target = &cell;
+		}
+	}
+
+	target->key = key;
+	target->terrain_vpos = terrain_vpos;
+	target->terrain_var = terrain_var;
+	target->last_update = ++_update_counter;
+}
+
+bool TerrainHeightGrid::lookup(const matrix::Vector2f &pos, float &terrain_vpos, float &terrain_var) const
+{
+	const uint32_t key = getCellKey(pos);
+
+	if ((key == INVALID_CELL) || (_cells == nullptr)) {
+		return false;
+	}
+
+	const uint16_t start = hash(key);
+
+	for (uint8_t probe = 0; probe < MAX_PROBES; probe++) {
+		const cell_s &cell = _cells[(start + probe) & (CAPACITY - 1)];
+
+		if (cell.key == key) {
+			terrain_vpos = cell.terrain_vpos;
+			terrain_var = cell.terrain_var;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+unsigned TerrainHeightGrid::getCellCount() const
+{
+	unsigned count = 0;
+
+	for (uint16_t i = 0; (_cells != nullptr) && (i < CAPACITY); i++) {
+		if (_cells[i].key != INVALID_CELL) {
+			count++;
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,119 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 Estimation and Control Library (ECL). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name ECL nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Terrain vertical position estimates learned during the flight, stored in a sparse grid of
+ * horizontal cells in the local NED frame. The cells live in a fixed size open addressing hash
+ * table, a lookup probes at most MAX_PROBES entries and the least recently updated cell of the
+ * probed entries is replaced when the table is full around a new cell. The table is allocated
+ * by allocate() before the flight, cells are never allocated while learning.
+ */
+#pragma once
+
+#include <matrix/math.hpp>
+
+class TerrainHeightGrid
+{
+public:
+	static constexpr uint16_t CAPACITY = 256; // number of cells, power of two
+	static constexpr uint8_t MAX_PROBES = 8;
+	static constexpr uint32_t INVALID_CELL = UINT32_MAX;
+
+	TerrainHeightGrid() = default;
+	~TerrainHeightGrid() { delete[] _cells; }
+
+	// copies are deep so that a copied estimator owns its own grid
+	TerrainHeightGrid(const TerrainHeightGrid &other);
+	TerrainHeightGrid &operator=(const TerrainHeightGrid &other);
+
+	// allocate the table if not done yet, returns false if the allocation failed
+	bool allocate();
+
+	// forget all cells, the table is kept
+	void reset();
+
+	// the grid is cleared when the cell size changes
+	void setCellSize(float cell_size);
+	float getCellSize() const { return _cell_size; }
+
+	// key of the cell containing a horizontal position (m), INVALID_CELL outside of the grid range
+	uint32_t getCellKey(const matrix::Vector2f &pos) const;
+
+	// store the terrain vertical position (m) and its variance (m**2) in the cell containing the position,
+	// replacing the stored estimate: the estimate already includes the cell and the previous estimates it was
+	// learned from, fusing them again would count the same information twice
+	void update(const matrix::Vector2f &pos, float terrain_vpos, float terrain_var);
+
+	// get the terrain stored in the cell containing the position, returns false if the cell is not known
+	bool lookup(const matrix::Vector2f &pos, float &terrain_vpos, float &terrain_var) const;
+
+	unsigned getCellCount() const;
+	bool isAllocated() const { return _cells != nullptr; }
+
+	// save or restore the grid, see snapshot.hpp
+	template<typename Archive>
+	void snapshot(Archive &ar)
+	{
+		bool allocated = (_cells != nullptr);
+		ar.io(allocated);
+
+		if (!allocated) {
+			delete[] _cells;
+			_cells = nullptr;
+
+		} else if (_cells == nullptr) {
+			_cells = new cell_s[CAPACITY];
+		}
+
+		if (_cells != nullptr) {
+			ar.bytes(_cells, sizeof(cell_s) * CAPACITY);
+		}
+
+		ar.io(_cell_size);
+		ar.io(_update_counter);
+	}
+
+private:
+	struct cell_s {
+		uint32_t key{INVALID_CELL};
+		uint32_t last_update{0};
+		float terrain_vpos{0.f};
+		float terrain_var{0.f};
+	};
+
+	static uint16_t hash(uint32_t key);
+
+	cell_s *_cells{nullptr};	///< CAPACITY cells, nullptr until allocate() is called
+	float _cell_size{0.f};
+	uint32_t _update_counter{0};
+};
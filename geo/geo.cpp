@@ -129,12 +129,9 @@ int map_projection_global_project(double lat, double lon, float *x, float *y)
 	return map_projection_project(&mp_ref, lat, lon, x, y);
 }
 
-int map_projection_project(const struct map_projection_reference_s *ref, double lat, double lon, float *x, float *y)
+// projection of a single point, shared by the single point and batch functions so that both give identical results
+static inline void project_point(const struct map_projection_reference_s *ref, double lat, double lon, float *x, float *y)
 {
-	if (!map_projection_initialized(ref)) {
-		return -1;
-	}
-
 	const double lat_rad = math::radians(lat);
 	const double lon_rad = math::radians(lon);
 
@@ -154,21 +151,41 @@ int map_projection_project(const struct map_projection_reference_s *ref, double
 
 	*x = static_cast<float>(k * (ref->cos_lat * sin_lat - ref->sin_lat * cos_lat * cos_d_lon) * CONSTANTS_RADIUS_OF_EARTH);
 	*y = static_cast<float>(k * cos_lat * sin(lon_rad - ref->lon_rad) * CONSTANTS_RADIUS_OF_EARTH);
-
-	return 0;
 }
 
-int map_projection_global_reproject(float x, float y, double *lat, double *lon)
+int map_projection_project(const struct map_projection_reference_s *ref, double lat, double lon, float *x, float *y)
 {
-	return map_projection_reproject(&mp_ref, x, y, lat, lon);
+	if (!map_projection_initialized(ref)) {
+		return -1;
+	}
+
+	project_point(ref, lat, lon, x, y);
+
+	return 0;
 }
 
-int map_projection_reproject(const struct map_projection_reference_s *ref, float x, float y, double *lat, double *lon)
+int map_projection_project_batch(const struct map_projection_reference_s *ref, const double *lat, const double *lon,
+				 float *x, float *y, size_t count)
 {
 	if (!map_projection_initialized(ref)) {
 		return -1;
 	}
 
+	for (size_t i = 0; i < count; i++) {
+		project_point(ref, lat[i], lon[i], &x[i], &y[i]);
+	}
+
+	return 0;
+}
+
+int map_projection_global_reproject(float x, float y, double *lat, double *lon)
+{
+	return map_projection_reproject(&mp_ref, x, y, lat, lon);
+}
+
+// inverse projection of a single point, shared by the single point and batch functions
+static inline void reproject_point(const struct map_projection_reference_s *ref, float x, float y, double *lat, double *lon)
+{
 	const double x_rad = (double)x / CONSTANTS_RADIUS_OF_EARTH;
 	const double y_rad = (double)y / CONSTANTS_RADIUS_OF_EARTH;
 	const double c = sqrt(x_rad * x_rad + y_rad * y_rad);
@@ -187,6 +204,29 @@ int map_projection_reproject(const struct map_projection_reference_s *ref, float
 		*lat = math::degrees(ref->lat_rad);
 		*lon = math::degrees(ref->lon_rad);
 	}
+}
+
+int map_projection_reproject(const struct map_projection_reference_s *ref, float x, float y, double *lat, double *lon)
+{
+	if (!map_projection_initialized(ref)) {
+		return -1;
+	}
+
+	reproject_point(ref, x, y, lat, lon);
+
+	return 0;
+}
+
+int map_projection_reproject_batch(const struct map_projection_reference_s *ref, const float *x, const float *y,
+				   double *lat, double *lon, size_t count)
+{
+	if (!map_projection_initialized(ref)) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		reproject_point(ref, x[i], y[i], &lat[i], &lon[i]);
+	}
 
 	return 0;
 }
@@ -267,21 +307,41 @@ int globallocalconverter_getref(double *lat_0, double *lon_0, float *alt_0)
 	return 0;
 }
 
-float get_distance_to_next_waypoint(double lat_now, double lon_now, double lat_next, double lon_next)
+// haversine distance from a position whose terms are computed once by the caller
+static inline float distance_from(double lat_now_rad, double lon_now_rad, double cos_lat_now, double lat_next,
+				  double lon_next)
 {
-	const double lat_now_rad = math::radians(lat_now);
 	const double lat_next_rad = math::radians(lat_next);
 
 	const double d_lat = lat_next_rad - lat_now_rad;
-	const double d_lon = math::radians(lon_next) - math::radians(lon_now);
+	const double d_lon = math::radians(lon_next) - lon_now_rad;
 
-	const double a = sin(d_lat / 2.0) * sin(d_lat / 2.0) + sin(d_lon / 2.0) * sin(d_lon / 2.0) * cos(lat_now_rad) * cos(lat_next_rad);
+	const double a = sin(d_lat / 2.0) * sin(d_lat / 2.0) + sin(d_lon / 2.0) * sin(d_lon / 2.0) * cos_lat_now * cos(lat_next_rad);
 
 	const double c = atan2(sqrt(a), sqrt(1.0 - a));
 
 	return static_cast<float>(CONSTANTS_RADIUS_OF_EARTH * 2.0 * c);
 }
 
+float get_distance_to_next_waypoint(double lat_now, double lon_now, double lat_next, double lon_next)
+{
+	const double lat_now_rad = math::radians(lat_now);
+
+	return distance_from(lat_now_rad, math::radians(lon_now), cos(lat_now_rad), lat_next, lon_next);
+}
+
+void get_distance_to_next_waypoint_batch(double lat_now, double lon_now, const double *lat_next, const double *lon_next,
+		float *dist, size_t count)
+{
+	const double lat_now_rad = math::radians(lat_now);
+	const double lon_now_rad = math::radians(lon_now);
+	const double cos_lat_now = cos(lat_now_rad);
+
+	for (size_t i = 0; i < count; i++) {
+		dist[i] = distance_from(lat_now_rad, lon_now_rad, cos_lat_now, lat_next[i], lon_next[i]);
+	}
+}
+
 void create_waypoint_from_line_and_dist(double lat_A, double lon_A, double lat_B, double lon_B, float dist,
 					double *lat_target, double *lon_target)
 {
@@ -46,6 +46,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 static constexpr float CONSTANTS_ONE_G = 9.80665f;						// m/s^2
@@ -173,6 +174,20 @@ int map_projection_global_project(double lat, double lon, float *x, float *y);
 */
 int map_projection_project(const struct map_projection_reference_s *ref, double lat, double lon, float *x, float *y);
 
+/**
+ * Transforms count points in the geographic coordinate system to the local azimuthal
+ * equidistant plane using the projection given by the argument, with the same results
+ * as map_projection_project(). The reference terms are shared by all points.
+ *
+ * @param lat array of count latitudes in degrees
+ * @param lon array of count longitudes in degrees
+ * @param x array receiving count north coordinates
+ * @param y array receiving count east coordinates
+ * @return 0 if map_projection_init was called before, -1 else
+ */
+int map_projection_project_batch(const struct map_projection_reference_s *ref, const double *lat, const double *lon,
+				 float *x, float *y, size_t count);
+
 /**
  * Transforms a point in the local azimuthal equidistant plane to the
  * geographic coordinate system using the global projection
@@ -197,6 +212,20 @@ int map_projection_global_reproject(float x, float y, double *lat, double *lon);
  */
 int map_projection_reproject(const struct map_projection_reference_s *ref, float x, float y, double *lat, double *lon);
 
+/**
+ * Transforms count points in the local azimuthal equidistant plane to the geographic
+ * coordinate system using the projection given by the argument, with the same results
+ * as map_projection_reproject().
+ *
+ * @param x array of count north coordinates
+ * @param y array of count east coordinates
+ * @param lat array receiving count latitudes in degrees
+ * @param lon array receiving count longitudes in degrees
+ * @return 0 if map_projection_init was called before, -1 else
+ */
+int map_projection_reproject_batch(const struct map_projection_reference_s *ref, const float *x, const float *y,
+				   double *lat, double *lon, size_t count);
+
 /**
  * Get reference position of the global map projection
  */
@@ -238,6 +267,17 @@ int globallocalconverter_getref(double *lat_0, double *lon_0, float *alt_0);
  */
 float get_distance_to_next_waypoint(double lat_now, double lon_now, double lat_next, double lon_next);
 
+/**
+ * Returns the distances from the current position to count waypoints in meters,
+ * with the same results as get_distance_to_next_waypoint().
+ *
+ * @param lat_next array of count waypoint latitudes in degrees
+ * @param lon_next array of count waypoint longitudes in degrees
+ * @param dist array receiving count distances
+ */
+void get_distance_to_next_waypoint_batch(double lat_now, double lon_now, const double *lat_next, const double *lon_next,
+		float *dist, size_t count);
+
 /**
  * Creates a new waypoint C on the line of two given waypoints (A, B) at certain distance
  * from waypoint A
@@ -0,0 +1,454 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file geofence_index.cpp
+ */
+
+#include "geofence_index.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// upper limit of the number of grid cells, the cell size is increased to stay below it
+static constexpr int MAX_CELLS = 65536;
+
+GeofenceIndex::~GeofenceIndex()
+{
+	freeIndex();
+	delete[] _segments;
+}
+
+void GeofenceIndex::init(double lat_ref, double lon_ref)
+{
+	freeIndex();
+	delete[] _segments;
+	_segments = nullptr;
+	_segment_count = 0;
+	_segment_capacity = 0;
+	_zone_count = 0;
+	_has_inclusion = false;
+
+	map_projection_init(&_ref, lat_ref, lon_ref);
+}
+
+void GeofenceIndex::project(double lat, double lon, float &x, float &y) const
+{
+	map_projection_project(&_ref, lat, lon, &x, &y);
+}
+
+bool GeofenceIndex::addPolygon(const double *lat, const double *lon, size_t count, bool inclusion)
+{
+	if (count < 3) {
+		return false;
+	}
+
+	return addZone(lat, lon, count, inclusion ? ZoneType::INCLUSION : ZoneType::EXCLUSION, 0.0f);
+}
+
+bool GeofenceIndex::addCorridor(const double *lat, const double *lon, size_t count, float half_width)
+{
+	if (count < 2 || !(half_width > 0.0f)) {
+		return false;
+	}
+
+	return addZone(lat, lon, count, ZoneType::CORRIDOR, half_width);
+}
+
+bool GeofenceIndex::addZone(const double *lat, const double *lon, size_t count, ZoneType type, float half_width)
+{
+	if (!map_projection_initialized(&_ref) || (_zone_count >= MAX_ZONES)) {
+		return false;
+	}
+
+	// polygons are closed by a segment from the last to the first vertex
+	const size_t segment_count = (type == ZoneType::CORRIDOR) ? (count - 1) : count;
+
+	if (!reserveSegments(_segment_count + segment_count)) {
+		return false;
+	}
+
+	// the index no longer covers all segments
+	freeIndex();
+
+	zone_s &zone = _zones[_zone_count];
+	zone.type = type;
+	zone.half_width = half_width;
+	zone.first_segment = _segment_count;
+	zone.segment_count = segment_count;
+
+	for (size_t i = 0; i < segment_count; i++) {
+		const size_t next = (i + 1) % count;
+		segment_s &segment = _segments[_segment_count + i];
+		project(lat[i], lon[i], segment.x0, segment.y0);
+		project(lat[next], lon[next], segment.x1, segment.y1);
+		segment.zone = static_cast<uint8_t>(_zone_count);
+	}
+
+	_segment_count += segment_count;
+	_zone_count++;
+
+	if (type != ZoneType::EXCLUSION) {
+		_has_inclusion = true;
+	}
+
+	return true;
+}
+
+bool GeofenceIndex::reserveSegments(size_t count)
+{
+	if (count <= _segment_capacity) {
+		return true;
+	}
+
+	size_t capacity = (_segment_capacity > 0) ? (2 * _segment_capacity) : 16;
+
+	while (capacity < count) {
+		capacity *= 2;
+	}
+
+	segment_s *segments = new segment_s[capacity];
+
+	if (segments == nullptr) {
+		return false;
+	}
+
+	if (_segments != nullptr) {
+		memcpy(segments, _segments, _segment_count * sizeof(segment_s));
+		delete[] _segments;
+	}
+
+	_segments = segments;
+	_segment_capacity = capacity;
+	return true;
+}
+
+void GeofenceIndex::freeIndex()
+{
+	delete[] _cell_start;
+	delete[] _cell_segments;
+	_cell_start = nullptr;
+	_cell_segments = nullptr;
+	_rows = 0;
+	_cols = 0;
+}
+
+bool GeofenceIndex::build(float cell_size)
+{
+	freeIndex();
+
+	if ((_segment_count == 0) || !(cell_size > 0.0f)) {
+		return false;
+	}
+
+	// bounding box of all segments including the corridor widths
+	float min_x = FLT_MAX;
+	float min_y = FLT_MAX;
+	float max_x = -FLT_MAX;
+	float max_y = -FLT_MAX;
+
+	for (uint32_t i = 0; i < _segment_count; i++) {
+		const segment_s &segment = _segments[i];
+		const float margin = _zones[segment.zone].half_width;
+		min_x = fminf(min_x, fminf(segment.x0, segment.x1) - margin);
+		min_y = fminf(min_y, fminf(segment.y0, segment.y1) - margin);
+		max_x = fmaxf(max_x, fmaxf(segment.x0, segment.x1) + margin);
+		max_y = fmaxf(max_y, fmaxf(segment.y0, segment.y1) + margin);
+	}
+
+	_min_x = min_x;
+	_min_y = min_y;
+	_cell_size = cell_size;
+
+	while (true) {
+		_rows = static_cast<int>((max_x - min_x) / _cell_size) + 1;
+		_cols = static_cast<int>((max_y - min_y) / _cell_size) + 1;
+
+		if (static_cast<long>(_rows) * _cols <= MAX_CELLS) {
+			break;
+		}
+
+		_cell_size *= 2.0f;
+	}
+
+	const int cell_count = _rows * _cols;
+	_cell_start = new uint32_t[cell_count + 1];
+	uint32_t *cell_fill = new uint32_t[cell_count];
+
+	if ((_cell_start == nullptr) || (cell_fill == nullptr)) {
+		delete[] cell_fill;
+		freeIndex();
+		return false;
+	}
+
+	memset(_cell_start, 0, (cell_count + 1) * sizeof(uint32_t));
+
+	// count the segments of each cell, then fill the cells in a second pass over the same cells
+	for (int pass = 0; pass < 2; pass++) {
+		for (uint32_t i = 0; i < _segment_count; i++) {
+			const segment_s &segment = _segments[i];
+			const float margin = _zones[segment.zone].half_width;
+			const int row_min = getRow(fminf(segment.x0, segment.x1) - margin);
+			const int row_max = getRow(fmaxf(segment.x0, segment.x1) + margin);
+			const int col_min = getCol(fminf(segment.y0, segment.y1) - margin);
+			const int col_max = getCol(fmaxf(segment.y0, segment.y1) + margin);
+
+			for (int row = row_min; row <= row_max; row++) {
+				for (int col = col_min; col <= col_max; col++) {
+					const int cell = row * _cols + col;
+
+					if (pass == 0) {
+						_cell_start[cell + 1]++;
+
+					} else {
+						_cell_segments[cell_fill[cell]++] = i;
+					}
+				}
+			}
+		}
+
+		if (pass == 0) {
+			for (int cell = 0; cell < cell_count; cell++) {
+				_cell_start[cell + 1] += _cell_start[cell];
+				cell_fill[cell] = _cell_start[cell];
+			}
+
+			_cell_segments = new uint32_t[_cell_start[cell_count] > 0 ? _cell_start[cell_count] : 1];
+
+			if (_cell_segments == nullptr) {
+				delete[] cell_fill;
+				freeIndex();
+				return false;
+			}
+		}
+	}
+
+	delete[] cell_fill;
+	return true;
+}
+
+int GeofenceIndex::getRow(float x) const
+{
+	const int row = static_cast<int>(floorf((x - _min_x) / _cell_size));
+	return (row < 0) ? 0 : ((row >= _rows) ? (_rows - 1) : row);
+}
+
+int GeofenceIndex::getCol(float y) const
+{
+	const int col = static_cast<int>(floorf((y - _min_y) / _cell_size));
+	return (col < 0) ? 0 : ((col >= _cols) ? (_cols - 1) : col);
+}
+
+bool GeofenceIndex::isInside(double lat, double lon) const
+{
+	float x;
+	float y;
+	project(lat, lon, x, y);
+	return isInsideLocal(x, y);
+}
+
+bool GeofenceIndex::isInsideLocal(float x, float y) const
+{
+	if (!isBuilt()) {
+		return false;
+	}
+
+	const bool in_grid = (x >= _min_x) && (x < _min_x + _rows * _cell_size)
+			     && (y >= _min_y) && (y < _min_y + _cols * _cell_size);
+
+	// all zones are inside of the grid
+	if (!in_grid) {
+		return !_has_inclusion;
+	}
+
+	const int row = getRow(x);
+	const int col_start = getCol(y);
+
+	// corridors: every segment within the corridor width is listed in the cell of the position
+	bool in_corridor = false;
+	const int cell = row * _cols + col_start;
+
+	for (uint32_t i = _cell_start[cell]; (i < _cell_start[cell + 1]) && !in_corridor; i++) {
+		const uint32_t segment_index = _cell_segments[i];
+		const zone_s &zone = _zones[_segments[segment_index].zone];
+
+		if (zone.type == ZoneType::CORRIDOR) {
+			geofence_segment_result result{};
+			result.distance = FLT_MAX;
+			updateNearest(x, y, segment_index, result);
+			in_corridor = (result.distance <= zone.half_width);
+		}
+	}
+
+	// polygons: count the crossings of a ray towards east with the edges of each polygon,
+	// each crossing is only counted in the cell it lies in
+	uint32_t parity = 0;
+
+	for (int col = col_start; col < _cols; col++) {
+		const int ray_cell = row * _cols + col;
+
+		for (uint32_t i = _cell_start[ray_cell]; i < _cell_start[ray_cell + 1]; i++) {
+			const segment_s &segment = _segments[_cell_segments[i]];
+
+			if ((_zones[segment.zone].type == ZoneType::CORRIDOR) || ((segment.x0 > x) == (segment.x1 > x))) {
+				continue;
+			}
+
+			float y_cross = segment.y0 + (x - segment.x0) * (segment.y1 - segment.y0) / (segment.x1 - segment.x0);
+			y_cross = fmaxf(fminf(y_cross, fmaxf(segment.y0, segment.y1)), fminf(segment.y0, segment.y1));
+
+			if ((y_cross > y) && (getCol(y_cross) == col)) {
+				parity ^= (1u << segment.zone);
+			}
+		}
+	}
+
+	bool in_inclusion = !_has_inclusion || in_corridor;
+	bool in_exclusion = false;
+
+	for (int zone = 0; zone < _zone_count; zone++) {
+		if (parity & (1u << zone)) {
+			if (_zones[zone].type == ZoneType::INCLUSION) {
+				in_inclusion = true;
+
+			} else {
+				in_exclusion = true;
+			}
+		}
+	}
+
+	return in_inclusion && !in_exclusion;
+}
+
+void GeofenceIndex::updateNearest(float x, float y, uint32_t segment_index, geofence_segment_result &result) const
+{
+	const segment_s &segment = _segments[segment_index];
+	const float dx = segment.x1 - segment.x0;
+	const float dy = segment.y1 - segment.y0;
+	const float length_sq = dx * dx + dy * dy;
+	const float rel_x = x - segment.x0;
+	const float rel_y = y - segment.y0;
+
+	// position of the closest point along the segment
+	const float t = (length_sq > 0.0f) ? ((rel_x * dx + rel_y * dy) / length_sq) : 0.0f;
+	const float t_clamped = fmaxf(0.0f, fminf(t, 1.0f));
+	const float closest_x = segment.x0 + t_clamped * dx;
+	const float closest_y = segment.y0 + t_clamped * dy;
+	const float distance = sqrtf((closest_x - x) * (closest_x - x) + (closest_y - y) * (closest_y - y));
+
+	if (distance < result.distance) {
+		const zone_s &zone = _zones[segment.zone];
+		result.zone = segment.zone;
+		result.segment = static_cast<int>(segment_index - zone.first_segment);
+		result.distance = distance;
+		result.crosstrack = (length_sq > 0.0f) ? ((dx * rel_y - dy * rel_x) / sqrtf(length_sq)) : 0.0f;
+		result.bearing = atan2f(closest_y - y, closest_x - x);
+		// segment direction rotated by -90 deg right of the segment, by +90 deg left of it
+		result.crosstrack_bearing = (result.crosstrack >= 0.0f) ? atan2f(-dx, dy) : atan2f(dx, -dy);
+		result.past_end = (t > 1.0f);
+	}
+}
+
+bool GeofenceIndex::getNearestSegment(double lat, double lon, geofence_segment_result &result, int zone) const
+{
+	float x;
+	float y;
+	project(lat, lon, x, y);
+	return getNearestSegmentLocal(x, y, result, zone);
+}
+
+bool GeofenceIndex::getNearestSegmentLocal(float x, float y, geofence_segment_result &result, int zone) const
+{
+	result = {};
+	result.zone = -1;
+	result.distance = FLT_MAX;
+
+	if (!isBuilt()) {
+		return false;
+	}
+
+	const int row_start = getRow(x);
+	const int col_start = getCol(y);
+	const int max_ring = (_rows > _cols) ? _rows : _cols;
+
+	// search rings of cells around the cell of the position until no closer segment can be found,
+	// cells of ring k are at least (k - 1) cells away from any point of the start cell
+	for (int ring = 0; ring <= max_ring; ring++) {
+		if ((result.zone >= 0) && (result.distance <= (ring - 1) * _cell_size)) {
+			break;
+		}
+
+		for (int row = row_start - ring; row <= row_start + ring; row++) {
+			if ((row < 0) || (row >= _rows)) {
+				continue;
+			}
+
+			// full rows at the top and bottom of the ring, only the two sides otherwise
+			const bool full_row = (row == row_start - ring) || (row == row_start + ring);
+			const int col_step = (full_row || (ring == 0)) ? 1 : (2 * ring);
+
+			for (int col = col_start - ring; col <= col_start + ring; col += col_step) {
+				if ((col < 0) || (col >= _cols)) {
+					continue;
+				}
+
+				const int cell = row * _cols + col;
+
+				for (uint32_t i = _cell_start[cell]; i < _cell_start[cell + 1]; i++) {
+					const uint32_t segment_index = _cell_segments[i];
+
+					if ((zone < 0) || (_segments[segment_index].zone == zone)) {
+						updateNearest(x, y, segment_index, result);
+					}
+				}
+			}
+		}
+	}
+
+	return result.zone >= 0;
+}
+
+bool GeofenceIndex::getCrossTrackError(crosstrack_error_s &crosstrack_error, double lat, double lon, int zone) const
+{
+	geofence_segment_result result;
+
+	if (!getNearestSegment(lat, lon, result, zone)) {
+		return false;
+	}
+
+	crosstrack_error.past_end = result.past_end;
+	crosstrack_error.distance = result.past_end ? 0.0f : result.crosstrack;
+	crosstrack_error.bearing = result.past_end ? 0.0f : result.crosstrack_bearing;
+	return true;
+}
@@ -0,0 +1,157 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file geofence_index.h
+ *
+ * Geofence and path zones projected into a local frame and indexed by a uniform grid,
+ * so that containment, nearest segment and cross-track queries only visit the segments
+ * near the query position instead of scanning all of them.
+ *
+ * Zones are added once during setup, build() then allocates the index. Queries do not
+ * allocate and are cheap enough to run at controller rate.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "geo.h"
+
+struct geofence_segment_result {
+	int zone;		// index of the zone the segment belongs to, -1 if no segment was found
+	int segment;		// index of the segment within its zone
+	float distance;		// distance to the closest point of the segment (m)
+	float crosstrack;	// signed distance to the line through the segment, positive right of the segment direction (m)
+	float bearing;		// bearing from the position to the closest point of the segment (rad)
+	float crosstrack_bearing;	// bearing from the position perpendicular to the line through the segment (rad)
+	bool past_end;		// true if the position is beyond the end point of the segment
+};
+
+class GeofenceIndex
+{
+public:
+	static constexpr int MAX_ZONES = 32;
+
+	enum class ZoneType : uint8_t {
+		INCLUSION = 0,	// polygon the vehicle has to stay inside of
+		EXCLUSION,	// polygon the vehicle has to stay outside of
+		CORRIDOR	// path the vehicle has to stay within a distance of
+	};
+
+	GeofenceIndex() = default;
+	~GeofenceIndex();
+
+	GeofenceIndex(const GeofenceIndex &) = delete;
+	GeofenceIndex &operator=(const GeofenceIndex &) = delete;
+
+	// set the origin of the local frame (deg) and remove all zones
+	void init(double lat_ref, double lon_ref);
+
+	// add a closed polygon with count vertices (deg), returns false if there is no room for another zone
+	bool addPolygon(const double *lat, const double *lon, size_t count, bool inclusion);
+
+	// add an open path with count vertices (deg) whose corridor of half_width (m) is an inclusion zone
+	bool addCorridor(const double *lat, const double *lon, size_t count, float half_width);
+
+	// build the grid index with square cells of cell_size (m), the cells are enlarged if the grid would get too big
+	bool build(float cell_size);
+
+	bool isBuilt() const { return _cell_start != nullptr; }
+	int getZoneCount() const { return _zone_count; }
+
+	// true if the position is inside an inclusion polygon or corridor, or if there are none,
+	// and outside of all exclusion polygons
+	bool isInside(double lat, double lon) const;
+	bool isInsideLocal(float x, float y) const;
+
+	// closest segment of any zone, or of the given zone, to the position
+	bool getNearestSegment(double lat, double lon, geofence_segment_result &result, int zone = -1) const;
+	bool getNearestSegmentLocal(float x, float y, geofence_segment_result &result, int zone = -1) const;
+
+	// cross-track error to the closest segment of a zone, in the convention of get_distance_to_line():
+	// beyond the end point of the segment only past_end is set, before its start point the distance
+	// and bearing refer to the extension of the segment
+	bool getCrossTrackError(crosstrack_error_s &crosstrack_error, double lat, double lon, int zone) const;
+
+	// position in the local frame (m)
+	void project(double lat, double lon, float &x, float &y) const;
+
+private:
+	struct segment_s {
+		float x0;
+		float y0;
+		float x1;
+		float y1;
+		uint8_t zone;
+	};
+
+	struct zone_s {
+		ZoneType type;
+		float half_width;	// corridor half width (m)
+		uint32_t first_segment;
+		uint32_t segment_count;
+	};
+
+	bool addZone(const double *lat, const double *lon, size_t count, ZoneType type, float half_width);
+	bool reserveSegments(size_t count);
+	void freeIndex();
+
+	// grid row or column of a local coordinate, clamped to the grid
+	int getRow(float x) const;
+	int getCol(float y) const;
+
+	// fill result if the segment is closer than result.distance
+	void updateNearest(float x, float y, uint32_t segment_index, geofence_segment_result &result) const;
+
+	map_projection_reference_s _ref{};
+
+	zone_s _zones[MAX_ZONES] {};
+	int _zone_count{0};
+	bool _has_inclusion{false};
+
+	segment_s *_segments{nullptr};
+	uint32_t _segment_count{0};
+	uint32_t _segment_capacity{0};
+
+	// grid cells hold the indices of all segments whose bounding box, enlarged by the corridor
+	// half width, overlaps the cell, stored as consecutive ranges of _cell_segments
+	float _min_x{0.0f};
+	float _min_y{0.0f};
+	float _cell_size{1.0f};
+	int _rows{0};
+	int _cols{0};
+	uint32_t *_cell_start{nullptr};		// _rows * _cols + 1 offsets into _cell_segments
+	uint32_t *_cell_segments{nullptr};
+};
@@ -32,14 +32,25 @@
 #
 ############################################################################
 
+import argparse
 import json
 import urllib.request
 
-SAMPLING_RES = 10
+parser = argparse.ArgumentParser(description='Generate geo_magnetic_tables.hpp from the NOAA IGRF grid calculator')
+parser.add_argument('--resolution', type=int, default=10, help='grid spacing in degrees')
+parser.add_argument('--tile-size', type=int, default=0,
+                    help='store the tables compressed with tiles of this many samples per side (see geo_mag_table.hpp), 0 stores whole degrees in int8_t')
+args = parser.parse_args()
+
+SAMPLING_RES = args.resolution
 SAMPLING_MIN_LAT = -80
 SAMPLING_MAX_LAT = 80
 SAMPLING_MIN_LON = -180
 SAMPLING_MAX_LON = 180
+TILE_SIZE = args.tile_size
+
+# value of one quantisation step of the compressed tables
+COMPRESSED_SCALE = 0.01
 
 def constrain(n, nmin, nmax):
     return max(min(nmin, n), nmax)
@@ -80,6 +91,8 @@ header = """/*******************************************************************
 print(header)
 
 print('#include <stdint.h>\n')
+if TILE_SIZE > 0:
+    print('#include "geo_mag_table.hpp"\n')
 
 LAT_DIM=int((SAMPLING_MAX_LAT-SAMPLING_MIN_LAT)/SAMPLING_RES)+1
 LON_DIM=int((SAMPLING_MAX_LON-SAMPLING_MIN_LON)/SAMPLING_RES)+1
@@ -92,71 +105,110 @@ print('static constexpr float SAMPLING_MAX_LON = {}'.format(SAMPLING_MAX_LON) +
 print('')
 print('static constexpr int LAT_DIM = {}'.format(LAT_DIM) + ';')
 print('static constexpr int LON_DIM = {}'.format(LON_DIM) + ';')
+
+if TILE_SIZE > 0:
+    TILES_LAT = (LAT_DIM + TILE_SIZE - 1) // TILE_SIZE
+    TILES_LON = (LON_DIM + TILE_SIZE - 1) // TILE_SIZE
+    print('')
+    print('static constexpr unsigned TILE_SIZE = {}'.format(TILE_SIZE) + ';')
+    print('static constexpr unsigned TILES_LAT = {}'.format(TILES_LAT) + ';')
+    print('static constexpr unsigned TILES_LON = {}'.format(TILES_LON) + ';')
+
 print('\n')
 
-# Declination
-params = urllib.parse.urlencode({'lat1': 0, 'lat2': 0, 'lon1': 0, 'lon2': 0, 'latStepSize': 1, 'lonStepSize': 1, 'magneticComponent': 'd', 'resultFormat': 'json'})
-f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
-data = json.loads(f.read())
-print("// Magnetic declination data in degrees")
-print('// Model: {},'.format(data['model']))
-print('// Version: {},'.format(data['version']))
-print('// Date: {},'.format(data['result'][0]['date']))
-print('static constexpr const int8_t declination_table[{}][{}]'.format(LAT_DIM, LON_DIM) + " {")
-for latitude in range(SAMPLING_MIN_LAT, SAMPLING_MAX_LAT+1, SAMPLING_RES):
-    params = urllib.parse.urlencode({'lat1': latitude, 'lat2': latitude, 'lon1': SAMPLING_MIN_LON, 'lon2': SAMPLING_MAX_LON, 'latStepSize': 1, 'lonStepSize': SAMPLING_RES, 'magneticComponent': 'd', 'resultFormat': 'json'})
+def fetch_model_info(component):
+    params = urllib.parse.urlencode({'lat1': 0, 'lat2': 0, 'lon1': 0, 'lon2': 0, 'latStepSize': 1, 'lonStepSize': 1, 'magneticComponent': component, 'resultFormat': 'json'})
     f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
     data = json.loads(f.read())
+    print('// Model: {},'.format(data['model']))
+    print('// Version: {},'.format(data['version']))
+    print('// Date: {},'.format(data['result'][0]['date']))
+
+def fetch_grid(component, key, scale):
+    grid = []
+    for latitude in range(SAMPLING_MIN_LAT, SAMPLING_MAX_LAT+1, SAMPLING_RES):
+        params = urllib.parse.urlencode({'lat1': latitude, 'lat2': latitude, 'lon1': SAMPLING_MIN_LON, 'lon2': SAMPLING_MAX_LON, 'latStepSize': 1, 'lonStepSize': SAMPLING_RES, 'magneticComponent': component, 'resultFormat': 'json'})
+        f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
+        data = json.loads(f.read())
+        grid.append([p[key] * scale for p in data['result']])
+    return grid
+
+def print_int8_table(name, grid, limit):
+    print('static constexpr const int8_t {}[{}][{}]'.format(name, LAT_DIM, LON_DIM) + " {")
+    for row in grid:
+        print('	{ ', end='')
+        for value in row:
+            value_int = int(round(value))
+            if limit:
+                value_int = constrain(value_int, 127, -128)
+            print('{0:4d},'.format(value_int), end='')
+
+        print(' },')
+    print("};\n")
+
+def compress_tile(values):
+    # base value in the middle of the tile range and the smallest shift that fits all residuals in an int8_t
+    base = constrain((min(values) + max(values)) // 2, 32767, -32768)
+    spread = max(abs(value - base) for value in values)
+    shift = 0
+    while (127 << shift) < spread:
+        shift += 1
+    residuals = [constrain(int(round((value - base) / (1 << shift))), 127, -128) for value in values]
+    return base, shift, residuals
+
+def print_compressed_table(name, grid):
+    quantised = [[int(round(value / COMPRESSED_SCALE)) for value in row] for row in grid]
+    bases = []
+    shifts = []
+    residuals = [[0] * LON_DIM for _ in range(LAT_DIM)]
+    max_error = 0.0
+
+    for tile_lat in range(TILES_LAT):
+        for tile_lon in range(TILES_LON):
+            indices = [(i, j) for i in range(tile_lat * TILE_SIZE, min((tile_lat + 1) * TILE_SIZE, LAT_DIM))
+                       for j in range(tile_lon * TILE_SIZE, min((tile_lon + 1) * TILE_SIZE, LON_DIM))]
+            base, shift, tile_residuals = compress_tile([quantised[i][j] for (i, j) in indices])
+            bases.append(base)
+            shifts.append(shift)
+            for (i, j), residual in zip(indices, tile_residuals):
+                residuals[i][j] = residual
+                decoded = (base + residual * (1 << shift)) * COMPRESSED_SCALE
+                max_error = max(max_error, abs(decoded - grid[i][j]))
+
+    size = 3 * TILES_LAT * TILES_LON + LAT_DIM * LON_DIM
+    print('// Compressed to {} bytes, max quantisation error {:.3f}'.format(size, max_error))
+    print('static constexpr int16_t {}_tile_base[TILES_LAT * TILES_LON]'.format(name) + " {")
+    for tile_lat in range(TILES_LAT):
+        print('	' + ''.join('{0:6d},'.format(b) for b in bases[tile_lat * TILES_LON:(tile_lat + 1) * TILES_LON]))
+    print("};\n")
+    print('static constexpr uint8_t {}_tile_shift[TILES_LAT * TILES_LON]'.format(name) + " {")
+    for tile_lat in range(TILES_LAT):
+        print('	' + ''.join('{0:2d},'.format(s) for s in shifts[tile_lat * TILES_LON:(tile_lat + 1) * TILES_LON]))
+    print("};\n")
+    print('static constexpr int8_t {}_residual[LAT_DIM * LON_DIM]'.format(name) + " {")
+    for row in residuals:
+        print('	' + ''.join('{0:4d},'.format(r) for r in row))
+    print("};\n")
+    print('static constexpr geo_mag_compressed_table {} {{{}f, TILE_SIZE, TILES_LON, LON_DIM, {}_tile_base, {}_tile_shift, {}_residual}};\n'.format(
+        name, COMPRESSED_SCALE, name, name, name))
+
+def print_table(name, grid, limit):
+    if TILE_SIZE > 0:
+        print_compressed_table(name, grid)
+    else:
+        print_int8_table(name, grid, limit)
 
-
-    print('	{ ', end='')
-    for p in data['result']:
-        declination_int = constrain(int(round(p['declination'])), 127, -128)
-        print('{0:4d},'.format(declination_int), end='')
-
-    print(' },')
-print("};\n")
+# Declination
+print("// Magnetic declination data in degrees")
+fetch_model_info('d')
+print_table('declination_table', fetch_grid('d', 'declination', 1.0), True)
 
 # Inclination
-params = urllib.parse.urlencode({'lat1': 0, 'lat2': 0, 'lon1': 0, 'lon2': 0, 'latStepSize': 1, 'lonStepSize': 1, 'magneticComponent': 'i', 'resultFormat': 'json'})
-f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
-data = json.loads(f.read())
 print("// Magnetic inclination data in degrees")
-print('// Model: {},'.format(data['model']))
-print('// Version: {},'.format(data['version']))
-print('// Date: {},'.format(data['result'][0]['date']))
-print('static constexpr const int8_t inclination_table[{}][{}]'.format(LAT_DIM, LON_DIM) + " {")
-for latitude in range(SAMPLING_MIN_LAT, SAMPLING_MAX_LAT+1, SAMPLING_RES):
-    params = urllib.parse.urlencode({'lat1': latitude, 'lat2': latitude, 'lon1': SAMPLING_MIN_LON, 'lon2': SAMPLING_MAX_LON, 'latStepSize': 1, 'lonStepSize': SAMPLING_RES, 'magneticComponent': 'i', 'resultFormat': 'json'})
-    f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
-    data = json.loads(f.read())
-
-    print('	{ ', end='')
-    for p in data['result']:
-        inclination_int = constrain(int(round(p['inclination'])), 127, -128)
-        print('{0:4d},'.format(inclination_int), end='')
-
-    print(' },')
-print("};\n")
+fetch_model_info('i')
+print_table('inclination_table', fetch_grid('i', 'inclination', 1.0), True)
 
 # total intensity
-params = urllib.parse.urlencode({'lat1': 0, 'lat2': 0, 'lon1': 0, 'lon2': 0, 'latStepSize': 1, 'lonStepSize': 1, 'magneticComponent': 'i', 'resultFormat': 'json'})
-f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
-data = json.loads(f.read())
 print("// Magnetic strength data in micro-Tesla or centi-Gauss")
-print('// Model: {},'.format(data['model']))
-print('// Version: {},'.format(data['version']))
-print('// Date: {},'.format(data['result'][0]['date']))
-print('static constexpr const int8_t strength_table[{}][{}]'.format(LAT_DIM, LON_DIM) + " {")
-for latitude in range(SAMPLING_MIN_LAT, SAMPLING_MAX_LAT+1, SAMPLING_RES):
-    params = urllib.parse.urlencode({'lat1': latitude, 'lat2': latitude, 'lon1': SAMPLING_MIN_LON, 'lon2': SAMPLING_MAX_LON, 'latStepSize': 1, 'lonStepSize': SAMPLING_RES, 'magneticComponent': 'f', 'resultFormat': 'json'})
-    f = urllib.request.urlopen("https://www.ngdc.noaa.gov/geomag-web/calculators/calculateIgrfgrid?%s" % params)
-    data = json.loads(f.read())
-
-    print('	{ ', end='')
-    for p in data['result']:
-        totalintensity_int = int(round(p['totalintensity'] / 1000))
-        print('{0:4d},'.format(totalintensity_int), end='')
-
-    print(' },')
-print("};")
+fetch_model_info('i')
+print_table('strength_table', fetch_grid('f', 'totalintensity', 0.001), False)
@@ -37,13 +37,14 @@
 * Calculation / lookup table for Earth's magnetic field declination (deg), inclination (deg) and strength (mTesla).
 * Data generated by https://www.ngdc.noaa.gov/geomag-web/#igrfgrid IGRF calculator on 22 Jan 2018
 *
-* XXX Lookup table currently too coarse in resolution (only full degrees)
-* and lat/lon res - needs extension medium term.
+* The default tables hold whole degrees on a 10 degree grid, finer grids are stored
+* compressed (see geo_mag_table.hpp) and are selected by regenerating geo_magnetic_tables.hpp.
 *
 */
 
 #include "geo_mag_declination.h"
 
+#include "geo_mag_table.hpp"
 #include "geo_magnetic_tables.hpp"
 
 #include <mathlib/mathlib.h>
@@ -66,7 +67,20 @@ static constexpr unsigned get_lookup_table_index(float *val, float min, float ma
 	return static_cast<unsigned>((-(min) + *val) / SAMPLING_RES);
 }
 
-static constexpr float get_table_data(float lat, float lon, const int8_t table[LAT_DIM][LON_DIM])
+// sample of a table of whole degrees generated at the default resolution
+static constexpr float get_table_value(const int8_t (&table)[LAT_DIM][LON_DIM], unsigned lat_index, unsigned lon_index)
+{
+	return table[lat_index][lon_index];
+}
+
+// sample of a compressed table generated at a finer resolution, see geo_mag_table.hpp
+static constexpr float get_table_value(const geo_mag_compressed_table &table, unsigned lat_index, unsigned lon_index)
+{
+	return get_compressed_table_value(table, lat_index, lon_index);
+}
+
+template<typename Table>
+static constexpr float get_table_data(float lat, float lon, const Table &table)
 {
 	/*
 	 * If the values exceed valid ranges, return zero as default
@@ -86,10 +100,10 @@ static constexpr float get_table_data(float lat, float lon, const int8_t table[L
 	unsigned min_lat_index = get_lookup_table_index(&min_lat, SAMPLING_MIN_LAT, SAMPLING_MAX_LAT);
 	unsigned min_lon_index = get_lookup_table_index(&min_lon, SAMPLING_MIN_LON, SAMPLING_MAX_LON);
 
-	const float data_sw = table[min_lat_index][min_lon_index];
-	const float data_se = table[min_lat_index][min_lon_index + 1];
-	const float data_ne = table[min_lat_index + 1][min_lon_index + 1];
-	const float data_nw = table[min_lat_index + 1][min_lon_index];
+	const float data_sw = get_table_value(table, min_lat_index, min_lon_index);
+	const float data_se = get_table_value(table, min_lat_index, min_lon_index + 1);
+	const float data_ne = get_table_value(table, min_lat_index + 1, min_lon_index + 1);
+	const float data_nw = get_table_value(table, min_lat_index + 1, min_lon_index);
 
 	/* perform bilinear interpolation on the four grid corners */
 	const float lat_scale = constrain((lat - min_lat) / SAMPLING_RES, 0.f, 1.f);
@@ -0,0 +1,71 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2014 MAV GEO Library (MAVGEO). All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name MAVGEO nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+* @file geo_mag_table.hpp
+*
+* Compressed storage for magnetic field grids finer than the default 10 degree tables.
+* The grid is split into square tiles, each tile stores an int16_t base value and a shift,
+* and every sample stores an int8_t residual relative to the base of its tile:
+*
+*   sample = (tile_base + residual * 2^tile_shift) * scale
+*
+* This keeps the flash footprint close to one byte per sample while any sample is
+* decoded in constant time. Tables in this format are generated by
+* fetch_noaa_table.py --tile-size.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+struct geo_mag_compressed_table {
+	float scale;			// value of one quantisation step
+	unsigned tile_size;		// number of samples along each side of a tile
+	unsigned tiles_lon;		// number of tiles along a row of constant latitude
+	unsigned lon_dim;		// number of samples along a row of constant latitude
+	const int16_t *tile_base;	// base value of each tile in quantisation steps, tiles stored row major
+	const uint8_t *tile_shift;	// power of two applied to the residuals of each tile
+	const int8_t *residual;		// residual of each sample, samples stored row major
+};
+
+// decode a single sample of a compressed table
+static constexpr float get_compressed_table_value(const geo_mag_compressed_table &table, unsigned lat_index,
+		unsigned lon_index)
+{
+	const unsigned tile = (lat_index / table.tile_size) * table.tiles_lon + lon_index / table.tile_size;
+	const int32_t residual = table.residual[lat_index * table.lon_dim + lon_index];
+
+	return (table.tile_base[tile] + residual * (int32_t(1) << table.tile_shift[tile])) * table.scale;
+}
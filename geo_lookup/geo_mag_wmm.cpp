@@ -0,0 +1,261 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2020 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+* @file geo_mag_wmm.cpp
+*
+* World Magnetic Model evaluation following the NOAA technical report of the model:
+* geodetic to geocentric conversion, recursive evaluation of the Schmidt semi-normalised
+* associated Legendre functions and rotation of the field back to the geodetic frame.
+*
+*/
+
+#include "geo_mag_wmm.h"
+
+#include <math.h>
+
+// WGS-84 ellipsoid and the geomagnetic reference radius (km)
+static constexpr double WGS84_A = 6378.137;
+static constexpr double WGS84_B = 6356.7523142;
+static constexpr double WMM_REFERENCE_RADIUS = 6371.2;
+
+static constexpr double DEG_TO_RAD = M_PI / 180.0;
+static constexpr double RAD_TO_DEG = 180.0 / M_PI;
+static constexpr double EARTH_RADIUS_M = 6371000.0;
+
+WorldMagneticModel::WorldMagneticModel()
+{
+	// Schmidt semi-normalisation factors, applied to the coefficients once
+	double schmidt[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	schmidt[0][0] = 1.0;
+
+	for (int n = 1; n <= WMM_MAX_DEGREE; n++) {
+		schmidt[n][0] = schmidt[n - 1][0] * (2 * n - 1) / n;
+
+		for (int m = 1; m <= n; m++) {
+			const double j = (m == 1) ? 2.0 : 1.0;
+			schmidt[n][m] = schmidt[n][m - 1] * sqrt((n - m + 1) * j / (n + m));
+		}
+
+		for (int m = 0; m <= n; m++) {
+			_k[n][m] = (n > 1) ? (double((n - 1) * (n - 1) - m * m) / double((2 * n - 1) * (2 * n - 3))) : 0.0;
+		}
+	}
+
+	for (const wmm_coefficient &coefficient : wmm_coefficients) {
+		const int n = coefficient.n;
+		const int m = coefficient.m;
+		_g[n][m] = schmidt[n][m] * coefficient.g;
+		_h[n][m] = schmidt[n][m] * coefficient.h;
+		_g_dot[n][m] = schmidt[n][m] * coefficient.g_dot;
+		_h_dot[n][m] = schmidt[n][m] * coefficient.h_dot;
+	}
+}
+
+void WorldMagneticModel::setCacheThresholds(float horizontal_m, float vertical_m, float years)
+{
+	_horizontal_threshold = horizontal_m;
+	_vertical_threshold = vertical_m;
+	_year_threshold = years;
+	_cache_valid = false;
+}
+
+const geo_mag_field &WorldMagneticModel::getField(double lat, double lon, float alt, float decimal_year)
+{
+	if (!isCacheValid(lat, lon, alt, decimal_year)) {
+		_cached_field = evaluate(lat, lon, alt, decimal_year);
+		_cached_lat = lat;
+		_cached_lon = lon;
+		_cached_alt = alt;
+		_cached_year = decimal_year;
+		_cache_valid = true;
+	}
+
+	return _cached_field;
+}
+
+void WorldMagneticModel::getFields(const double *lat, const double *lon, const float *alt, size_t count,
+				   float decimal_year, geo_mag_field *fields)
+{
+	for (size_t i = 0; i < count; i++) {
+		fields[i] = getField(lat[i], lon[i], alt[i], decimal_year);
+	}
+}
+
+bool WorldMagneticModel::isCacheValid(double lat, double lon, float alt, float decimal_year) const
+{
+	if (!_cache_valid) {
+		return false;
+	}
+
+	// equirectangular approximation of the horizontal distance, sufficient for thresholds of a few km
+	double delta_lon = fabs(lon - _cached_lon);
+
+	if (delta_lon > 180.0) {
+		delta_lon = 360.0 - delta_lon;
+	}
+
+	const double north = (lat - _cached_lat) * DEG_TO_RAD * EARTH_RADIUS_M;
+	const double east = delta_lon * DEG_TO_RAD * EARTH_RADIUS_M * cos(_cached_lat * DEG_TO_RAD);
+
+	return (north * north + east * east <= double(_horizontal_threshold) * double(_horizontal_threshold))
+	       && (fabsf(alt - _cached_alt) <= _vertical_threshold)
+	       && (fabsf(decimal_year - _cached_year) <= _year_threshold);
+}
+
+void WorldMagneticModel::updateCoefficients(float decimal_year)
+{
+	if (_coefficients_valid && (decimal_year == _coefficients_year)) {
+		return;
+	}
+
+	const double dt = double(decimal_year) - double(WMM_EPOCH);
+
+	for (int n = 1; n <= WMM_MAX_DEGREE; n++) {
+		for (int m = 0; m <= n; m++) {
+			_g_t[n][m] = _g[n][m] + dt * _g_dot[n][m];
+			_h_t[n][m] = _h[n][m] + dt * _h_dot[n][m];
+		}
+	}
+
+	_coefficients_year = decimal_year;
+	_coefficients_valid = true;
+}
+
+geo_mag_field WorldMagneticModel::evaluate(double lat, double lon, float alt, float decimal_year)
+{
+	updateCoefficients(decimal_year);
+	_evaluation_count++;
+
+	const double alt_km = double(alt) * 1.0e-3;
+	const double sin_lat = sin(lat * DEG_TO_RAD);
+	const double cos_lat = cos(lat * DEG_TO_RAD);
+	const double sin_lat_sq = sin_lat * sin_lat;
+	const double cos_lat_sq = cos_lat * cos_lat;
+
+	// geodetic to geocentric spherical coordinates
+	const double a2 = WGS84_A * WGS84_A;
+	const double b2 = WGS84_B * WGS84_B;
+	const double c2 = a2 - b2;
+	const double a4 = a2 * a2;
+	const double c4 = a4 - b2 * b2;
+
+	const double q = sqrt(a2 - c2 * sin_lat_sq);
+	const double q1 = alt_km * q;
+	const double q2 = ((q1 + a2) / (q1 + b2)) * ((q1 + a2) / (q1 + b2));
+	const double ct = sin_lat / sqrt(q2 * cos_lat_sq + sin_lat_sq);	// cosine of the geocentric colatitude
+	const double st = sqrt(1.0 - ct * ct);					// sine of the geocentric colatitude
+	const double r = sqrt(alt_km * alt_km + 2.0 * q1 + (a4 - c4 * sin_lat_sq) / (q * q));
+	const double d = sqrt(a2 * cos_lat_sq + b2 * sin_lat_sq);
+	const double ca = (alt_km + d) / r;					// rotation from the geocentric
+	const double sa = c2 * cos_lat * sin_lat / (r * d);			// to the geodetic frame
+
+	// sin(m * lon) and cos(m * lon) by the angle sum recursion
+	double sin_m_lon[WMM_MAX_DEGREE + 1];
+	double cos_m_lon[WMM_MAX_DEGREE + 1];
+	sin_m_lon[0] = 0.0;
+	cos_m_lon[0] = 1.0;
+	sin_m_lon[1] = sin(lon * DEG_TO_RAD);
+	cos_m_lon[1] = cos(lon * DEG_TO_RAD);
+
+	for (int m = 2; m <= WMM_MAX_DEGREE; m++) {
+		sin_m_lon[m] = sin_m_lon[1] * cos_m_lon[m - 1] + cos_m_lon[1] * sin_m_lon[m - 1];
+		cos_m_lon[m] = cos_m_lon[1] * cos_m_lon[m - 1] - sin_m_lon[1] * sin_m_lon[m - 1];
+	}
+
+	// associated Legendre functions P[n][m] and their derivatives with respect to the colatitude,
+	// Gauss normalised so that they combine with the Schmidt semi-normalised coefficients
+	double P[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	double dP[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	P[0][0] = 1.0;
+
+	// P[n][1] / sin(colatitude) for the east component at the geographic poles
+	double P_pole[WMM_MAX_DEGREE + 1] {};
+	P_pole[0] = 1.0;
+
+	const double ratio = WMM_REFERENCE_RADIUS / r;
+	double ratio_pow = ratio * ratio;
+
+	double B_r = 0.0;		// radial component
+	double B_theta = 0.0;		// colatitude component
+	double B_phi = 0.0;		// longitude component
+	double B_phi_pole = 0.0;
+
+	for (int n = 1; n <= WMM_MAX_DEGREE; n++) {
+		ratio_pow *= ratio;	// (a / r)^(n + 2)
+
+		for (int m = 0; m <= n; m++) {
+			if (n == m) {
+				P[n][m] = st * P[n - 1][m - 1];
+				dP[n][m] = st * dP[n - 1][m - 1] + ct * P[n - 1][m - 1];
+
+			} else if (n == 1) {
+				P[n][m] = ct * P[n - 1][m];
+				dP[n][m] = ct * dP[n - 1][m] - st * P[n - 1][m];
+
+			} else {
+				P[n][m] = ct * P[n - 1][m] - _k[n][m] * P[n - 2][m];
+				dP[n][m] = ct * dP[n - 1][m] - st * P[n - 1][m] - _k[n][m] * dP[n - 2][m];
+			}
+
+			const double cos_term = _g_t[n][m] * cos_m_lon[m] + _h_t[n][m] * sin_m_lon[m];
+			const double sin_term = _g_t[n][m] * sin_m_lon[m] - _h_t[n][m] * cos_m_lon[m];
+
+			B_theta -= ratio_pow * cos_term * dP[n][m];
+			B_phi += m * sin_term * ratio_pow * P[n][m];
+			B_r += (n + 1) * cos_term * ratio_pow * P[n][m];
+
+			if (m == 1) {
+				P_pole[n] = (n == 1) ? P_pole[n - 1] : (ct * P_pole[n - 1] - _k[n][m] * P_pole[n - 2]);
+				B_phi_pole += sin_term * ratio_pow * P_pole[n];
+			}
+		}
+	}
+
+	B_phi = (st > 1.0e-10) ? (B_phi / st) : B_phi_pole;
+
+	// rotate to the geodetic north, east, down frame
+	const double north = -B_theta * ca - B_r * sa;
+	const double east = B_phi;
+	const double down = B_theta * sa - B_r * ca;
+	const double horizontal = sqrt(north * north + east * east);
+
+	geo_mag_field field{};
+	field.declination = float(atan2(east, north) * RAD_TO_DEG);
+	field.inclination = float(atan2(down, horizontal) * RAD_TO_DEG);
+	field.strength = float(sqrt(horizontal * horizontal + down * down) * 1.0e-3);
+	field.north = float(north * 1.0e-3);
+	field.east = float(east * 1.0e-3);
+	field.down = float(down * 1.0e-3);
+	return field;
+}
@@ -0,0 +1,116 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2020 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+* @file geo_mag_wmm.h
+*
+* Evaluation of the World Magnetic Model spherical harmonic expansion, an alternative to
+* the lookup tables of geo_mag_declination.h where their resolution is not sufficient.
+*
+* The last field is cached and only recomputed when the position or date has moved past
+* configurable thresholds, so that densely sampled positions such as log points or a
+* mission plan are cheap to evaluate.
+*
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "geo_mag_wmm_coefficients.hpp"
+
+struct geo_mag_field {
+	float declination;	// deg
+	float inclination;	// deg
+	float strength;		// total intensity in micro-Tesla, same as get_mag_strength()
+	float north;		// micro-Tesla
+	float east;		// micro-Tesla
+	float down;		// micro-Tesla
+};
+
+class WorldMagneticModel
+{
+public:
+	WorldMagneticModel();
+
+	// A cached field is reused while the position is within horizontal_m and vertical_m metres and the
+	// date within years of the position and date it was evaluated at. Zero thresholds disable the cache.
+	void setCacheThresholds(float horizontal_m, float vertical_m, float years);
+
+	// field at a geodetic position (deg) and height above the WGS-84 ellipsoid (m) on a decimal year date
+	const geo_mag_field &getField(double lat, double lon, float alt, float decimal_year);
+
+	// field at count positions on the same date, positions are best ordered along a path to make use of the cache
+	void getFields(const double *lat, const double *lon, const float *alt, size_t count, float decimal_year,
+		       geo_mag_field *fields);
+
+	// field at a position without using or updating the cache
+	geo_mag_field evaluate(double lat, double lon, float alt, float decimal_year);
+
+	// number of full evaluations of the spherical harmonic expansion
+	unsigned getEvaluationCount() const { return _evaluation_count; }
+
+	void resetCache() { _cache_valid = false; }
+
+private:
+	// Schmidt semi-normalised coefficients at the epoch, indexed [n][m] (nT)
+	double _g[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	double _h[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	double _g_dot[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	double _h_dot[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+
+	// coefficients propagated to _coefficients_year
+	double _g_t[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	double _h_t[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+	float _coefficients_year{0.0f};
+	bool _coefficients_valid{false};
+
+	// recursion constants of the associated Legendre functions
+	double _k[WMM_MAX_DEGREE + 1][WMM_MAX_DEGREE + 1] {};
+
+	float _horizontal_threshold{500.0f};	// m
+	float _vertical_threshold{50.0f};	// m
+	float _year_threshold{0.01f};		// years
+
+	geo_mag_field _cached_field{};
+	double _cached_lat{0.0};
+	double _cached_lon{0.0};
+	float _cached_alt{0.0f};
+	float _cached_year{0.0f};
+	bool _cache_valid{false};
+
+	unsigned _evaluation_count{0};
+
+	void updateCoefficients(float decimal_year);
+	bool isCacheValid(double lat, double lon, float alt, float decimal_year) const;
+};
@@ -0,0 +1,149 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2020 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+* @file geo_mag_wmm_coefficients.hpp
+*
+* Spherical harmonic coefficients of the World Magnetic Model, from WMM.COF
+* published by NOAA NCEI with each model release.
+*
+*/
+
+#pragma once
+
+static constexpr int WMM_MAX_DEGREE = 12;
+static constexpr float WMM_EPOCH = 2020.0f;	// decimal year
+static constexpr float WMM_VALID_YEARS = 5.0f;	// the model is valid from the epoch for this many years
+
+struct wmm_coefficient {
+	int n;		// degree
+	int m;		// order
+	float g;	// Gauss coefficient g(n, m) at the epoch (nT)
+	float h;	// Gauss coefficient h(n, m) at the epoch (nT)
+	float g_dot;	// secular variation of g(n, m) (nT/year)
+	float h_dot;	// secular variation of h(n, m) (nT/year)
+};
+
+// Model: WMM-2020
+static constexpr wmm_coefficient wmm_coefficients[] {
+	{ 1,  0, -29404.5f,      0.0f,   6.7f,   0.0f},
+	{ 1,  1,  -1450.7f,   4652.9f,   7.7f, -25.1f},
+	{ 2,  0,  -2500.0f,      0.0f, -11.5f,   0.0f},
+	{ 2,  1,   2982.0f,  -2991.6f,  -7.1f, -30.2f},
+	{ 2,  2,   1676.8f,   -734.8f,  -2.2f, -23.9f},
+	{ 3,  0,   1363.9f,      0.0f,   2.8f,   0.0f},
+	{ 3,  1,  -2381.0f,    -82.2f,  -6.2f,   5.7f},
+	{ 3,  2,   1236.2f,    241.8f,   3.4f,  -1.0f},
+	{ 3,  3,    525.7f,   -542.9f, -12.2f,   1.1f},
+	{ 4,  0,    903.1f,      0.0f,  -1.1f,   0.0f},
+	{ 4,  1,    809.4f,    282.0f,  -1.6f,   0.2f},
+	{ 4,  2,     86.2f,   -158.4f,  -6.0f,   6.9f},
+	{ 4,  3,   -309.4f,    199.8f,   5.4f,   3.7f},
+	{ 4,  4,     47.9f,   -350.1f,  -5.5f,  -5.6f},
+	{ 5,  0,   -234.4f,      0.0f,  -0.3f,   0.0f},
+	{ 5,  1,    363.1f,     47.7f,   0.6f,   0.1f},
+	{ 5,  2,    187.8f,    208.4f,  -0.7f,   2.5f},
+	{ 5,  3,   -140.7f,   -121.3f,   0.1f,  -0.9f},
+	{ 5,  4,   -151.2f,     32.2f,   1.2f,   3.0f},
+	{ 5,  5,     13.7f,     99.1f,   1.0f,   0.5f},
+	{ 6,  0,     65.9f,      0.0f,  -0.6f,   0.0f},
+	{ 6,  1,     65.6f,    -19.1f,  -0.4f,   0.1f},
+	{ 6,  2,     73.0f,     25.0f,   0.5f,  -1.8f},
+	{ 6,  3,   -121.5f,     52.7f,   1.4f,  -1.4f},
+	{ 6,  4,    -36.2f,    -64.4f,  -1.4f,   0.9f},
+	{ 6,  5,     13.5f,      9.0f,  -0.0f,   0.1f},
+	{ 6,  6,    -64.7f,     68.1f,   0.8f,   1.0f},
+	{ 7,  0,     80.6f,      0.0f,  -0.1f,   0.0f},
+	{ 7,  1,    -76.8f,    -51.4f,  -0.3f,   0.5f},
+	{ 7,  2,     -8.3f,    -16.8f,  -0.1f,   0.6f},
+	{ 7,  3,     56.5f,      2.3f,   0.7f,  -0.7f},
+	{ 7,  4,     15.8f,     23.5f,   0.2f,  -0.2f},
+	{ 7,  5,      6.4f,     -2.2f,  -0.5f,  -1.2f},
+	{ 7,  6,     -7.2f,    -27.2f,  -0.8f,   0.2f},
+	{ 7,  7,      9.8f,     -1.9f,   1.0f,   0.3f},
+	{ 8,  0,     23.6f,      0.0f,  -0.1f,   0.0f},
+	{ 8,  1,      9.8f,      8.4f,   0.1f,  -0.3f},
+	{ 8,  2,    -17.5f,    -15.3f,  -0.1f,   0.7f},
+	{ 8,  3,     -0.4f,     12.8f,   0.5f,  -0.2f},
+	{ 8,  4,    -21.1f,    -11.8f,  -0.1f,   0.5f},
+	{ 8,  5,     15.3f,     14.9f,   0.4f,  -0.3f},
+	{ 8,  6,     13.7f,      3.6f,   0.5f,  -0.5f},
+	{ 8,  7,    -16.5f,     -6.9f,   0.0f,   0.4f},
+	{ 8,  8,     -0.3f,      2.8f,   0.4f,   0.1f},
+	{ 9,  0,      5.0f,      0.0f,  -0.1f,   0.0f},
+	{ 9,  1,      8.2f,    -23.3f,  -0.2f,  -0.3f},
+	{ 9,  2,      2.9f,     11.1f,  -0.0f,   0.2f},
+	{ 9,  3,     -1.4f,      9.8f,   0.4f,  -0.4f},
+	{ 9,  4,     -1.1f,     -5.1f,  -0.3f,   0.4f},
+	{ 9,  5,    -13.3f,     -6.2f,  -0.0f,   0.1f},
+	{ 9,  6,      1.1f,      7.8f,   0.3f,  -0.0f},
+	{ 9,  7,      8.9f,      0.4f,  -0.0f,  -0.2f},
+	{ 9,  8,     -9.3f,     -1.5f,  -0.0f,   0.5f},
+	{ 9,  9,    -11.9f,      9.7f,  -0.4f,   0.2f},
+	{10,  0,     -1.9f,      0.0f,   0.0f,   0.0f},
+	{10,  1,     -6.2f,      3.4f,  -0.0f,  -0.0f},
+	{10,  2,     -0.1f,     -0.2f,  -0.0f,   0.1f},
+	{10,  3,      1.7f,      3.5f,   0.2f,  -0.3f},
+	{10,  4,     -0.9f,      4.8f,  -0.1f,   0.1f},
+	{10,  5,      0.6f,     -8.6f,  -0.2f,  -0.2f},
+	{10,  6,     -0.9f,     -0.1f,  -0.0f,   0.1f},
+	{10,  7,      1.9f,     -4.2f,  -0.1f,  -0.0f},
+	{10,  8,      1.4f,     -3.4f,  -0.2f,  -0.1f},
+	{10,  9,     -2.4f,     -0.1f,  -0.1f,   0.2f},
+	{10, 10,     -3.9f,     -8.8f,  -0.0f,  -0.0f},
+	{11,  0,      3.0f,      0.0f,  -0.0f,   0.0f},
+	{11,  1,     -1.4f,     -0.0f,  -0.1f,  -0.0f},
+	{11,  2,     -2.5f,      2.6f,  -0.0f,   0.1f},
+	{11,  3,      2.4f,     -0.5f,   0.0f,   0.0f},
+	{11,  4,     -0.9f,     -0.4f,  -0.0f,   0.2f},
+	{11,  5,      0.3f,      0.6f,  -0.1f,  -0.0f},
+	{11,  6,     -0.7f,     -0.2f,   0.0f,   0.0f},
+	{11,  7,     -0.1f,     -1.7f,  -0.0f,   0.1f},
+	{11,  8,      1.4f,     -1.6f,  -0.1f,  -0.0f},
+	{11,  9,     -0.6f,     -3.0f,  -0.1f,  -0.1f},
+	{11, 10,      0.2f,     -2.0f,  -0.1f,   0.0f},
+	{11, 11,      3.1f,     -2.6f,  -0.1f,  -0.0f},
+	{12,  0,     -2.0f,      0.0f,   0.0f,   0.0f},
+	{12,  1,     -0.1f,     -1.2f,  -0.0f,  -0.0f},
+	{12,  2,      0.5f,      0.5f,  -0.0f,   0.0f},
+	{12,  3,      1.3f,      1.3f,   0.0f,  -0.1f},
+	{12,  4,     -1.2f,     -1.8f,  -0.0f,   0.1f},
+	{12,  5,      0.7f,      0.1f,  -0.0f,  -0.0f},
+	{12,  6,      0.3f,      0.7f,   0.0f,   0.0f},
+	{12,  7,      0.5f,     -0.1f,  -0.0f,  -0.0f},
+	{12,  8,     -0.2f,      0.6f,   0.0f,   0.1f},
+	{12,  9,     -0.5f,      0.2f,  -0.0f,  -0.0f},
+	{12, 10,      0.1f,     -0.9f,  -0.0f,  -0.0f},
+	{12, 11,     -1.1f,     -0.0f,  -0.0f,   0.0f},
+	{12, 12,     -0.3f,      0.5f,  -0.1f,  -0.1f},
+};
@@ -0,0 +1,455 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2020 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+* @file terrain_dem.cpp
+*
+*/
+
+#include "terrain_dem.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+TerrainDemCache::TerrainDemCache(unsigned max_resident_tiles) :
+	_max_resident_tiles(max_resident_tiles > 0 ? max_resident_tiles : 1)
+{
+}
+
+TerrainDemCache::~TerrainDemCache()
+{
+	close();
+}
+
+bool TerrainDemCache::open(const char *file_name)
+{
+	close();
+
+	_fd = ::open(file_name, O_RDONLY);
+
+	if (_fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+
+	if (fstat(_fd, &file_stat) != 0) {
+		close();
+		return false;
+	}
+
+	_file_size = static_cast<uint64_t>(file_stat.st_size);
+
+	// the tile table has to be complete, the tiles themselves are checked when they are mapped
+	const bool header_valid = (pread(_fd, &_header, sizeof(_header), 0) == (ssize_t)sizeof(_header))
+				  && (_header.magic == TERRAIN_DEM_MAGIC)
+				  && (_header.version == TERRAIN_DEM_VERSION)
+				  && (_header.tile_size > 0)
+				  && (_header.spacing > 0.0)
+				  && (_header.tiles_lat > 0)
+				  && (_header.tiles_lon > 0)
+				  && (getTileTableEnd() <= _file_size);
+
+	if (header_valid) {
+		_tiles = new tile_s[_max_resident_tiles];
+	}
+
+	if (_tiles == nullptr) {
+		close();
+		return false;
+	}
+
+	const long page_size = sysconf(_SC_PAGESIZE);
+	_page_size = (page_size > 0) ? static_cast<size_t>(page_size) : 4096;
+
+	_stop_loader = false;
+	_loader = std::thread(&TerrainDemCache::runLoader, this);
+
+	return true;
+}
+
+void TerrainDemCache::close()
+{
+	if (_loader.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop_loader = true;
+		}
+
+		_request_cv.notify_all();
+		_loader.join();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_tiles != nullptr) {
+		for (unsigned i = 0; i < _max_resident_tiles; i++) {
+			unmapTile(_tiles[i]);
+		}
+
+		delete[] _tiles;
+		_tiles = nullptr;
+	}
+
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+
+	_file_size = 0;
+	_request_pending = false;
+	_requested_count = 0;
+}
+
+void TerrainDemCache::unmapTile(tile_s &tile)
+{
+	if (tile.map != nullptr) {
+		munmap(tile.map, tile.map_length);
+	}
+
+	tile = tile_s{};
+}
+
+unsigned TerrainDemCache::getResidentTileCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	unsigned count = 0;
+
+	for (unsigned i = 0; (_tiles != nullptr) && (i < _max_resident_tiles); i++) {
+		if (_tiles[i].map != nullptr) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+unsigned TerrainDemCache::getTileLoadCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _tile_load_count;
+}
+
+uint64_t TerrainDemCache::getTileTableEnd() const
+{
+	return sizeof(terrain_dem_header) + uint64_t(_header.tiles_lat) * _header.tiles_lon * sizeof(uint64_t);
+}
+
+TerrainDemCache::tile_s *TerrainDemCache::findTile(uint32_t tile_index)
+{
+	for (unsigned i = 0; i < _max_resident_tiles; i++) {
+		if (_tiles[i].index == tile_index) {
+			return &_tiles[i];
+		}
+	}
+
+	return nullptr;
+}
+
+TerrainDemCache::tile_s *TerrainDemCache::findReplaceableTile()
+{
+	tile_s *least_recent = nullptr;
+
+	for (unsigned i = 0; i < _max_resident_tiles; i++) {
+		if (_tiles[i].index < 0) {
+			return &_tiles[i];
+		}
+
+		bool requested = false;
+
+		for (unsigned j = 0; j < _requested_count; j++) {
+			requested |= (_tiles[i].index == _requested[j]);
+		}
+
+		if (!requested && ((least_recent == nullptr) || (_tiles[i].last_used < least_recent->last_used))) {
+			least_recent = &_tiles[i];
+		}
+	}
+
+	return least_recent;
+}
+
+void TerrainDemCache::requestTiles(double row, double col)
+{
+	const uint32_t tile_size = _header.tile_size;
+	const int64_t tile_row = static_cast<uint32_t>(row) / tile_size;
+	const int64_t tile_col = static_cast<uint32_t>(col) / tile_size;
+
+	// the neighbours on the sides of the tile that the position is closest to
+	const int64_t rows[2] = {tile_row, (row - tile_row * tile_size >= 0.5 * tile_size) ? tile_row + 1 : tile_row - 1};
+	const int64_t cols[2] = {tile_col, (col - tile_col * tile_size >= 0.5 * tile_size) ? tile_col + 1 : tile_col - 1};
+
+	uint32_t requested[MAX_REQUESTED_TILES];
+	unsigned requested_count = 0;
+
+	for (unsigned i = 0; i < 2; i++) {
+		for (unsigned j = 0; j < 2; j++) {
+			if ((rows[i] >= 0) && (rows[i] < _header.tiles_lat) && (cols[j] >= 0) && (cols[j] < _header.tiles_lon)
+			    && (requested_count < _max_resident_tiles)) {
+				requested[requested_count++] = static_cast<uint32_t>(rows[i] * _header.tiles_lon + cols[j]);
+			}
+		}
+	}
+
+	bool changed = (requested_count != _requested_count);
+
+	for (unsigned i = 0; i < requested_count; i++) {
+		changed |= (requested[i] != _requested[i]);
+		_requested[i] = requested[i];
+	}
+
+	_requested_count = requested_count;
+
+	if (changed) {
+		_request_pending = true;
+		_request_cv.notify_one();
+	}
+}
+
+TerrainDemCache::tile_s TerrainDemCache::loadTile(uint32_t tile_index) const
+{
+	// tiles missing from the file are kept as entries without heights so that they are not read again
+	tile_s tile{};
+	tile.index = tile_index;
+
+	uint64_t offset = 0;
+	const off_t table_offset = sizeof(terrain_dem_header) + uint64_t(tile_index) * sizeof(uint64_t);
+
+	if ((pread(_fd, &offset, sizeof(offset), table_offset) != (ssize_t)sizeof(offset)) || (offset == 0)) {
+		return tile;
+	}
+
+	// mapping a tile that extends past the end of a truncated file would fault when it is read
+	const size_t tile_bytes = size_t(_header.tile_size + 1) * size_t(_header.tile_size + 1) * sizeof(int16_t);
+
+	if ((offset < getTileTableEnd()) || (offset > _file_size) || (tile_bytes > _file_size - offset)) {
+		return tile;
+	}
+
+	// mappings have to start on a page boundary
+	const uint64_t map_offset = offset - (offset % _page_size);
+	const size_t map_length = tile_bytes + (offset - map_offset);
+
+	void *map = mmap(nullptr, map_length, PROT_READ, MAP_PRIVATE, _fd, map_offset);
+
+	if (map == MAP_FAILED) {
+		return tile;
+	}
+
+	// read the tile into memory now so that lookups do not fault on it, locking it is best effort
+	// as it is limited for unprivileged processes
+	(void)mlock(map, map_length);
+
+	volatile uint8_t touched = 0;
+
+	for (size_t i = 0; i < map_length; i += _page_size) {
+		touched = touched + static_cast<const uint8_t *>(map)[i];
+	}
+
+	tile.map = map;
+	tile.map_length = map_length;
+	tile.heights = reinterpret_cast<const int16_t *>(static_cast<const uint8_t *>(map) + (offset - map_offset));
+
+	return tile;
+}
+
+void TerrainDemCache::runLoader()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_stop_loader) {
+		if (!_request_pending) {
+			_loading = false;
+			_idle_cv.notify_all();
+			_request_cv.wait(lock);
+			continue;
+		}
+
+		_request_pending = false;
+		_loading = true;
+
+		// start over if the position moved to other tiles in the meantime
+		for (unsigned i = 0; (i < _requested_count) && !_request_pending && !_stop_loader; i++) {
+			const uint32_t tile_index = _requested[i];
+
+			if (findTile(tile_index) != nullptr) {
+				continue;
+			}
+
+			// the file is read without holding the lock, lookups only wait for the tiles to be swapped
+			lock.unlock();
+			tile_s loaded = loadTile(tile_index);
+			lock.lock();
+
+			tile_s *entry = findReplaceableTile();
+
+			if (entry != nullptr) {
+				std::swap(*entry, loaded);
+				entry->last_used = ++_use_counter;
+
+				if (entry->map != nullptr) {
+					_tile_load_count++;
+				}
+			}
+
+			// the replaced tile, or the loaded one if all resident tiles are still requested
+			lock.unlock();
+			unmapTile(loaded);
+			lock.lock();
+		}
+	}
+
+	_loading = false;
+	_idle_cv.notify_all();
+}
+
+void TerrainDemCache::waitForTiles()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle_cv.wait(lock, [this] { return !_request_pending && !_loading; });
+}
+
+bool TerrainDemCache::getTerrainHeight(double lat, double lon, float &height, float &variance)
+{
+	// never wait for the loader thread, it only holds the lock briefly while swapping tiles
+	std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+
+	if (!lock.owns_lock() || !isOpen()) {
+		return false;
+	}
+
+	const double row = (lat - _header.lat_min) / _header.spacing;
+	const double col = (lon - _header.lon_min) / _header.spacing;
+	const uint32_t tile_size = _header.tile_size;
+
+	if ((row < 0.0) || (col < 0.0)
+	    || (row >= double(_header.tiles_lat) * tile_size) || (col >= double(_header.tiles_lon) * tile_size)) {
+		return false;
+	}
+
+	requestTiles(row, col);
+
+	const uint32_t tile_row = static_cast<uint32_t>(row) / tile_size;
+	const uint32_t tile_col = static_cast<uint32_t>(col) / tile_size;
+	tile_s *tile = findTile(tile_row * _header.tiles_lon + tile_col);
+
+	if ((tile == nullptr) || (tile->heights == nullptr)) {
+		return false;
+	}
+
+	tile->last_used = ++_use_counter;
+	const int16_t *heights = tile->heights;
+
+	// position within the tile, the samples at i + 1 and j + 1 are always part of the tile
+	const double tile_y = row - double(tile_row * tile_size);
+	const double tile_x = col - double(tile_col * tile_size);
+	const uint32_t i = static_cast<uint32_t>(tile_y);
+	const uint32_t j = static_cast<uint32_t>(tile_x);
+	const uint32_t stride = tile_size + 1;
+
+	const int16_t h_sw = heights[i * stride + j];
+	const int16_t h_se = heights[i * stride + j + 1];
+	const int16_t h_nw = heights[(i + 1) * stride + j];
+	const int16_t h_ne = heights[(i + 1) * stride + j + 1];
+
+	if ((h_sw == _header.no_data) || (h_se == _header.no_data) || (h_nw == _header.no_data) || (h_ne == _header.no_data)) {
+		return false;
+	}
+
+	const float lat_scale = static_cast<float>(tile_y - i);
+	const float lon_scale = static_cast<float>(tile_x - j);
+
+	const float h_south = h_sw + lon_scale * (h_se - h_sw);
+	const float h_north = h_nw + lon_scale * (h_ne - h_nw);
+
+	height = h_south + lat_scale * (h_north - h_south);
+	variance = _header.accuracy * _header.accuracy;
+	return true;
+}
+
+bool TerrainDemCache::writeFile(const char *file_name, double lat_min, double lon_min, double spacing, uint32_t rows,
+				uint32_t cols, const int16_t *heights, uint16_t tile_size, float accuracy, int16_t no_data)
+{
+	if ((rows < 2) || (cols < 2) || (tile_size == 0)) {
+		return false;
+	}
+
+	terrain_dem_header header{};
+	header.magic = TERRAIN_DEM_MAGIC;
+	header.version = TERRAIN_DEM_VERSION;
+	header.tile_size = tile_size;
+	header.lat_min = lat_min;
+	header.lon_min = lon_min;
+	header.spacing = spacing;
+	header.tiles_lat = (rows - 2) / tile_size + 1;
+	header.tiles_lon = (cols - 2) / tile_size + 1;
+	header.accuracy = accuracy;
+	header.no_data = no_data;
+
+	FILE *file = fopen(file_name, "wb");
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	const uint32_t tile_count = header.tiles_lat * header.tiles_lon;
+	const uint32_t stride = tile_size + 1;
+	const uint64_t tile_bytes = stride * stride * sizeof(int16_t);
+	bool success = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+	for (uint32_t tile = 0; success && (tile < tile_count); tile++) {
+		const uint64_t offset = sizeof(header) + tile_count * sizeof(uint64_t) + tile * tile_bytes;
+		success = (fwrite(&offset, sizeof(offset), 1, file) == 1);
+	}
+
+	for (uint32_t tile = 0; success && (tile < tile_count); tile++) {
+		const uint32_t row_start = (tile / header.tiles_lon) * tile_size;
+		const uint32_t col_start = (tile % header.tiles_lon) * tile_size;
+
+		for (uint32_t i = 0; success && (i < stride); i++) {
+			for (uint32_t j = 0; success && (j < stride); j++) {
+				const uint32_t row = row_start + i;
+				const uint32_t col = col_start + j;
+				const int16_t height = ((row < rows) && (col < cols)) ? heights[row * cols + col] : no_data;
+				success = (fwrite(&height, sizeof(height), 1, file) == 1);
+			}
+		}
+	}
+
+	return (fclose(file) == 0) && success;
+}
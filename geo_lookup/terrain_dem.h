@@ -0,0 +1,147 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2020 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+* @file terrain_dem.h
+*
+* Terrain elevation model stored as a tiled grid in a binary file. A loader thread memory
+* maps the tiles around the last queried position and a bounded number of them is kept
+* resident, the least recently used tile is unmapped when another one is needed. Lookups
+* only use resident tiles, so they never wait for the file and can be made from the filter
+* update.
+*
+* File layout, all values little endian:
+*   terrain_dem_header
+*   tiles_lat * tiles_lon uint64_t file offsets of the tiles, row major from the south-west, 0 for missing tiles
+*   tiles of (tile_size + 1) * (tile_size + 1) int16_t heights (m), rows of increasing latitude,
+*   neighbouring tiles share their edge samples so that interpolation never needs two tiles
+*
+*/
+
+#pragma once
+
+#include "terrain_height_source.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+
+static constexpr uint32_t TERRAIN_DEM_MAGIC = 0x444c4345; // "ECLD"
+static constexpr uint16_t TERRAIN_DEM_VERSION = 1;
+
+struct terrain_dem_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t tile_size;	///< number of sample intervals along each side of a tile
+	double lat_min;		///< latitude of the south-west sample (deg)
+	double lon_min;		///< longitude of the south-west sample (deg)
+	double spacing;		///< sample spacing (deg)
+	uint32_t tiles_lat;
+	uint32_t tiles_lon;
+	float accuracy;		///< 1-sigma accuracy of the heights (m)
+	int16_t no_data;	///< height of samples without data
+	uint16_t reserved;
+};
+
+static_assert(sizeof(terrain_dem_header) == 48, "terrain_dem_header must not contain padding");
+
+class TerrainDemCache : public TerrainHeightSource
+{
+public:
+	explicit TerrainDemCache(unsigned max_resident_tiles = 4);
+	~TerrainDemCache() override;
+
+	TerrainDemCache(const TerrainDemCache &) = delete;
+	TerrainDemCache &operator=(const TerrainDemCache &) = delete;
+
+	bool open(const char *file_name);
+	void close();
+	bool isOpen() const { return _fd >= 0; }
+
+	// bilinear interpolation of the heights around the position, returns false while the
+	// tile is not resident yet and asks the loader thread for it and its closest neighbours
+	bool getTerrainHeight(double lat, double lon, float &height, float &variance) override;
+
+	// block until the loader thread has mapped the requested tiles, not for use on the filter thread
+	void waitForTiles();
+
+	unsigned getResidentTileCount() const;
+	unsigned getTileLoadCount() const;
+
+	// write a grid of rows * cols heights (m), rows of increasing latitude, as a DEM file
+	static bool writeFile(const char *file_name, double lat_min, double lon_min, double spacing, uint32_t rows,
+			      uint32_t cols, const int16_t *heights, uint16_t tile_size, float accuracy, int16_t no_data);
+
+private:
+	struct tile_s {
+		int64_t index{-1};		// tile index in the file, -1 for an unused entry
+		void *map{nullptr};		// start of the page aligned mapping
+		size_t map_length{0};
+		const int16_t *heights{nullptr};	// nullptr for tiles missing from the file
+		uint32_t last_used{0};
+	};
+
+	// the tile under the position and its neighbours towards the closest edges
+	static constexpr unsigned MAX_REQUESTED_TILES = 4;
+
+	uint64_t getTileTableEnd() const;
+	void requestTiles(double row, double col);
+	tile_s *findTile(uint32_t tile_index);
+	tile_s *findReplaceableTile();
+	tile_s loadTile(uint32_t tile_index) const;
+	static void unmapTile(tile_s &tile);
+	void runLoader();
+
+	terrain_dem_header _header{};
+	int _fd{-1};
+	uint64_t _file_size{0};
+	size_t _page_size{4096};
+
+	// the members below are shared with the loader thread and protected by _mutex
+	mutable std::mutex _mutex;
+	std::condition_variable _request_cv;
+	std::condition_variable _idle_cv;
+	std::thread _loader;
+	bool _stop_loader{false};
+	bool _loading{false};
+	bool _request_pending{false};
+	uint32_t _requested[MAX_REQUESTED_TILES] {};
+	unsigned _requested_count{0};
+
+	tile_s *_tiles{nullptr};
+	unsigned _max_resident_tiles;
+	uint32_t _use_counter{0};
+	unsigned _tile_load_count{0};
+};
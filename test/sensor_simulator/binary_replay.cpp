@@ -0,0 +1,351 @@
+#include "binary_replay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+constexpr char kMagic[4] {'E', 'C', 'L', 'R'};
+constexpr uint16_t kVersion = 1;
+constexpr uint16_t kHeaderSize = 32;
+constexpr size_t kRecordHeaderSize = 10;
+constexpr uint32_t kIndexInterval = 1024;
+constexpr size_t kIndexEntrySize = 16;
+constexpr uint8_t kMaxValues = 10;
+
+// altitude, latitude and longitude are integers and would lose precision as float
+bool isIntegerValue(sensor_info::measurement_t sensor_type, uint8_t index)
+{
+	return sensor_type == sensor_info::GPS && index < 3;
+}
+
+template<typename T>
+void putLittleEndian(uint8_t *buffer, T value)
+{
+	for (size_t i = 0; i < sizeof(T); i++) {
+		buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+}
+
+template<typename T>
+T getLittleEndian(const uint8_t *buffer)
+{
+	T value = 0;
+
+	for (size_t i = 0; i < sizeof(T); i++) {
+		value |= static_cast<T>(buffer[i]) << (8 * i);
+	}
+
+	return value;
+}
+
+uint32_t floatToBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+float bitsToFloat(uint32_t bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+} // namespace
+
+BinaryReplayWriter::BinaryReplayWriter()
+{
+}
+
+BinaryReplayWriter::~BinaryReplayWriter()
+{
+	if (_file.is_open()) {
+		close();
+	}
+}
+
+bool BinaryReplayWriter::open(const std::string &file_name)
+{
+	_file.open(file_name, std::ios::binary | std::ios::trunc);
+	_offset = 0;
+	_record_count = 0;
+	_index.clear();
+
+	if (!_file) {
+		return false;
+	}
+
+	// the header is rewritten with the final counts when closing
+	writeHeader(0, 0);
+	return bool(_file);
+}
+
+void BinaryReplayWriter::write(const sensor_info &sample)
+{
+	if (_record_count % kIndexInterval == 0) {
+		_index.push_back(sample.timestamp);
+		_index.push_back(_offset);
+	}
+
+	const uint8_t num_values = std::min(sample.num_values, kMaxValues);
+	uint8_t record[kRecordHeaderSize + 4 * kMaxValues];
+	putLittleEndian<uint64_t>(record, sample.timestamp);
+	record[8] = static_cast<uint8_t>(sample.sensor_type);
+	record[9] = num_values;
+
+	for (uint8_t i = 0; i < num_values; i++) {
+		const uint32_t bits = isIntegerValue(sample.sensor_type, i)
+				      ? static_cast<uint32_t>(static_cast<int32_t>(sample.sensor_data[i]))
+				      : floatToBits(static_cast<float>(sample.sensor_data[i]));
+		putLittleEndian<uint32_t>(record + kRecordHeaderSize + 4 * i, bits);
+	}
+
+	const size_t record_size = kRecordHeaderSize + 4 * num_values;
+	_file.write(reinterpret_cast<const char *>(record), record_size);
+	_offset += record_size;
+	_record_count++;
+}
+
+bool BinaryReplayWriter::close()
+{
+	const uint64_t index_offset = kHeaderSize + _offset;
+	uint8_t entry[kIndexEntrySize];
+
+	for (size_t i = 0; i + 1 < _index.size(); i += 2) {
+		putLittleEndian<uint64_t>(entry, _index[i]);
+		putLittleEndian<uint64_t>(entry + 8, kHeaderSize + _index[i + 1]);
+		_file.write(reinterpret_cast<const char *>(entry), kIndexEntrySize);
+	}
+
+	_file.seekp(0);
+	writeHeader(_index.size() / 2, index_offset);
+
+	const bool success = bool(_file);
+	_file.close();
+	return success;
+}
+
+void BinaryReplayWriter::writeHeader(uint32_t index_count, uint64_t index_offset)
+{
+	uint8_t header[kHeaderSize] {};
+	memcpy(header, kMagic, sizeof(kMagic));
+	putLittleEndian<uint16_t>(header + 4, kVersion);
+	putLittleEndian<uint16_t>(header + 6, kHeaderSize);
+	putLittleEndian<uint32_t>(header + 8, _record_count);
+	putLittleEndian<uint32_t>(header + 12, index_count);
+	putLittleEndian<uint64_t>(header + 16, index_offset);
+	putLittleEndian<uint32_t>(header + 24, kIndexInterval);
+	_file.write(reinterpret_cast<const char *>(header), kHeaderSize);
+}
+
+bool BinaryReplayWriter::convertFromCsv(const std::string &csv_file_name, const std::string &binary_file_name)
+{
+	std::ifstream csv_file(csv_file_name);
+
+	if (!csv_file) {
+		return false;
+	}
+
+	BinaryReplayWriter writer;
+
+	if (!writer.open(binary_file_name)) {
+		std::remove(binary_file_name.c_str());
+		return false;
+	}
+
+	// stream line by line so that arbitrarily large logs can be converted
+	sensor_info sample;
+	uint64_t last_timestamp = 0;
+	bool success = true;
+
+	while (SensorSimulator::readSensorSample(csv_file, sample)) {
+		if (sample.timestamp < last_timestamp) {
+			std::cout << "Timestamps not sorted ascendingly" << std::endl;
+			success = false;
+			break;
+		}
+
+		last_timestamp = sample.timestamp;
+		writer.write(sample);
+	}
+
+	success = writer.close() && success;
+
+	// do not leave a partly written file behind
+	if (!success) {
+		std::remove(binary_file_name.c_str());
+	}
+
+	return success;
+}
+
+bool BinaryReplayWriter::convert(ReplaySource &source, const std::string &binary_file_name)
+{
+	BinaryReplayWriter writer;
+
+	if (!writer.open(binary_file_name)) {
+		return false;
+	}
+
+	sensor_info sample;
+
+	while (source.readNext(sample)) {
+		writer.write(sample);
+	}
+
+	return writer.close();
+}
+
+BinaryReplayReader::BinaryReplayReader()
+{
+}
+
+BinaryReplayReader::~BinaryReplayReader()
+{
+	close();
+}
+
+bool BinaryReplayReader::open(const std::string &file_name)
+{
+	close();
+
+	const int fd = ::open(file_name.c_str(), O_RDONLY);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+
+	if (fstat(fd, &file_stat) != 0 || size_t(file_stat.st_size) < kHeaderSize) {
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	_data = static_cast<const uint8_t *>(data);
+	_size = file_stat.st_size;
+
+	// records are read sequentially
+	madvise(data, _size, MADV_SEQUENTIAL);
+
+	const uint64_t index_offset = getLittleEndian<uint64_t>(_data + 16);
+	_record_count = getLittleEndian<uint32_t>(_data + 8);
+	_index_count = getLittleEndian<uint32_t>(_data + 12);
+
+	if (memcmp(_data, kMagic, sizeof(kMagic)) != 0
+	    || getLittleEndian<uint16_t>(_data + 4) != kVersion
+	    || getLittleEndian<uint16_t>(_data + 6) != kHeaderSize
+	    || index_offset < kHeaderSize
+	    || index_offset + uint64_t(_index_count) * kIndexEntrySize != _size) {
+		close();
+		return false;
+	}
+
+	_records_begin = kHeaderSize;
+	_records_end = index_offset;
+	_pos = _records_begin;
+
+	return true;
+}
+
+void BinaryReplayReader::close()
+{
+	if (_data != nullptr) {
+		munmap(const_cast<uint8_t *>(_data), _size);
+	}
+
+	_data = nullptr;
+	_size = 0;
+	_records_begin = 0;
+	_records_end = 0;
+	_pos = 0;
+	_record_count = 0;
+	_index_count = 0;
+}
+
+bool BinaryReplayReader::peekTimestamp(uint64_t &timestamp)
+{
+	if (_pos + kRecordHeaderSize > _records_end) {
+		return false;
+	}
+
+	timestamp = getLittleEndian<uint64_t>(_data + _pos);
+	return true;
+}
+
+bool BinaryReplayReader::readNext(sensor_info &sample)
+{
+	if (_pos + kRecordHeaderSize > _records_end) {
+		return false;
+	}
+
+	const uint8_t *record = _data + _pos;
+	const uint8_t sensor_type = record[8];
+	const uint8_t num_values = record[9];
+	const size_t record_size = kRecordHeaderSize + 4 * num_values;
+
+	if (sensor_type > sensor_info::LANDING_STATUS || num_values > kMaxValues || _pos + record_size > _records_end) {
+		// skip the rest of a corrupted log
+		_pos = _records_end;
+		return false;
+	}
+
+	sample = {};
+	sample.timestamp = getLittleEndian<uint64_t>(record);
+	sample.sensor_type = static_cast<sensor_info::measurement_t>(sensor_type);
+	sample.num_values = num_values;
+
+	for (uint8_t i = 0; i < num_values; i++) {
+		const uint32_t bits = getLittleEndian<uint32_t>(record + kRecordHeaderSize + 4 * i);
+		sample.sensor_data[i] = isIntegerValue(sample.sensor_type, i)
+					? double(static_cast<int32_t>(bits))
+					: double(bitsToFloat(bits));
+	}
+
+	_pos += record_size;
+	return true;
+}
+
+void BinaryReplayReader::seek(uint64_t timestamp)
+{
+	// find the last indexed record older than the requested time
+	_pos = _records_begin;
+	uint32_t low = 0;
+	uint32_t high = _index_count;
+
+	while (low < high) {
+		const uint32_t mid = low + (high - low) / 2;
+		const uint8_t *entry = _data + _records_end + size_t(mid) * kIndexEntrySize;
+
+		if (getLittleEndian<uint64_t>(entry) < timestamp) {
+			_pos = getLittleEndian<uint64_t>(entry + 8);
+			low = mid + 1;
+
+		} else {
+			high = mid;
+		}
+	}
+
+	// and step forward from there
+	uint64_t record_timestamp;
+
+	while (peekTimestamp(record_timestamp) && record_timestamp < timestamp) {
+		const size_t record_size = kRecordHeaderSize + 4 * _data[_pos + 9];
+		_pos = std::min(_pos + record_size, _records_end);
+	}
+}
@@ -0,0 +1,117 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Compact binary replay format that can be memory mapped and streamed.
+ *
+ * All values are little-endian. The file starts with a header, followed by
+ * one record per sensor sample and an index at the end of the file:
+ *
+ * header:  char[4] "ECLR", uint16 version, uint16 header size, uint32 record count,
+ *          uint32 index entry count, uint64 index offset, uint32 index interval, uint32 reserved
+ * record:  uint64 timestamp (us), uint8 sensor type, uint8 value count,
+ *          value count * 4 byte values (int32 for the GPS altitude, latitude
+ *          and longitude, float32 for everything else)
+ * index:   uint64 timestamp, uint64 file offset of every index interval-th record
+ */
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sensor_simulator.h"
+
+class BinaryReplayWriter
+{
+public:
+	BinaryReplayWriter();
+	~BinaryReplayWriter();
+
+	bool open(const std::string &file_name);
+	void write(const sensor_info &sample);
+
+	// write the index and the final header, returns false if writing failed
+	bool close();
+
+	uint32_t getRecordCount() const { return _record_count; }
+
+	// convert a replay csv file to the binary format, returns false on failure
+	static bool convertFromCsv(const std::string &csv_file_name, const std::string &binary_file_name);
+
+	// write all samples of a streaming source to the binary format, returns false on failure
+	static bool convert(ReplaySource &source, const std::string &binary_file_name);
+
+private:
+	std::ofstream _file;
+	uint64_t _offset{0};
+	uint32_t _record_count{0};
+	std::vector<uint64_t> _index;	///< pairs of timestamp and offset
+
+	void writeHeader(uint32_t index_count, uint64_t index_offset);
+};
+
+class BinaryReplayReader : public ReplaySource
+{
+public:
+	BinaryReplayReader();
+	~BinaryReplayReader() override;
+
+	// the reader owns the memory mapping
+	BinaryReplayReader(const BinaryReplayReader &) = delete;
+	BinaryReplayReader &operator=(const BinaryReplayReader &) = delete;
+
+	bool open(const std::string &file_name);
+	void close();
+	bool isOpen() const { return _data != nullptr; }
+
+	uint32_t getRecordCount() const { return _record_count; }
+
+	bool peekTimestamp(uint64_t &timestamp) override;
+
+	// decode the next record, returns false at the end of the log or if the record is corrupted
+	bool readNext(sensor_info &sample) override;
+
+	// position the reader on the first record with a timestamp not older than the given one
+	void seek(uint64_t timestamp);
+	void rewind() { _pos = _records_begin; }
+
+private:
+	const uint8_t *_data{nullptr};
+	size_t _size{0};
+	size_t _records_begin{0};
+	size_t _records_end{0};
+	size_t _pos{0};
+	uint32_t _record_count{0};
+	uint32_t _index_count{0};
+};
@@ -0,0 +1,37 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "log_comparator.h"
+
+// compares two EKF logs within tolerances, see log_comparator.h
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		std::cerr << "usage: " << argv[0]
+			  << " <reference> <candidate> [abs_tolerance] [field_prefix=abs_tolerance[:rel_tolerance] ...]" << std::endl;
+		return -1;
+	}
+
+	LogComparator comparator;
+
+	for (int i = 3; i < argc; i++) {
+		const std::string argument(argv[i]);
+		const size_t equal = argument.find('=');
+
+		if (equal == std::string::npos) {
+			comparator.setDefaultTolerance(std::atof(argv[i]));
+			continue;
+		}
+
+		const std::string tolerances = argument.substr(equal + 1);
+		const size_t colon = tolerances.find(':');
+		const double rel_tolerance = (colon == std::string::npos) ? 0.0 : std::atof(tolerances.c_str() + colon + 1);
+		comparator.setTolerance(argument.substr(0, equal), std::atof(tolerances.c_str()), rel_tolerance);
+	}
+
+	const bool passed = comparator.compare(argv[1], argv[2]);
+	comparator.printReport(std::cout);
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+#include "ekf_binary_logger.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+constexpr uint32_t EkfBinaryLogger::kMagic;
+constexpr uint32_t EkfBinaryLogger::kVersion;
+
+class EkfBinaryLogger::FieldNameCollector
+{
+public:
+	FieldNameCollector(std::vector<std::string> &names, std::vector<char> &types):
+		_names(names), _types(types) {}
+
+	void field(const char *name, int index, float) { add(name, "", index, 'f'); }
+	void field(const char *name, int index, uint32_t) { add(name, "", index, 'u'); }
+	void field(const char *name, const char *suffix, int index, float) { add(name, suffix, index, 'f'); }
+
+private:
+	std::vector<std::string> &_names;
+	std::vector<char> &_types;
+
+	void add(const char *name, const char *suffix, int index, char type)
+	{
+		const std::string joined = std::string(name) + suffix;
+		_names.push_back(index < 0 ? joined : joined + "[" + std::to_string(index) + "]");
+		_types.push_back(type);
+	}
+};
+
+class EkfBinaryLogger::RecordWriter
+{
+public:
+	explicit RecordWriter(uint8_t *record): _data(record) {}
+
+	void field(const char *, int, float value) { put(value); }
+	void field(const char *, int, uint32_t value) { put(value); }
+	void field(const char *, const char *, int, float value) { put(value); }
+
+private:
+	uint8_t *_data;
+
+	template<typename T>
+	void put(T value)
+	{
+		memcpy(_data, &value, sizeof(T));
+		_data += sizeof(T);
+	}
+};
+
+EkfBinaryLogger::EkfBinaryLogger(std::shared_ptr<Ekf> ekf, uint32_t channels, size_t buffer_records):
+	_ekf{ekf},
+	_channels{channels},
+	_ring_records{std::max(buffer_records, (size_t)1)}
+{
+	updateFields();
+}
+
+EkfBinaryLogger::~EkfBinaryLogger()
+{
+	close();
+}
+
+void EkfBinaryLogger::setChannels(uint32_t channels)
+{
+	if (!_running) {
+		_channels = channels;
+		updateFields();
+	}
+}
+
+bool EkfBinaryLogger::open(const std::string &file_path)
+{
+	close();
+
+	_file.open(file_path, std::ios::binary);
+
+	if (!_file) {
+		std::cerr << "Can not open output file " << file_path << std::endl;
+		return false;
+	}
+
+	writeHeader();
+	_ring.resize(_ring_records * getRecordSize());
+	_head = 0;
+	_tail = 0;
+	_record_count = 0;
+	_running = true;
+	_writer_thread = std::thread(&EkfBinaryLogger::writerLoop, this);
+	return true;
+}
+
+void EkfBinaryLogger::close()
+{
+	if (_writer_thread.joinable()) {
+		_running = false;
+		_writer_thread.join();
+	}
+
+	if (_file.is_open()) {
+		_file.close();
+	}
+}
+
+void EkfBinaryLogger::writeState()
+{
+	if (!_running) {
+		return;
+	}
+
+	const size_t head = _head.load(std::memory_order_relaxed);
+
+	// wait for the writer thread instead of dropping records
+	while (head - _tail.load(std::memory_order_acquire) >= _ring_records) {
+		std::this_thread::yield();
+	}
+
+	uint8_t *record = &_ring[(head % _ring_records) * getRecordSize()];
+	const uint64_t time_us = _ekf->get_imu_sample_delayed().time_us;
+	memcpy(record, &time_us, sizeof(time_us));
+
+	RecordWriter writer(record + sizeof(time_us));
+	visitFields(writer);
+
+	_head.store(head + 1, std::memory_order_release);
+	_record_count++;
+}
+
+template<typename Visitor>
+void EkfBinaryLogger::visitFields(Visitor &visitor) const
+{
+	const Ekf &ekf = *_ekf;
+
+	if (_channels & STATES) {
+		const matrix::Vector<float, 24> state = _ekf->getStateAtFusionHorizonAsVector();
+
+		for (int i = 0; i < 24; i++) {
+			visitor.field("state", i, state(i));
+		}
+	}
+
+	if (_channels & VARIANCES) {
+		const matrix::Vector<float, 24> variance = _ekf->covariances_diagonal();
+
+		for (int i = 0; i < 24; i++) {
+			visitor.field("variance", i, variance(i));
+		}
+	}
+
+	// innovations and their variances are provided by getters with identical signatures, the name suffix is
+	// passed on separately so that only the field name collector joins the strings
+	auto innovations = [&](const char *suffix,
+			       void (Ekf::*gps)(float[2], float &, float[2], float &) const,
+			       void (Ekf::*ev)(float[2], float &, float[2], float &) const,
+			       void (Ekf::*baro)(float &) const,
+			       void (Ekf::*rng)(float &) const,
+			       void (Ekf::*aux_vel)(float[2]) const,
+			       void (Ekf::*flow)(float[2]) const,
+			       void (Ekf::*heading)(float &) const,
+			       void (Ekf::*mag)(float[3]) const,
+			       void (Ekf::*drag)(float[2]) const,
+			       void (Ekf::*airspeed)(float &) const,
+			       void (Ekf::*beta)(float &) const,
+			       void (Ekf::*hagl)(float &) const) {
+		float hvel[2], vvel, hpos[2], vpos, value, values[3];
+		auto field = [&](const char *sensor, int index, float v) {
+			visitor.field(sensor, suffix, index, v);
+		};
+
+		(ekf.*gps)(hvel, vvel, hpos, vpos);
+		field("gps_hvel", 0, hvel[0]);
+		field("gps_hvel", 1, hvel[1]);
+		field("gps_vvel", -1, vvel);
+		field("gps_hpos", 0, hpos[0]);
+		field("gps_hpos", 1, hpos[1]);
+		field("gps_vpos", -1, vpos);
+
+		(ekf.*ev)(hvel, vvel, hpos, vpos);
+		field("ev_hvel", 0, hvel[0]);
+		field("ev_hvel", 1, hvel[1]);
+		field("ev_vvel", -1, vvel);
+		field("ev_hpos", 0, hpos[0]);
+		field("ev_hpos", 1, hpos[1]);
+		field("ev_vpos", -1, vpos);
+
+		(ekf.*baro)(value);
+		field("baro_hgt", -1, value);
+		(ekf.*rng)(value);
+		field("rng_hgt", -1, value);
+		(ekf.*aux_vel)(values);
+		field("aux_vel", 0, values[0]);
+		field("aux_vel", 1, values[1]);
+		(ekf.*flow)(values);
+		field("flow", 0, values[0]);
+		field("flow", 1, values[1]);
+		(ekf.*heading)(value);
+		field("heading", -1, value);
+		(ekf.*mag)(values);
+		field("mag", 0, values[0]);
+		field("mag", 1, values[1]);
+		field("mag", 2, values[2]);
+		(ekf.*drag)(values);
+		field("drag", 0, values[0]);
+		field("drag", 1, values[1]);
+		(ekf.*airspeed)(value);
+		field("airspeed", -1, value);
+		(ekf.*beta)(value);
+		field("beta", -1, value);
+		(ekf.*hagl)(value);
+		field("hagl", -1, value);
+	};
+
+	if (_channels & INNOVATIONS) {
+		innovations("_innov", &Ekf::getGpsVelPosInnov, &Ekf::getEvVelPosInnov, &Ekf::getBaroHgtInnov,
+			    &Ekf::getRngHgtInnov, &Ekf::getAuxVelInnov, &Ekf::getFlowInnov, &Ekf::getHeadingInnov,
+			    &Ekf::getMagInnov, &Ekf::getDragInnov, &Ekf::getAirspeedInnov, &Ekf::getBetaInnov,
+			    &Ekf::getHaglInnov);
+	}
+
+	if (_channels & INNOVATION_VARIANCES) {
+		innovations("_innov_var", &Ekf::getGpsVelPosInnovVar, &Ekf::getEvVelPosInnovVar, &Ekf::getBaroHgtInnovVar,
+			    &Ekf::getRngHgtInnovVar, &Ekf::getAuxVelInnovVar, &Ekf::getFlowInnovVar, &Ekf::getHeadingInnovVar,
+			    &Ekf::getMagInnovVar, &Ekf::getDragInnovVar, &Ekf::getAirspeedInnovVar, &Ekf::getBetaInnovVar,
+			    &Ekf::getHaglInnovVar);
+	}
+
+	if (_channels & TEST_RATIOS) {
+		float hvel, vvel, hpos, vpos, value, values[2];
+
+		ekf.getGpsVelPosInnovRatio(hvel, vvel, hpos, vpos);
+		visitor.field("gps_hvel_test_ratio", -1, hvel);
+		visitor.field("gps_vvel_test_ratio", -1, vvel);
+		visitor.field("gps_hpos_test_ratio", -1, hpos);
+		visitor.field("gps_vpos_test_ratio", -1, vpos);
+
+		ekf.getEvVelPosInnovRatio(hvel, vvel, hpos, vpos);
+		visitor.field("ev_hvel_test_ratio", -1, hvel);
+		visitor.field("ev_vvel_test_ratio", -1, vvel);
+		visitor.field("ev_hpos_test_ratio", -1, hpos);
+		visitor.field("ev_vpos_test_ratio", -1, vpos);
+
+		ekf.getBaroHgtInnovRatio(value);
+		visitor.field("baro_hgt_test_ratio", -1, value);
+		ekf.getRngHgtInnovRatio(value);
+		visitor.field("rng_hgt_test_ratio", -1, value);
+		ekf.getAuxVelInnovRatio(value);
+		visitor.field("aux_vel_test_ratio", -1, value);
+		ekf.getFlowInnovRatio(value);
+		visitor.field("flow_test_ratio", -1, value);
+		ekf.getHeadingInnovRatio(value);
+		visitor.field("heading_test_ratio", -1, value);
+		ekf.getMagInnovRatio(value);
+		visitor.field("mag_test_ratio", -1, value);
+		ekf.getDragInnovRatio(values);
+		visitor.field("drag_test_ratio", 0, values[0]);
+		visitor.field("drag_test_ratio", 1, values[1]);
+		ekf.getAirspeedInnovRatio(value);
+		visitor.field("airspeed_test_ratio", -1, value);
+		ekf.getBetaInnovRatio(value);
+		visitor.field("beta_test_ratio", -1, value);
+		ekf.getHaglInnovRatio(value);
+		visitor.field("hagl_test_ratio", -1, value);
+	}
+
+	if (_channels & CONTROL_STATUS) {
+		uint32_t control_status;
+		_ekf->get_control_mode(&control_status);
+		visitor.field("control_status", -1, control_status);
+	}
+
+	if (_channels & FAULT_STATUS) {
+		uint16_t fault_status;
+		_ekf->get_filter_fault_status(&fault_status);
+		visitor.field("fault_status", -1, (uint32_t)fault_status);
+	}
+
+	if (_channels & OUTPUT_PREDICTOR) {
+		const Quatf quat = ekf.getQuaternion();
+		const Vector3f vel = ekf.getVelocity();
+		const Vector3f pos = ekf.getPosition();
+		const Vector3f tracking_error = ekf.getOutputTrackingError();
+
+		for (int i = 0; i < 4; i++) {
+			visitor.field("output_quat", i, quat(i));
+		}
+
+		for (int i = 0; i < 3; i++) {
+			visitor.field("output_vel", i, vel(i));
+		}
+
+		for (int i = 0; i < 3; i++) {
+			visitor.field("output_pos", i, pos(i));
+		}
+
+		for (int i = 0; i < 3; i++) {
+			visitor.field("output_tracking_error", i, tracking_error(i));
+		}
+	}
+}
+
+void EkfBinaryLogger::updateFields()
+{
+	_field_names.clear();
+	_field_types.clear();
+	FieldNameCollector collector(_field_names, _field_types);
+	visitFields(collector);
+}
+
+void EkfBinaryLogger::writeHeader()
+{
+	const uint32_t header[4] {kMagic, kVersion, _channels, (uint32_t)_field_names.size()};
+	_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+	for (size_t i = 0; i < _field_names.size(); i++) {
+		_file.put(_field_types[i]);
+		_file.write(_field_names[i].c_str(), _field_names[i].size() + 1);
+	}
+}
+
+void EkfBinaryLogger::writerLoop()
+{
+	while (_running.load()) {
+		if (drainRing() == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	// the producer has stopped, write what is left
+	drainRing();
+	_file.flush();
+}
+
+size_t EkfBinaryLogger::drainRing()
+{
+	const size_t tail = _tail.load(std::memory_order_relaxed);
+	const size_t head = _head.load(std::memory_order_acquire);
+	const size_t available = head - tail;
+
+	if (available == 0) {
+		return 0;
+	}
+
+	// write the records up to the end of the ring in one go, the rest on the next call
+	const size_t first = tail % _ring_records;
+	const size_t count = std::min(available, _ring_records - first);
+	_file.write(reinterpret_cast<const char *>(&_ring[first * getRecordSize()]), count * getRecordSize());
+
+	_tail.store(tail + count, std::memory_order_release);
+	return count;
+}
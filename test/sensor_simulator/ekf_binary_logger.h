@@ -0,0 +1,122 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Buffered binary logger for the EKF outputs.
+ * writeState() copies the selected channels into a lock-free single producer,
+ * single consumer ring, which is drained to file by a background thread, so
+ * the filter loop never waits on formatting or disk access unless the ring is full.
+ *
+ * File layout (little-endian):
+ *   char[4] "ECLL", uint32 version, uint32 channel mask, uint32 field count,
+ *   field count times {char type ('f' float, 'u' uint32), null-terminated name},
+ *   then records of {uint64 timestamp (usec), field count times 4 byte value}.
+ */
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EKF/ekf.h"
+
+class EkfBinaryLogger
+{
+public:
+	enum Channel : uint32_t {
+		STATES = (1 << 0),
+		VARIANCES = (1 << 1),
+		INNOVATIONS = (1 << 2),
+		INNOVATION_VARIANCES = (1 << 3),
+		TEST_RATIOS = (1 << 4),
+		CONTROL_STATUS = (1 << 5),
+		FAULT_STATUS = (1 << 6),
+		OUTPUT_PREDICTOR = (1 << 7),
+		ALL_CHANNELS = 0xff
+	};
+
+	static constexpr uint32_t kMagic = 0x4c4c4345; // "ECLL"
+	static constexpr uint32_t kVersion = 1;
+
+	EkfBinaryLogger(std::shared_ptr<Ekf> ekf, uint32_t channels = STATES | VARIANCES, size_t buffer_records = 4096);
+	~EkfBinaryLogger();
+
+	// the channels can only be changed while no file is open
+	void setChannels(uint32_t channels);
+	uint32_t getChannels() const { return _channels; }
+
+	// write the file header and start the writer thread
+	bool open(const std::string &file_path);
+
+	// write all buffered records and stop the writer thread
+	void close();
+
+	// log the selected channels of the current filter state
+	void writeState();
+
+	const std::vector<std::string> &getFieldNames() const { return _field_names; }
+	size_t getRecordSize() const { return sizeof(uint64_t) + _field_names.size() * sizeof(uint32_t); }
+	uint64_t getRecordCount() const { return _record_count; }
+
+private:
+	class FieldNameCollector;
+	class RecordWriter;
+
+	std::shared_ptr<Ekf> _ekf;
+	uint32_t _channels;
+
+	std::vector<std::string> _field_names;
+	std::vector<char> _field_types;
+
+	std::ofstream _file;
+	std::thread _writer_thread;
+	std::atomic<bool> _running{false};
+
+	// ring of fixed size records, _head is only written by the producer and _tail by the consumer
+	std::vector<uint8_t> _ring;
+	size_t _ring_records;
+	std::atomic<size_t> _head{0};
+	std::atomic<size_t> _tail{0};
+	uint64_t _record_count{0};
+
+	template<typename Visitor>
+	void visitFields(Visitor &visitor) const;
+
+	void updateFields();
+	void writeHeader();
+	void writerLoop();
+	size_t drainRing();
+};
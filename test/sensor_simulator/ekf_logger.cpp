@@ -35,7 +35,7 @@ void EkfLogger::writeStateToFile()
 				_file << ",variance[" << i << "]";
 			}
 		}
-		_file << std::endl;
+		_file << "\n";
 	}
 
 	if (_file)
@@ -72,6 +72,6 @@ void EkfLogger::writeState()
 				_file << "," << variance(i);
 			}
 		}
-		_file << std::endl;
+		_file << "\n";
 	}
 }
@@ -225,6 +225,40 @@ bool EkfWrapper::isIntendingTerrainFlowFusion() const
 	return terrain_status.flags.flow;
 }
 
+void EkfWrapper::enableTerrainPriorFusion()
+{
+	_ekf_params->terrain_fusion_mode |= TerrainFusionMask::TerrainFusePrior;
+}
+
+void EkfWrapper::disableTerrainPriorFusion()
+{
+	_ekf_params->terrain_fusion_mode &= ~TerrainFusionMask::TerrainFusePrior;
+}
+
+bool EkfWrapper::isIntendingTerrainPriorFusion() const
+{
+	terrain_fusion_status_u terrain_status;
+	terrain_status.value = _ekf->getTerrainEstimateSensorBitfield();
+	return terrain_status.flags.prior;
+}
+
+void EkfWrapper::enableTerrainGridFusion()
+{
+	_ekf_params->terrain_fusion_mode |= TerrainFusionMask::TerrainFuseGrid;
+}
+
+void EkfWrapper::disableTerrainGridFusion()
+{
+	_ekf_params->terrain_fusion_mode &= ~TerrainFusionMask::TerrainFuseGrid;
+}
+
+bool EkfWrapper::isIntendingTerrainGridFusion() const
+{
+	terrain_fusion_status_u terrain_status;
+	terrain_status.value = _ekf->getTerrainEstimateSensorBitfield();
+	return terrain_status.flags.grid;
+}
+
 Eulerf EkfWrapper::getEulerAngles() const
 {
 	return Eulerf(_ekf->getQuaternion());
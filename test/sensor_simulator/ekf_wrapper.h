@@ -100,6 +100,14 @@ public:
 	void disableTerrainFlowFusion();
 	bool isIntendingTerrainFlowFusion() const;
 
+	void enableTerrainPriorFusion();
+	void disableTerrainPriorFusion();
+	bool isIntendingTerrainPriorFusion() const;
+
+	void enableTerrainGridFusion();
+	void disableTerrainGridFusion();
+	bool isIntendingTerrainGridFusion() const;
+
 	Eulerf getEulerAngles() const;
 	float getYawAngle() const;
 	matrix::Vector<float, 4> getQuaternionVariance() const;
@@ -65,6 +65,7 @@ public:
 	void setPdop(float pdop);
 
 	gps_message getDefaultGpsData();
+	const gps_message &getData() const { return _gps_data; }
 
 private:
 	gps_message _gps_data{};
@@ -0,0 +1,311 @@
+#include "log_comparator.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "ekf_binary_logger.h"
+
+namespace
+{
+
+class CsvLogStream : public LogStream
+{
+public:
+	explicit CsvLogStream(std::ifstream &&file):
+		_file(std::move(file))
+	{
+		std::string header;
+		std::getline(_file, header);
+
+		// the first column is the timestamp
+		size_t start = header.find(',');
+
+		while (start != std::string::npos) {
+			const size_t end = header.find(',', start + 1);
+			std::string name = header.substr(start + 1, end == std::string::npos ? std::string::npos : end - start - 1);
+
+			if (!name.empty() && name.back() == '\r') {
+				name.pop_back();
+			}
+
+			_field_names.push_back(name);
+			start = end;
+		}
+
+		_integer_fields.resize(_field_names.size(), false);
+	}
+
+	bool readNext(uint64_t &timestamp, std::vector<double> &values) override
+	{
+		if (!std::getline(_file, _line) || _line.empty()) {
+			return false;
+		}
+
+		const char *position = _line.c_str();
+		char *end;
+		timestamp = std::strtoull(position, &end, 10);
+		values.resize(_field_names.size());
+
+		for (double &value : values) {
+			if (*end != ',') {
+				return false;
+			}
+
+			position = end + 1;
+			value = std::strtod(position, &end);
+		}
+
+		return true;
+	}
+
+private:
+	std::ifstream _file;
+	std::string _line;
+};
+
+class BinaryLogStream : public LogStream
+{
+public:
+	explicit BinaryLogStream(std::ifstream &&file):
+		_file(std::move(file))
+	{
+		uint32_t header[4] {};
+		_file.read(reinterpret_cast<char *>(header), sizeof(header));
+
+		if (header[0] != EkfBinaryLogger::kMagic || header[1] != EkfBinaryLogger::kVersion) {
+			_file.setstate(std::ios::failbit);
+			return;
+		}
+
+		for (uint32_t i = 0; i < header[3]; i++) {
+			const char type = _file.get();
+			std::string name;
+			std::getline(_file, name, '\0');
+			_field_names.push_back(name);
+			_integer_fields.push_back(type == 'u');
+		}
+
+		_record.resize(sizeof(uint64_t) + _field_names.size() * sizeof(uint32_t));
+	}
+
+	bool readNext(uint64_t &timestamp, std::vector<double> &values) override
+	{
+		if (!_file.read(reinterpret_cast<char *>(_record.data()), _record.size())) {
+			return false;
+		}
+
+		memcpy(&timestamp, _record.data(), sizeof(timestamp));
+		values.resize(_field_names.size());
+		const uint8_t *data = _record.data() + sizeof(timestamp);
+
+		for (size_t i = 0; i < values.size(); i++, data += sizeof(uint32_t)) {
+			if (_integer_fields[i]) {
+				uint32_t value;
+				memcpy(&value, data, sizeof(value));
+				values[i] = value;
+
+			} else {
+				float value;
+				memcpy(&value, data, sizeof(value));
+				values[i] = value;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	std::ifstream _file;
+	std::vector<uint8_t> _record;
+};
+
+} // namespace
+
+std::unique_ptr<LogStream> LogStream::open(const std::string &file_name)
+{
+	std::ifstream file(file_name, std::ios::binary);
+	uint32_t magic = 0;
+
+	if (!file.read(reinterpret_cast<char *>(&magic), sizeof(magic))) {
+		return nullptr;
+	}
+
+	file.seekg(0);
+
+	if (magic == EkfBinaryLogger::kMagic) {
+		return std::unique_ptr<LogStream>(new BinaryLogStream(std::move(file)));
+	}
+
+	return std::unique_ptr<LogStream>(new CsvLogStream(std::move(file)));
+}
+
+void LogComparator::setDefaultTolerance(double abs_tolerance, double rel_tolerance)
+{
+	_default_tolerance = {abs_tolerance, rel_tolerance};
+}
+
+void LogComparator::setTolerance(const std::string &field_prefix, double abs_tolerance, double rel_tolerance)
+{
+	_tolerances[field_prefix] = {abs_tolerance, rel_tolerance};
+}
+
+LogComparator::tolerance LogComparator::findTolerance(const std::string &field_name, bool integer_field) const
+{
+	// bitmasks have to match exactly unless configured otherwise
+	tolerance result = integer_field ? tolerance{0.0, 0.0} : _default_tolerance;
+	size_t longest_match = 0;
+
+	for (const auto &entry : _tolerances) {
+		const std::string &prefix = entry.first;
+
+		if (prefix.size() > longest_match && field_name.compare(0, prefix.size(), prefix) == 0) {
+			result = entry.second;
+			longest_match = prefix.size();
+		}
+	}
+
+	return result;
+}
+
+bool LogComparator::compare(const std::string &reference_file, const std::string &candidate_file)
+{
+	std::unique_ptr<LogStream> reference = LogStream::open(reference_file);
+	std::unique_ptr<LogStream> candidate = LogStream::open(candidate_file);
+
+	if (!reference || !candidate) {
+		std::cerr << "Can not open log file " << (reference ? candidate_file : reference_file) << std::endl;
+		_deviations.clear();
+		_matched_records = 0;
+		_unmatched_records = 0;
+		return false;
+	}
+
+	return compare(*reference, *candidate);
+}
+
+bool LogComparator::compare(LogStream &reference, LogStream &candidate)
+{
+	_deviations.clear();
+	_matched_records = 0;
+	_unmatched_records = 0;
+
+	// map the common fields by name
+	std::vector<size_t> reference_index;
+	std::vector<size_t> candidate_index;
+	const std::vector<std::string> &candidate_names = candidate.getFieldNames();
+
+	for (size_t i = 0; i < reference.getFieldNames().size(); i++) {
+		const std::string &name = reference.getFieldNames()[i];
+
+		for (size_t j = 0; j < candidate_names.size(); j++) {
+			if (candidate_names[j] == name) {
+				const bool integer_field = reference.getIntegerFields()[i] || candidate.getIntegerFields()[j];
+				const tolerance tol = findTolerance(name, integer_field);
+				field_deviation deviation;
+				deviation.name = name;
+				deviation.abs_tolerance = tol.abs;
+				deviation.rel_tolerance = tol.rel;
+				_deviations.push_back(deviation);
+				reference_index.push_back(i);
+				candidate_index.push_back(j);
+				break;
+			}
+		}
+	}
+
+	std::vector<double> sum_sq(_deviations.size(), 0.0);
+	std::vector<double> reference_values;
+	std::vector<double> candidate_values;
+	uint64_t reference_time;
+	uint64_t candidate_time;
+	bool reference_valid = reference.readNext(reference_time, reference_values);
+	bool candidate_valid = candidate.readNext(candidate_time, candidate_values);
+
+	// merge both logs by timestamp, records without a counterpart are counted as unmatched
+	while (reference_valid || candidate_valid) {
+		if (!candidate_valid || (reference_valid && reference_time < candidate_time)) {
+			_unmatched_records++;
+			reference_valid = reference.readNext(reference_time, reference_values);
+			continue;
+		}
+
+		if (!reference_valid || candidate_time < reference_time) {
+			_unmatched_records++;
+			candidate_valid = candidate.readNext(candidate_time, candidate_values);
+			continue;
+		}
+
+		for (size_t k = 0; k < _deviations.size(); k++) {
+			const double expected = reference_values[reference_index[k]];
+			const double actual = candidate_values[candidate_index[k]];
+			field_deviation &deviation = _deviations[k];
+			double error = std::fabs(actual - expected);
+
+			if (std::isnan(expected) && std::isnan(actual)) {
+				error = 0.0;
+
+			} else if (!std::isfinite(error)) {
+				error = INFINITY;
+			}
+
+			if (error > deviation.abs_tolerance + deviation.rel_tolerance * std::fabs(expected)) {
+				deviation.exceeded++;
+			}
+
+			if (error > deviation.max_error || deviation.samples == 0) {
+				deviation.max_error = error;
+				deviation.max_error_timestamp = reference_time;
+			}
+
+			sum_sq[k] += error * error;
+			deviation.samples++;
+		}
+
+		_matched_records++;
+		reference_valid = reference.readNext(reference_time, reference_values);
+		candidate_valid = candidate.readNext(candidate_time, candidate_values);
+	}
+
+	for (size_t k = 0; k < _deviations.size(); k++) {
+		if (_deviations[k].samples > 0) {
+			_deviations[k].rms_error = std::sqrt(sum_sq[k] / _deviations[k].samples);
+		}
+	}
+
+	return passed();
+}
+
+bool LogComparator::passed() const
+{
+	if (_matched_records == 0 || _unmatched_records > 0 || _deviations.empty()) {
+		return false;
+	}
+
+	for (const field_deviation &deviation : _deviations) {
+		if (!deviation.passed()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void LogComparator::printReport(std::ostream &out) const
+{
+	out << "matched records: " << _matched_records << ", unmatched records: " << _unmatched_records << "\n";
+	out << std::left << std::setw(28) << "field" << std::right
+	    << std::setw(14) << "max error" << std::setw(14) << "rms error"
+	    << std::setw(14) << "at (usec)" << std::setw(14) << "tolerance" << std::setw(10) << "exceeded" << "\n";
+
+	for (const field_deviation &deviation : _deviations) {
+		out << std::left << std::setw(28) << deviation.name << std::right << std::setprecision(6)
+		    << std::setw(14) << deviation.max_error << std::setw(14) << deviation.rms_error
+		    << std::setw(14) << deviation.max_error_timestamp << std::setw(14) << deviation.abs_tolerance
+		    << std::setw(10) << deviation.exceeded << (deviation.passed() ? "" : "  FAIL") << "\n";
+	}
+
+	out << (passed() ? "PASSED" : "FAILED") << std::endl;
+}
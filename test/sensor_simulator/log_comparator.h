@@ -0,0 +1,121 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Numerical comparison of two EKF logs written by EkfLogger (csv) or
+ * EkfBinaryLogger. Both logs are streamed record by record, aligned by
+ * timestamp and the fields present in both are compared against absolute
+ * and relative tolerances, reporting the max and RMS deviation per field.
+ */
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct field_deviation {
+	std::string name;
+	double abs_tolerance {0.0};
+	double rel_tolerance {0.0};
+	double max_error {0.0};			// largest absolute difference
+	double rms_error {0.0};
+	uint64_t max_error_timestamp {0};	// (usec)
+	uint64_t samples {0};
+	uint64_t exceeded {0};			// number of samples outside the tolerance
+
+	bool passed() const { return exceeded == 0; }
+};
+
+// sequential reader of the records of a log file
+class LogStream
+{
+public:
+	virtual ~LogStream() = default;
+
+	// open a csv or binary log, depending on its content
+	static std::unique_ptr<LogStream> open(const std::string &file_name);
+
+	const std::vector<std::string> &getFieldNames() const { return _field_names; }
+
+	// true for fields holding integer bitmasks
+	const std::vector<bool> &getIntegerFields() const { return _integer_fields; }
+
+	// read the next record, returns false at the end of the log
+	virtual bool readNext(uint64_t &timestamp, std::vector<double> &values) = 0;
+
+protected:
+	std::vector<std::string> _field_names;
+	std::vector<bool> _integer_fields;
+};
+
+class LogComparator
+{
+public:
+	// tolerance applied to all fields without a more specific one
+	void setDefaultTolerance(double abs_tolerance, double rel_tolerance = 0.0);
+
+	// tolerance for all fields starting with the given prefix, e.g. "state[4]" or "variance"
+	// the longest matching prefix is used
+	void setTolerance(const std::string &field_prefix, double abs_tolerance, double rel_tolerance = 0.0);
+
+	// returns true if both logs are on the same timeline and all common fields are within tolerance
+	bool compare(const std::string &reference_file, const std::string &candidate_file);
+	bool compare(LogStream &reference, LogStream &candidate);
+
+	bool passed() const;
+
+	const std::vector<field_deviation> &getDeviations() const { return _deviations; }
+	uint64_t getMatchedRecords() const { return _matched_records; }
+	uint64_t getUnmatchedRecords() const { return _unmatched_records; }
+
+	void printReport(std::ostream &out) const;
+
+private:
+	struct tolerance {
+		double abs;
+		double rel;
+	};
+
+	tolerance _default_tolerance {0.0, 0.0};
+	std::map<std::string, tolerance> _tolerances;
+
+	std::vector<field_deviation> _deviations;
+	uint64_t _matched_records {0};
+	uint64_t _unmatched_records {0};
+
+	tolerance findTolerance(const std::string &field_name, bool integer_field) const;
+};
@@ -0,0 +1,367 @@
+#include "monte_carlo.h"
+
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include "geo_lookup/geo_mag_declination.h"
+
+namespace
+{
+
+float sq(float x) { return x * x; }
+
+float normalisedErrorSquared(const Vector3f &error, const matrix::SquareMatrix<float, 3> &covariance)
+{
+	matrix::SquareMatrix<float, 3> covariance_inv;
+
+	if (!matrix::inv(covariance, covariance_inv)) {
+		return NAN;
+	}
+
+	return error.dot(covariance_inv * error);
+}
+
+} // namespace
+
+MonteCarlo::MonteCarlo(const monte_carlo_config &config):
+_config{config}
+{
+}
+
+MonteCarlo::~MonteCarlo()
+{
+}
+
+monte_carlo_scenario MonteCarlo::generateScenario(const monte_carlo_config &config, uint32_t index)
+{
+	monte_carlo_scenario scenario{};
+	scenario.seed = config.seed + index;
+
+	std::mt19937 generator(scenario.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> symmetric(-1.0f, 1.0f);
+
+	for (int i = 0; i < 3; i++) {
+		scenario.accel_bias(i) = symmetric(generator) * config.accel_bias_max;
+		scenario.gyro_bias(i) = symmetric(generator) * config.gyro_bias_max;
+	}
+
+	scenario.accel_noise = unit(generator) * config.accel_noise_max;
+	scenario.gyro_noise = unit(generator) * config.gyro_noise_max;
+	scenario.gps_pos_noise = unit(generator) * config.gps_pos_noise_max;
+	scenario.gps_vel_noise = unit(generator) * config.gps_vel_noise_max;
+	scenario.baro_noise = unit(generator) * config.baro_noise_max;
+	scenario.mag_noise = unit(generator) * config.mag_noise_max;
+
+	// the true delay is spread around the delay the estimator is configured with
+	const parameters default_params{};
+	scenario.gps_delay = fmaxf(default_params.gps_delay_ms * 1e-3f + symmetric(generator) * config.gps_delay_error_max, 0.0f);
+
+	scenario.yaw = symmetric(generator) * _m_pi;
+	const float course = symmetric(generator) * _m_pi;
+	const float speed = unit(generator) * config.speed_max;
+	scenario.velocity = Vector2f(speed * cosf(course), speed * sinf(course));
+
+	// outages and disturbances happen once the GPS checks had enough time to pass
+	if (unit(generator) < config.gps_outage_probability) {
+		scenario.gps_outage_start = config.duration * (0.3f + 0.4f * unit(generator));
+		scenario.gps_outage_duration = unit(generator) * config.gps_outage_duration_max;
+	}
+
+	if (unit(generator) < config.mag_disturbance_probability) {
+		scenario.mag_disturbance_start = config.duration * (0.2f + 0.6f * unit(generator));
+		scenario.mag_disturbance_duration = unit(generator) * config.mag_disturbance_duration_max;
+
+		for (int i = 0; i < 3; i++) {
+			scenario.mag_disturbance(i) = symmetric(generator) * config.mag_disturbance_max;
+		}
+	}
+
+	return scenario;
+}
+
+monte_carlo_result MonteCarlo::runScenario(const monte_carlo_config &config, const monte_carlo_scenario &scenario,
+		const ParameterSetter &set_parameters)
+{
+	monte_carlo_result result{};
+	result.scenario = scenario;
+
+	// use a different stream than the one the scenario was drawn from
+	std::seed_seq seed{scenario.seed, 1u};
+	std::mt19937 generator(seed);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator simulator(ekf);
+	EkfWrapper ekf_wrapper(ekf);
+
+	if (set_parameters) {
+		set_parameters(*ekf->getParamHandle());
+	}
+
+	// the vehicle is moving for the whole scenario
+	ekf->set_in_air_status(true);
+	simulator.startGps();
+	ekf_wrapper.enableGpsFusion();
+
+	// truth
+	gps_message gps_data = simulator._gps.getDefaultGpsData();
+	const double lat_origin = gps_data.lat * 1e-7;
+	const double lon_origin = gps_data.lon * 1e-7;
+	const float alt_origin = gps_data.alt * 1e-3f;
+	map_projection_reference_s truth_origin;
+	map_projection_init(&truth_origin, lat_origin, lon_origin);
+
+	const float baro_origin = 122.2f;
+	const Dcmf R_to_earth(Eulerf(0.0f, 0.0f, scenario.yaw));
+	const float declination = math::radians(get_mag_declination(float(lat_origin), float(lon_origin)));
+	const Vector3f mag_earth(0.2f * cosf(declination), 0.2f * sinf(declination), 0.4f);
+	const Vector3f mag_body = R_to_earth.transpose() * mag_earth;
+	const Vector3f vel_truth(scenario.velocity(0), scenario.velocity(1), 0.0f);
+
+	auto noise = [&](float sigma) { return normal(generator) * sigma; };
+	auto noiseVector = [&](float sigma) { return Vector3f(noise(sigma), noise(sigma), noise(sigma)); };
+	auto inWindow = [](float time, float start, float duration) { return time >= start && time < start + duration; };
+
+	const uint64_t duration_us = uint64_t(config.duration * 1e6f);
+	const uint64_t sample_interval_us = uint64_t(config.sample_interval * 1e6f);
+	uint64_t time_next_sample_us = sample_interval_us;
+
+	float pos_nees_sum = 0.0f;
+	float vel_nees_sum = 0.0f;
+	float gps_nis_sum = 0.0f;
+	float baro_nis_sum = 0.0f;
+	float pos_error_sum_sq = 0.0f;
+	float gps_hpos_innov_prev[2] {};
+	float baro_innov_prev = 0.0f;
+
+	while (simulator.getTime() < duration_us) {
+		const uint64_t time_us = simulator.getTime();
+		const float time = time_us * 1e-6f;
+
+		if (simulator._imu.should_send(time_us)) {
+			simulator._imu.setData(Vector3f(0.0f, 0.0f, -CONSTANTS_ONE_G) + scenario.accel_bias + noiseVector(scenario.accel_noise),
+					       scenario.gyro_bias + noiseVector(scenario.gyro_noise));
+		}
+
+		if (simulator._mag.should_send(time_us)) {
+			Vector3f mag = mag_body + noiseVector(scenario.mag_noise);
+
+			if (inWindow(time, scenario.mag_disturbance_start, scenario.mag_disturbance_duration)) {
+				mag += scenario.mag_disturbance;
+			}
+
+			simulator._mag.setData(mag);
+		}
+
+		if (simulator._baro.should_send(time_us)) {
+			simulator._baro.setData(baro_origin + noise(scenario.baro_noise));
+		}
+
+		const bool gps_outage = inWindow(time, scenario.gps_outage_start, scenario.gps_outage_duration);
+
+		if (gps_outage && simulator._gps.isRunning()) {
+			simulator.stopGps();
+
+		} else if (!gps_outage && !simulator._gps.isRunning()) {
+			simulator.startGps();
+		}
+
+		if (simulator._gps.should_send(time_us)) {
+			// the measurement describes the vehicle state at the time it was taken
+			const Vector2f pos_measured = scenario.velocity * (time - scenario.gps_delay)
+						      + Vector2f(noise(scenario.gps_pos_noise), noise(scenario.gps_pos_noise));
+			double lat;
+			double lon;
+			map_projection_reproject(&truth_origin, pos_measured(0), pos_measured(1), &lat, &lon);
+			gps_data.lat = static_cast<int32_t>(lat * 1e7);
+			gps_data.lon = static_cast<int32_t>(lon * 1e7);
+			gps_data.alt = static_cast<int32_t>((alt_origin + noise(scenario.gps_pos_noise)) * 1e3f);
+			gps_data.vel_ned = vel_truth + noiseVector(scenario.gps_vel_noise);
+			gps_data.vel_m_s = gps_data.vel_ned.norm();
+			gps_data.eph = fmaxf(scenario.gps_pos_noise, 0.1f);
+			gps_data.epv = fmaxf(scenario.gps_pos_noise, 0.1f);
+			gps_data.sacc = fmaxf(scenario.gps_vel_noise, 0.1f);
+			simulator._gps.setData(gps_data);
+		}
+
+		simulator.runMicroseconds(1000);
+
+		if (time_us < time_next_sample_us) {
+			continue;
+		}
+
+		time_next_sample_us += sample_interval_us;
+
+		// the errors are only meaningful once the position is referenced to the GPS origin
+		if (!ekf_wrapper.isIntendingGpsFusion()) {
+			continue;
+		}
+
+		map_projection_reference_s ekf_origin;
+		uint64_t origin_time;
+		float origin_alt;
+		ekf->get_ekf_origin(&origin_time, &ekf_origin, &origin_alt);
+
+		double lat_truth;
+		double lon_truth;
+		const Vector2f pos_truth_ne = scenario.velocity * time;
+		map_projection_reproject(&truth_origin, pos_truth_ne(0), pos_truth_ne(1), &lat_truth, &lon_truth);
+		Vector3f pos_truth;
+		map_projection_project(&ekf_origin, lat_truth, lon_truth, &pos_truth(0), &pos_truth(1));
+		pos_truth(2) = 0.0f;
+
+		const Vector3f pos_error = ekf->getPosition() - pos_truth;
+		const Vector3f vel_error = ekf->getVelocity() - vel_truth;
+		const float pos_nees = normalisedErrorSquared(pos_error, ekf->position_covariances());
+		const float vel_nees = normalisedErrorSquared(vel_error, ekf->velocity_covariances());
+
+		if (std::isfinite(pos_nees) && std::isfinite(vel_nees)) {
+			pos_nees_sum += pos_nees;
+			vel_nees_sum += vel_nees;
+			pos_error_sum_sq += pos_error.norm_squared();
+			result.nees_samples++;
+		}
+
+		// innovations are only counted when they have been updated since the last sample
+		float hvel[2], vvel, hpos[2], vpos;
+		float hvel_var[2], vvel_var, hpos_var[2], vpos_var;
+		ekf->getGpsVelPosInnov(hvel, vvel, hpos, vpos);
+		ekf->getGpsVelPosInnovVar(hvel_var, vvel_var, hpos_var, vpos_var);
+
+		if ((hpos[0] != gps_hpos_innov_prev[0] || hpos[1] != gps_hpos_innov_prev[1])
+		    && hvel_var[0] > 0.0f && hvel_var[1] > 0.0f && vvel_var > 0.0f && hpos_var[0] > 0.0f && hpos_var[1] > 0.0f) {
+			gps_nis_sum += sq(hvel[0]) / hvel_var[0] + sq(hvel[1]) / hvel_var[1] + sq(vvel) / vvel_var
+				       + sq(hpos[0]) / hpos_var[0] + sq(hpos[1]) / hpos_var[1];
+			result.gps_nis_samples++;
+		}
+
+		gps_hpos_innov_prev[0] = hpos[0];
+		gps_hpos_innov_prev[1] = hpos[1];
+
+		float baro_innov;
+		float baro_innov_var;
+		ekf->getBaroHgtInnov(baro_innov);
+		ekf->getBaroHgtInnovVar(baro_innov_var);
+
+		if (baro_innov != baro_innov_prev && baro_innov_var > 0.0f) {
+			baro_nis_sum += sq(baro_innov) / baro_innov_var;
+			result.baro_nis_samples++;
+		}
+
+		baro_innov_prev = baro_innov;
+
+		result.pos_error_final = pos_error.norm();
+		result.vel_error_final = vel_error.norm();
+		result.yaw_error_final = fabsf(wrap_pi(Eulerf(ekf->getQuaternion()).psi() - scenario.yaw));
+	}
+
+	result.gps_fusion_active = ekf_wrapper.isIntendingGpsFusion();
+
+	if (result.nees_samples > 0) {
+		result.pos_nees_mean = pos_nees_sum / result.nees_samples;
+		result.vel_nees_mean = vel_nees_sum / result.nees_samples;
+		result.pos_error_rms = sqrtf(pos_error_sum_sq / result.nees_samples);
+	}
+
+	if (result.gps_nis_samples > 0) {
+		result.gps_nis_mean = gps_nis_sum / result.gps_nis_samples;
+	}
+
+	if (result.baro_nis_samples > 0) {
+		result.baro_nis_mean = baro_nis_sum / result.baro_nis_samples;
+	}
+
+	return result;
+}
+
+void MonteCarlo::run()
+{
+	_results.clear();
+	_results.resize(_config.num_scenarios);
+
+	// every worker picks the next scenario that has not been started yet
+	std::atomic<uint32_t> next_scenario{0};
+
+	auto worker = [&]() {
+		for (uint32_t index = next_scenario++; index < _config.num_scenarios; index = next_scenario++) {
+			_results[index] = runScenario(_config, generateScenario(_config, index), _set_parameters);
+		}
+	};
+
+	const uint32_t num_threads = std::max(std::min(_config.num_threads, _config.num_scenarios), 1u);
+	std::vector<std::thread> threads;
+
+	for (uint32_t i = 1; i < num_threads; i++) {
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+}
+
+monte_carlo_summary MonteCarlo::getSummary() const
+{
+	monte_carlo_summary summary{};
+	summary.num_scenarios = _results.size();
+
+	if (_results.empty()) {
+		return summary;
+	}
+
+	float pos_error_sum_sq = 0.0f;
+	float vel_error_sum_sq = 0.0f;
+	float yaw_error_sum_sq = 0.0f;
+
+	for (const monte_carlo_result &result : _results) {
+		if (result.gps_fusion_active) {
+			summary.num_gps_fusion_active++;
+		}
+
+		summary.pos_nees_mean += result.pos_nees_mean;
+		summary.vel_nees_mean += result.vel_nees_mean;
+		summary.gps_nis_mean += result.gps_nis_mean;
+		summary.baro_nis_mean += result.baro_nis_mean;
+		pos_error_sum_sq += sq(result.pos_error_final);
+		vel_error_sum_sq += sq(result.vel_error_final);
+		yaw_error_sum_sq += sq(result.yaw_error_final);
+		summary.pos_error_final_max = std::max(summary.pos_error_final_max, result.pos_error_final);
+	}
+
+	const float num_inv = 1.0f / _results.size();
+	summary.pos_nees_mean *= num_inv;
+	summary.vel_nees_mean *= num_inv;
+	summary.gps_nis_mean *= num_inv;
+	summary.baro_nis_mean *= num_inv;
+	summary.pos_error_final_rms = sqrtf(pos_error_sum_sq * num_inv);
+	summary.vel_error_final_rms = sqrtf(vel_error_sum_sq * num_inv);
+	summary.yaw_error_final_rms = sqrtf(yaw_error_sum_sq * num_inv);
+
+	return summary;
+}
+
+void MonteCarlo::writeResultsToFile(const std::string &file_path) const
+{
+	std::ofstream file(file_path);
+
+	if (!file) {
+		std::cerr << "Can not write to output file" << std::endl;
+		std::exit(-1);
+	}
+
+	file << "seed,gps_outage_duration,mag_disturbance_duration,gps_fusion_active,nees_samples,"
+	     "pos_nees,vel_nees,gps_nis,baro_nis,pos_error_rms,pos_error_final,vel_error_final,yaw_error_final\n";
+
+	for (const monte_carlo_result &result : _results) {
+		file << result.scenario.seed << "," << result.scenario.gps_outage_duration
+		     << "," << result.scenario.mag_disturbance_duration << "," << result.gps_fusion_active
+		     << "," << result.nees_samples << "," << result.pos_nees_mean << "," << result.vel_nees_mean
+		     << "," << result.gps_nis_mean << "," << result.baro_nis_mean << "," << result.pos_error_rms
+		     << "," << result.pos_error_final << "," << result.vel_error_final << "," << result.yaw_error_final << "\n";
+	}
+}
@@ -0,0 +1,158 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Runs randomised simulation scenarios through independent Ekf instances
+ * on a pool of threads. For every scenario the consistency of the estimate
+ * (NEES, NIS) and the final errors with respect to the simulated truth are
+ * accumulated on the fly, so no per-sample data has to be written to file.
+ *
+ * The simulated vehicle flies level at a constant velocity. Each scenario
+ * draws its IMU biases, sensor noise levels, GPS delay and optional GPS
+ * outage and magnetic disturbance windows from its own seed, which makes
+ * every scenario reproducible independent of the number of threads.
+ */
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sensor_simulator.h"
+#include "ekf_wrapper.h"
+
+struct monte_carlo_config {
+	uint32_t num_scenarios {100};
+	uint32_t num_threads {4};
+	uint32_t seed {0};			// scenario i is generated from seed + i
+	float duration {60.0f};			// simulated time per scenario (sec)
+	float sample_interval {0.1f};		// interval at which the statistics are sampled (sec)
+
+	float accel_bias_max {0.2f};		// (m/sec**2)
+	float gyro_bias_max {5.0e-3f};		// (rad/sec)
+	float accel_noise_max {0.3f};		// 1-sigma (m/sec**2)
+	float gyro_noise_max {5.0e-3f};		// 1-sigma (rad/sec)
+	float gps_pos_noise_max {1.0f};		// 1-sigma (m)
+	float gps_vel_noise_max {0.3f};		// 1-sigma (m/sec)
+	float baro_noise_max {1.0f};		// 1-sigma (m)
+	float mag_noise_max {5.0e-3f};		// 1-sigma (Gauss)
+	float gps_delay_error_max {0.05f};	// deviation of the true GPS delay from the configured one (sec)
+	float speed_max {5.0f};			// horizontal ground speed (m/sec)
+
+	float gps_outage_probability {0.3f};
+	float gps_outage_duration_max {10.0f};	// (sec)
+	float mag_disturbance_probability {0.3f};
+	float mag_disturbance_max {0.1f};	// (Gauss)
+	float mag_disturbance_duration_max {5.0f};	// (sec)
+};
+
+struct monte_carlo_scenario {
+	uint32_t seed {0};
+	Vector3f accel_bias;			// (m/sec**2)
+	Vector3f gyro_bias;			// (rad/sec)
+	float accel_noise {0.0f};		// 1-sigma (m/sec**2)
+	float gyro_noise {0.0f};		// 1-sigma (rad/sec)
+	float gps_pos_noise {0.0f};		// 1-sigma (m)
+	float gps_vel_noise {0.0f};		// 1-sigma (m/sec)
+	float baro_noise {0.0f};		// 1-sigma (m)
+	float mag_noise {0.0f};			// 1-sigma (Gauss)
+	float gps_delay {0.0f};			// true GPS measurement delay (sec)
+	float yaw {0.0f};			// true heading (rad)
+	Vector2f velocity;			// true NE velocity (m/sec)
+	float gps_outage_start {0.0f};		// (sec)
+	float gps_outage_duration {0.0f};	// zero if there is no outage (sec)
+	float mag_disturbance_start {0.0f};	// (sec)
+	float mag_disturbance_duration {0.0f};	// zero if there is no disturbance (sec)
+	Vector3f mag_disturbance;		// body frame field offset (Gauss)
+};
+
+struct monte_carlo_result {
+	monte_carlo_scenario scenario;
+	bool gps_fusion_active {false};		// true if GPS was fused at the end of the scenario
+	uint32_t nees_samples {0};
+	float pos_nees_mean {0.0f};		// expected value is 3 for a consistent filter
+	float vel_nees_mean {0.0f};		// expected value is 3 for a consistent filter
+	uint32_t gps_nis_samples {0};
+	float gps_nis_mean {0.0f};		// GPS NE position and NED velocity, expected value is 5
+	uint32_t baro_nis_samples {0};
+	float baro_nis_mean {0.0f};		// expected value is 1
+	float pos_error_rms {0.0f};		// (m)
+	float pos_error_final {0.0f};		// (m)
+	float vel_error_final {0.0f};		// (m/sec)
+	float yaw_error_final {0.0f};		// (rad)
+};
+
+struct monte_carlo_summary {
+	uint32_t num_scenarios {0};
+	uint32_t num_gps_fusion_active {0};
+	float pos_nees_mean {0.0f};
+	float vel_nees_mean {0.0f};
+	float gps_nis_mean {0.0f};
+	float baro_nis_mean {0.0f};
+	float pos_error_final_rms {0.0f};	// (m)
+	float pos_error_final_max {0.0f};	// (m)
+	float vel_error_final_rms {0.0f};	// (m/sec)
+	float yaw_error_final_rms {0.0f};	// (rad)
+};
+
+class MonteCarlo
+{
+public:
+	using ParameterSetter = std::function<void(parameters &)>;
+
+	MonteCarlo(const monte_carlo_config &config);
+	~MonteCarlo();
+
+	// modify the parameters of every estimator instance before it is initialised
+	void setParameterSetter(const ParameterSetter &set_parameters) { _set_parameters = set_parameters; }
+
+	// run all scenarios, blocks until the last one has finished
+	void run();
+
+	const std::vector<monte_carlo_result> &getResults() const { return _results; }
+	monte_carlo_summary getSummary() const;
+
+	// write one line per scenario
+	void writeResultsToFile(const std::string &file_path) const;
+
+	// single scenarios can be regenerated and rerun from their index for debugging
+	static monte_carlo_scenario generateScenario(const monte_carlo_config &config, uint32_t index);
+	static monte_carlo_result runScenario(const monte_carlo_config &config, const monte_carlo_scenario &scenario,
+					      const ParameterSetter &set_parameters = nullptr);
+
+private:
+	const monte_carlo_config _config;
+	ParameterSetter _set_parameters {nullptr};
+	std::vector<monte_carlo_result> _results;
+};
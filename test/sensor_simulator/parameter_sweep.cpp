@@ -0,0 +1,138 @@
+#include "parameter_sweep.h"
+
+ParameterSweep::Run::Run(const std::string &name, std::shared_ptr<Ekf> ekf_in,
+			 std::shared_ptr<const std::vector<sensor_info>> replay_data):
+ekf{ekf_in},
+simulator(ekf_in),
+wrapper(ekf_in)
+{
+	result.name = name;
+	simulator.setReplayData(replay_data);
+}
+
+ParameterSweep::ParameterSweep(std::shared_ptr<const std::vector<sensor_info>> replay_data):
+_replay_data{replay_data}
+{
+}
+
+ParameterSweep::~ParameterSweep()
+{
+}
+
+size_t ParameterSweep::addRun(const std::string &name, const ParameterSetter &set_parameters)
+{
+	std::unique_ptr<Run> run(new Run(name, std::make_shared<Ekf>(), _replay_data));
+
+	// parameters have to be set before the first IMU sample initialises the buffers
+	if (set_parameters) {
+		set_parameters(*run->ekf->getParamHandle());
+	}
+
+	_runs.push_back(std::move(run));
+	return _runs.size() - 1;
+}
+
+void ParameterSweep::forEachRun(const RunAction &action)
+{
+	for (auto &run : _runs) {
+		action(run->simulator, run->wrapper);
+	}
+}
+
+void ParameterSweep::runReplaySeconds(float duration_seconds, float step_seconds)
+{
+	// advance all instances by one step before moving on so that the
+	// part of the log being replayed stays hot in the cache
+	const uint32_t step_us = uint32_t(step_seconds * 1e6f);
+	const uint32_t duration_us = uint32_t(duration_seconds * 1e6f);
+
+	for (uint32_t elapsed_us = 0; elapsed_us < duration_us; elapsed_us += step_us) {
+		const uint32_t run_us = std::min(step_us, duration_us - elapsed_us);
+
+		for (auto &run : _runs) {
+			run->simulator.runReplayMicroseconds(run_us);
+			updateStatistics(*run);
+		}
+	}
+}
+
+void ParameterSweep::updateStatistics(Run &run)
+{
+	uint16_t status;
+	float mag, vel, pos, hgt, tas, hagl, beta;
+	run.ekf->get_innovation_test_status(status, mag, vel, pos, hgt, tas, hagl, beta);
+
+	sweep_result &result = run.result;
+	result.samples++;
+
+	if (status != 0) {
+		result.rejections++;
+	}
+
+	run.vel_ratio_sum_sq += vel * vel;
+	run.pos_ratio_sum_sq += pos * pos;
+	run.hgt_ratio_sum_sq += hgt * hgt;
+	run.mag_ratio_sum_sq += mag * mag;
+	result.vel_ratio_max = std::max(result.vel_ratio_max, vel);
+	result.pos_ratio_max = std::max(result.pos_ratio_max, pos);
+	result.hgt_ratio_max = std::max(result.hgt_ratio_max, hgt);
+	result.mag_ratio_max = std::max(result.mag_ratio_max, mag);
+
+	run.ekf->get_ekf_lpos_accuracy(&result.eph, &result.epv);
+	result.position = run.ekf->getPosition();
+	result.velocity = run.ekf->getVelocity();
+}
+
+std::vector<sweep_result> ParameterSweep::getResults() const
+{
+	std::vector<sweep_result> results;
+	results.reserve(_runs.size());
+
+	for (const auto &run : _runs) {
+		sweep_result result = run->result;
+
+		if (result.samples > 0) {
+			const float samples_inv = 1.0f / result.samples;
+			result.vel_ratio_rms = sqrtf(run->vel_ratio_sum_sq * samples_inv);
+			result.pos_ratio_rms = sqrtf(run->pos_ratio_sum_sq * samples_inv);
+			result.hgt_ratio_rms = sqrtf(run->hgt_ratio_sum_sq * samples_inv);
+			result.mag_ratio_rms = sqrtf(run->mag_ratio_sum_sq * samples_inv);
+		}
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void ParameterSweep::writeResultsToFile(const std::string &file_path) const
+{
+	std::ofstream file(file_path);
+
+	if (!file) {
+		std::cerr << "Can not write to output file" << std::endl;
+		std::exit(-1);
+	}
+
+	file << "name,samples,rejections,vel_rms,vel_max,pos_rms,pos_max,hgt_rms,hgt_max,mag_rms,mag_max,"
+	     "eph,epv,pos_n,pos_e,pos_d,vel_n,vel_e,vel_d\n";
+
+	for (const sweep_result &result : getResults()) {
+		file << result.name << "," << result.samples << "," << result.rejections
+		     << "," << result.vel_ratio_rms << "," << result.vel_ratio_max
+		     << "," << result.pos_ratio_rms << "," << result.pos_ratio_max
+		     << "," << result.hgt_ratio_rms << "," << result.hgt_ratio_max
+		     << "," << result.mag_ratio_rms << "," << result.mag_ratio_max
+		     << "," << result.eph << "," << result.epv;
+
+		for (int i = 0; i < 3; i++) {
+			file << "," << result.position(i);
+		}
+
+		for (int i = 0; i < 3; i++) {
+			file << "," << result.velocity(i);
+		}
+
+		file << "\n";
+	}
+}
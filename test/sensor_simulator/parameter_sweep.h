@@ -0,0 +1,115 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Replays one sensor log through several Ekf instances in lockstep.
+ * Every instance is configured with its own parameter set, while the
+ * decoded sensor samples are shared between all of them. A compact
+ * summary of the innovation consistency and final accuracy is kept
+ * for every parameter set.
+ */
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sensor_simulator.h"
+#include "ekf_wrapper.h"
+
+struct sweep_result {
+	std::string name;
+	uint32_t samples {0};		// number of times the statistics have been sampled
+	uint32_t rejections {0};	// number of samples with at least one rejected innovation
+	float vel_ratio_rms {0.0f};	// velocity innovation test ratio
+	float vel_ratio_max {0.0f};
+	float pos_ratio_rms {0.0f};	// horizontal position innovation test ratio
+	float pos_ratio_max {0.0f};
+	float hgt_ratio_rms {0.0f};	// vertical position innovation test ratio
+	float hgt_ratio_max {0.0f};
+	float mag_ratio_rms {0.0f};	// magnetometer or heading innovation test ratio
+	float mag_ratio_max {0.0f};
+	float eph {0.0f};		// final 1-sigma horizontal position uncertainty (m)
+	float epv {0.0f};		// final 1-sigma vertical position uncertainty (m)
+	Vector3f position;		// final NED position (m)
+	Vector3f velocity;		// final NED velocity (m/s)
+};
+
+class ParameterSweep
+{
+public:
+	using ParameterSetter = std::function<void(parameters &)>;
+	using RunAction = std::function<void(SensorSimulator &, EkfWrapper &)>;
+
+	ParameterSweep(std::shared_ptr<const std::vector<sensor_info>> replay_data);
+	~ParameterSweep();
+
+	// add an estimator instance configured by set_parameters and return its index
+	size_t addRun(const std::string &name, const ParameterSetter &set_parameters);
+
+	// apply the same action to every instance, e.g. starting sensors or enabling fusion modes
+	void forEachRun(const RunAction &action);
+
+	// advance all instances over the same part of the log, step_seconds at a time
+	void runReplaySeconds(float duration_seconds, float step_seconds = 0.1f);
+
+	size_t getNumberOfRuns() const { return _runs.size(); }
+	std::shared_ptr<Ekf> getEkf(size_t index) const { return _runs[index]->ekf; }
+
+	std::vector<sweep_result> getResults() const;
+	void writeResultsToFile(const std::string &file_path) const;
+
+private:
+	struct Run {
+		Run(const std::string &name, std::shared_ptr<Ekf> ekf_in, std::shared_ptr<const std::vector<sensor_info>> replay_data);
+
+		std::shared_ptr<Ekf> ekf;
+		SensorSimulator simulator;
+		EkfWrapper wrapper;
+
+		sweep_result result;
+		float vel_ratio_sum_sq {0.0f};
+		float pos_ratio_sum_sq {0.0f};
+		float hgt_ratio_sum_sq {0.0f};
+		float mag_ratio_sum_sq {0.0f};
+	};
+
+	std::shared_ptr<const std::vector<sensor_info>> _replay_data;
+	std::vector<std::unique_ptr<Run>> _runs;
+
+	static void updateStatistics(Run &run);
+};
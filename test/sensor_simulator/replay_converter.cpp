@@ -0,0 +1,31 @@
+#include <iostream>
+
+#include "binary_replay.h"
+#include "ulog_reader.h"
+
+// converts a replay csv or ULog file to the binary replay format, see binary_replay.h
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		std::cerr << "usage: " << argv[0] << " <input.csv|input.ulg> <output.eclr>" << std::endl;
+		return -1;
+	}
+
+	const std::string input(argv[1]);
+	bool success = false;
+
+	if (input.size() > 4 && input.compare(input.size() - 4, 4, ".ulg") == 0) {
+		ULogReader reader;
+		success = reader.open(input) && BinaryReplayWriter::convert(reader, argv[2]);
+
+	} else {
+		success = BinaryReplayWriter::convertFromCsv(input, argv[2]);
+	}
+
+	if (!success) {
+		std::cerr << "Conversion failed" << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -1,4 +1,6 @@
 #include "sensor_simulator.h"
+#include "binary_replay.h"
+#include "ulog_reader.h"
 
 
 SensorSimulator::SensorSimulator(std::shared_ptr<Ekf> ekf):
@@ -24,24 +26,59 @@ SensorSimulator::~SensorSimulator()
 
 void SensorSimulator::loadSensorDataFromFile(std::string file_name)
 {
-	std::ifstream file(file_name);
-	std::string line;
+	setReplayData(readSensorDataFromFile(file_name));
+}
 
-	while (!file.eof()) {
-		std::string timestamp;
-		std::string sensor_type;
-		std::string sensor_data;
-		sensor_info sensor_sample;
+void SensorSimulator::setReplayData(std::shared_ptr<const std::vector<sensor_info>> replay_data)
+{
+	_replay_data = replay_data;
+	_replay_source = nullptr;
+	_current_replay_data_index = 0;
+	_has_replay_data = (_replay_data != nullptr);
+}
 
-		getline(file, timestamp, ',');
+void SensorSimulator::setReplaySource(std::shared_ptr<ReplaySource> replay_source)
+{
+	_replay_source = replay_source;
+	_replay_source_failed = false;
+	_replay_data = nullptr;
+	_current_replay_data_index = 0;
+	_has_replay_data = (_replay_source != nullptr);
+}
 
-		if (!timestamp.compare("")){ // empty line at end of file
-			break;
-		}
-		sensor_sample.timestamp = std::stoul(timestamp);
+void SensorSimulator::loadSensorDataFromBinaryFile(std::string file_name)
+{
+	auto reader = std::make_shared<BinaryReplayReader>();
+
+	if (!reader->open(file_name)) {
+		std::cerr << "Can not open binary replay file " << file_name << std::endl;
+		exit(-1);
+	}
+
+	setReplaySource(reader);
+}
+
+void SensorSimulator::loadSensorDataFromULogFile(std::string file_name)
+{
+	auto reader = std::make_shared<ULogReader>();
 
-		if(_replay_data.size() > 0) {
-			sensor_info last_sample = _replay_data.back();
+	if (!reader->open(file_name)) {
+		std::cerr << "Can not open ULog file " << file_name << std::endl;
+		exit(-1);
+	}
+
+	setReplaySource(reader);
+}
+
+std::shared_ptr<const std::vector<sensor_info>> SensorSimulator::readSensorDataFromFile(std::string file_name)
+{
+	auto replay_data = std::make_shared<std::vector<sensor_info>>();
+	std::ifstream file(file_name);
+	sensor_info sensor_sample;
+
+	while (readSensorSample(file, sensor_sample)) {
+		if(replay_data->size() > 0) {
+			sensor_info last_sample = replay_data->back();
 			if (sensor_sample.timestamp < last_sample.timestamp)
 			{
 				std::cout << "Timestamps not sorted ascendingly" << std::endl;
@@ -49,59 +86,82 @@ void SensorSimulator::loadSensorDataFromFile(std::string file_name)
 			}
 		}
 
-		getline(file, sensor_type, ',');
-		if (!sensor_type.compare("imu")) {
-			sensor_sample.sensor_type = sensor_info::IMU;
-		} else if (!sensor_type.compare("mag")) {
-			sensor_sample.sensor_type = sensor_info::MAG;
+		replay_data->emplace_back(sensor_sample);
+	}
+	file.close();
+	return replay_data;
+}
 
-		} else if (!sensor_type.compare("baro")) {
-			sensor_sample.sensor_type = sensor_info::BARO;
+bool SensorSimulator::readSensorSample(std::istream &file, sensor_info &sensor_sample)
+{
+	std::string timestamp;
+	std::string sensor_type;
+	std::string sensor_data;
+	sensor_sample = {};
 
-		} else if (!sensor_type.compare("gps")) {
-			sensor_sample.sensor_type = sensor_info::GPS;
+	if (file.eof()) {
+		return false;
+	}
 
-		} else if (!sensor_type.compare("airspeed")) {
-			sensor_sample.sensor_type = sensor_info::AIRSPEED;
+	getline(file, timestamp, ',');
 
-		} else if (!sensor_type.compare("range")) {
-			sensor_sample.sensor_type = sensor_info::RANGE;
+	if (!timestamp.compare("")){ // empty line at end of file
+		return false;
+	}
+	sensor_sample.timestamp = std::stoul(timestamp);
 
-		} else if (!sensor_type.compare("flow")) {
-			sensor_sample.sensor_type = sensor_info::FLOW;
+	getline(file, sensor_type, ',');
+	if (!sensor_type.compare("imu")) {
+		sensor_sample.sensor_type = sensor_info::IMU;
+	} else if (!sensor_type.compare("mag")) {
+		sensor_sample.sensor_type = sensor_info::MAG;
 
-		} else if (!sensor_type.compare("vio")) {
-			sensor_sample.sensor_type = sensor_info::VISION;
+	} else if (!sensor_type.compare("baro")) {
+		sensor_sample.sensor_type = sensor_info::BARO;
 
-		} else if (!sensor_type.compare("landed")) {
-			sensor_sample.sensor_type = sensor_info::LANDING_STATUS;
+	} else if (!sensor_type.compare("gps")) {
+		sensor_sample.sensor_type = sensor_info::GPS;
 
-		} else {
-			std::cout << "Sensor type in file unknown" << std::endl;
+	} else if (!sensor_type.compare("airspeed")) {
+		sensor_sample.sensor_type = sensor_info::AIRSPEED;
+
+	} else if (!sensor_type.compare("range")) {
+		sensor_sample.sensor_type = sensor_info::RANGE;
+
+	} else if (!sensor_type.compare("flow")) {
+		sensor_sample.sensor_type = sensor_info::FLOW;
+
+	} else if (!sensor_type.compare("vio")) {
+		sensor_sample.sensor_type = sensor_info::VISION;
+
+	} else if (!sensor_type.compare("landed")) {
+		sensor_sample.sensor_type = sensor_info::LANDING_STATUS;
+
+	} else {
+		std::cout << "Sensor type in file unknown" << std::endl;
+		exit(-1);
+	}
+
+	getline(file, sensor_data);
+	std::stringstream ss(sensor_data);
+	int8_t i = 0;
+	while( ss.good() )
+	{
+		if(i>=10){
+			std::cout << "sensor data bigger than expected" << std::endl;
 			exit(-1);
 		}
-
-		getline(file, sensor_data);
-		std::stringstream ss(sensor_data);
-		int8_t i = 0;
-		while( ss.good() )
-		{
-			if(i>=10){
-				std::cout << "sensor data bigger than expected" << std::endl;
-				exit(-1);
-			}
-			std::string value_string;
-			getline( ss, value_string, ',' );
-			if(!value_string.compare("")){
-				continue;
-			}
-			sensor_sample.sensor_data[i] = std::stod(value_string);
-			i++;
+		std::string value_string;
+		getline( ss, value_string, ',' );
+		if(!value_string.compare("")){
+			continue;
 		}
-		_replay_data.emplace_back(sensor_sample);
+		sensor_sample.sensor_data[i] = std::stod(value_string);
+		i++;
 	}
-	file.close();
-	_has_replay_data = true;
+	sensor_sample.num_values = i;
+
+	return true;
 }
 
 void SensorSimulator::setSensorRateToDefault()
@@ -198,18 +258,35 @@ void SensorSimulator::runReplayMicroseconds(uint32_t duration)
 
 void SensorSimulator::setSensorDataFromReplayData()
 {
-	if(_replay_data.size() > 0) {
-		sensor_info sample = _replay_data[_current_replay_data_index];
-		while(sample.timestamp < _time)
-		{
+	if (_replay_source) {
+		sensor_info sample;
+		uint64_t timestamp;
+
+		while (!_replay_source_failed && _replay_source->peekTimestamp(timestamp) && timestamp < _time) {
+			if (!_replay_source->readNext(sample)) {
+				std::cerr << "Could not read replay sample at " << timestamp << ", stopping the replay" << std::endl;
+				_replay_source_failed = true;
+				break;
+			}
+
 			setSingleReplaySample(sample);
-			if(_current_replay_data_index < _replay_data.size())
+		}
+
+		return;
+	}
+
+	const std::vector<sensor_info> &replay_data = *_replay_data;
+
+	if(replay_data.size() > 0) {
+		while(_current_replay_data_index < replay_data.size())
+		{
+			const sensor_info &sample = replay_data[_current_replay_data_index];
+			if(sample.timestamp >= _time)
 			{
-				_current_replay_data_index ++;
-			} else {
 				break;
 			}
-			sample = _replay_data[_current_replay_data_index];
+			setSingleReplaySample(sample);
+			_current_replay_data_index ++;
 		}
 	} else {
 		std::cerr << "Loaded replay data empty. Likely could not load replay data" << std::endl;
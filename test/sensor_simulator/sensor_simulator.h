@@ -65,6 +65,20 @@ struct sensor_info {
 uint64_t timestamp {};
 enum measurement_t {IMU, MAG, BARO, GPS, AIRSPEED, RANGE, FLOW, VISION, LANDING_STATUS} sensor_type = IMU;
 std::array<double, 10> sensor_data {};
+uint8_t num_values {0};
+};
+
+// streaming source of replay samples in timestamp order
+class ReplaySource
+{
+public:
+	virtual ~ReplaySource() = default;
+
+	// timestamp of the next sample without consuming it, returns false at the end of the log
+	virtual bool peekTimestamp(uint64_t &timestamp) = 0;
+
+	// read the next sample, returns false at the end of the log
+	virtual bool readNext(sensor_info &sample) = 0;
 };
 
 class SensorSimulator
@@ -118,6 +132,18 @@ public:
 
 	void loadSensorDataFromFile(std::string filename);
 
+	// parse a replay file once so that its samples can be shared by several simulators
+	static std::shared_ptr<const std::vector<sensor_info>> readSensorDataFromFile(std::string file_name);
+	void setReplayData(std::shared_ptr<const std::vector<sensor_info>> replay_data);
+
+	// read one line of a replay csv file, returns false at the end of the file
+	static bool readSensorSample(std::istream &file, sensor_info &sensor_sample);
+
+	// stream the replay samples instead of loading them up front
+	void setReplaySource(std::shared_ptr<ReplaySource> replay_source);
+	void loadSensorDataFromBinaryFile(std::string file_name);	// see binary_replay.h
+	void loadSensorDataFromULogFile(std::string file_name);		// see ulog_reader.h
+
 	Imu _imu;
 	Mag _mag;
 	Baro _baro;
@@ -128,7 +154,9 @@ public:
 	Airspeed _airspeed;
 
 	bool _has_replay_data {false};
-	std::vector<sensor_info> _replay_data;
+	std::shared_ptr<const std::vector<sensor_info>> _replay_data;
 	uint64_t _current_replay_data_index {0};
+	std::shared_ptr<ReplaySource> _replay_source;
+	bool _replay_source_failed {false};	// a sample could not be read, the rest of the log is not replayed
 
 };
@@ -0,0 +1,349 @@
+#include "ulog_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+struct topic_fields {
+	const char *topic;
+	sensor_info::measurement_t sensor_type;
+	std::vector<std::string> fields;
+};
+
+// the same topics and fields as extracted by convertULogToSensorData.py
+const topic_fields kTopics[] = {
+	{"sensor_combined", sensor_info::IMU, {"accelerometer_m_s2[0]", "accelerometer_m_s2[1]", "accelerometer_m_s2[2]", "gyro_rad[0]", "gyro_rad[1]", "gyro_rad[2]"}},
+	{"vehicle_magnetometer", sensor_info::MAG, {"magnetometer_ga[0]", "magnetometer_ga[1]", "magnetometer_ga[2]"}},
+	{"vehicle_air_data", sensor_info::BARO, {"baro_alt_meter"}},
+	{"vehicle_gps_position", sensor_info::GPS, {"alt", "lon", "lat", "vel_n_m_s", "vel_e_m_s", "vel_d_m_s"}},
+	{"airspeed", sensor_info::AIRSPEED, {"true_airspeed_m_s", "indicated_airspeed_m_s"}},
+	{"distance_sensor", sensor_info::RANGE, {"current_distance", "signal_quality"}},
+	{"optical_flow", sensor_info::FLOW, {"pixel_flow_x_integral", "pixel_flow_y_integral", "gyro_x_rate_integral", "gyro_y_rate_integral", "gyro_z_rate_integral", "quality"}},
+	{"vehicle_visual_odometry", sensor_info::VISION, {"x", "y", "z", "q[0]", "q[1]", "q[2]", "q[3]", "vx", "vy", "vz"}},
+	{"vehicle_land_detected", sensor_info::LANDING_STATUS, {"landed"}},
+};
+
+constexpr uint8_t kMagic[7] {'U', 'L', 'o', 'g', 0x01, 0x12, 0x35};
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kMessageHeaderSize = 3;
+
+// ULog is little-endian like all hosts this runs on, so values are copied as they are
+template<typename T>
+double readAs(const uint8_t *data)
+{
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return static_cast<double>(value);
+}
+
+} // namespace
+
+ULogReader::ULogReader()
+{
+}
+
+ULogReader::~ULogReader()
+{
+}
+
+bool ULogReader::open(const std::string &file_name)
+{
+	_file.open(file_name, std::ios::binary);
+	_formats.clear();
+	_subscriptions.clear();
+	_pending = decltype(_pending)();
+	_newest_timestamp = 0;
+
+	uint8_t header[kFileHeaderSize];
+
+	if (!_file || !_file.read(reinterpret_cast<char *>(header), kFileHeaderSize)
+	    || memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+		_end_of_file = true;
+		return false;
+	}
+
+	_end_of_file = false;
+	return true;
+}
+
+bool ULogReader::peekTimestamp(uint64_t &timestamp)
+{
+	// keep reading until the oldest pending sample can not be overtaken by a later message anymore
+	while (!_end_of_file && (_pending.empty() || _pending.top().timestamp + _reorder_window_us > _newest_timestamp)) {
+		if (!readMessage()) {
+			_end_of_file = true;
+		}
+	}
+
+	if (_pending.empty()) {
+		return false;
+	}
+
+	timestamp = _pending.top().timestamp;
+	return true;
+}
+
+bool ULogReader::readNext(sensor_info &sample)
+{
+	uint64_t timestamp;
+
+	if (!peekTimestamp(timestamp)) {
+		return false;
+	}
+
+	sample = _pending.top();
+	_pending.pop();
+	return true;
+}
+
+bool ULogReader::readMessage()
+{
+	uint8_t header[kMessageHeaderSize];
+
+	if (!_file.read(reinterpret_cast<char *>(header), kMessageHeaderSize)) {
+		return false;
+	}
+
+	const uint16_t message_size = header[0] | (header[1] << 8);
+	const char message_type = header[2];
+	_message.resize(message_size);
+
+	if (message_size > 0 && !_file.read(reinterpret_cast<char *>(_message.data()), message_size)) {
+		return false;
+	}
+
+	switch (message_type) {
+	case 'F':
+		parseFormat(std::string(_message.begin(), _message.end()));
+		break;
+
+	case 'A':
+		parseSubscription();
+		break;
+
+	case 'D':
+		parseData();
+		break;
+
+	default:
+		// info, parameter, logging, sync and dropout messages are not needed for replay
+		break;
+	}
+
+	return true;
+}
+
+void ULogReader::parseFormat(const std::string &format)
+{
+	// "name:type field;type[size] field;..."
+	const size_t name_end = format.find(':');
+
+	if (name_end == std::string::npos) {
+		return;
+	}
+
+	std::vector<field_definition> &fields = _formats[format.substr(0, name_end)];
+	fields.clear();
+	size_t start = name_end + 1;
+
+	while (start < format.size()) {
+		size_t end = format.find(';', start);
+
+		if (end == std::string::npos) {
+			end = format.size();
+		}
+
+		const std::string field = format.substr(start, end - start);
+		const size_t space = field.find(' ');
+		start = end + 1;
+
+		if (space == std::string::npos) {
+			continue;
+		}
+
+		field_definition definition{field.substr(0, space), field.substr(space + 1), 0};
+		const size_t bracket = definition.type.find('[');
+
+		if (bracket != std::string::npos) {
+			definition.array_size = std::stoul(definition.type.substr(bracket + 1));
+			definition.type = definition.type.substr(0, bracket);
+		}
+
+		fields.push_back(definition);
+	}
+}
+
+void ULogReader::parseSubscription()
+{
+	if (_message.size() < 3) {
+		return;
+	}
+
+	const uint16_t msg_id = _message[1] | (_message[2] << 8);
+	const std::string topic(_message.begin() + 3, _message.end());
+
+	for (const topic_fields &entry : kTopics) {
+		if (topic != entry.topic) {
+			continue;
+		}
+
+		subscription sub{};
+		sub.sensor_type = entry.sensor_type;
+		bool found = findField(topic, "timestamp", sub.timestamp);
+
+		for (const std::string &field : entry.fields) {
+			field_location location;
+			found = found && findField(topic, field, location);
+			sub.values.push_back(location);
+		}
+
+		if (found) {
+			_subscriptions[msg_id] = sub;
+
+		} else {
+			std::cout << "ULog topic " << topic << " is missing replay fields, ignoring it" << std::endl;
+		}
+
+		return;
+	}
+}
+
+void ULogReader::parseData()
+{
+	if (_message.size() < 2) {
+		return;
+	}
+
+	const uint16_t msg_id = _message[0] | (_message[1] << 8);
+	const auto it = _subscriptions.find(msg_id);
+
+	if (it == _subscriptions.end()) {
+		return;
+	}
+
+	const subscription &sub = it->second;
+	const uint8_t *data = _message.data() + 2;
+	const size_t size = _message.size() - 2;
+	bool valid = true;
+
+	sensor_info sample{};
+	sample.sensor_type = sub.sensor_type;
+	sample.timestamp = static_cast<uint64_t>(readValue(sub.timestamp, data, size, valid));
+	sample.num_values = sub.values.size();
+
+	for (size_t i = 0; i < sub.values.size(); i++) {
+		sample.sensor_data[i] = readValue(sub.values[i], data, size, valid);
+	}
+
+	if (valid) {
+		_newest_timestamp = std::max(_newest_timestamp, sample.timestamp);
+		_pending.push(sample);
+	}
+}
+
+size_t ULogReader::typeSize(const std::string &type) const
+{
+	if (type == "int8_t" || type == "uint8_t" || type == "bool" || type == "char") {
+		return 1;
+
+	} else if (type == "int16_t" || type == "uint16_t") {
+		return 2;
+
+	} else if (type == "int32_t" || type == "uint32_t" || type == "float") {
+		return 4;
+
+	} else if (type == "int64_t" || type == "uint64_t" || type == "double") {
+		return 8;
+	}
+
+	// nested message type
+	const auto it = _formats.find(type);
+
+	if (it == _formats.end()) {
+		return 0;
+	}
+
+	size_t size = 0;
+
+	for (const field_definition &field : it->second) {
+		size += typeSize(field.type) * std::max(field.array_size, 1u);
+	}
+
+	return size;
+}
+
+bool ULogReader::findField(const std::string &format, const std::string &field, field_location &location) const
+{
+	const auto it = _formats.find(format);
+
+	if (it == _formats.end()) {
+		return false;
+	}
+
+	// split "name[index].rest"
+	const size_t dot = field.find('.');
+	const std::string head = field.substr(0, dot);
+	const std::string rest = (dot == std::string::npos) ? "" : field.substr(dot + 1);
+	const size_t bracket = head.find('[');
+	const std::string name = head.substr(0, bracket);
+	const unsigned index = (bracket == std::string::npos) ? 0 : std::stoul(head.substr(bracket + 1));
+
+	size_t offset = 0;
+
+	for (const field_definition &definition : it->second) {
+		const size_t size = typeSize(definition.type);
+
+		if (definition.name == name) {
+			if (index >= std::max(definition.array_size, 1u)) {
+				return false;
+			}
+
+			offset += index * size;
+
+			if (!rest.empty()) {
+				if (!findField(definition.type, rest, location)) {
+					return false;
+				}
+
+				location.offset += offset;
+				return true;
+			}
+
+			location.offset = offset;
+			location.type = definition.type;
+			return size > 0;
+		}
+
+		offset += size * std::max(definition.array_size, 1u);
+	}
+
+	return false;
+}
+
+double ULogReader::readValue(const field_location &location, const uint8_t *data, size_t size, bool &valid) const
+{
+	// trailing padding is not logged, so the data can be shorter than the format
+	if (location.offset + typeSize(location.type) > size) {
+		valid = false;
+		return 0.0;
+	}
+
+	const uint8_t *value = data + location.offset;
+	const std::string &type = location.type;
+
+	if (type == "int8_t") { return readAs<int8_t>(value); }
+	if (type == "uint8_t" || type == "bool" || type == "char") { return readAs<uint8_t>(value); }
+	if (type == "int16_t") { return readAs<int16_t>(value); }
+	if (type == "uint16_t") { return readAs<uint16_t>(value); }
+	if (type == "int32_t") { return readAs<int32_t>(value); }
+	if (type == "uint32_t") { return readAs<uint32_t>(value); }
+	if (type == "int64_t") { return readAs<int64_t>(value); }
+	if (type == "uint64_t") { return readAs<uint64_t>(value); }
+	if (type == "float") { return readAs<float>(value); }
+	if (type == "double") { return readAs<double>(value); }
+
+	valid = false;
+	return 0.0;
+}
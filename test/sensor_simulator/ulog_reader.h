@@ -0,0 +1,108 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Streaming reader for PX4 ULog files.
+ * Extracts the topics the EKF needs and returns them as replay samples in
+ * timestamp order, using the same field selection as convertULogToSensorData.py.
+ * Only a short reordering window of samples is kept in memory.
+ */
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "sensor_simulator.h"
+
+class ULogReader : public ReplaySource
+{
+public:
+	ULogReader();
+	~ULogReader() override;
+
+	bool open(const std::string &file_name);
+
+	bool peekTimestamp(uint64_t &timestamp) override;
+	bool readNext(sensor_info &sample) override;
+
+	// samples are released once a sample this much newer has been read (usec)
+	void setReorderWindow(uint64_t window_us) { _reorder_window_us = window_us; }
+
+private:
+	struct field_definition {
+		std::string type;
+		std::string name;
+		unsigned array_size;	///< 0 if the field is not an array
+	};
+
+	struct field_location {
+		size_t offset;
+		std::string type;
+	};
+
+	// a logged topic instance the samples of which are extracted
+	struct subscription {
+		sensor_info::measurement_t sensor_type;
+		field_location timestamp;
+		std::vector<field_location> values;
+	};
+
+	struct later_sample {
+		bool operator()(const sensor_info &a, const sensor_info &b) const
+		{
+			// order samples with equal timestamps by type to make the output deterministic
+			return a.timestamp > b.timestamp || (a.timestamp == b.timestamp && a.sensor_type > b.sensor_type);
+		}
+	};
+
+	std::ifstream _file;
+	bool _end_of_file{true};
+	std::map<std::string, std::vector<field_definition>> _formats;
+	std::map<uint16_t, subscription> _subscriptions;
+	std::priority_queue<sensor_info, std::vector<sensor_info>, later_sample> _pending;
+	uint64_t _newest_timestamp{0};
+	uint64_t _reorder_window_us{1000000};
+	std::vector<uint8_t> _message;
+
+	bool readMessage();
+	void parseFormat(const std::string &format);
+	void parseSubscription();
+	void parseData();
+
+	size_t typeSize(const std::string &type) const;
+	bool findField(const std::string &format, const std::string &field, field_location &location) const;
+	double readValue(const field_location &location, const uint8_t *data, size_t size, bool &valid) const;
+};
@@ -192,4 +192,67 @@ TEST_F(EkfBasicsTest, accelBiasEstimation)
 		<< "gyro_bias = " << gyro_bias(0) << ", " << gyro_bias(1) << ", " << gyro_bias(2);
 }
 
+TEST_F(EkfBasicsTest, statusSnapshot)
+{
+	// GIVEN: a filter fusing GPS
+	_sensor_simulator.startGps();
+	_sensor_simulator.runSeconds(11);
+
+	// WHEN: requesting the status with only some of the sections
+	estimatorStatusSnapshot snapshot{};
+	snapshot.states[0] = -1.f;
+	_ekf->getStatusSnapshot(snapshot, STATUS_SECTION_INNOVATIONS | STATUS_SECTION_RESETS);
+
+	// THEN: the status matches the individual getters
+	uint32_t control_status;
+	_ekf->get_control_mode(&control_status);
+	EXPECT_EQ(snapshot.control_status, control_status);
+	EXPECT_EQ(snapshot.sections, STATUS_SECTION_INNOVATIONS | STATUS_SECTION_RESETS);
+
+	uint16_t solution_status;
+	_ekf->get_ekf_soln_status(&solution_status);
+	EXPECT_EQ(snapshot.solution_status, solution_status);
+	EXPECT_TRUE(snapshot.local_position_valid);
+
+	float eph;
+	float epv;
+	_ekf->get_ekf_lpos_accuracy(&eph, &epv);
+	EXPECT_FLOAT_EQ(snapshot.lpos_eph, eph);
+	EXPECT_FLOAT_EQ(snapshot.lpos_epv, epv);
+
+	// AND: the requested sections match the individual getters
+	float hvel[2];
+	float vvel;
+	float hpos[2];
+	float vpos;
+	_ekf->getGpsVelPosInnov(hvel, vvel, hpos, vpos);
+	EXPECT_FLOAT_EQ(snapshot.gps.innov[0], hvel[0]);
+	EXPECT_FLOAT_EQ(snapshot.gps.innov[2], vvel);
+	EXPECT_FLOAT_EQ(snapshot.gps.innov[4], hpos[1]);
+	EXPECT_FLOAT_EQ(snapshot.gps.innov[5], vpos);
+
+	float baro_hgt_innov_var;
+	_ekf->getBaroHgtInnovVar(baro_hgt_innov_var);
+	EXPECT_FLOAT_EQ(snapshot.baro_hgt.innov_var, baro_hgt_innov_var);
+
+	float delta_quat[4];
+	uint8_t quat_reset_counter;
+	_ekf->get_quat_reset(delta_quat, &quat_reset_counter);
+	EXPECT_EQ(snapshot.quat_reset_counter, quat_reset_counter);
+
+	// AND: the other sections are left untouched
+	EXPECT_FLOAT_EQ(snapshot.states[0], -1.f);
+	EXPECT_EQ(snapshot.ingest.sensor[OBS_SENSOR_GPS].received, 0u);
+
+	// WHEN: requesting all sections
+	_ekf->getStatusSnapshot(snapshot);
+
+	// THEN: the states and the ingest status are filled as well
+	const matrix::Vector<float, 24> state = _ekf->getStateAtFusionHorizonAsVector();
+	EXPECT_FLOAT_EQ(snapshot.states[0], state(0));
+	EXPECT_FLOAT_EQ(snapshot.variances[7], _ekf->covariances_diagonal()(7));
+	EXPECT_FLOAT_EQ(snapshot.output_pos[2], _ekf->getPosition()(2));
+	EXPECT_GT(snapshot.ingest.sensor[OBS_SENSOR_GPS].received, 0u);
+}
+
 // TODO: Add sampling tests
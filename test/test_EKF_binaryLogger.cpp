@@ -0,0 +1,157 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test the buffered binary logger
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "EKF/ekf.h"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ekf_wrapper.h"
+#include "sensor_simulator/ekf_binary_logger.h"
+
+class EkfBinaryLoggerTest : public ::testing::Test {
+ public:
+
+	EkfBinaryLoggerTest(): ::testing::Test(),
+	_ekf{std::make_shared<Ekf>()},
+	_sensor_simulator(_ekf),
+	_ekf_wrapper(_ekf) {};
+
+	std::shared_ptr<Ekf> _ekf;
+	SensorSimulator _sensor_simulator;
+	EkfWrapper _ekf_wrapper;
+
+	// read the header of a log file, returns the field names
+	static std::vector<std::string> readHeader(std::ifstream &file, uint32_t &channels)
+	{
+		uint32_t header[4] {};
+		file.read(reinterpret_cast<char *>(header), sizeof(header));
+		EXPECT_EQ(header[0], EkfBinaryLogger::kMagic);
+		EXPECT_EQ(header[1], EkfBinaryLogger::kVersion);
+		channels = header[2];
+
+		std::vector<std::string> names;
+
+		for (uint32_t i = 0; i < header[3]; i++) {
+			file.get();
+			std::string name;
+			std::getline(file, name, '\0');
+			names.push_back(name);
+		}
+
+		return names;
+	}
+};
+
+TEST_F(EkfBinaryLoggerTest, logsSelectedChannels)
+{
+	// GIVEN: a logger with a ring too small to hold all records
+	const std::string file_name = "binary_logger_test.ecll";
+	EkfBinaryLogger logger(_ekf, EkfBinaryLogger::STATES | EkfBinaryLogger::CONTROL_STATUS, 8);
+	ASSERT_TRUE(logger.open(file_name));
+
+	_sensor_simulator.runSeconds(1);
+	_sensor_simulator.startGps();
+	_ekf_wrapper.enableGpsFusion();
+
+	// WHEN: logging while the filter runs
+	std::vector<uint64_t> timestamps;
+	std::vector<matrix::Vector<float, 24>> states;
+	std::vector<uint32_t> control_status;
+
+	for (int i = 0; i < 200; i++) {
+		_sensor_simulator.runSeconds(0.05f);
+		logger.writeState();
+		timestamps.push_back(_ekf->get_imu_sample_delayed().time_us);
+		states.push_back(_ekf->getStateAtFusionHorizonAsVector());
+		uint32_t status;
+		_ekf->get_control_mode(&status);
+		control_status.push_back(status);
+	}
+
+	logger.close();
+	EXPECT_EQ(logger.getRecordCount(), 200u);
+
+	// THEN: the file holds every record in order
+	std::ifstream file(file_name, std::ios::binary);
+	uint32_t channels;
+	const std::vector<std::string> names = readHeader(file, channels);
+	EXPECT_EQ(channels, (uint32_t)(EkfBinaryLogger::STATES | EkfBinaryLogger::CONTROL_STATUS));
+	ASSERT_EQ(names.size(), 25u);
+	EXPECT_EQ(names.front(), "state[0]");
+	EXPECT_EQ(names.back(), "control_status");
+
+	std::vector<uint8_t> record(logger.getRecordSize());
+
+	for (size_t i = 0; i < timestamps.size(); i++) {
+		ASSERT_TRUE(file.read(reinterpret_cast<char *>(record.data()), record.size()));
+		uint64_t timestamp;
+		float state[24];
+		uint32_t status;
+		memcpy(&timestamp, record.data(), sizeof(timestamp));
+		memcpy(state, record.data() + sizeof(timestamp), sizeof(state));
+		memcpy(&status, record.data() + sizeof(timestamp) + sizeof(state), sizeof(status));
+
+		EXPECT_EQ(timestamp, timestamps[i]);
+		EXPECT_EQ(status, control_status[i]);
+
+		for (int j = 0; j < 24; j++) {
+			EXPECT_EQ(state[j], states[i](j));
+		}
+	}
+
+	EXPECT_FALSE(file.read(reinterpret_cast<char *>(record.data()), 1));
+}
+
+TEST_F(EkfBinaryLoggerTest, allChannelsHaveUniqueNames)
+{
+	EkfBinaryLogger logger(_ekf, EkfBinaryLogger::ALL_CHANNELS);
+	const std::vector<std::string> &names = logger.getFieldNames();
+
+	// 24 states, 24 variances, 28 innovations, 28 innovation variances,
+	// 17 test ratios, control and fault status and 13 output predictor values
+	EXPECT_EQ(names.size(), 24u + 24u + 28u + 28u + 17u + 2u + 13u);
+
+	std::vector<std::string> sorted = names;
+	std::sort(sorted.begin(), sorted.end());
+	EXPECT_TRUE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+	// changing the channels changes the record layout
+	logger.setChannels(EkfBinaryLogger::STATES);
+	EXPECT_EQ(names.size(), 24u);
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test forking a running filter by copying it
+ */
+
+#include <gtest/gtest.h>
+#include "EKF/ekf.h"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ekf_wrapper.h"
+
+class EkfForkTest : public ::testing::Test {
+ public:
+
+	EkfForkTest(): ::testing::Test(),
+	_ekf{std::make_shared<Ekf>()},
+	_sensor_simulator(_ekf),
+	_ekf_wrapper(_ekf),
+	_ekf_fork{std::make_shared<Ekf>()},
+	_sensor_simulator_fork(_ekf_fork),
+	_ekf_wrapper_fork(_ekf_fork) {};
+
+	std::shared_ptr<Ekf> _ekf;
+	SensorSimulator _sensor_simulator;
+	EkfWrapper _ekf_wrapper;
+
+	// the fork is fed by its own simulator running on the same time line
+	std::shared_ptr<Ekf> _ekf_fork;
+	SensorSimulator _sensor_simulator_fork;
+	EkfWrapper _ekf_wrapper_fork;
+
+	void SetUp() override
+	{
+		_ekf->init(0);
+		_ekf_wrapper.enableGpsFusion();
+		_sensor_simulator.startGps();
+		_sensor_simulator.runSeconds(15);
+
+		_sensor_simulator_fork.startGps();
+		_sensor_simulator_fork.runSeconds(15);
+	}
+};
+
+TEST_F(EkfForkTest, forkContinuesIdentically)
+{
+	// WHEN: forking a filter that fuses GPS
+	Ekf fork(*_ekf);
+	*_ekf_fork = fork;
+	EXPECT_TRUE(_ekf_wrapper_fork.isIntendingGpsFusion());
+
+	// THEN: the fork produces the same results when receiving the same data
+	_sensor_simulator.runSeconds(5);
+	_sensor_simulator_fork.runSeconds(5);
+
+	EXPECT_EQ(_ekf->getPosition(), _ekf_fork->getPosition());
+	EXPECT_EQ(_ekf->getVelocity(), _ekf_fork->getVelocity());
+	EXPECT_EQ(_ekf->getQuaternion(), _ekf_fork->getQuaternion());
+	EXPECT_EQ(_ekf->covariances_diagonal(), _ekf_fork->covariances_diagonal());
+}
+
+TEST_F(EkfForkTest, forkIsIndependent)
+{
+	// GIVEN: a fork of a filter that fuses GPS
+	*_ekf_fork = *_ekf;
+
+	// WHEN: the GPS position jumps and the fork does not receive GPS data anymore
+	_sensor_simulator_fork.stopGps();
+	_sensor_simulator._gps.stepHorizontalPositionByMeters(Vector2f(2.0f, 0.0f));
+	_sensor_simulator.runSeconds(1);
+	_sensor_simulator_fork.runSeconds(1);
+
+	// THEN: only the original follows the GPS
+	EXPECT_GT(_ekf->getPosition()(0) - _ekf_fork->getPosition()(0), 1.0f);
+}
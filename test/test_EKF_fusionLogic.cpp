@@ -122,6 +122,87 @@ TEST_F(EkfFusionLogicTest, doGpsFusion)
 	// THIS is not happening at the moment
 }
 
+TEST_F(EkfFusionLogicTest, deferFusionOverBudget)
+{
+	// GIVEN: GPS and magnetometer fusion without a fusion budget
+	_ekf_wrapper.enableGpsFusion();
+	_sensor_simulator.startGps();
+	_sensor_simulator.runSeconds(11);
+
+	// THEN: no fusion is deferred
+	EXPECT_EQ(_ekf->getDeferredFusionCount(), 0u);
+
+	// WHEN: the budget only allows the GPS and height fusions in the same update
+	_ekf->getParamHandle()->fusion_budget = 6;
+	_sensor_simulator.runSeconds(5);
+
+	// THEN: the magnetometer fusion is deferred when GPS is fused but still used
+	const uint32_t deferred_count = _ekf->getDeferredFusionCount();
+	EXPECT_GT(deferred_count, 0u);
+	EXPECT_TRUE(_ekf_wrapper.isIntendingGpsFusion());
+	EXPECT_TRUE(_ekf_wrapper.isIntendingMagHeadingFusion() || _ekf_wrapper.isIntendingMag3DFusion());
+	EXPECT_TRUE(_ekf->local_position_is_valid());
+	EXPECT_NEAR(_ekf_wrapper.getYawAngle(), 0.f, 0.05f);
+
+	// WHEN: the budget is disabled again
+	_ekf->getParamHandle()->fusion_budget = 0;
+	_sensor_simulator.runSeconds(1);
+
+	// THEN: nothing is deferred anymore
+	EXPECT_EQ(_ekf->getDeferredFusionCount(), deferred_count);
+}
+
+TEST_F(EkfFusionLogicTest, shedProcessingOnOverload)
+{
+	// GIVEN: GPS fusion and an update time budget
+	_ekf_wrapper.enableGpsFusion();
+	_sensor_simulator.startGps();
+	_sensor_simulator.runSeconds(11);
+	_ekf->getParamHandle()->update_budget_us = 1000;
+
+	const auto runWithUpdateTime = [&](float duration_s, uint32_t update_time_us) {
+		for (uint32_t t = 0; t < (uint32_t)(duration_s * 1e6f); t += 1000) {
+			_ekf->setUpdateTime(update_time_us);
+			_sensor_simulator.runMicroseconds(1000);
+		}
+	};
+
+	// WHEN: the updates stay within the budget
+	runWithUpdateTime(1.f, 900);
+
+	// THEN: nothing is shed
+	EXPECT_EQ(_ekf->getOverloadStatus(), 0);
+
+	// WHEN: the updates take longer than the budget
+	runWithUpdateTime(1.f, 2000);
+
+	// THEN: all optional processing is shed but the filter keeps fusing GPS
+	overload_status_u status{};
+	status.value = _ekf->getOverloadStatus();
+	EXPECT_TRUE(status.flags.ekfgsf);
+	EXPECT_TRUE(status.flags.terrain);
+	EXPECT_TRUE(status.flags.drag_beta);
+	EXPECT_TRUE(status.flags.cov_decimated);
+	EXPECT_TRUE(_ekf_wrapper.isIntendingGpsFusion());
+	EXPECT_TRUE(_ekf->local_position_is_valid());
+	EXPECT_NEAR(_ekf_wrapper.getYawAngle(), 0.f, 0.05f);
+
+	// WHEN: the updates are fast again for a short time
+	runWithUpdateTime(0.6f, 500);
+
+	// THEN: the last shed step is restored first
+	status.value = _ekf->getOverloadStatus();
+	EXPECT_TRUE(status.flags.drag_beta);
+	EXPECT_FALSE(status.flags.cov_decimated);
+
+	// WHEN: the updates stay fast
+	runWithUpdateTime(3.f, 500);
+
+	// THEN: everything is restored
+	EXPECT_EQ(_ekf->getOverloadStatus(), 0);
+	EXPECT_TRUE(_ekf_wrapper.isIntendingGpsFusion());
+}
+
 TEST_F(EkfFusionLogicTest, rejectGpsSignalJump)
 {
 	// GIVEN: a tilt and heading aligned filter
@@ -364,3 +445,45 @@ TEST_F(EkfFusionLogicTest, doVisionHeightFusion)
 	// TODO: This is not happening
 	EXPECT_TRUE(_ekf_wrapper.isIntendingVisionHeightFusion()); // TODO: Needs to change
 }
+
+TEST_F(EkfFusionLogicTest, reportIngestStatus)
+{
+	// WHEN: fusing GPS
+	_ekf_wrapper.enableGpsFusion();
+	_sensor_simulator.startGps();
+	_sensor_simulator.runSeconds(12);
+
+	ingestStatus status;
+	_ekf->getIngestStatus(status);
+
+	// THEN: every GPS sample is buffered and fused
+	const obsIngestStatus &gps = status.sensor[OBS_SENSOR_GPS];
+	EXPECT_NEAR(gps.received, 60u, 2u);
+	EXPECT_EQ(gps.averaged, 0u);
+	EXPECT_EQ(gps.dropped, 0u);
+	EXPECT_EQ(gps.overwritten, 0u);
+	EXPECT_EQ(gps.resize_dropped, 0u);
+	EXPECT_GT(gps.fused, 0u);
+	EXPECT_EQ(gps.gate_rejected, 0u);
+	EXPECT_GE(gps.peak_occupancy, 1u);
+	EXPECT_LE(gps.peak_occupancy, gps.buffer_length);
+
+	// AND: every buffered sample is counted once in the age histogram
+	uint32_t age_count = 0;
+
+	for (uint8_t bin = 0; bin < OBS_INGEST_HIST_BINS; bin++) {
+		age_count += gps.age_histogram[bin];
+	}
+
+	EXPECT_EQ(age_count, gps.received - gps.dropped);
+
+	// AND: the magnetometer data arriving faster than the buffers can hold is averaged, not dropped
+	const obsIngestStatus &mag = status.sensor[OBS_SENSOR_MAG];
+	EXPECT_GT(mag.received, 0u);
+	EXPECT_GT(mag.averaged, 0u);
+	EXPECT_EQ(mag.dropped, 0u);
+	EXPECT_GT(mag.fused, 0u);
+
+	// AND: sensors that are not used report nothing
+	EXPECT_EQ(status.sensor[OBS_SENSOR_FLOW].received, 0u);
+}
@@ -140,3 +140,206 @@ TEST_F(EkfGpsTest, resetToGpsPosition)
 	EXPECT_TRUE(isEqual(estimated_position,
 		previous_position + simulated_position_change, 1e-2f));
 }
+
+TEST(EkfGpsRetrodictionTest, fuseAtShorterHorizon)
+{
+	// GIVEN: a filter where GPS has the longest delay and may be fused after the time it was measured at
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator sensor_simulator(ekf);
+	EkfWrapper ekf_wrapper(ekf);
+	ekf->getParamHandle()->ev_delay_ms = 0.f;
+	ekf->getParamHandle()->airspeed_delay_ms = 0.f;
+	ekf->getParamHandle()->retrodiction_max_ms = 80.f;
+	ekf->init(0);
+
+	// THEN: the fusion time horizon is not set by the GPS delay anymore
+	EXPECT_EQ(ekf->getFusionHorizonDelayMs(), 30u);
+
+	// WHEN: fusing GPS
+	sensor_simulator.runSeconds(2);
+	ekf_wrapper.enableGpsFusion();
+	sensor_simulator.startGps();
+	sensor_simulator.runSeconds(11);
+	const Vector3f previous_position = ekf->getPosition();
+
+	// AND: the GPS position changes
+	const Vector3f simulated_position_change(2.0f, -1.0f, 0.f);
+	sensor_simulator._gps.stepHorizontalPositionByMeters(Vector2f(simulated_position_change));
+	sensor_simulator.runSeconds(5);
+
+	// THEN: the GPS data is used at the shorter horizon
+	EXPECT_TRUE(ekf_wrapper.isIntendingGpsFusion());
+	EXPECT_TRUE(isEqual(ekf->getPosition(), previous_position + simulated_position_change, 0.1f));
+	EXPECT_LT(ekf->getVelocity().norm(), 0.3f);
+}
+
+// start fusing GPS data of a vehicle moving at constant velocity, the GPS position can only move once
+// the filter has set its origin
+static void startMovingGps(std::shared_ptr<Ekf> ekf, SensorSimulator &sensor_simulator, EkfWrapper &ekf_wrapper,
+			   const Vector3f &vel)
+{
+	sensor_simulator.runSeconds(2);
+	ekf_wrapper.enableGpsFusion();
+	sensor_simulator._gps.setVelocity(vel);
+	sensor_simulator.startGps();
+
+	for (int i = 0; (i < 2000) && !ekf->global_position_is_valid(); i++) {
+		sensor_simulator.runMicroseconds(10000);
+	}
+
+	sensor_simulator._gps.setPositionRateNED(vel);
+}
+
+// run a filter with the vehicle moving at constant velocity and return the estimation errors at the end
+static void runConstantVelocity(float retrodiction_max_ms, float &pos_error, float &vel_error)
+{
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator sensor_simulator(ekf);
+	EkfWrapper ekf_wrapper(ekf);
+	ekf->getParamHandle()->ev_delay_ms = 0.f;
+	ekf->getParamHandle()->airspeed_delay_ms = 0.f;
+	ekf->getParamHandle()->retrodiction_max_ms = retrodiction_max_ms;
+	ekf->init(0);
+
+	const Vector3f vel{4.f, -3.f, 0.f};
+	startMovingGps(ekf, sensor_simulator, ekf_wrapper, vel);
+	sensor_simulator.runSeconds(20);
+
+	// the GPS data is taken at its send time and the filter treats it as measured gps_delay_ms earlier,
+	// so the vehicle has moved on by the delay and the time since it was sent
+	const gps_message &gps = sensor_simulator._gps.getData();
+	map_projection_reference_s origin;
+	uint64_t origin_time;
+	float origin_alt;
+	ekf->get_ekf_origin(&origin_time, &origin, &origin_alt);
+	float gps_north;
+	float gps_east;
+	map_projection_project(&origin, gps.lat * 1e-7, gps.lon * 1e-7, &gps_north, &gps_east);
+	const float lag = ekf->getParamHandle()->gps_delay_ms * 1e-3f + (sensor_simulator.getTime() - gps.time_usec) * 1e-6f;
+	const Vector2f true_pos = Vector2f{gps_north, gps_east} + Vector2f(vel.xy()) * lag;
+
+	EXPECT_TRUE(ekf_wrapper.isIntendingGpsFusion());
+	pos_error = (Vector2f(ekf->getPosition().xy()) - true_pos).norm();
+	vel_error = (ekf->getVelocity() - vel).norm();
+}
+
+TEST(EkfGpsRetrodictionTest, constantVelocity)
+{
+	// GIVEN: a vehicle moving at 5 m/s, which covers 0.4 m in the 80 ms the GPS data is retrodicted over
+	float pos_error;
+	float vel_error;
+	float pos_error_retrodiction;
+	float vel_error_retrodiction;
+
+	// WHEN: the GPS data is fused at its own delay or at the shorter horizon after correcting it
+	runConstantVelocity(0.f, pos_error, vel_error);
+	runConstantVelocity(80.f, pos_error_retrodiction, vel_error_retrodiction);
+
+	// THEN: the correction keeps the estimate as accurate as fusing the data at its own delay
+	EXPECT_LT(pos_error, 0.1f);
+	EXPECT_LT(vel_error, 0.1f);
+	EXPECT_LT(pos_error_retrodiction, 0.1f);
+	EXPECT_LT(vel_error_retrodiction, 0.1f);
+	EXPECT_NEAR(pos_error_retrodiction, pos_error, 0.05f);
+}
+
+TEST(EkfGpsRetrodictionTest, stateDeltaOverPartialSteps)
+{
+	// GIVEN: a filter keeping the state changes of a vehicle moving at constant velocity
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator sensor_simulator(ekf);
+	EkfWrapper ekf_wrapper(ekf);
+	ekf->getParamHandle()->retrodiction_max_ms = 80.f;
+	ekf->init(0);
+	startMovingGps(ekf, sensor_simulator, ekf_wrapper, Vector3f{4.f, -3.f, 0.f});
+	sensor_simulator.runSeconds(10);
+
+	const uint64_t horizon_us = ekf->get_imu_sample_delayed().time_us;
+	Vector3f delta_vel;
+	Vector3f delta_pos;
+	float delta_yaw;
+
+	// WHEN: asking for the change since times that start part way into a prediction step
+	for (uint64_t lag_us = 500; lag_us < 80000; lag_us += 1500) {
+		ASSERT_TRUE(ekf->getStateDeltaSince(horizon_us - lag_us, delta_vel, delta_pos, delta_yaw)) << lag_us;
+
+		// THEN: only the part of the first step after that time is used
+		EXPECT_TRUE(isEqual(delta_pos, ekf->getVelocity() * (lag_us * 1e-6f), 5e-3f)) << lag_us;
+		EXPECT_LT(delta_vel.norm(), 0.01f);
+		EXPECT_LT(fabsf(delta_yaw), 1e-3f);
+	}
+
+	// WHEN: the time is at the horizon or older than the kept changes
+	// THEN: there is no change or it is not known
+	EXPECT_TRUE(ekf->getStateDeltaSince(horizon_us, delta_vel, delta_pos, delta_yaw));
+	EXPECT_EQ(delta_pos.norm(), 0.f);
+	EXPECT_FALSE(ekf->getStateDeltaSince(horizon_us - 200000, delta_vel, delta_pos, delta_yaw));
+}
+
+TEST(EkfObsBufferSizingTest, gpsBufferFollowsMeasuredTiming)
+{
+	// GIVEN: a filter sizing the observation buffers from the measured sensor timing
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator sensor_simulator(ekf);
+	EkfWrapper ekf_wrapper(ekf);
+	ekf->getParamHandle()->obs_buffer_sizing = 1;
+	ekf->init(0);
+
+	// WHEN: fusing GPS on ground
+	sensor_simulator.runSeconds(2);
+	ekf_wrapper.enableGpsFusion();
+	sensor_simulator.startGps();
+	sensor_simulator.runSeconds(11);
+
+	// THEN: the slow GPS data uses a shorter buffer than the default length without losing samples
+	const ObsIngestMonitor &gps_ingest = ekf->getObsIngest(OBS_SENSOR_GPS);
+	EXPECT_TRUE(gps_ingest.isValid());
+	EXPECT_NEAR(gps_ingest.getInterval(), 200e3f, 1e3f);
+	EXPECT_LT(gps_ingest.getBufferLength(), 9);
+	EXPECT_GE(gps_ingest.getBufferLength(), 2);
+	EXPECT_EQ(gps_ingest.getOverrunCount(), 0u);
+	EXPECT_EQ(gps_ingest.getResizeDroppedCount(), 0u);
+	EXPECT_TRUE(ekf_wrapper.isIntendingGpsFusion());
+
+	// AND: the faster baro data keeps enough entries for the time it waits
+	const ObsIngestMonitor &baro_ingest = ekf->getObsIngest(OBS_SENSOR_BARO);
+	EXPECT_TRUE(baro_ingest.isValid());
+	EXPECT_EQ(baro_ingest.getOverrunCount(), 0u);
+}
+
+TEST(EkfObsBufferSizingTest, bufferLengthIsEvaluatedAtMostOncePerSecond)
+{
+	// GIVEN: a filter sizing the observation buffers from the measured sensor timing
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator sensor_simulator(ekf);
+	EkfWrapper ekf_wrapper(ekf);
+	ekf->getParamHandle()->obs_buffer_sizing = 1;
+	ekf->init(0);
+	ekf_wrapper.enableGpsFusion();
+	sensor_simulator.startGps();
+
+	// WHEN: the sensor timing is measured on ground
+	uint8_t length_last[OBS_SENSOR_COUNT] {};
+	float time_last_change[OBS_SENSOR_COUNT] {};
+	int change_count = 0;
+
+	for (int step = 1; step <= 130; step++) {
+		sensor_simulator.runSeconds(0.1f);
+		const float time = step * 0.1f;
+
+		for (int sensor = 0; sensor < OBS_SENSOR_COUNT; sensor++) {
+			const uint8_t length = ekf->getObsIngest((ObsSensorType)sensor).getBufferLength();
+
+			// THEN: the buffer lengths do not change more often than once per second
+			if ((length_last[sensor] != 0) && (length != length_last[sensor])) {
+				EXPECT_GT(time - time_last_change[sensor], 0.8f) << sensor;
+				time_last_change[sensor] = time;
+				change_count++;
+			}
+
+			length_last[sensor] = length;
+		}
+	}
+
+	EXPECT_GT(change_count, 0);
+}
@@ -0,0 +1,135 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test the tolerance based comparison of EKF logs
+ */
+
+#include <gtest/gtest.h>
+#include "EKF/ekf.h"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ekf_wrapper.h"
+#include "sensor_simulator/ekf_logger.h"
+#include "sensor_simulator/ekf_binary_logger.h"
+#include "sensor_simulator/log_comparator.h"
+
+class EkfLogComparatorTest : public ::testing::Test {
+ public:
+
+	// run a simulation and log it in csv and binary format
+	static void writeLogs(const std::string &name, float gyro_noise, int records)
+	{
+		std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+		ekf->getParamHandle()->gyro_noise = gyro_noise;
+		SensorSimulator sensor_simulator(ekf);
+		EkfWrapper ekf_wrapper(ekf);
+		EkfLogger csv_logger(ekf);
+		EkfBinaryLogger binary_logger(ekf);
+		csv_logger.setFilePath(name + ".csv");
+		ASSERT_TRUE(binary_logger.open(name + ".ecll"));
+
+		sensor_simulator.runSeconds(1);
+		sensor_simulator.startGps();
+		ekf_wrapper.enableGpsFusion();
+
+		for (int i = 0; i < records; i++) {
+			sensor_simulator.runSeconds(0.1f);
+			csv_logger.writeStateToFile();
+			binary_logger.writeState();
+		}
+	}
+};
+
+TEST_F(EkfLogComparatorTest, csvAndBinaryLogsOfTheSameRunMatch)
+{
+	// GIVEN: the same run logged as csv with 6 significant digits and as binary
+	writeLogs("comparator_reference", 1.5e-2f, 100);
+
+	// WHEN: comparing them with a tolerance covering the csv rounding
+	LogComparator comparator;
+	comparator.setDefaultTolerance(1e-9, 1e-5);
+
+	// THEN: all states and variances should be found equivalent
+	EXPECT_TRUE(comparator.compare("comparator_reference.csv", "comparator_reference.ecll"));
+	EXPECT_EQ(comparator.getMatchedRecords(), 100u);
+	EXPECT_EQ(comparator.getUnmatchedRecords(), 0u);
+	EXPECT_EQ(comparator.getDeviations().size(), 48u);
+}
+
+TEST_F(EkfLogComparatorTest, reportsDeviationsOutsideTolerance)
+{
+	// GIVEN: two runs with different gyro noise
+	writeLogs("comparator_reference", 1.5e-2f, 100);
+	writeLogs("comparator_candidate", 1.5e-1f, 100);
+
+	// WHEN: comparing them with tight tolerances
+	LogComparator comparator;
+	comparator.setDefaultTolerance(1e-6);
+	EXPECT_FALSE(comparator.compare("comparator_reference.ecll", "comparator_candidate.ecll"));
+
+	// THEN: the deviation of the attitude variance should be quantified
+	const std::vector<field_deviation> &deviations = comparator.getDeviations();
+	ASSERT_EQ(deviations.size(), 48u);
+	const field_deviation &attitude_variance = deviations[24 + 1];
+	EXPECT_EQ(attitude_variance.name, "variance[1]");
+	EXPECT_FALSE(attitude_variance.passed());
+	EXPECT_GT(attitude_variance.max_error, 0.0);
+	EXPECT_GE(attitude_variance.max_error, attitude_variance.rms_error);
+
+	// WHEN: relaxing the tolerance of the fields that differ
+	for (const field_deviation &deviation : deviations) {
+		comparator.setTolerance(deviation.name, deviation.max_error);
+	}
+
+	// THEN: the comparison should pass
+	EXPECT_TRUE(comparator.compare("comparator_reference.ecll", "comparator_candidate.ecll"));
+}
+
+TEST_F(EkfLogComparatorTest, failsOnDifferentTimeline)
+{
+	// GIVEN: a log which ends early
+	writeLogs("comparator_reference", 1.5e-2f, 100);
+	writeLogs("comparator_candidate", 1.5e-2f, 80);
+
+	// WHEN: comparing it with the complete log
+	LogComparator comparator;
+
+	// THEN: the records without counterpart should fail the comparison
+	EXPECT_FALSE(comparator.compare("comparator_reference.ecll", "comparator_candidate.ecll"));
+	EXPECT_EQ(comparator.getMatchedRecords(), 80u);
+	EXPECT_EQ(comparator.getUnmatchedRecords(), 20u);
+
+	for (const field_deviation &deviation : comparator.getDeviations()) {
+		EXPECT_TRUE(deviation.passed());
+	}
+}
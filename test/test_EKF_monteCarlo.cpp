@@ -0,0 +1,93 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test the Monte Carlo simulation harness
+ */
+
+#include <gtest/gtest.h>
+#include "EKF/ekf.h"
+#include "sensor_simulator/monte_carlo.h"
+
+class EkfMonteCarloTest : public ::testing::Test {
+ public:
+	EkfMonteCarloTest(): ::testing::Test()
+	{
+		_config.num_scenarios = 4;
+		_config.duration = 30.0f;
+		_config.gps_outage_probability = 0.0f;
+	};
+
+	monte_carlo_config _config;
+};
+
+TEST_F(EkfMonteCarloTest, resultsIndependentOfThreadCount)
+{
+	_config.num_threads = 1;
+	MonteCarlo single_thread(_config);
+	single_thread.run();
+
+	_config.num_threads = 4;
+	MonteCarlo multi_thread(_config);
+	multi_thread.run();
+
+	ASSERT_EQ(single_thread.getResults().size(), _config.num_scenarios);
+	ASSERT_EQ(multi_thread.getResults().size(), _config.num_scenarios);
+
+	for (uint32_t i = 0; i < _config.num_scenarios; i++) {
+		const monte_carlo_result &a = single_thread.getResults()[i];
+		const monte_carlo_result &b = multi_thread.getResults()[i];
+		EXPECT_EQ(a.scenario.seed, b.scenario.seed);
+		EXPECT_EQ(a.nees_samples, b.nees_samples);
+		EXPECT_EQ(a.pos_nees_mean, b.pos_nees_mean);
+		EXPECT_EQ(a.pos_error_final, b.pos_error_final);
+	}
+}
+
+TEST_F(EkfMonteCarloTest, scenariosConverge)
+{
+	MonteCarlo monte_carlo(_config);
+	monte_carlo.run();
+	const monte_carlo_summary summary = monte_carlo.getSummary();
+
+	EXPECT_EQ(summary.num_scenarios, _config.num_scenarios);
+	EXPECT_EQ(summary.num_gps_fusion_active, _config.num_scenarios);
+	EXPECT_LT(summary.pos_error_final_max, 5.0f);
+
+	for (const monte_carlo_result &result : monte_carlo.getResults()) {
+		EXPECT_GT(result.nees_samples, 0u);
+		EXPECT_GT(result.gps_nis_samples, 0u);
+		EXPECT_TRUE(std::isfinite(result.pos_nees_mean));
+		EXPECT_TRUE(std::isfinite(result.gps_nis_mean));
+	}
+}
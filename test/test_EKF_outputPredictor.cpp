@@ -0,0 +1,258 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test the output predictor running decoupled from the filter update
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "EKF/ekf.h"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ekf_wrapper.h"
+
+// stationary and level IMU sample
+static imuSample stationaryImuSample(uint64_t time_us)
+{
+	imuSample imu{};
+	imu.time_us = time_us;
+	imu.delta_ang_dt = 0.004f;
+	imu.delta_vel_dt = 0.004f;
+	imu.delta_vel = Vector3f{0.f, 0.f, -CONSTANTS_ONE_G} * imu.delta_vel_dt;
+	return imu;
+}
+
+TEST(OutputPredictorTest, integrateFromPublishedOutput)
+{
+	// GIVEN: a predictor that has not received any filter output
+	OutputPredictor predictor;
+	predictor.update(stationaryImuSample(4000));
+	EXPECT_FALSE(predictor.isValid());
+
+	// WHEN: the filter publishes a level output moving north
+	outputSample output{};
+	output.time_us = 4000;
+	output.quat_nominal.setIdentity();
+	output.vel = Vector3f{1.f, 0.f, 0.f};
+	predictor.publish(output, Vector3f{}, Vector3f{});
+
+	for (uint64_t time_us = 8000; time_us <= 1004000; time_us += 4000) {
+		predictor.update(stationaryImuSample(time_us));
+	}
+
+	// THEN: the predictor integrates the IMU samples from that output
+	EXPECT_TRUE(predictor.isValid());
+	EXPECT_EQ(predictor.getOutput().time_us, 1004000u);
+	EXPECT_TRUE(matrix::isEqual(predictor.getOutput().vel, Vector3f(1.f, 0.f, 0.f), 1e-4f));
+	EXPECT_TRUE(matrix::isEqual(predictor.getOutput().pos, Vector3f(1.f, 0.f, 0.f), 1e-3f));
+}
+
+TEST(OutputPredictorTest, alignToDelayedPublication)
+{
+	// GIVEN: a predictor running ahead of the filter
+	OutputPredictor predictor;
+	outputSample output{};
+	output.time_us = 4000;
+	output.quat_nominal.setIdentity();
+	predictor.publish(output, Vector3f{}, Vector3f{});
+
+	uint64_t time_us = 4000;
+
+	for (int i = 0; i < 10; i++) {
+		time_us += 4000;
+		predictor.update(stationaryImuSample(time_us));
+	}
+
+	// WHEN: the filter publishes a correction of the velocity five samples back
+	output.time_us = time_us - 5 * 4000;
+	output.vel = Vector3f{0.f, 2.f, 0.f};
+	predictor.publish(output, Vector3f{}, Vector3f{});
+	time_us += 4000;
+	predictor.update(stationaryImuSample(time_us));
+
+	// THEN: the correction is applied to the newer predictor states, the position only
+	//       changes by the published position error and then integrates the new velocity
+	EXPECT_TRUE(matrix::isEqual(predictor.getOutput().vel, Vector3f(0.f, 2.f, 0.f), 1e-4f));
+	EXPECT_NEAR(predictor.getOutput().pos(1), 2.f * 0.004f, 1e-4f);
+
+	// WHEN: an older publication than the predictor history arrives
+	output.time_us = 100;
+	output.vel = Vector3f{0.f, -5.f, 0.f};
+	predictor.publish(output, Vector3f{}, Vector3f{});
+	time_us += 4000;
+	predictor.update(stationaryImuSample(time_us));
+
+	// THEN: it is ignored
+	EXPECT_TRUE(matrix::isEqual(predictor.getOutput().vel, Vector3f(0.f, 2.f, 0.f), 1e-4f));
+}
+
+TEST(OutputPredictorTest, seqLockReadsAreNotTorn)
+{
+	struct data_s {
+		uint32_t values[32];
+	};
+
+	SeqLock<data_s> seq_lock;
+	std::atomic<bool> done{false};
+
+	// GIVEN: a writer thread that keeps all values equal
+	std::thread writer([&]() {
+		data_s data{};
+
+		for (uint32_t i = 1; i <= 100000; i++) {
+			for (uint32_t &value : data.values) {
+				value = i;
+			}
+
+			seq_lock.write(data);
+		}
+
+		done = true;
+	});
+
+	// WHEN: reading concurrently
+	uint32_t last_sequence = 0;
+	bool consistent = true;
+
+	while (!done) {
+		data_s data{};
+		uint32_t sequence;
+
+		if (seq_lock.read(data, sequence)) {
+			consistent &= (sequence >= last_sequence);
+			last_sequence = sequence;
+
+			for (uint32_t value : data.values) {
+				consistent &= (value == data.values[0]);
+			}
+		}
+	}
+
+	writer.join();
+
+	// THEN: the reads only return complete writes
+	EXPECT_TRUE(consistent);
+
+	data_s data{};
+	uint32_t sequence;
+	EXPECT_TRUE(seq_lock.read(data, sequence));
+	EXPECT_EQ(data.values[31], 100000u);
+}
+
+class EkfOutputPredictorTest : public ::testing::Test {
+ public:
+
+	EkfOutputPredictorTest(): ::testing::Test(),
+	_ekf{std::make_shared<Ekf>()},
+	_sensor_simulator(_ekf),
+	_ekf_wrapper(_ekf) {};
+
+	std::shared_ptr<Ekf> _ekf;
+	SensorSimulator _sensor_simulator;
+	EkfWrapper _ekf_wrapper;
+
+	void SetUp() override
+	{
+		_ekf->init(0);
+		_sensor_simulator.runSeconds(2);
+	}
+};
+
+TEST_F(EkfOutputPredictorTest, followFilterOutput)
+{
+	// GIVEN: a predictor attached to a filter fusing GPS
+	OutputPredictor predictor;
+	_ekf->setOutputPredictor(&predictor);
+	_ekf_wrapper.enableGpsFusion();
+	_sensor_simulator.startGps();
+	_sensor_simulator.runSeconds(10);
+
+	// WHEN: the predictor receives the next IMU sample
+	predictor.update(stationaryImuSample(_sensor_simulator.getTime() + 4000));
+
+	// THEN: its output matches the filter output
+	EXPECT_TRUE(predictor.isValid());
+	const Quatf q_error = predictor.getOutput().quat_nominal * _ekf->getQuaternion().inversed();
+	EXPECT_LT(Vector3f(q_error(1), q_error(2), q_error(3)).norm(), 1e-3f);
+	EXPECT_TRUE(matrix::isEqual(predictor.getOutput().vel, _ekf->getVelocity(), 0.01f));
+	EXPECT_TRUE(matrix::isEqual(predictor.getOutput().pos, _ekf->getPosition(), 0.01f));
+
+	// WHEN: the predictor is detached
+	_ekf->setOutputPredictor(nullptr);
+	const uint64_t time_us = predictor.getOutput().time_us;
+	_sensor_simulator.runSeconds(1);
+	predictor.update(stationaryImuSample(time_us + 4000));
+
+	// THEN: it keeps integrating its own solution
+	EXPECT_EQ(predictor.getOutput().time_us, time_us + 4000);
+}
+
+TEST_F(EkfOutputPredictorTest, forkDoesNotPublish)
+{
+	// GIVEN: a predictor attached to a filter
+	OutputPredictor predictor;
+	_ekf->setOutputPredictor(&predictor);
+	_sensor_simulator.runSeconds(2);
+	uint64_t time_us = _sensor_simulator.getTime();
+	predictor.update(stationaryImuSample(time_us));
+	ASSERT_TRUE(predictor.isValid());
+
+	// WHEN: a fork of the filter sees an acceleration that the original does not see
+	Ekf fork(*_ekf);
+	_ekf->setOutputPredictor(nullptr);
+
+	auto accelerate = [&](Ekf & ekf) {
+		for (int i = 0; i < 250; i++) {
+			time_us += 4000;
+			imuSample imu = stationaryImuSample(time_us);
+			imu.delta_vel(0) = 2.f * imu.delta_vel_dt;
+			ekf.setIMUData(imu);
+			ekf.update();
+			predictor.update(stationaryImuSample(time_us));
+		}
+	};
+
+	accelerate(fork);
+
+	// THEN: the predictor of the original does not receive the output of the fork
+	EXPECT_GT(fork.getVelocity()(0), 1.f);
+	EXPECT_LT(predictor.getOutput().vel.norm(), 0.1f);
+
+	// WHEN: the predictor is attached to the fork
+	fork.setOutputPredictor(&predictor);
+	accelerate(fork);
+
+	// THEN: it follows the fork
+	EXPECT_NEAR(predictor.getOutput().vel(0), fork.getVelocity()(0), 0.1f);
+}
@@ -142,6 +142,33 @@ TEST_F(EkfRingBufferTest, askingForTooNewSample)
 	EXPECT_EQ(false, _buffer->pop_first_older_than(_y.time_us+100000, &pop));
 }
 
+TEST_F(EkfRingBufferTest, emptyAfterPop)
+{
+	// GIVEN: an allocated buffer
+	ASSERT_EQ(true, _buffer->allocate(3));
+	EXPECT_TRUE(_buffer->is_empty());
+
+	_buffer->push(_x);
+	_buffer->push(_y);
+	EXPECT_FALSE(_buffer->is_empty());
+
+	sample pop = {};
+	// WHEN: an older sample is popped
+	// THEN: the newer one is still in the buffer
+	EXPECT_EQ(true, _buffer->pop_first_older_than(_x.time_us + 1, &pop));
+	EXPECT_FALSE(_buffer->is_empty());
+
+	// WHEN: the newest sample is popped
+	// THEN: the buffer is empty and nothing else can be popped
+	EXPECT_EQ(true, _buffer->pop_first_older_than(_y.time_us + 1, &pop));
+	EXPECT_TRUE(_buffer->is_empty());
+	EXPECT_EQ(false, _buffer->pop_first_older_than(_y.time_us + 2, &pop));
+
+	// WHEN: a new sample is pushed
+	_buffer->push(_z);
+	EXPECT_FALSE(_buffer->is_empty());
+}
+
 TEST_F(EkfRingBufferTest, reallocateBuffer)
 {
 	ASSERT_EQ(true, _buffer->allocate(5));
@@ -158,3 +185,80 @@ TEST_F(EkfRingBufferTest, reallocateBuffer)
 	EXPECT_EQ(3, _buffer->get_length());
 
 }
+
+TEST_F(EkfRingBufferTest, resizeBuffer)
+{
+	ASSERT_EQ(true, _buffer->allocate(3));
+	EXPECT_FALSE(_buffer->push(_x));
+	EXPECT_FALSE(_buffer->push(_y));
+	EXPECT_FALSE(_buffer->push(_z));
+
+	// GIVEN: a full buffer
+	// WHEN: another sample is pushed
+	// THEN: the oldest sample is reported as overwritten
+	EXPECT_TRUE(_buffer->push(_z));
+	EXPECT_EQ(_y.time_us, _buffer->get_oldest().time_us);
+
+	// WHEN: the buffer is made longer
+	ASSERT_EQ(true, _buffer->resize(5));
+
+	// THEN: the samples are kept in order and the new entries are free
+	EXPECT_EQ(5, _buffer->get_length());
+	EXPECT_EQ(_y.time_us, _buffer->get_oldest().time_us);
+	EXPECT_EQ(_z.time_us, _buffer->get_newest().time_us);
+	EXPECT_FALSE(_buffer->push(_z));
+	EXPECT_FALSE(_buffer->push(_z));
+	EXPECT_TRUE(_buffer->push(_z));
+
+	// WHEN: the buffer is made shorter
+	sample pop = {};
+	ASSERT_EQ(true, _buffer->allocate(3));
+	_buffer->push(_x);
+	_buffer->push(_y);
+	_buffer->push(_z);
+	ASSERT_EQ(true, _buffer->resize(2));
+
+	// THEN: the newest samples are kept
+	EXPECT_EQ(2, _buffer->get_length());
+	EXPECT_EQ(_y.time_us, _buffer->get_oldest().time_us);
+	EXPECT_EQ(true, _buffer->pop_first_older_than(_y.time_us + 1, &pop));
+	EXPECT_EQ(_y.time_us, pop.time_us);
+
+	// WHEN: an empty buffer is resized
+	EXPECT_EQ(true, _buffer->pop_first_older_than(_z.time_us + 1, &pop));
+	ASSERT_EQ(true, _buffer->resize(4));
+
+	// THEN: it stays empty
+	EXPECT_TRUE(_buffer->is_empty());
+	EXPECT_FALSE(_buffer->push(_x));
+	EXPECT_EQ(_x.time_us, _buffer->get_newest().time_us);
+}
+
+TEST_F(EkfRingBufferTest, copyBuffer)
+{
+	ASSERT_EQ(true, _buffer->allocate(3));
+	_buffer->push(_x);
+	_buffer->push(_y);
+
+	// GIVEN: a copy of a filled buffer
+	RingBuffer<sample> copy(*_buffer);
+	EXPECT_EQ(_buffer->get_length(), copy.get_length());
+	EXPECT_EQ(_x.time_us, copy.get_oldest().time_us);
+	EXPECT_EQ(_y.time_us, copy.get_newest().time_us);
+
+	// WHEN: the original is modified
+	_buffer->push(_z);
+	_buffer->push(_z);
+
+	// THEN: the copy should keep its own samples
+	EXPECT_EQ(_x.time_us, copy.get_oldest().time_us);
+	EXPECT_EQ(_y.time_us, copy.get_newest().time_us);
+	EXPECT_EQ(_y.time_us, _buffer->get_oldest().time_us);
+
+	// WHEN: assigning the copy back
+	*_buffer = copy;
+
+	// THEN: the original should have its previous samples again
+	EXPECT_EQ(_x.time_us, _buffer->get_oldest().time_us);
+	EXPECT_EQ(_y.time_us, _buffer->get_newest().time_us);
+}
@@ -0,0 +1,140 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test saving and restoring the complete filter state
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "EKF/ekf.h"
+#include "EKF/snapshot.hpp"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ekf_wrapper.h"
+
+class EkfSnapshotTest : public ::testing::Test {
+ public:
+
+	EkfSnapshotTest(): ::testing::Test(),
+	_ekf{std::make_shared<Ekf>()},
+	_sensor_simulator(_ekf),
+	_ekf_wrapper(_ekf),
+	_ekf_other{std::make_shared<Ekf>()},
+	_sensor_simulator_other(_ekf_other),
+	_ekf_wrapper_other(_ekf_other) {};
+
+	std::shared_ptr<Ekf> _ekf;
+	SensorSimulator _sensor_simulator;
+	EkfWrapper _ekf_wrapper;
+
+	// second instance running on the same time line
+	std::shared_ptr<Ekf> _ekf_other;
+	SensorSimulator _sensor_simulator_other;
+	EkfWrapper _ekf_wrapper_other;
+
+	void SetUp() override
+	{
+		_ekf->init(0);
+		_ekf_other->init(0);
+
+		// only the first instance gets GPS data so that both estimates are different
+		_ekf_wrapper.enableGpsFusion();
+		_sensor_simulator.startGps();
+		_sensor_simulator.runSeconds(15);
+		_sensor_simulator_other.runSeconds(15);
+	}
+
+	std::vector<uint8_t> saveSnapshot(const Ekf &ekf)
+	{
+		std::vector<uint8_t> snapshot(ekf.getSnapshotSize());
+		EXPECT_EQ(ekf.saveSnapshot(snapshot.data(), snapshot.size()), snapshot.size());
+		return snapshot;
+	}
+};
+
+TEST_F(EkfSnapshotTest, restoredFilterContinuesIdentically)
+{
+	// GIVEN: a snapshot of a filter that fuses GPS
+	std::vector<uint8_t> snapshot = saveSnapshot(*_ekf);
+	EXPECT_TRUE(_ekf_wrapper.isIntendingGpsFusion());
+	EXPECT_FALSE(_ekf_wrapper_other.isIntendingGpsFusion());
+
+	// WHEN: restoring it into a filter which has been running without GPS
+	EXPECT_TRUE(_ekf_other->restoreSnapshot(snapshot.data(), snapshot.size()));
+	EXPECT_EQ(saveSnapshot(*_ekf_other), snapshot);
+
+	// THEN: both filters produce the same results when receiving the same data
+	_sensor_simulator_other.startGps();
+	_sensor_simulator.runSeconds(5);
+	_sensor_simulator_other.runSeconds(5);
+
+	EXPECT_TRUE(_ekf_wrapper_other.isIntendingGpsFusion());
+	EXPECT_EQ(_ekf->getPosition(), _ekf_other->getPosition());
+	EXPECT_EQ(_ekf->getVelocity(), _ekf_other->getVelocity());
+	EXPECT_EQ(_ekf->getQuaternion(), _ekf_other->getQuaternion());
+	EXPECT_EQ(_ekf->covariances_diagonal(), _ekf_other->covariances_diagonal());
+}
+
+TEST_F(EkfSnapshotTest, rejectInvalidSnapshot)
+{
+	std::vector<uint8_t> snapshot = saveSnapshot(*_ekf);
+	const std::vector<uint8_t> other_before = saveSnapshot(*_ekf_other);
+
+	// buffer too small to save
+	EXPECT_EQ(_ekf->saveSnapshot(snapshot.data(), snapshot.size() - 1), 0u);
+
+	// truncated
+	EXPECT_FALSE(_ekf_other->restoreSnapshot(snapshot.data(), snapshot.size() - 1));
+
+	// corrupted payload
+	snapshot.back() ^= 0xff;
+	EXPECT_FALSE(_ekf_other->restoreSnapshot(snapshot.data(), snapshot.size()));
+	snapshot.back() ^= 0xff;
+
+	// different format version
+	snapshot_header header;
+	memcpy(&header, snapshot.data(), sizeof(header));
+	header.version++;
+	memcpy(snapshot.data(), &header, sizeof(header));
+	EXPECT_FALSE(_ekf_other->restoreSnapshot(snapshot.data(), snapshot.size()));
+	header.version--;
+
+	// valid checksum but the payload ends before all members are read
+	header.payload_size /= 2;
+	header.checksum = snapshotChecksum(snapshot.data() + sizeof(header), header.payload_size);
+	memcpy(snapshot.data(), &header, sizeof(header));
+	EXPECT_FALSE(_ekf_other->restoreSnapshot(snapshot.data(), snapshot.size()));
+
+	// the rejected data did not modify the filter
+	EXPECT_EQ(saveSnapshot(*_ekf_other), other_before);
+}
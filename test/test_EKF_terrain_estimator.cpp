@@ -38,9 +38,26 @@
 
 #include <gtest/gtest.h>
 #include "EKF/ekf.h"
+#include <geo_lookup/terrain_height_source.h>
 #include "sensor_simulator/sensor_simulator.h"
 #include "sensor_simulator/ekf_wrapper.h"
 
+// terrain prior with the same height everywhere
+class FlatTerrainSource : public TerrainHeightSource
+{
+public:
+	bool getTerrainHeight(double lat, double lon, float &height, float &variance) override
+	{
+		(void)lat;
+		(void)lon;
+		height = _height;
+		variance = 1.f;
+		return true;
+	}
+
+	float _height{0.f};
+};
+
 class EkfTerrainTest : public ::testing::Test {
  public:
 
@@ -99,6 +116,35 @@ class EkfTerrainTest : public ::testing::Test {
 		_ekf->set_in_air_status(true);
 		_sensor_simulator.runSeconds(8);
 	}
+
+	// fly a pass north with the range finder and come back south without it,
+	// returns the terrain variance at the end of the return pass
+	float runSurveyScenario(const float rng_height)
+	{
+		_sensor_simulator.startGps();
+		_ekf->set_min_required_gps_health_time(1e6);
+		_ekf_wrapper.enableGpsFusion();
+		_ekf_wrapper.setBaroHeight();
+		_sensor_simulator.runSeconds(2);
+
+		_sensor_simulator._rng.setData(rng_height, 100);
+		_sensor_simulator._rng.setLimits(0.1f, 20.f);
+		_sensor_simulator.startRangeFinder();
+		_ekf->set_in_air_status(true);
+		_sensor_simulator.runSeconds(8); // hover until GPS fusion has started
+
+		const Vector3f velocity_north(2.f, 0.f, 0.f);
+		_sensor_simulator._gps.setVelocity(velocity_north);
+		_sensor_simulator._gps.setPositionRateNED(velocity_north);
+		_sensor_simulator.runSeconds(12);
+
+		_sensor_simulator.stopRangeFinder();
+		_sensor_simulator._gps.setVelocity(-velocity_north);
+		_sensor_simulator._gps.setPositionRateNED(-velocity_north);
+		_sensor_simulator.runSeconds(10);
+
+		return _ekf->get_terrain_var();
+	}
 };
 
 TEST_F(EkfTerrainTest, setFlowAndRangeTerrainFusion)
@@ -174,3 +220,166 @@ TEST_F(EkfTerrainTest, testRngForTerrainFusion)
 	const float estimated_distance_to_ground = _ekf->getTerrainVertPos();
 	EXPECT_NEAR(estimated_distance_to_ground, rng_height, 0.01f);
 }
+
+TEST_F(EkfTerrainTest, testPriorForTerrainFusion)
+{
+	// GIVEN: the terrain prior enabled and calibrated on ground, but no terrain sensor
+	FlatTerrainSource terrain;
+	_ekf->setTerrainHeightSource(&terrain);
+	_ekf_wrapper.enableTerrainPriorFusion();
+	_ekf_wrapper.disableTerrainRngFusion();
+	_ekf_wrapper.disableTerrainFlowFusion();
+
+	_sensor_simulator.startGps();
+	_ekf->set_min_required_gps_health_time(1e6);
+	_ekf_wrapper.enableGpsFusion();
+	_ekf_wrapper.setBaroHeight();
+	_sensor_simulator.runSeconds(2);
+	const float terrain_on_ground = _ekf->getTerrainVertPos();
+
+	// WHEN: the vehicle flies over terrain that is lower than the takeoff location
+	const float terrain_drop = 3.f;
+	terrain._height -= terrain_drop;
+	_ekf->set_in_air_status(true);
+	_sensor_simulator.runSeconds(10);
+
+	// THEN: the terrain estimate follows the prior, but the prior alone does not make it valid
+	EXPECT_TRUE(_ekf_wrapper.isIntendingTerrainPriorFusion());
+	EXPECT_FALSE(_ekf->isTerrainEstimateValid());
+	EXPECT_NEAR(_ekf->getTerrainVertPos(), terrain_on_ground + terrain_drop, 0.5f);
+
+	// WHEN: the prior is disabled
+	_ekf_wrapper.disableTerrainPriorFusion();
+	_sensor_simulator.runSeconds(6);
+
+	// THEN: it is not fused anymore
+	EXPECT_FALSE(_ekf_wrapper.isIntendingTerrainPriorFusion());
+}
+
+TEST_F(EkfTerrainTest, testPriorDuringRangeFinderDropout)
+{
+	// GIVEN: range finder and terrain prior fusion, calibrated on ground
+	FlatTerrainSource terrain;
+	_ekf->setTerrainHeightSource(&terrain);
+	_ekf_wrapper.enableTerrainPriorFusion();
+	_ekf_wrapper.disableTerrainFlowFusion();
+
+	_sensor_simulator.startGps();
+	_ekf->set_min_required_gps_health_time(1e6);
+	_ekf_wrapper.enableGpsFusion();
+	_ekf_wrapper.setBaroHeight();
+	_sensor_simulator.runSeconds(2);
+	const float terrain_on_ground = _ekf->getTerrainVertPos();
+
+	// WHEN: flying over terrain that is lower than the takeoff location and consistent with the range finder
+	const float rng_height = 2.f;
+	const float terrain_drop = rng_height - 0.1f; // the ground clearance is used as terrain estimate on ground
+	terrain._height = -terrain_drop;
+	_sensor_simulator._rng.setData(rng_height, 100);
+	_sensor_simulator._rng.setLimits(0.1f, 20.f);
+	_sensor_simulator.startRangeFinder();
+	_ekf->set_in_air_status(true);
+	_sensor_simulator.runSeconds(5);
+
+	EXPECT_TRUE(_ekf_wrapper.isIntendingTerrainRngFusion());
+	EXPECT_TRUE(_ekf_wrapper.isIntendingTerrainPriorFusion());
+
+	// AND: the range finder stops
+	_sensor_simulator.stopRangeFinder();
+	_sensor_simulator.runSeconds(20);
+
+	// THEN: the prior keeps the terrain estimate and its variance bounded
+	EXPECT_FALSE(_ekf_wrapper.isIntendingTerrainRngFusion());
+	EXPECT_TRUE(_ekf_wrapper.isIntendingTerrainPriorFusion());
+	EXPECT_NEAR(_ekf->getTerrainVertPos(), terrain_on_ground + terrain_drop, 0.5f);
+	EXPECT_LT(_ekf->get_terrain_var(), 2.f);
+}
+
+TEST_F(EkfTerrainTest, testGridForTerrainFusion)
+{
+	// GIVEN: the learned terrain grid with small cells
+	_ekf_wrapper.enableTerrainGridFusion();
+	_ekf_wrapper.disableTerrainFlowFusion();
+	_ekf->getParamHandle()->terrain_grid_cell_size = 2.f;
+
+	// WHEN: coming back over terrain measured by the range finder, without the range finder
+	const float rng_height = 2.f;
+	const float terrain_var = runSurveyScenario(rng_height);
+
+	// THEN: the learned cells keep the terrain estimate accurate
+	EXPECT_TRUE(_ekf_wrapper.isIntendingTerrainGridFusion());
+	EXPECT_FALSE(_ekf_wrapper.isIntendingTerrainRngFusion());
+	EXPECT_LT(terrain_var, 1.f);
+	EXPECT_NEAR(_ekf->getTerrainVertPos() - _ekf->getPosition()(2), rng_height, 0.2f);
+
+	// AND: the learned cells are kept in a snapshot of the filter
+	std::vector<uint8_t> snapshot(_ekf->getSnapshotSize());
+	ASSERT_EQ(_ekf->saveSnapshot(snapshot.data(), snapshot.size()), snapshot.size());
+	Ekf restored;
+	EXPECT_TRUE(restored.restoreSnapshot(snapshot.data(), snapshot.size()));
+	EXPECT_GT(restored.getTerrainGrid().getCellCount(), 0u);
+	EXPECT_EQ(restored.getTerrainGrid().getCellCount(), _ekf->getTerrainGrid().getCellCount());
+}
+
+TEST_F(EkfTerrainTest, testWithoutGridForTerrainFusion)
+{
+	// GIVEN: the same flight without the learned terrain grid
+	_ekf_wrapper.disableTerrainGridFusion();
+	_ekf_wrapper.disableTerrainFlowFusion();
+	_ekf->getParamHandle()->terrain_grid_cell_size = 2.f;
+
+	const float terrain_var = runSurveyScenario(2.f);
+
+	// THEN: the terrain uncertainty grows during the return pass
+	EXPECT_FALSE(_ekf_wrapper.isIntendingTerrainGridFusion());
+	EXPECT_GT(terrain_var, 2.f);
+
+	// AND: no memory is used for the grid
+	EXPECT_FALSE(_ekf->getTerrainGrid().isAllocated());
+}
+
+TEST_F(EkfTerrainTest, testGridOnlyLearnsFromTerrainFusion)
+{
+	// GIVEN: the main filter fusing optical flow and the terrain estimator only using the range finder
+	_ekf_wrapper.enableTerrainGridFusion();
+	_ekf_wrapper.disableTerrainFlowFusion();
+	_ekf->getParamHandle()->terrain_grid_cell_size = 2.f;
+
+	_sensor_simulator.startGps();
+	_ekf->set_min_required_gps_health_time(1e6);
+	_ekf_wrapper.enableGpsFusion();
+	_ekf_wrapper.setBaroHeight();
+	_sensor_simulator.runSeconds(2);
+
+	const float rng_height = 2.f;
+	_sensor_simulator._rng.setData(rng_height, 100);
+	_sensor_simulator._rng.setLimits(0.1f, 20.f);
+	_sensor_simulator.startRangeFinder();
+	_ekf->set_in_air_status(true);
+	_sensor_simulator.runSeconds(8);
+
+	const Vector3f velocity_north(1.f, 0.f, 0.f);
+	_sensor_simulator._gps.setVelocity(velocity_north);
+	_sensor_simulator._gps.setPositionRateNED(velocity_north);
+
+	flowSample flow_sample = _sensor_simulator._flow.dataAtRest();
+	flow_sample.flow_xy_rad = Vector2f(0.f, -velocity_north(0) * flow_sample.dt / rng_height);
+	_sensor_simulator._flow.setData(flow_sample);
+	_ekf->set_optical_flow_limits(5.f, 0.f, 50.f);
+	_ekf_wrapper.enableFlowFusion();
+	_sensor_simulator.startFlow();
+	_sensor_simulator.runSeconds(5);
+	EXPECT_TRUE(_ekf_wrapper.isIntendingFlowFusion());
+
+	float grid_vpos = 0.f;
+	float grid_var = 0.f;
+	EXPECT_TRUE(_ekf->getTerrainGrid().lookup(_ekf->getPosition().xy(), grid_vpos, grid_var));
+
+	// WHEN: the range finder stops while the main filter keeps fusing optical flow
+	_sensor_simulator.stopRangeFinder();
+	_sensor_simulator.runSeconds(3);
+	EXPECT_TRUE(_ekf_wrapper.isIntendingFlowFusion());
+
+	// THEN: the cells entered since are not learned, the terrain estimate was not measured there
+	EXPECT_FALSE(_ekf->getTerrainGrid().lookup(_ekf->getPosition().xy(), grid_vpos, grid_var));
+}
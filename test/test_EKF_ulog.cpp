@@ -0,0 +1,291 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test replaying ULog files through the sensor simulator
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include "EKF/ekf.h"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ulog_reader.h"
+#include "sensor_simulator/ekf_wrapper.h"
+
+namespace
+{
+
+// writes the subset of the ULog format used by the logger
+class ULogTestWriter
+{
+public:
+	explicit ULogTestWriter(const std::string &file_name):
+		_file(file_name, std::ios::binary)
+	{
+		const char header[16] {'U', 'L', 'o', 'g', 0x01, 0x12, 0x35, 0x01};
+		_file.write(header, sizeof(header));
+	}
+
+	void addFormat(const std::string &format) { addMessage('F', format); }
+	void addInfo(const std::string &info) { addMessage('I', info); }
+
+	void addSubscription(uint16_t msg_id, const std::string &topic)
+	{
+		std::string payload {0, (char)(msg_id & 0xff), (char)(msg_id >> 8)};
+		addMessage('A', payload + topic);
+	}
+
+	void addData(uint16_t msg_id, const std::string &data)
+	{
+		std::string payload {(char)(msg_id & 0xff), (char)(msg_id >> 8)};
+		addMessage('D', payload + data);
+	}
+
+	template<typename T>
+	static void append(std::string &data, T value)
+	{
+		data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+private:
+	std::ofstream _file;
+
+	void addMessage(char type, const std::string &payload)
+	{
+		const char header[3] {(char)(payload.size() & 0xff), (char)(payload.size() >> 8), type};
+		_file.write(header, sizeof(header));
+		_file.write(payload.data(), payload.size());
+	}
+};
+
+enum msg_id : uint16_t {IMU_ID, MAG_ID, BARO_ID, GPS_ID, AIRSPEED_ID, LANDED_ID, STATUS_ID};
+
+// serialize a replay sample the way the corresponding topic is logged
+void writeSample(ULogTestWriter &writer, const sensor_info &sample)
+{
+	std::string data;
+	ULogTestWriter::append<uint64_t>(data, sample.timestamp);
+	const auto &value = sample.sensor_data;
+
+	switch (sample.sensor_type) {
+	case sensor_info::IMU:
+		for (int i = 3; i < 6; i++) { ULogTestWriter::append<float>(data, value[i]); }
+
+		ULogTestWriter::append<uint32_t>(data, 4000);
+		ULogTestWriter::append<int32_t>(data, 0);
+
+		for (int i = 0; i < 3; i++) { ULogTestWriter::append<float>(data, value[i]); }
+
+		ULogTestWriter::append<uint32_t>(data, 4000);
+		ULogTestWriter::append<uint8_t>(data, 0);
+		data.append(3, '\0');
+		writer.addData(IMU_ID, data);
+		break;
+
+	case sensor_info::MAG:
+		ULogTestWriter::append<uint64_t>(data, sample.timestamp);
+		ULogTestWriter::append<uint32_t>(data, 1);
+
+		for (int i = 0; i < 3; i++) { ULogTestWriter::append<float>(data, value[i]); }
+
+		// trailing padding is not logged
+		ULogTestWriter::append<uint8_t>(data, 0);
+		writer.addData(MAG_ID, data);
+		break;
+
+	case sensor_info::BARO:
+		for (int i = 0; i < 2; i++) {
+			ULogTestWriter::append<uint32_t>(data, 1);
+			ULogTestWriter::append<float>(data, 20.f);
+		}
+
+		ULogTestWriter::append<float>(data, value[0]);
+		writer.addData(BARO_ID, data);
+		break;
+
+	case sensor_info::GPS:
+		ULogTestWriter::append<int32_t>(data, value[2]);
+		ULogTestWriter::append<int32_t>(data, value[1]);
+		ULogTestWriter::append<int32_t>(data, value[0]);
+
+		for (int i = 3; i < 6; i++) { ULogTestWriter::append<float>(data, value[i]); }
+
+		writer.addData(GPS_ID, data);
+		break;
+
+	case sensor_info::AIRSPEED:
+		ULogTestWriter::append<float>(data, value[1]);
+		ULogTestWriter::append<float>(data, value[0]);
+		writer.addData(AIRSPEED_ID, data);
+		break;
+
+	case sensor_info::LANDING_STATUS:
+		data.append(3, '\0');
+		ULogTestWriter::append<uint8_t>(data, value[0]);
+		writer.addData(LANDED_ID, data);
+		break;
+
+	default:
+		break;
+	}
+}
+
+// convert replay samples to a ULog file, delaying the gps messages like the logger does
+void writeULogFile(const std::string &file_name, const std::vector<sensor_info> &samples, uint64_t gps_delay)
+{
+	ULogTestWriter writer(file_name);
+	writer.addInfo(std::string("\x0bchar[4] ver_hw") + "SITL");
+	writer.addFormat("sensor_combined:uint64_t timestamp;float[3] gyro_rad;uint32_t gyro_integral_dt;"
+			 "int32_t accelerometer_timestamp_relative;float[3] accelerometer_m_s2;"
+			 "uint32_t accelerometer_integral_dt;uint8_t accelerometer_clipping;uint8_t[3] _padding0;");
+	writer.addFormat("vehicle_magnetometer:uint64_t timestamp;uint64_t timestamp_sample;uint32_t device_id;"
+			 "float[3] magnetometer_ga;uint8_t calibration_count;uint8_t[3] _padding0;");
+	writer.addFormat("sample_info:uint32_t device_id;float temperature;");
+	writer.addFormat("vehicle_air_data:uint64_t timestamp;sample_info[2] info;float baro_alt_meter;");
+	writer.addFormat("vehicle_gps_position:uint64_t timestamp;int32_t lat;int32_t lon;int32_t alt;"
+			 "float vel_n_m_s;float vel_e_m_s;float vel_d_m_s;");
+	writer.addFormat("airspeed:uint64_t timestamp;float indicated_airspeed_m_s;float true_airspeed_m_s;");
+	writer.addFormat("vehicle_land_detected:uint64_t timestamp;bool freefall;bool ground_contact;bool maybe_landed;bool landed;");
+	writer.addFormat("vehicle_status:uint64_t timestamp;uint8_t arming_state;");
+	writer.addSubscription(IMU_ID, "sensor_combined");
+	writer.addSubscription(MAG_ID, "vehicle_magnetometer");
+	writer.addSubscription(BARO_ID, "vehicle_air_data");
+	writer.addSubscription(GPS_ID, "vehicle_gps_position");
+	writer.addSubscription(AIRSPEED_ID, "airspeed");
+	writer.addSubscription(LANDED_ID, "vehicle_land_detected");
+	writer.addSubscription(STATUS_ID, "vehicle_status");
+
+	std::vector<sensor_info> delayed_gps;
+
+	for (const sensor_info &sample : samples) {
+		while (!delayed_gps.empty() && delayed_gps.front().timestamp + gps_delay <= sample.timestamp) {
+			writeSample(writer, delayed_gps.front());
+			delayed_gps.erase(delayed_gps.begin());
+		}
+
+		if (sample.sensor_type == sensor_info::GPS) {
+			delayed_gps.push_back(sample);
+
+		} else {
+			writeSample(writer, sample);
+		}
+
+		if (sample.sensor_type == sensor_info::LANDING_STATUS) {
+			std::string status;
+			ULogTestWriter::append<uint64_t>(status, sample.timestamp);
+			ULogTestWriter::append<uint8_t>(status, 2);
+			writer.addData(STATUS_ID, status);
+		}
+	}
+
+	for (const sensor_info &sample : delayed_gps) {
+		writeSample(writer, sample);
+	}
+}
+
+} // namespace
+
+TEST(EkfULogReplayTest, ulogReplayMatchesCsvReplay)
+{
+	const std::string csv_file = "../../../test/replay_data/iris_gps.csv";
+	const std::string ulog_file = "iris_gps.ulg";
+
+	// GIVEN: a ULog file logged from the replay data with delayed gps messages
+	std::shared_ptr<const std::vector<sensor_info>> csv_data = SensorSimulator::readSensorDataFromFile(csv_file);
+	writeULogFile(ulog_file, *csv_data, 100000);
+
+	// WHEN: reading it back
+	ULogReader reader;
+	ASSERT_TRUE(reader.open(ulog_file));
+
+	std::map<int, std::vector<sensor_info>> ulog_samples;
+	sensor_info sample;
+	uint64_t last_timestamp = 0;
+	size_t sample_count = 0;
+
+	while (reader.readNext(sample)) {
+		// THEN: the samples come out in timestamp order
+		ASSERT_GE(sample.timestamp, last_timestamp);
+		last_timestamp = sample.timestamp;
+		ulog_samples[sample.sensor_type].push_back(sample);
+		sample_count++;
+	}
+
+	ASSERT_EQ(sample_count, csv_data->size());
+
+	// AND: every topic holds the values of the replay data
+	std::map<int, size_t> index;
+
+	for (const sensor_info &csv_sample : *csv_data) {
+		const sensor_info &ulog_sample = ulog_samples[csv_sample.sensor_type][index[csv_sample.sensor_type]++];
+		ASSERT_EQ(ulog_sample.timestamp, csv_sample.timestamp);
+		ASSERT_EQ(ulog_sample.num_values, csv_sample.num_values);
+
+		for (int i = 0; i < csv_sample.num_values; i++) {
+			if (csv_sample.sensor_type == sensor_info::GPS && i < 3) {
+				EXPECT_EQ((int32_t) ulog_sample.sensor_data[i], (int32_t) csv_sample.sensor_data[i]);
+
+			} else {
+				EXPECT_EQ((float) ulog_sample.sensor_data[i], (float) csv_sample.sensor_data[i]);
+			}
+		}
+	}
+
+	// AND: replaying both should give the same estimate
+	std::shared_ptr<Ekf> ekf_csv = std::make_shared<Ekf>();
+	std::shared_ptr<Ekf> ekf_ulog = std::make_shared<Ekf>();
+	SensorSimulator simulator_csv(ekf_csv);
+	SensorSimulator simulator_ulog(ekf_ulog);
+	simulator_csv.setReplayData(csv_data);
+	simulator_ulog.loadSensorDataFromULogFile(ulog_file);
+	simulator_csv.startGps();
+	simulator_ulog.startGps();
+	EkfWrapper(ekf_csv).enableGpsFusion();
+	EkfWrapper(ekf_ulog).enableGpsFusion();
+
+	simulator_csv.runReplaySeconds(15.0f);
+	simulator_ulog.runReplaySeconds(15.0f);
+
+	EXPECT_EQ(ekf_csv->getPosition(), ekf_ulog->getPosition());
+	EXPECT_EQ(ekf_csv->getVelocity(), ekf_ulog->getVelocity());
+	EXPECT_EQ(ekf_csv->getQuaternion(), ekf_ulog->getQuaternion());
+}
+
+TEST(EkfULogReplayTest, rejectsFileWithoutULogHeader)
+{
+	ULogReader reader;
+	EXPECT_FALSE(reader.open("../../../test/replay_data/iris_gps.csv"));
+
+	sensor_info sample;
+	EXPECT_FALSE(reader.readNext(sample));
+}
@@ -33,11 +33,16 @@
 
 #include <gtest/gtest.h>
 #include <math.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include "EKF/ekf.h"
 #include "sensor_simulator/sensor_simulator.h"
 #include "sensor_simulator/ekf_wrapper.h"
 #include "sensor_simulator/ekf_logger.h"
+#include "sensor_simulator/parameter_sweep.h"
+#include "sensor_simulator/binary_replay.h"
 
 class EkfReplayTest : public ::testing::Test {
  public:
@@ -70,3 +75,145 @@ TEST_F(EkfReplayTest, replaySensorData)
 		_ekf_logger.writeStateToFile();
 	}
 }
+
+TEST(EkfParameterSweepTest, lockstepRunsOverSharedReplayData)
+{
+	ParameterSweep sweep(SensorSimulator::readSensorDataFromFile("../../../test/replay_data/iris_gps.csv"));
+
+	sweep.addRun("default_a", nullptr);
+	sweep.addRun("default_b", nullptr);
+	sweep.addRun("high_gyro_noise", [](parameters &params) { params.gyro_noise *= 10.0f; });
+
+	sweep.forEachRun([](SensorSimulator &simulator, EkfWrapper &ekf_wrapper) {
+		simulator.startGps();
+		ekf_wrapper.enableGpsFusion();
+	});
+
+	sweep.runReplaySeconds(10.0f);
+
+	const std::vector<sweep_result> results = sweep.getResults();
+	ASSERT_EQ(results.size(), 3u);
+	EXPECT_EQ(results[0].samples, 100u);
+
+	// instances with the same parameters replaying the same data have to give the same result
+	EXPECT_EQ(results[0].position, results[1].position);
+	EXPECT_EQ(results[0].vel_ratio_max, results[1].vel_ratio_max);
+	EXPECT_EQ(results[0].eph, results[1].eph);
+
+	// the parameter change has to be visible in the estimate
+	EXPECT_FALSE(results[0].position == results[2].position);
+	EXPECT_NE(results[0].eph, results[2].eph);
+}
+
+TEST(EkfBinaryReplayTest, binaryReplayMatchesCsvReplay)
+{
+	const std::string csv_file = "../../../test/replay_data/iris_gps.csv";
+	const std::string binary_file = "iris_gps.eclr";
+	ASSERT_TRUE(BinaryReplayWriter::convertFromCsv(csv_file, binary_file));
+
+	// GIVEN: the same log in csv and binary form
+	std::shared_ptr<const std::vector<sensor_info>> csv_data = SensorSimulator::readSensorDataFromFile(csv_file);
+	BinaryReplayReader reader;
+	ASSERT_TRUE(reader.open(binary_file));
+	ASSERT_EQ(reader.getRecordCount(), csv_data->size());
+
+	// THEN: every record should hold the values the simulator uses
+	sensor_info sample;
+
+	for (const sensor_info &csv_sample : *csv_data) {
+		ASSERT_TRUE(reader.readNext(sample));
+		ASSERT_EQ(sample.timestamp, csv_sample.timestamp);
+		ASSERT_EQ(sample.sensor_type, csv_sample.sensor_type);
+		ASSERT_EQ(sample.num_values, csv_sample.num_values);
+
+		for (int i = 0; i < csv_sample.num_values; i++) {
+			if (sample.sensor_type == sensor_info::GPS && i < 3) {
+				EXPECT_EQ((int32_t) sample.sensor_data[i], (int32_t) csv_sample.sensor_data[i]);
+
+			} else {
+				EXPECT_EQ((float) sample.sensor_data[i], (float) csv_sample.sensor_data[i]);
+			}
+		}
+	}
+
+	EXPECT_FALSE(reader.readNext(sample));
+
+	// AND: seeking should position the reader on the first record not older than the requested time
+	const uint64_t seek_time = 20000000;
+	reader.seek(seek_time);
+	ASSERT_TRUE(reader.readNext(sample));
+	const auto first_not_older = std::find_if(csv_data->begin(), csv_data->end(),
+				     [&](const sensor_info &s) { return s.timestamp >= seek_time; });
+	EXPECT_EQ(sample.timestamp, first_not_older->timestamp);
+	EXPECT_EQ(sample.sensor_type, first_not_older->sensor_type);
+
+	// AND: replaying both should give the same estimate
+	std::shared_ptr<Ekf> ekf_csv = std::make_shared<Ekf>();
+	std::shared_ptr<Ekf> ekf_binary = std::make_shared<Ekf>();
+	SensorSimulator simulator_csv(ekf_csv);
+	SensorSimulator simulator_binary(ekf_binary);
+	simulator_csv.setReplayData(csv_data);
+	simulator_binary.loadSensorDataFromBinaryFile(binary_file);
+	simulator_csv.startGps();
+	simulator_binary.startGps();
+	EkfWrapper(ekf_csv).enableGpsFusion();
+	EkfWrapper(ekf_binary).enableGpsFusion();
+
+	simulator_csv.runReplaySeconds(15.0f);
+	simulator_binary.runReplaySeconds(15.0f);
+
+	EXPECT_EQ(ekf_csv->getPosition(), ekf_binary->getPosition());
+	EXPECT_EQ(ekf_csv->getVelocity(), ekf_binary->getVelocity());
+	EXPECT_EQ(ekf_csv->getQuaternion(), ekf_binary->getQuaternion());
+}
+
+// source whose samples are announced but can not be read
+class UnreadableReplaySource : public ReplaySource
+{
+public:
+	bool peekTimestamp(uint64_t &timestamp) override
+	{
+		timestamp = 0;
+		return true;
+	}
+
+	bool readNext(sensor_info &) override
+	{
+		read_count++;
+		return false;
+	}
+
+	int read_count{0};
+};
+
+TEST(EkfBinaryReplayTest, replayStopsWhenSampleCanNotBeRead)
+{
+	// GIVEN: a replay source that fails to read its next sample
+	std::shared_ptr<Ekf> ekf = std::make_shared<Ekf>();
+	SensorSimulator simulator(ekf);
+	auto source = std::make_shared<UnreadableReplaySource>();
+	simulator.setReplaySource(source);
+
+	// WHEN: replaying
+	simulator.runReplaySeconds(0.1f);
+
+	// THEN: the replay stops at the failed read instead of applying a sample again
+	EXPECT_EQ(source->read_count, 1);
+}
+
+TEST(EkfBinaryReplayTest, failedConversionLeavesNoFile)
+{
+	// GIVEN: a csv log with timestamps out of order
+	const std::string csv_file = "unsorted.csv";
+	const std::string binary_file = "unsorted.eclr";
+	{
+		std::ofstream csv(csv_file);
+		csv << "8000,baro,487.6\n" << "4000,baro,487.7\n";
+	}
+
+	// WHEN: converting it
+	// THEN: the conversion fails and no partly written file is left behind
+	EXPECT_FALSE(BinaryReplayWriter::convertFromCsv(csv_file, binary_file));
+	EXPECT_FALSE(std::ifstream(binary_file).good());
+	std::remove(csv_file.c_str());
+}
@@ -0,0 +1,145 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * Test the activation of the EKF-GSF yaw estimator
+ */
+
+#include <gtest/gtest.h>
+#include "EKF/ekf.h"
+#include "sensor_simulator/sensor_simulator.h"
+#include "sensor_simulator/ekf_wrapper.h"
+
+class EkfYawEstimatorTest : public ::testing::Test {
+ public:
+
+	EkfYawEstimatorTest(): ::testing::Test(),
+	_ekf{std::make_shared<Ekf>()},
+	_sensor_simulator(_ekf),
+	_ekf_wrapper(_ekf) {};
+
+	std::shared_ptr<Ekf> _ekf;
+	SensorSimulator _sensor_simulator;
+	EkfWrapper _ekf_wrapper;
+
+	void SetUp() override
+	{
+		_ekf->init(0);
+		_sensor_simulator.runSeconds(2);
+		_ekf_wrapper.enableGpsFusion();
+		_sensor_simulator.startGps();
+		_sensor_simulator.runSeconds(11);
+		_ekf->set_in_air_status(true);
+	}
+
+	bool isYawEstimatorRunning()
+	{
+		float yaw_composite, yaw_variance;
+		float yaw[N_MODELS_EKFGSF], innov_VN[N_MODELS_EKFGSF], innov_VE[N_MODELS_EKFGSF], weight[N_MODELS_EKFGSF];
+		return _ekf->getDataEKFGSF(&yaw_composite, &yaw_variance, yaw, innov_VN, innov_VE, weight);
+	}
+};
+
+TEST_F(EkfYawEstimatorTest, alwaysRunsByDefault)
+{
+	// WHEN: flying with a stable, aided yaw for a long time
+	_sensor_simulator.runSeconds(60);
+
+	// THEN: the yaw estimator should still be running
+	EXPECT_TRUE(_ekf_wrapper.isIntendingMagHeadingFusion());
+	EXPECT_TRUE(isYawEstimatorRunning());
+}
+
+TEST_F(EkfYawEstimatorTest, lazyStopsAndRestarts)
+{
+	// GIVEN: the estimator is only run when needed
+	parameters *params = _ekf->getParamHandle();
+	params->EKFGSF_lazy = 1;
+	params->EKFGSF_lazy_stable_time = 5000000;
+	params->EKFGSF_lazy_period = 20000000;
+	params->EKFGSF_lazy_duration = 4000000;
+
+	_sensor_simulator.runSeconds(1);
+	EXPECT_TRUE(isYawEstimatorRunning());
+
+	// WHEN: the yaw has been aided and consistent for longer than the stable time
+	_sensor_simulator.runSeconds(5);
+
+	// THEN: the estimator should be stopped
+	EXPECT_FALSE(isYawEstimatorRunning());
+
+	// AND: it should be run for the end of every period
+	_sensor_simulator.runSeconds(16);
+	EXPECT_TRUE(isYawEstimatorRunning());
+
+	// AND: have been restarted with the model yaws spread evenly around the main filter yaw
+	float yaw_composite, yaw_variance;
+	float yaw[N_MODELS_EKFGSF], innov_VN[N_MODELS_EKFGSF], innov_VE[N_MODELS_EKFGSF], weight[N_MODELS_EKFGSF];
+	ASSERT_TRUE(_ekf->getDataEKFGSF(&yaw_composite, &yaw_variance, yaw, innov_VN, innov_VE, weight));
+	const float yaw_increment = 2.0f * M_PI_F / N_MODELS_EKFGSF;
+
+	for (int model_index = 0; model_index < N_MODELS_EKFGSF; model_index++) {
+		const float expected_offset = -M_PI_F + (model_index + 0.5f) * yaw_increment;
+		EXPECT_NEAR(wrap_pi(yaw[model_index] - _ekf_wrapper.getYawAngle()), expected_offset, 0.05f);
+		EXPECT_NEAR(weight[model_index], 1.0f / N_MODELS_EKFGSF, 0.05f);
+	}
+
+	_sensor_simulator.runSeconds(4);
+	EXPECT_FALSE(isYawEstimatorRunning());
+
+	// WHEN: an emergency yaw reset is requested
+	_ekf->requestEmergencyNavReset();
+	_sensor_simulator.runSeconds(0.1f);
+
+	// THEN: the estimator should run again
+	EXPECT_TRUE(isYawEstimatorRunning());
+}
+
+TEST_F(EkfYawEstimatorTest, lazyKeepsRunningOnGround)
+{
+	// GIVEN: the estimator is only run when needed
+	parameters *params = _ekf->getParamHandle();
+	params->EKFGSF_lazy = 1;
+	params->EKFGSF_lazy_stable_time = 5000000;
+
+	// WHEN: landed
+	_ekf->set_in_air_status(false);
+	_sensor_simulator.runSeconds(1);
+	_ekf->set_in_air_status(true);
+	_sensor_simulator.runSeconds(4);
+
+	// THEN: the stable time should start after takeoff
+	EXPECT_TRUE(isYawEstimatorRunning());
+	_sensor_simulator.runSeconds(2);
+	EXPECT_FALSE(isYawEstimatorRunning());
+}
@@ -0,0 +1,209 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <gtest/gtest.h>
+#include "EKF/terrain_height_grid.hpp"
+#include <matrix/math.hpp>
+
+using matrix::Vector2f;
+
+class TerrainHeightGridTest : public ::testing::Test {
+public:
+	void SetUp() override
+	{
+		_grid.setCellSize(_cell_size);
+		ASSERT_TRUE(_grid.allocate());
+	}
+
+protected:
+	TerrainHeightGrid _grid{};
+	const float _cell_size{5.f};
+};
+
+TEST_F(TerrainHeightGridTest, storeAndLookup)
+{
+	float vpos = 0.f;
+	float var = 0.f;
+
+	// WHEN: nothing has been learned
+	// THEN: no cell is known
+	EXPECT_FALSE(_grid.lookup(Vector2f(1.f, 1.f), vpos, var));
+	EXPECT_EQ(_grid.getCellCount(), 0u);
+
+	// WHEN: the terrain is stored at a position
+	_grid.update(Vector2f(1.f, 1.f), 3.f, 0.1f);
+
+	// THEN: it is found anywhere in the same cell, including negative coordinates
+	EXPECT_TRUE(_grid.lookup(Vector2f(4.9f, 0.1f), vpos, var));
+	EXPECT_FLOAT_EQ(vpos, 3.f);
+	EXPECT_FLOAT_EQ(var, 0.1f);
+	EXPECT_FALSE(_grid.lookup(Vector2f(5.1f, 1.f), vpos, var));
+	EXPECT_FALSE(_grid.lookup(Vector2f(1.f, -1.f), vpos, var));
+
+	_grid.update(Vector2f(-0.1f, -0.1f), -2.f, 0.2f);
+	EXPECT_TRUE(_grid.lookup(Vector2f(-4.9f, -4.9f), vpos, var));
+	EXPECT_FLOAT_EQ(vpos, -2.f);
+
+	// WHEN: the same cell is updated again
+	_grid.update(Vector2f(2.f, 2.f), 4.f, 0.05f);
+
+	// THEN: the newer estimate replaces the stored one
+	EXPECT_TRUE(_grid.lookup(Vector2f(1.f, 1.f), vpos, var));
+	EXPECT_FLOAT_EQ(vpos, 4.f);
+	EXPECT_FLOAT_EQ(var, 0.05f);
+	EXPECT_EQ(_grid.getCellCount(), 2u);
+}
+
+TEST_F(TerrainHeightGridTest, revisitedCellFollowsChangedEstimate)
+{
+	float vpos = 0.f;
+	float var = 0.f;
+
+	// GIVEN: a cell learned from many correlated estimates of the terrain estimator
+	for (int i = 0; i < 200; i++) {
+		_grid.update(Vector2f(1.f, 1.f), 3.f, 0.1f);
+	}
+
+	// THEN: repeating the same information does not make the cell more certain
+	EXPECT_TRUE(_grid.lookup(Vector2f(1.f, 1.f), vpos, var));
+	EXPECT_FLOAT_EQ(var, 0.1f);
+
+	// WHEN: the cell is revisited and the terrain estimate has changed
+	for (int i = 0; i < 5; i++) {
+		_grid.update(Vector2f(2.f, 2.f), 4.5f, 0.2f);
+	}
+
+	// THEN: the cell follows the new estimate
+	EXPECT_TRUE(_grid.lookup(Vector2f(1.f, 1.f), vpos, var));
+	EXPECT_FLOAT_EQ(vpos, 4.5f);
+	EXPECT_FLOAT_EQ(var, 0.2f);
+}
+
+TEST_F(TerrainHeightGridTest, allocatedBeforeLearning)
+{
+	float vpos = 0.f;
+	float var = 0.f;
+
+	// WHEN: the table has not been allocated
+	TerrainHeightGrid unallocated{};
+	unallocated.setCellSize(_cell_size);
+	unallocated.update(Vector2f(1.f, 1.f), 3.f, 0.1f);
+
+	// THEN: nothing is learned and no memory is used
+	EXPECT_FALSE(unallocated.isAllocated());
+	EXPECT_FALSE(unallocated.lookup(Vector2f(1.f, 1.f), vpos, var));
+
+	// WHEN: a copy is made after the first cell is learned
+	_grid.update(Vector2f(1.f, 1.f), 3.f, 0.1f);
+	EXPECT_TRUE(_grid.isAllocated());
+	TerrainHeightGrid copy(_grid);
+
+	// THEN: the copy has its own cells
+	_grid.update(Vector2f(10.f, 1.f), 5.f, 0.1f);
+	EXPECT_TRUE(copy.lookup(Vector2f(1.f, 1.f), vpos, var));
+	EXPECT_FLOAT_EQ(vpos, 3.f);
+	EXPECT_FALSE(copy.lookup(Vector2f(10.f, 1.f), vpos, var));
+
+	// WHEN: the grid is reset
+	_grid.reset();
+
+	// THEN: the cells are forgotten but the table is kept for learning again
+	EXPECT_TRUE(_grid.isAllocated());
+	EXPECT_EQ(_grid.getCellCount(), 0u);
+
+	// AND: an unallocated grid can be assigned
+	copy = unallocated;
+	EXPECT_FALSE(copy.isAllocated());
+	EXPECT_EQ(copy.getCellCount(), 0u);
+}
+
+TEST_F(TerrainHeightGridTest, memoryIsBounded)
+{
+	// WHEN: many more cells than the capacity are visited along a survey pattern
+	for (int row = 0; row < 40; row++) {
+		for (int col = 0; col < 40; col++) {
+			_grid.update(Vector2f(row * _cell_size, col * _cell_size), float(row + col), 0.1f);
+		}
+	}
+
+	// THEN: the grid is full and the most recently visited cells are kept
+	EXPECT_EQ(_grid.getCellCount(), unsigned(TerrainHeightGrid::CAPACITY));
+
+	float vpos = 0.f;
+	float var = 0.f;
+	unsigned recent_cells_found = 0;
+
+	for (int col = 0; col < 40; col++) {
+		if (_grid.lookup(Vector2f(39 * _cell_size, col * _cell_size), vpos, var)) {
+			EXPECT_FLOAT_EQ(vpos, float(39 + col));
+			recent_cells_found++;
+		}
+	}
+
+	EXPECT_EQ(recent_cells_found, 40u);
+}
+
+TEST_F(TerrainHeightGridTest, outOfRange)
+{
+	float vpos = 0.f;
+	float var = 0.f;
+
+	// WHEN: the position cannot be represented by a cell
+	const Vector2f far_away(1e6f, 0.f);
+	_grid.update(far_away, 1.f, 1.f);
+
+	// THEN: it is ignored
+	EXPECT_EQ(_grid.getCellKey(far_away), TerrainHeightGrid::INVALID_CELL);
+	EXPECT_FALSE(_grid.lookup(far_away, vpos, var));
+	EXPECT_EQ(_grid.getCellCount(), 0u);
+}
+
+TEST_F(TerrainHeightGridTest, cellSizeChange)
+{
+	float vpos = 0.f;
+	float var = 0.f;
+	_grid.update(Vector2f(1.f, 1.f), 3.f, 0.1f);
+
+	// WHEN: the cell size does not change
+	_grid.setCellSize(_cell_size);
+
+	// THEN: the grid is kept
+	EXPECT_TRUE(_grid.lookup(Vector2f(1.f, 1.f), vpos, var));
+
+	// WHEN: the cell size changes
+	_grid.setCellSize(2.f * _cell_size);
+
+	// THEN: the learned cells are discarded
+	EXPECT_FALSE(_grid.lookup(Vector2f(1.f, 1.f), vpos, var));
+	EXPECT_EQ(_grid.getCellCount(), 0u);
+}
@@ -0,0 +1,146 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file test_fastMath.cpp
+ *
+ * @brief Checks the documented error bounds of the fast math approximations
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <matrix/math.hpp>
+
+#include "EKF/fast_math.hpp"
+
+using namespace estimator;
+
+TEST(FastMathTest, atan2ErrorBound)
+{
+	double max_error = 0.0;
+
+	for (int i = 0; i < 3600; i++) {
+		const double angle = (i - 1800) * M_PI / 1800.0 + 1.0e-4;
+
+		for (float radius : {1.0e-3f, 1.0f, 1.0e3f}) {
+			const float x = radius * static_cast<float>(cos(angle));
+			const float y = radius * static_cast<float>(sin(angle));
+			max_error = fmax(max_error, fabs(fast_math::atan2(y, x) - atan2(static_cast<double>(y), static_cast<double>(x))));
+		}
+	}
+
+	EXPECT_LT(max_error, 3.0e-7);
+	EXPECT_EQ(fast_math::atan2(0.0f, 0.0f), 0.0f);
+	EXPECT_FLOAT_EQ(fast_math::atan2(1.0f, 0.0f), 0.5f * M_PI);
+	EXPECT_FLOAT_EQ(fast_math::atan2(0.0f, -1.0f), M_PI);
+}
+
+TEST(FastMathTest, sincosErrorBound)
+{
+	double max_error = 0.0;
+
+	for (int i = -100000; i <= 100000; i++) {
+		const float x = i * 1.0e-3f;
+		float sin_x;
+		float cos_x;
+		fast_math::sincos(x, sin_x, cos_x);
+		max_error = fmax(max_error, fabs(sin_x - sin(static_cast<double>(x))));
+		max_error = fmax(max_error, fabs(cos_x - cos(static_cast<double>(x))));
+	}
+
+	EXPECT_LT(max_error, 2.5e-7);
+}
+
+TEST(FastMathTest, expErrorBound)
+{
+	double max_error = 0.0;
+
+	for (int i = -86999; i < 88000; i++) {
+		const float x = i * 1.0e-3f;
+		const double expected = exp(static_cast<double>(x));
+		max_error = fmax(max_error, fabs(fast_math::exp(x) - expected) / expected);
+	}
+
+	EXPECT_LT(max_error, 4.0e-7);
+	EXPECT_EQ(fast_math::exp(-100.0f), 0.0f);
+}
+
+TEST(FastMathTest, invSqrtErrorBound)
+{
+	double max_error = 0.0;
+
+	for (float x = 1.0e-20f; x < 1.0e20f; x *= 1.001f) {
+		const double expected = 1.0 / sqrt(static_cast<double>(x));
+		max_error = fmax(max_error, fabs(fast_math::invSqrt(x) - expected) / expected);
+	}
+
+	EXPECT_LT(max_error, 5.0e-6);
+}
+
+TEST(FastMathTest, quatFromAxisAngle)
+{
+	// GIVEN: rotation vectors from a typical IMU delta angle up to a large rotation
+	for (const matrix::Vector3f &rot_vec : {matrix::Vector3f{1.0e-3f, -2.0e-3f, 5.0e-4f},
+						matrix::Vector3f{0.3f, 0.2f, -0.1f},
+						matrix::Vector3f{2.0f, -1.0f, 1.5f}}) {
+		// WHEN: the quaternion is built with the approximations
+		const matrix::Quatf q = fast_math::quatFromAxisAngle(rot_vec);
+
+		// THEN: it matches the quaternion built by the matrix library
+		const matrix::Quatf q_expected{matrix::AxisAnglef{rot_vec}};
+
+		for (int i = 0; i < 4; i++) {
+			EXPECT_NEAR(q(i), q_expected(i), 5.0e-6f);
+		}
+	}
+
+	// a zero rotation gives the identity quaternion
+	const matrix::Quatf q_zero = fast_math::quatFromAxisAngle(matrix::Vector3f{});
+	EXPECT_EQ(q_zero(0), 1.0f);
+	EXPECT_EQ(q_zero(1), 0.0f);
+}
+
+#if !defined(ECL_FAST_MATH)
+TEST(FastMathTest, hotPathUsesLibmByDefault)
+{
+	// without the build option the estimator results must not change
+	EXPECT_EQ(hotpath::atan2f(0.3f, -0.7f), atan2f(0.3f, -0.7f));
+	EXPECT_EQ(hotpath::expf(-3.3f), expf(-3.3f));
+
+	float sin_x;
+	float cos_x;
+	hotpath::sincosf(1.234f, sin_x, cos_x);
+	EXPECT_EQ(sin_x, sinf(1.234f));
+	EXPECT_EQ(cos_x, cosf(1.234f));
+}
+#endif // ECL_FAST_MATH
@@ -95,3 +95,77 @@ TEST_F(GeoTest, projectReproject)
 	EXPECT_FLOAT_EQ(lat, lat_new);
 	EXPECT_FLOAT_EQ(lon, lon_new);
 }
+
+TEST_F(GeoTest, batchProjectionMatchesSinglePoint)
+{
+	// GIVEN: points spread around the origin
+	static constexpr size_t count = 64;
+	double lat[count];
+	double lon[count];
+
+	for (size_t i = 0; i < count; i++) {
+		lat[i] = 47.3566094 + 0.01 * sin(0.3 * i) * i;
+		lon[i] = 8.5190237 + 0.01 * cos(0.3 * i) * i;
+	}
+
+	lat[0] = math::degrees(origin.lat_rad);
+	lon[0] = math::degrees(origin.lon_rad);
+
+	// WHEN: they are projected and reprojected as a batch
+	float x[count];
+	float y[count];
+	double lat_new[count];
+	double lon_new[count];
+	EXPECT_EQ(map_projection_project_batch(&origin, lat, lon, x, y, count), 0);
+	EXPECT_EQ(map_projection_reproject_batch(&origin, x, y, lat_new, lon_new, count), 0);
+
+	// THEN: the results are identical to the single point functions
+	for (size_t i = 0; i < count; i++) {
+		float x_single;
+		float y_single;
+		map_projection_project(&origin, lat[i], lon[i], &x_single, &y_single);
+		EXPECT_EQ(x[i], x_single);
+		EXPECT_EQ(y[i], y_single);
+
+		double lat_single;
+		double lon_single;
+		map_projection_reproject(&origin, x[i], y[i], &lat_single, &lon_single);
+		EXPECT_EQ(lat_new[i], lat_single);
+		EXPECT_EQ(lon_new[i], lon_single);
+	}
+}
+
+TEST_F(GeoTest, batchProjectionNeedsReference)
+{
+	map_projection_reference_s ref{};
+	double lat = 47.0;
+	double lon = 8.0;
+	float x;
+	float y;
+	EXPECT_EQ(map_projection_project_batch(&ref, &lat, &lon, &x, &y, 1), -1);
+	EXPECT_EQ(map_projection_reproject_batch(&ref, &x, &y, &lat, &lon, 1), -1);
+}
+
+TEST_F(GeoTest, batchDistanceMatchesSinglePoint)
+{
+	// GIVEN: waypoints at increasing distance from the current position
+	static constexpr size_t count = 32;
+	double lat_next[count];
+	double lon_next[count];
+
+	for (size_t i = 0; i < count; i++) {
+		lat_next[i] = 47.3566094 - 0.05 * i;
+		lon_next[i] = 8.5190237 + 0.07 * i;
+	}
+
+	// WHEN: the distances are computed as a batch
+	float dist[count];
+	get_distance_to_next_waypoint_batch(47.3566094, 8.5190237, lat_next, lon_next, dist, count);
+
+	// THEN: they are identical to the single point function
+	for (size_t i = 0; i < count; i++) {
+		EXPECT_EQ(dist[i], get_distance_to_next_waypoint(47.3566094, 8.5190237, lat_next[i], lon_next[i]));
+	}
+
+	EXPECT_EQ(dist[0], 0.f);
+}
@@ -0,0 +1,145 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <gtest/gtest.h>
+#include <geo_lookup/geo_mag_declination.h>
+#include <geo_lookup/geo_mag_wmm.h>
+
+#include <vector>
+
+class WorldMagneticModelTest : public ::testing::Test {
+ public:
+	WorldMagneticModel _model;
+};
+
+TEST_F(WorldMagneticModelTest, referenceValues)
+{
+	// GIVEN: test values published with the WMM-2020 report (nT)
+	const geo_mag_field arctic = _model.evaluate(80.0, 0.0, 0.0f, 2020.0f);
+	EXPECT_NEAR(arctic.north, 6.5704f, 1e-3f);
+	EXPECT_NEAR(arctic.east, -0.1463f, 1e-3f);
+	EXPECT_NEAR(arctic.down, 54.6060f, 1e-3f);
+	EXPECT_NEAR(arctic.declination, -1.28f, 0.01f);
+	EXPECT_NEAR(arctic.inclination, 83.14f, 0.01f);
+
+	const geo_mag_field equator = _model.evaluate(0.0, 120.0, 0.0f, 2020.0f);
+	EXPECT_NEAR(equator.north, 39.6243f, 1e-3f);
+	EXPECT_NEAR(equator.east, 0.1099f, 1e-3f);
+	EXPECT_NEAR(equator.down, -10.9325f, 1e-3f);
+}
+
+TEST_F(WorldMagneticModelTest, matchesLookupTables)
+{
+	// GIVEN: the grid points of the lookup tables, which hold the same model rounded to whole units
+	for (int lat = -60; lat <= 60; lat += 10) {
+		for (int lon = -180; lon < 180; lon += 10) {
+			const geo_mag_field field = _model.evaluate(lat, lon, 0.0f, 2020.4755f);
+
+			// THEN: the model is within the rounding of the tables
+			EXPECT_NEAR(field.declination, get_mag_declination(lat, lon), 0.5f) << lat << " " << lon;
+			EXPECT_NEAR(field.inclination, get_mag_inclination(lat, lon), 0.5f) << lat << " " << lon;
+			EXPECT_NEAR(field.strength, get_mag_strength(lat, lon), 0.5f) << lat << " " << lon;
+		}
+	}
+}
+
+TEST_F(WorldMagneticModelTest, geographicPole)
+{
+	// WHEN: the field is evaluated at the pole, where the longitude is undefined
+	const geo_mag_field pole = _model.evaluate(90.0, 0.0, 0.0f, 2020.0f);
+	const geo_mag_field near_pole = _model.evaluate(89.9999, 0.0, 0.0f, 2020.0f);
+
+	// THEN: it is continuous with the field next to the pole
+	EXPECT_NEAR(pole.north, near_pole.north, 1e-3f);
+	EXPECT_NEAR(pole.east, near_pole.east, 1e-3f);
+	EXPECT_NEAR(pole.down, near_pole.down, 1e-3f);
+}
+
+TEST_F(WorldMagneticModelTest, cacheThresholds)
+{
+	_model.setCacheThresholds(1000.0f, 100.0f, 0.1f);
+
+	// WHEN: the field is requested for nearby positions and dates
+	const float declination = _model.getField(47.0, 8.0, 500.0f, 2021.0f).declination;
+	_model.getField(47.005, 8.005, 550.0f, 2021.05f);
+
+	// THEN: the cached field is returned
+	EXPECT_EQ(_model.getEvaluationCount(), 1u);
+	EXPECT_FLOAT_EQ(_model.getField(47.0, 8.0, 500.0f, 2021.0f).declination, declination);
+
+	// WHEN: the position, height or date moves past a threshold
+	_model.getField(47.02, 8.0, 500.0f, 2021.0f);
+	EXPECT_EQ(_model.getEvaluationCount(), 2u);
+	_model.getField(47.02, 8.0, 700.0f, 2021.0f);
+	EXPECT_EQ(_model.getEvaluationCount(), 3u);
+	_model.getField(47.02, 8.0, 700.0f, 2021.5f);
+	EXPECT_EQ(_model.getEvaluationCount(), 4u);
+
+	// AND: zero thresholds evaluate every call
+	_model.setCacheThresholds(0.0f, 0.0f, 0.0f);
+	_model.getField(47.02, 8.0, 700.0f, 2021.5f);
+	_model.getField(47.02, 8.0, 700.1f, 2021.5f);
+	EXPECT_EQ(_model.getEvaluationCount(), 6u);
+}
+
+TEST_F(WorldMagneticModelTest, batchEvaluation)
+{
+	// GIVEN: positions along a path of 100 m steps
+	std::vector<double> lat;
+	std::vector<double> lon;
+	std::vector<float> alt;
+
+	for (int i = 0; i < 1000; i++) {
+		lat.push_back(47.0 + i * 9.0e-4);
+		lon.push_back(8.0);
+		alt.push_back(500.0f);
+	}
+
+	std::vector<geo_mag_field> fields(lat.size());
+
+	// WHEN: they are evaluated as a batch
+	_model.setCacheThresholds(500.0f, 50.0f, 0.01f);
+	_model.getFields(lat.data(), lon.data(), alt.data(), lat.size(), 2021.0f, fields.data());
+
+	// THEN: only every few points needs a full evaluation
+	EXPECT_LT(_model.getEvaluationCount(), 250u);
+
+	// AND: the error stays small compared to evaluating every point
+	WorldMagneticModel reference;
+
+	for (size_t i = 0; i < lat.size(); i += 37) {
+		const geo_mag_field expected = reference.evaluate(lat[i], lon[i], alt[i], 2021.0f);
+		EXPECT_NEAR(fields[i].declination, expected.declination, 0.01f);
+		EXPECT_NEAR(fields[i].strength, expected.strength, 0.01f);
+	}
+}
@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <gtest/gtest.h>
+#include <geo_lookup/geo_mag_declination.h>
+#include <geo_lookup/geo_mag_table.hpp>
+
+// 3 x 5 grid in tiles of 2 x 2 samples
+static constexpr int16_t test_tile_base[2 * 3] {
+	100, -200, 0,
+	3000, 0, -32768,
+};
+
+static constexpr uint8_t test_tile_shift[2 * 3] {
+	0, 1, 0,
+	4, 0, 7,
+};
+
+static constexpr int8_t test_residual[3 * 5] {
+	0,   1,  -1, 127,  5,
+	-128, 2,  3,   4,  -6,
+	10, -10, 20, -20, 127,
+};
+
+static constexpr geo_mag_compressed_table test_table {0.01f, 2, 3, 5, test_tile_base, test_tile_shift, test_residual};
+
+// the lookup has to be usable in constant expressions
+static_assert(get_compressed_table_value(test_table, 0, 0) == 1.0f, "constexpr decode");
+
+TEST(GeoMagneticTablesTest, compressedTableDecode)
+{
+	// tile (0, 0): residuals added to the base without scaling
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 0, 1), 1.01f);
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 1, 0), -0.28f);
+
+	// tile (0, 1): residuals scaled by 2
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 0, 3), (-200 + 2 * 127) * 0.01f);
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 1, 2), (-200 + 2 * 3) * 0.01f);
+
+	// partial tiles along the edges of the grid
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 1, 4), -0.06f);
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 2, 0), (3000 + 16 * 10) * 0.01f);
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 2, 2), 0.2f);
+	EXPECT_FLOAT_EQ(get_compressed_table_value(test_table, 2, 4), (-32768 + 128 * 127) * 0.01f);
+}
+
+TEST(GeoMagneticTablesTest, bilinearInterpolation)
+{
+	// GIVEN: two neighbouring samples of the declination table at 40 deg south
+	const float west = get_mag_declination(-40.f, -180.f);
+	const float east = get_mag_declination(-40.f, -170.f);
+	EXPECT_FLOAT_EQ(west, 22.f);
+	EXPECT_FLOAT_EQ(east, 23.f);
+
+	// THEN: a location half way between them gets the mean
+	EXPECT_FLOAT_EQ(get_mag_declination(-40.f, -175.f), 22.5f);
+
+	// AND: locations outside of the valid range return zero
+	EXPECT_FLOAT_EQ(get_mag_declination(-91.f, 0.f), 0.f);
+}
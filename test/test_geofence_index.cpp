@@ -0,0 +1,224 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <mathlib/mathlib.h>
+#include <geo/geo.h>
+#include <geo/geofence_index.h>
+
+#include <random>
+#include <vector>
+
+static constexpr double LAT_REF = 47.3566094;
+static constexpr double LON_REF = 8.5190237;
+
+class GeofenceIndexTest : public ::testing::Test {
+ public:
+	void SetUp() override
+	{
+		_fence.init(LAT_REF, LON_REF);
+		map_projection_init(&_ref, LAT_REF, LON_REF);
+	}
+
+	// vertices (deg) of a star shaped polygon around a local position (m)
+	void makeStar(float north, float east, float radius_inner, float radius_outer, int points,
+		      std::vector<double> &lat, std::vector<double> &lon)
+	{
+		for (int i = 0; i < 2 * points; i++) {
+			const float radius = (i % 2) ? radius_inner : radius_outer;
+			const float angle = i * M_PI_F / points;
+			double vertex_lat;
+			double vertex_lon;
+			map_projection_reproject(&_ref, north + radius * cosf(angle), east + radius * sinf(angle), &vertex_lat, &vertex_lon);
+			lat.push_back(vertex_lat);
+			lon.push_back(vertex_lon);
+		}
+	}
+
+	// reference point in polygon test over all vertices
+	bool insidePolygon(const std::vector<double> &lat, const std::vector<double> &lon, float x, float y)
+	{
+		bool inside = false;
+
+		for (size_t i = 0, j = lat.size() - 1; i < lat.size(); j = i++) {
+			float xi, yi, xj, yj;
+			map_projection_project(&_ref, lat[i], lon[i], &xi, &yi);
+			map_projection_project(&_ref, lat[j], lon[j], &xj, &yj);
+
+			if (((xi > x) != (xj > x)) && (y < yi + (x - xi) * (yj - yi) / (xj - xi))) {
+				inside = !inside;
+			}
+		}
+
+		return inside;
+	}
+
+	GeofenceIndex _fence;
+	map_projection_reference_s _ref{};
+};
+
+TEST_F(GeofenceIndexTest, containmentMatchesBruteForce)
+{
+	// GIVEN: a large inclusion polygon with many vertices and an exclusion zone inside of it
+	std::vector<double> outer_lat, outer_lon, hole_lat, hole_lon;
+	makeStar(0.f, 0.f, 1500.f, 2000.f, 150, outer_lat, outer_lon);
+	makeStar(300.f, -200.f, 200.f, 400.f, 40, hole_lat, hole_lon);
+	ASSERT_TRUE(_fence.addPolygon(outer_lat.data(), outer_lon.data(), outer_lat.size(), true));
+	ASSERT_TRUE(_fence.addPolygon(hole_lat.data(), hole_lon.data(), hole_lat.size(), false));
+	ASSERT_TRUE(_fence.build(50.f));
+
+	// WHEN: random positions are checked
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> pos(-2500.f, 2500.f);
+
+	for (int i = 0; i < 2000; i++) {
+		const float x = pos(gen);
+		const float y = pos(gen);
+
+		// THEN: the index agrees with testing every edge
+		const bool expected = insidePolygon(outer_lat, outer_lon, x, y) && !insidePolygon(hole_lat, hole_lon, x, y);
+		EXPECT_EQ(_fence.isInsideLocal(x, y), expected) << x << " " << y;
+	}
+
+	EXPECT_TRUE(_fence.isInside(LAT_REF, LON_REF));
+	EXPECT_FALSE(_fence.isInsideLocal(10000.f, 0.f));
+}
+
+TEST_F(GeofenceIndexTest, nearestSegmentMatchesBruteForce)
+{
+	// GIVEN: a polygon with many edges
+	std::vector<double> lat, lon;
+	makeStar(0.f, 0.f, 800.f, 1000.f, 100, lat, lon);
+	ASSERT_TRUE(_fence.addPolygon(lat.data(), lon.data(), lat.size(), true));
+	ASSERT_TRUE(_fence.build(40.f));
+
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<float> pos(-3000.f, 3000.f);
+
+	for (int i = 0; i < 1000; i++) {
+		const float x = pos(gen);
+		const float y = pos(gen);
+
+		// WHEN: the closest segment is looked up
+		geofence_segment_result result;
+		ASSERT_TRUE(_fence.getNearestSegmentLocal(x, y, result));
+
+		// THEN: no segment is closer
+		float expected = FLT_MAX;
+
+		for (size_t j = 0; j < lat.size(); j++) {
+			float x0, y0, x1, y1;
+			map_projection_project(&_ref, lat[j], lon[j], &x0, &y0);
+			map_projection_project(&_ref, lat[(j + 1) % lat.size()], lon[(j + 1) % lat.size()], &x1, &y1);
+			const float dx = x1 - x0;
+			const float dy = y1 - y0;
+			const float t = math::constrain(((x - x0) * dx + (y - y0) * dy) / (dx * dx + dy * dy), 0.f, 1.f);
+			expected = fminf(expected, sqrtf(powf(x0 + t * dx - x, 2) + powf(y0 + t * dy - y, 2)));
+		}
+
+		EXPECT_NEAR(result.distance, expected, 1e-3f);
+		EXPECT_EQ(result.zone, 0);
+	}
+}
+
+TEST_F(GeofenceIndexTest, corridorCrossTrack)
+{
+	// GIVEN: a corridor heading north then east
+	double lat[3];
+	double lon[3];
+	map_projection_reproject(&_ref, 0.f, 0.f, &lat[0], &lon[0]);
+	map_projection_reproject(&_ref, 1000.f, 0.f, &lat[1], &lon[1]);
+	map_projection_reproject(&_ref, 1000.f, 1000.f, &lat[2], &lon[2]);
+	ASSERT_TRUE(_fence.addCorridor(lat, lon, 3, 50.f));
+	ASSERT_TRUE(_fence.build(20.f));
+
+	// THEN: positions within the corridor width are inside
+	EXPECT_TRUE(_fence.isInsideLocal(500.f, 40.f));
+	EXPECT_TRUE(_fence.isInsideLocal(1040.f, 500.f));
+	EXPECT_FALSE(_fence.isInsideLocal(500.f, 60.f));
+	EXPECT_FALSE(_fence.isInsideLocal(500.f, 500.f));
+
+	// AND: the cross-track error has the sign convention of get_distance_to_line
+	double lat_now;
+	double lon_now;
+	map_projection_reproject(&_ref, 500.f, 30.f, &lat_now, &lon_now);
+	crosstrack_error_s crosstrack{};
+	ASSERT_TRUE(_fence.getCrossTrackError(crosstrack, lat_now, lon_now, 0));
+
+	crosstrack_error_s expected{};
+	get_distance_to_line(&expected, lat_now, lon_now, lat[0], lon[0], lat[1], lon[1]);
+	EXPECT_NEAR(crosstrack.distance, 30.f, 0.1f);
+	EXPECT_NEAR(crosstrack.distance, expected.distance, 0.1f);
+	EXPECT_NEAR(crosstrack.bearing, expected.bearing, 1e-3f);
+	EXPECT_FALSE(crosstrack.past_end);
+
+	// WHEN: the position is before the start of the corridor
+	map_projection_reproject(&_ref, -100.f, -20.f, &lat_now, &lon_now);
+	ASSERT_TRUE(_fence.getCrossTrackError(crosstrack, lat_now, lon_now, 0));
+	get_distance_to_line(&expected, lat_now, lon_now, lat[0], lon[0], lat[1], lon[1]);
+
+	// THEN: the cross-track error refers to the extension of the first segment
+	EXPECT_FALSE(expected.past_end);
+	EXPECT_FALSE(crosstrack.past_end);
+	EXPECT_NEAR(crosstrack.distance, -20.f, 0.1f);
+	EXPECT_NEAR(crosstrack.distance, expected.distance, 0.1f);
+	EXPECT_NEAR(crosstrack.bearing, expected.bearing, 1e-3f);
+
+	// WHEN: the position is beyond the end of the corridor
+	map_projection_reproject(&_ref, 1010.f, 1100.f, &lat_now, &lon_now);
+	ASSERT_TRUE(_fence.getCrossTrackError(crosstrack, lat_now, lon_now, 0));
+	get_distance_to_line(&expected, lat_now, lon_now, lat[1], lon[1], lat[2], lon[2]);
+
+	// THEN: only past_end is set
+	EXPECT_TRUE(expected.past_end);
+	EXPECT_TRUE(crosstrack.past_end);
+	EXPECT_EQ(crosstrack.distance, expected.distance);
+	EXPECT_EQ(crosstrack.bearing, expected.bearing);
+}
+
+TEST_F(GeofenceIndexTest, exclusionOnly)
+{
+	// GIVEN: only an exclusion zone
+	std::vector<double> lat, lon;
+	makeStar(0.f, 0.f, 100.f, 200.f, 5, lat, lon);
+	ASSERT_TRUE(_fence.addPolygon(lat.data(), lon.data(), lat.size(), false));
+
+	// THEN: queries fail until the index is built
+	EXPECT_FALSE(_fence.isInsideLocal(1000.f, 0.f));
+	ASSERT_TRUE(_fence.build(10.f));
+
+	// AND: everything outside of the exclusion zone is allowed
+	EXPECT_TRUE(_fence.isInsideLocal(1000.f, 0.f));
+	EXPECT_FALSE(_fence.isInsideLocal(0.f, 0.f));
+}
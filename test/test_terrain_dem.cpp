@@ -0,0 +1,261 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2020 ECL Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <gtest/gtest.h>
+#include <geo_lookup/terrain_dem.h>
+
+#include <cstdio>
+#include <vector>
+
+class TerrainDemTest : public ::testing::Test {
+ public:
+	// grid of 9 x 13 samples on a plane, split into 2 x 3 tiles of 4 intervals
+	static constexpr uint32_t ROWS = 9;
+	static constexpr uint32_t COLS = 13;
+	static constexpr double LAT_MIN = 47.0;
+	static constexpr double LON_MIN = 8.0;
+	static constexpr double SPACING = 0.001;
+	static constexpr int16_t NO_DATA = -32768;
+
+	const char *_file_name = "terrain_dem_test.ecld";
+	std::vector<int16_t> _heights;
+
+	void SetUp() override
+	{
+		_heights.resize(ROWS * COLS);
+
+		for (uint32_t row = 0; row < ROWS; row++) {
+			for (uint32_t col = 0; col < COLS; col++) {
+				_heights[row * COLS + col] = planeHeight(row, col);
+			}
+		}
+	}
+
+	void TearDown() override
+	{
+		std::remove(_file_name);
+	}
+
+	static int16_t planeHeight(double row, double col) { return static_cast<int16_t>(400 + 10 * row - 3 * col); }
+
+	// look up a height and give the loader thread time to map the tile if it is not resident yet
+	static bool getHeight(TerrainDemCache &dem, double lat, double lon, float &height, float &variance)
+	{
+		if (dem.getTerrainHeight(lat, lon, height, variance)) {
+			return true;
+		}
+
+		dem.waitForTiles();
+		return dem.getTerrainHeight(lat, lon, height, variance);
+	}
+
+	bool writeFile()
+	{
+		return TerrainDemCache::writeFile(_file_name, LAT_MIN, LON_MIN, SPACING, ROWS, COLS, _heights.data(), 4, 2.f, NO_DATA);
+	}
+};
+
+TEST_F(TerrainDemTest, interpolation)
+{
+	// GIVEN: a DEM of a plane
+	ASSERT_TRUE(writeFile());
+	TerrainDemCache dem;
+	ASSERT_TRUE(dem.open(_file_name));
+
+	// WHEN: it is queried between and on the samples, including the tile edges
+	for (double row = 0.0; row < ROWS - 1; row += 0.25) {
+		for (double col = 0.0; col < COLS - 1; col += 0.25) {
+			float height = 0.f;
+			float variance = 0.f;
+			ASSERT_TRUE(getHeight(dem, LAT_MIN + row * SPACING, LON_MIN + col * SPACING, height, variance));
+
+			// THEN: the bilinear interpolation is exact
+			EXPECT_NEAR(height, 400.0 + 10.0 * row - 3.0 * col, 1e-3) << row << " " << col;
+			EXPECT_FLOAT_EQ(variance, 4.f);
+		}
+	}
+}
+
+TEST_F(TerrainDemTest, outsideArea)
+{
+	ASSERT_TRUE(writeFile());
+	TerrainDemCache dem;
+	ASSERT_TRUE(dem.open(_file_name));
+
+	float height = 0.f;
+	float variance = 0.f;
+	EXPECT_FALSE(dem.getTerrainHeight(LAT_MIN - SPACING, LON_MIN, height, variance));
+	EXPECT_FALSE(dem.getTerrainHeight(LAT_MIN, LON_MIN - SPACING, height, variance));
+	EXPECT_FALSE(dem.getTerrainHeight(LAT_MIN + ROWS * SPACING, LON_MIN, height, variance));
+	EXPECT_FALSE(dem.getTerrainHeight(LAT_MIN, LON_MIN + COLS * SPACING, height, variance));
+	EXPECT_EQ(dem.getTileLoadCount(), 0u);
+}
+
+TEST_F(TerrainDemTest, noData)
+{
+	// GIVEN: a sample without data
+	_heights[5 * COLS + 6] = NO_DATA;
+	ASSERT_TRUE(writeFile());
+	TerrainDemCache dem;
+	ASSERT_TRUE(dem.open(_file_name));
+
+	// THEN: the cells using it have no height, their neighbours do
+	float height = 0.f;
+	float variance = 0.f;
+	EXPECT_FALSE(getHeight(dem, LAT_MIN + 4.5 * SPACING, LON_MIN + 5.5 * SPACING, height, variance));
+	EXPECT_FALSE(getHeight(dem, LAT_MIN + 5.5 * SPACING, LON_MIN + 6.5 * SPACING, height, variance));
+	EXPECT_TRUE(getHeight(dem, LAT_MIN + 3.5 * SPACING, LON_MIN + 6.5 * SPACING, height, variance));
+	EXPECT_TRUE(getHeight(dem, LAT_MIN + 5.5 * SPACING, LON_MIN + 7.5 * SPACING, height, variance));
+}
+
+TEST_F(TerrainDemTest, lookupDoesNotWaitForTiles)
+{
+	// GIVEN: a DEM without resident tiles
+	ASSERT_TRUE(writeFile());
+	TerrainDemCache dem;
+	ASSERT_TRUE(dem.open(_file_name));
+
+	// WHEN: a position close to the north-east corner of the first tile is looked up
+	float height = 0.f;
+	float variance = 0.f;
+
+	// THEN: the lookup fails instead of waiting for the tile
+	EXPECT_FALSE(dem.getTerrainHeight(LAT_MIN + 3.5 * SPACING, LON_MIN + 3.5 * SPACING, height, variance));
+
+	// AND: the loader thread maps the tile and its three neighbours around that corner
+	dem.waitForTiles();
+	EXPECT_EQ(dem.getResidentTileCount(), 4u);
+	EXPECT_EQ(dem.getTileLoadCount(), 4u);
+	EXPECT_TRUE(dem.getTerrainHeight(LAT_MIN + 3.5 * SPACING, LON_MIN + 3.5 * SPACING, height, variance));
+	EXPECT_TRUE(dem.getTerrainHeight(LAT_MIN + 4.5 * SPACING, LON_MIN + 4.5 * SPACING, height, variance));
+	EXPECT_NEAR(height, 400.0 + 10.0 * 4.5 - 3.0 * 4.5, 1e-3);
+	EXPECT_EQ(dem.getTileLoadCount(), 4u);
+}
+
+TEST_F(TerrainDemTest, residentTilesAreBounded)
+{
+	// GIVEN: a cache of two tiles
+	ASSERT_TRUE(writeFile());
+	TerrainDemCache dem(2);
+	ASSERT_TRUE(dem.open(_file_name));
+
+	float height = 0.f;
+	float variance = 0.f;
+	auto query_tile = [&](uint32_t tile_row, uint32_t tile_col) {
+		return getHeight(dem, LAT_MIN + (tile_row * 4 + 1) * SPACING, LON_MIN + (tile_col * 4 + 1) * SPACING,
+				 height, variance);
+	};
+
+	// WHEN: the south-west corner of the first tile is used
+	// THEN: it has no neighbours to prefetch
+	EXPECT_TRUE(query_tile(0, 0));
+	EXPECT_EQ(dem.getResidentTileCount(), 1u);
+	EXPECT_EQ(dem.getTileLoadCount(), 1u);
+
+	// WHEN: the south-west corner of the last tile is used
+	// THEN: it and its western neighbour replace the first tile
+	EXPECT_TRUE(query_tile(1, 2));
+	EXPECT_EQ(dem.getResidentTileCount(), 2u);
+	EXPECT_EQ(dem.getTileLoadCount(), 3u);
+
+	// WHEN: going back to the first tile
+	// THEN: the least recently used tile is replaced
+	EXPECT_TRUE(query_tile(0, 0));
+	EXPECT_EQ(dem.getResidentTileCount(), 2u);
+	EXPECT_EQ(dem.getTileLoadCount(), 4u);
+
+	// WHEN: going back to the last tile, which is still resident
+	// THEN: it is used right away and its neighbour is loaded again
+	EXPECT_TRUE(query_tile(1, 2));
+	dem.waitForTiles();
+	EXPECT_EQ(dem.getTileLoadCount(), 5u);
+	EXPECT_EQ(dem.getResidentTileCount(), 2u);
+
+	// WHEN: the file is closed
+	dem.close();
+
+	// THEN: all tiles are unmapped
+	EXPECT_EQ(dem.getResidentTileCount(), 0u);
+	EXPECT_FALSE(dem.getTerrainHeight(LAT_MIN, LON_MIN, height, variance));
+}
+
+TEST_F(TerrainDemTest, invalidFile)
+{
+	TerrainDemCache dem;
+	EXPECT_FALSE(dem.open("terrain_dem_missing.ecld"));
+	EXPECT_FALSE(dem.isOpen());
+
+	// a file that is not a DEM
+	FILE *file = fopen(_file_name, "wb");
+	ASSERT_NE(file, nullptr);
+	fputs("not a terrain model", file);
+	fclose(file);
+	EXPECT_FALSE(dem.open(_file_name));
+}
+
+TEST_F(TerrainDemTest, truncatedFile)
+{
+	// GIVEN: a DEM file that ends in the middle of its last tile
+	ASSERT_TRUE(writeFile());
+	std::vector<char> contents(1 << 16);
+	FILE *file = fopen(_file_name, "rb");
+	ASSERT_NE(file, nullptr);
+	const size_t file_size = fread(contents.data(), 1, contents.size(), file);
+	fclose(file);
+
+	file = fopen(_file_name, "wb");
+	ASSERT_NE(file, nullptr);
+	ASSERT_EQ(fwrite(contents.data(), 1, file_size - 10, file), file_size - 10);
+	fclose(file);
+
+	TerrainDemCache dem;
+	ASSERT_TRUE(dem.open(_file_name));
+
+	// THEN: the complete tiles can be used, the truncated one is not mapped
+	float height = 0.f;
+	float variance = 0.f;
+	EXPECT_TRUE(getHeight(dem, LAT_MIN + SPACING, LON_MIN + SPACING, height, variance));
+	EXPECT_FALSE(getHeight(dem, LAT_MIN + 5 * SPACING, LON_MIN + 9 * SPACING, height, variance));
+	EXPECT_TRUE(getHeight(dem, LAT_MIN + 5 * SPACING, LON_MIN + 7 * SPACING, height, variance));
+	EXPECT_EQ(dem.getTileLoadCount(), 4u);
+
+	// WHEN: the file is too short for its tile table
+	file = fopen(_file_name, "wb");
+	ASSERT_NE(file, nullptr);
+	ASSERT_EQ(fwrite(contents.data(), 1, sizeof(terrain_dem_header) + 8, file), sizeof(terrain_dem_header) + 8);
+	fclose(file);
+
+	// THEN: it is rejected
+	EXPECT_FALSE(dem.open(_file_name));
+	EXPECT_FALSE(dem.isOpen());
+}